@@ -3,10 +3,12 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
 #include <string_view>
-#include <algorithm>
-#include <numeric>
 #include "pico/printf.h"
+#include "Command_Registry.hpp"
+#include "Command_Limits.hpp"
+#include "Command_Schema.hpp"
 #include "variable_array.hpp"
 
 enum struct Command_Result
@@ -16,116 +18,147 @@ enum struct Command_Result
     ARG_INVALID
 };
 
-template <size_t ARG_LENGTH, size_t ARG_MAX_COUNT>
+/* Where a word sits in the line it was typed on */
+struct Command_Token
+{
+    uint8_t offset;
+    uint8_t length;
+};
+
+/* A command doesn't hold its words, only where they are in the line.  The line stays where the line provider put
+ * it until the command has been handled, so the views name() and argument() hand out are good until then. */
+template <size_t ARG_MAX_COUNT>
 struct Command_T
 {
 public:
-    // using arg_type = std::array<char, ARG_LENGTH>;
-    using arg_type = embp::variable_array<char, ARG_LENGTH>;
-    embp::variable_array<char, ARG_LENGTH> name;
-    embp::variable_array<arg_type, ARG_MAX_COUNT> arguments;
+    std::string_view line;
+    Command_Token name_token{};
+    embp::variable_array<Command_Token, ARG_MAX_COUNT> argument_tokens;
+    // the line had more words than argument_tokens has room for
+    bool too_many_arguments{false};
+
+    [[nodiscard]] constexpr std::string_view name() const noexcept
+    {
+        return word(name_token);
+    }
+    [[nodiscard]] constexpr std::string_view argument(size_t index) const noexcept
+    {
+        return word(argument_tokens[index]);
+    }
+    [[nodiscard]] constexpr size_t argument_count() const noexcept
+    {
+        return std::size(argument_tokens);
+    }
+
+private:
+    [[nodiscard]] constexpr std::string_view word(Command_Token token) const noexcept
+    {
+        return line.substr(token.offset, token.length);
+    }
 };
 
-using Command = Command_T<16, 16>;
+/* A command less its first argument, for commands where that word picks the schema for the rest (`set hsv ...`);
+ * name() is what the usage calls it. */
+template <class Parent>
+struct Subcommand
+{
+public:
+    constexpr Subcommand(const Parent &parent, std::string_view name) noexcept
+        : too_many_arguments{parent.too_many_arguments}, m_parent{parent}, m_name{name}
+    {
+    }
+
+    bool too_many_arguments;
+
+    [[nodiscard]] constexpr std::string_view name() const noexcept
+    {
+        return m_name;
+    }
+    [[nodiscard]] constexpr std::string_view argument(size_t index) const noexcept
+    {
+        return m_parent.argument(index + 1);
+    }
+    [[nodiscard]] constexpr size_t argument_count() const noexcept
+    {
+        return m_parent.argument_count() - 1;
+    }
+
+private:
+    const Parent &m_parent;
+    std::string_view m_name;
+};
+
+// room for the longest argument list any command's schema accepts, and no more
+using Command = Command_T<command_limits::MAX_ARGUMENTS>;
 using Command_Handler = Command_Result (*)(const Command &);
 
 extern Command_Result help_fn(const Command &);
 extern Command_Result set_fn(const Command &);
 extern Command_Result pattern_fn(const Command &);
 extern Command_Result clock_fn(const Command &);
+extern Command_Result stats_fn(const Command &);
+extern Command_Result stream_fn(const Command &);
+extern Command_Result power_fn(const Command &);
+extern Command_Result dither_fn(const Command &);
+extern Command_Result brightness_fn(const Command &);
+extern Command_Result gamma_fn(const Command &);
+
+struct Command_Entry
+{
+    std::string_view name;
+    Command_Handler handler;
+    std::string_view help;
+};
 
-inline constexpr std::array BASECMDS{
-    std::string_view{"help"},
-    std::string_view{"set"},
-    std::string_view{"pattern"},
-    std::string_view{"clock"}};
-inline constexpr std::array CMDHANDLES{
-    Command_Handler{help_fn},
-    Command_Handler{set_fn},
-    Command_Handler{pattern_fn},
-    Command_Handler{clock_fn}};
-
-constexpr Command_Handler lookup_fn(const auto &name, Command_Result &status)
+/* Every command the shell knows, declared once: name, handler and one line for `help` */
+inline constexpr command_registry::Registry COMMANDS{std::array{
+    Command_Entry{"help", help_fn, "list the commands"},
+    Command_Entry{"set", set_fn, "set one pixel, or all of them"},
+    Command_Entry{"pattern", pattern_fn, "run a preset pattern in the background, or stop it"},
+    Command_Entry{"clock", clock_fn, "run as a clock"},
+    Command_Entry{"stats", stats_fn, "frame output counters"},
+    Command_Entry{"stream", stream_fn, "take binary frames until the host ends the stream"},
+    Command_Entry{"power", power_fn, "show or set the power budget frames are dimmed to"},
+    Command_Entry{"dither", dither_fn, "show, or turn on or off, 16-bit patterns dithered down to the strip"},
+    Command_Entry{"brightness", brightness_fn, "show or set the brightness and white balance frames are sent at"},
+    Command_Entry{"gamma", gamma_fn, "show or set the gamma curve frames are sent through"}}};
+
+[[nodiscard]] constexpr Command_Result handle(const Command_Entry &entry, const Command &cmd) noexcept
 {
-    status = Command_Result::SUCCESS;
-    const auto itr{std::find(std::begin(BASECMDS), std::end(BASECMDS), std::begin(name))};
-    if (itr == std::end(BASECMDS))
-    {
-        status = Command_Result::COMMAND_NOT_FOUND;
-        return {};
-    }
-    return *std::next(std::begin(CMDHANDLES), std::distance(std::begin(BASECMDS), itr));
+    return entry.handler(cmd);
 }
 
-[[nodiscard]] constexpr bool check_command_is_valid(const Command &cmd)
+[[nodiscard]] constexpr Command_Result handle(const Command &cmd) noexcept
 {
-    auto start = std::begin(cmd.name);
-    const auto finish = std::end(cmd.name);
-
-    // we check each one character at a time across all possibilities
-    // we keep track of which commands are not a match, and skip any additionaly processing if it has already failed
-    // if this command possibility hasn't failed, it will fail if any are true:
-    //  1. the length of the input pattern and the length of the command are not the same
-    //  2. the charater in the input pattern does not match the letter in the command
-    const size_t word_dis{static_cast<size_t>(std::distance(start, finish))};
-
-    std::array<bool, std::size(BASECMDS)> failed{};
-
-    // check word size
-    for (size_t cmdidx{0}; cmdidx < std::size(BASECMDS); ++cmdidx)
-    {
-        const auto &command_possibility{BASECMDS[cmdidx]};
-        if (word_dis != std::size(command_possibility))
-        {
-            failed[cmdidx] = true;
-        }
-    }
-
-    // check string equality
-    constexpr auto LONGEST_C0MMAND{[]
-                                   {
-                                       return std::transform_reduce(
-                                           std::begin(BASECMDS), std::end(BASECMDS), size_t{0},
-                                           [](auto init, auto val)
-                                           { return std::max(init, val); },
-                                           [](auto str)
-                                           { return std::size(str); });
-                                   }()};
-
-    for (size_t charidx{0}; charidx < LONGEST_C0MMAND; ++charidx, ++start)
+    const auto *entry{COMMANDS.find(cmd.name())};
+    if (entry == nullptr)
     {
-        for (size_t cmdidx{0}; cmdidx < std::size(BASECMDS); ++cmdidx)
-        {
-            if (failed[cmdidx])
-            {
-                continue;
-            }
-            const auto &command_possibility{BASECMDS[cmdidx]};
-            if (!(charidx < std::size(command_possibility)))
-            {
-                continue;
-            }
-            if (*start != command_possibility[charidx])
-            {
-                failed[cmdidx] = true;
-                continue;
-            }
-        }
+        return Command_Result::COMMAND_NOT_FOUND;
     }
-
-    return !std::all_of(std::begin(failed), std::end(failed), [](auto val)
-                        { return val; });
+    return handle(*entry, cmd);
 }
 
-[[nodiscard]] constexpr Command_Result handle(const Command &cmd) noexcept
+/**
+ * @brief run `handler` with the arguments of `cmd` (a Command, or a Subcommand of one) as `schema` converts them.
+ *  "help" and arguments that don't fit the schema get the usage instead.
+ */
+template <class Schema, class Handler>
+Command_Result handle_with(const auto &cmd, const Schema &schema, Handler &&handler)
 {
-    Command_Result status{Command_Result::SUCCESS};
-    auto &&fn{lookup_fn(cmd.name, status)};
-    if (status != Command_Result::SUCCESS)
+    const auto parsed{schema.parse(cmd)};
+    switch (parsed.status)
     {
-        return status;
+    case command_schema::Parse_Status::SUCCESS:
+        return handler(parsed.args);
+    case command_schema::Parse_Status::HELP_REQUESTED:
+        schema.print_usage(cmd.name());
+        return Command_Result::SUCCESS;
+    case command_schema::Parse_Status::WRONG_ARGUMENT_COUNT:
+    case command_schema::Parse_Status::ARGUMENT_INVALID:
+        break;
     }
-    return fn(cmd);
+    schema.print_usage(cmd.name());
+    return Command_Result::ARG_INVALID;
 }
 
 template <class Console>
@@ -157,20 +190,20 @@ public:
             return;
         }
 
-        const Command next_cmd{get_next_command(m_commander)};
+        // handled where it sits, and only then let go of
+        const Command &next_cmd{next_command(m_commander)};
 
-        if (!check_command_is_valid(next_cmd))
+        // finding it is also what checks it
+        const auto *entry{COMMANDS.find(next_cmd.name())};
+        if (entry == nullptr)
         {
             print_error(m_log, "Not a valid command.\n");
-            print(m_log, m_console);
-            return;
         }
-
-        const auto status{handle(next_cmd)};
-        if (status != Command_Result::SUCCESS)
+        else if (const auto status{handle(*entry, next_cmd)}; status != Command_Result::SUCCESS)
         {
             print_error(m_log, status);
         }
+        pop_command(m_commander);
         print(m_log, m_console);
     }
 
@@ -0,0 +1,14 @@
+#if !defined(COMMAND_LIMITS_HPP)
+#define COMMAND_LIMITS_HPP
+
+#include <cstddef>
+
+/* How big a Command is, apart from the schemas that decide it, so the shell core needn't depend on what the
+ * commands drive.  commands/arguments.hpp checks this against its schemas. */
+namespace command_limits
+{
+    // the most arguments any command takes: `set` and `set hsv`, five each
+    inline constexpr size_t MAX_ARGUMENTS{5};
+}
+
+#endif
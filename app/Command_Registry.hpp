@@ -0,0 +1,189 @@
+#if !defined(COMMAND_REGISTRY_HPP)
+#define COMMAND_REGISTRY_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/* A fixed set of named entries with a perfect hash built for them at compile time.
+ *
+ * Hash and displace: each name's FNV-1a hash picks a bucket, and each bucket has a displacement, found here, that
+ * scatters its names into slots no other name uses.  find() is therefore one hash of the name, two table reads and
+ * one string compare, however many entries there are; the compare is also what rejects unknown names. */
+namespace command_registry
+{
+    namespace detail
+    {
+        [[nodiscard]] constexpr uint32_t fnv1a(std::string_view name) noexcept
+        {
+            uint32_t hash{2166136261U};
+            for (const char c : name)
+            {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= 16777619U;
+            }
+            return hash;
+        }
+
+        // deliberately not constexpr: reaching it stops the build, with its name in the diagnostic
+        void no_perfect_hash_found_is_a_name_registered_twice();
+    }
+
+    template <class Entry, size_t N>
+        requires(N > 0 && N < 255)
+    class Registry
+    {
+    public:
+        using entry_type = Entry;
+        static constexpr size_t SLOTS{std::bit_ceil(N) * 2};
+        static constexpr size_t BUCKETS{std::max<size_t>(std::bit_ceil(N) / 4, 1)};
+
+        consteval explicit Registry(const std::array<Entry, N> &entries) : m_entries{entries}
+        {
+            std::array<uint32_t, N> hashes{};
+            std::array<size_t, BUCKETS> bucket_sizes{};
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                hashes[ii] = detail::fnv1a(m_entries[ii].name);
+                ++bucket_sizes[bucket_of(hashes[ii])];
+            }
+            m_slots.fill(EMPTY);
+
+            // fullest bucket first, while there is the most room
+            std::array<bool, BUCKETS> placed{};
+            for (size_t round{0}; round < BUCKETS; ++round)
+            {
+                size_t bucket{0};
+                for (size_t bb{0}; bb < BUCKETS; ++bb)
+                {
+                    if (!placed[bb] && (placed[bucket] || bucket_sizes[bb] > bucket_sizes[bucket]))
+                    {
+                        bucket = bb;
+                    }
+                }
+                placed[bucket] = true;
+                if (bucket_sizes[bucket] != 0 && !place_bucket(bucket, hashes))
+                {
+                    detail::no_perfect_hash_found_is_a_name_registered_twice();
+                }
+            }
+        }
+
+        /**
+         * @brief the entry registered as `name`, or nullptr if there isn't one
+         */
+        [[nodiscard]] constexpr const Entry *find(std::string_view name) const noexcept
+        {
+            const auto hash{detail::fnv1a(name)};
+            const auto index{m_slots[slot_of(hash, m_displacements[bucket_of(hash)])]};
+            if (index == EMPTY || m_entries[index].name != name)
+            {
+                return nullptr;
+            }
+            return &m_entries[index];
+        }
+
+        /* in the order they were registered */
+        [[nodiscard]] constexpr std::span<const Entry, N> entries() const noexcept
+        {
+            return m_entries;
+        }
+
+    private:
+        static constexpr uint8_t EMPTY{0xFF};
+        static constexpr uint32_t SLOT_SHIFT{32U - static_cast<uint32_t>(std::countr_zero(SLOTS))};
+
+        std::array<Entry, N> m_entries;
+        std::array<uint16_t, BUCKETS> m_displacements{};
+        std::array<uint8_t, SLOTS> m_slots{};
+
+        [[nodiscard]] static constexpr size_t bucket_of(uint32_t hash) noexcept
+        {
+            return hash & (BUCKETS - 1);
+        }
+        [[nodiscard]] static constexpr size_t slot_of(uint32_t hash, uint16_t displacement) noexcept
+        {
+            return static_cast<uint32_t>((hash ^ (displacement * 0x9E3779B9U)) * 0x85EBCA6BU) >> SLOT_SHIFT;
+        }
+
+        /* the first displacement that puts every name in `bucket` into a slot of its own */
+        consteval bool place_bucket(size_t bucket, const std::array<uint32_t, N> &hashes)
+        {
+            for (uint32_t displacement{0}; displacement <= UINT16_MAX; ++displacement)
+            {
+                auto slots{m_slots};
+                bool fits{true};
+                for (size_t ii{0}; ii < N && fits; ++ii)
+                {
+                    if (bucket_of(hashes[ii]) != bucket)
+                    {
+                        continue;
+                    }
+                    auto &slot{slots[slot_of(hashes[ii], static_cast<uint16_t>(displacement))]};
+                    fits = slot == EMPTY;
+                    slot = static_cast<uint8_t>(ii);
+                }
+                if (fits)
+                {
+                    m_slots = slots;
+                    m_displacements[bucket] = static_cast<uint16_t>(displacement);
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+}
+
+namespace tests
+{
+    struct Test_Entry
+    {
+        std::string_view name;
+        int value;
+    };
+
+    [[nodiscard]] constexpr bool run_command_registry_tests()
+    {
+        bool rv{true};
+
+        constexpr command_registry::Registry dut{std::array{
+            Test_Entry{"help", 0},
+            Test_Entry{"set", 1},
+            Test_Entry{"pattern", 2},
+            Test_Entry{"clock", 3},
+            Test_Entry{"stats", 4},
+            Test_Entry{"sat", 5},
+            Test_Entry{"s", 6},
+            Test_Entry{"", 7}}};
+
+        // =========================================
+        // every name finds its own entry
+        for (const auto &entry : dut.entries())
+        {
+            const auto *found{dut.find(entry.name)};
+            rv &= found != nullptr && found->value == entry.value;
+        }
+
+        // =========================================
+        // near misses don't
+        rv &= dut.find("sets") == nullptr;
+        rv &= dut.find("se") == nullptr;
+        rv &= dut.find("Set") == nullptr;
+        rv &= dut.find("patterns") == nullptr;
+        rv &= dut.find("t") == nullptr;
+
+        // =========================================
+        rv &= std::size(dut.entries()) == 8;
+        rv &= dut.entries()[2].name == "pattern";
+
+        return rv;
+    }
+    static_assert(run_command_registry_tests());
+}
+
+#endif
@@ -0,0 +1,459 @@
+#if !defined(COMMAND_SCHEMA_HPP)
+#define COMMAND_SCHEMA_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "pico/printf.h"
+#include "Command_Registry.hpp"
+
+/* A command's arguments, declared once as typed parameters; the parser, the validation and the usage text all
+ * come from the declaration.
+ *
+ *   struct Set_Args { uint8_t white; ...; std::optional<size_t> index; };
+ *   inline constexpr auto SET{command_schema::schema<Set_Args>(
+ *       command_schema::U8{"WHITE"}, ..., command_schema::Optional{command_schema::Index{"INDEX", LED_COUNT}})};
+ *
+ * Parameters fill the struct's members in order.  Optional parameters can only come last.  A lone "help" argument
+ * is understood by every schema. */
+namespace command_schema
+{
+    namespace detail
+    {
+        /* decimal only, all of `word`, nothing out of range */
+        template <class T>
+        [[nodiscard]] constexpr std::optional<T> parse_unsigned(std::string_view word) noexcept
+        {
+            if (std::empty(word))
+            {
+                return std::nullopt;
+            }
+            T value{0};
+            for (const char c : word)
+            {
+                if (c < '0' || c > '9')
+                {
+                    return std::nullopt;
+                }
+                const auto digit{static_cast<T>(c - '0')};
+                if (value > (std::numeric_limits<T>::max() - digit) / 10)
+                {
+                    return std::nullopt;
+                }
+                value = static_cast<T>(value * 10 + digit);
+            }
+            return value;
+        }
+
+        inline void print_word(std::string_view word) noexcept
+        {
+            printf("%.*s", static_cast<int>(std::size(word)), std::data(word));
+        }
+    }
+
+    /* 0 to 255 */
+    struct U8
+    {
+        using value_type = uint8_t;
+        std::string_view name;
+
+        [[nodiscard]] constexpr std::optional<value_type> parse(std::string_view word) const noexcept
+        {
+            return detail::parse_unsigned<uint8_t>(word);
+        }
+        void print_values() const noexcept
+        {
+            printf("0 to 255");
+        }
+    };
+
+    /* 0 to count - 1 */
+    struct Index
+    {
+        using value_type = size_t;
+        std::string_view name;
+        size_t count;
+
+        [[nodiscard]] constexpr std::optional<value_type> parse(std::string_view word) const noexcept
+        {
+            const auto value{detail::parse_unsigned<size_t>(word)};
+            if (!value.has_value() || *value >= count)
+            {
+                return std::nullopt;
+            }
+            return value;
+        }
+        void print_values() const noexcept
+        {
+            printf("0 to %u", static_cast<unsigned>(count - 1));
+        }
+    };
+
+    /* min to max */
+    struct Range
+    {
+        using value_type = uint32_t;
+        std::string_view name;
+        uint32_t min;
+        uint32_t max;
+
+        [[nodiscard]] constexpr std::optional<value_type> parse(std::string_view word) const noexcept
+        {
+            const auto value{detail::parse_unsigned<uint32_t>(word)};
+            if (!value.has_value() || *value < min || *value > max)
+            {
+                return std::nullopt;
+            }
+            return value;
+        }
+        void print_values() const noexcept
+        {
+            printf("%lu to %lu", static_cast<unsigned long>(min), static_cast<unsigned long>(max));
+        }
+    };
+
+    /* one of a fixed set of words, each standing for an enumerator */
+    template <class Enum, size_t N>
+        requires std::is_enum_v<Enum>
+    struct Keyword
+    {
+        using value_type = Enum;
+        std::string_view name;
+        std::array<std::pair<std::string_view, Enum>, N> words;
+
+        [[nodiscard]] constexpr std::optional<value_type> parse(std::string_view word) const noexcept
+        {
+            for (const auto &[keyword, value] : words)
+            {
+                if (keyword == word)
+                {
+                    return value;
+                }
+            }
+            return std::nullopt;
+        }
+        void print_values() const noexcept
+        {
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                printf("%s", ii == 0 ? "" : " | ");
+                detail::print_word(words[ii].first);
+            }
+        }
+    };
+    template <class Enum, size_t N>
+    Keyword(std::string_view, std::array<std::pair<std::string_view, Enum>, N>) -> Keyword<Enum, N>;
+
+    /* the name of one of a command_registry::Registry's entries; the member points at the entry */
+    template <class Registry>
+    struct Entry_Of
+    {
+        using value_type = const typename Registry::entry_type *;
+        std::string_view name;
+        const Registry *registry;
+
+        [[nodiscard]] constexpr std::optional<value_type> parse(std::string_view word) const noexcept
+        {
+            const auto *entry{registry->find(word)};
+            if (entry == nullptr)
+            {
+                return std::nullopt;
+            }
+            return entry;
+        }
+        void print_values() const noexcept
+        {
+            const auto entries{registry->entries()};
+            for (size_t ii{0}; ii < std::size(entries); ++ii)
+            {
+                printf("%s", ii == 0 ? "" : " | ");
+                detail::print_word(entries[ii].name);
+            }
+        }
+    };
+
+    /* may be left off the end of the command; the member is a std::optional */
+    template <class Param>
+    struct Optional
+    {
+        using value_type = std::optional<typename Param::value_type>;
+        Param param;
+
+        [[nodiscard]] constexpr std::optional<value_type> parse(std::string_view word) const noexcept
+        {
+            const auto value{param.parse(word)};
+            if (!value.has_value())
+            {
+                return std::nullopt;
+            }
+            return value_type{*value};
+        }
+        [[nodiscard]] constexpr std::string_view name_of() const noexcept
+        {
+            return param.name;
+        }
+        void print_values() const noexcept
+        {
+            param.print_values();
+        }
+    };
+
+    template <class Param>
+    inline constexpr bool is_optional{false};
+    template <class Param>
+    inline constexpr bool is_optional<Optional<Param>>{true};
+
+    template <class Param>
+    [[nodiscard]] constexpr std::string_view name_of(const Param &param) noexcept
+    {
+        if constexpr (is_optional<Param>)
+        {
+            return param.name_of();
+        }
+        else
+        {
+            return param.name;
+        }
+    }
+
+    enum struct Parse_Status
+    {
+        SUCCESS,
+        HELP_REQUESTED,
+        WRONG_ARGUMENT_COUNT,
+        ARGUMENT_INVALID
+    };
+
+    template <class Args>
+    struct Parsed
+    {
+        Parse_Status status;
+        Args args{};
+    };
+
+    template <class Args, class... Params>
+    class Schema
+    {
+    public:
+        static constexpr size_t MAX_ARGUMENTS{sizeof...(Params)};
+        static constexpr size_t MIN_ARGUMENTS{(size_t{0} + ... + size_t{!is_optional<Params>})};
+        static_assert([]
+                      {
+                          constexpr std::array<bool, sizeof...(Params) + 1> optional{is_optional<Params>..., true};
+                          for (size_t ii{0}; ii < MIN_ARGUMENTS; ++ii)
+                          {
+                              if (optional[ii])
+                              {
+                                  return false;
+                              }
+                          }
+                          return true;
+                      }(),
+                      "optional parameters must come after all the others");
+
+        constexpr explicit Schema(Params... params) noexcept : m_params{params...} {}
+
+        /**
+         * @brief check and convert the arguments of `cmd`; anything with argument_count(), argument() and
+         *  too_many_arguments will do
+         */
+        [[nodiscard]] constexpr Parsed<Args> parse(const auto &cmd) const noexcept
+        {
+            const auto count{cmd.argument_count()};
+            if (count == 1 && cmd.argument(0) == "help")
+            {
+                return {Parse_Status::HELP_REQUESTED};
+            }
+            if (cmd.too_many_arguments || count < MIN_ARGUMENTS || count > MAX_ARGUMENTS)
+            {
+                return {Parse_Status::WRONG_ARGUMENT_COUNT};
+            }
+            return parse_each(cmd, std::index_sequence_for<Params...>{});
+        }
+
+        void print_usage(std::string_view command) const noexcept
+        {
+            printf("Usage:\n  ");
+            detail::print_word(command);
+            std::apply([](const auto &...params)
+                       { (print_placeholder(params), ...); },
+                       m_params);
+            printf("\n  ");
+            detail::print_word(command);
+            printf(" help\n");
+            std::apply([](const auto &...params)
+                       { (print_values(params), ...); },
+                       m_params);
+        }
+
+    private:
+        std::tuple<Params...> m_params;
+
+        template <size_t... I>
+        [[nodiscard]] constexpr Parsed<Args> parse_each(const auto &cmd, std::index_sequence<I...>) const noexcept
+        {
+            std::tuple<typename Params::value_type...> values{};
+            const bool valid{(parse_one<I>(cmd, std::get<I>(values)) && ...)};
+            if (!valid)
+            {
+                return {Parse_Status::ARGUMENT_INVALID};
+            }
+            return {Parse_Status::SUCCESS, Args{std::get<I>(values)...}};
+        }
+
+        template <size_t I>
+        [[nodiscard]] constexpr bool parse_one(const auto &cmd, auto &value) const noexcept
+        {
+            // only optional parameters can be missing, by the count check
+            if (I >= cmd.argument_count())
+            {
+                return true;
+            }
+            const auto parsed{std::get<I>(m_params).parse(cmd.argument(I))};
+            if (parsed.has_value())
+            {
+                value = *parsed;
+            }
+            return parsed.has_value();
+        }
+
+        template <class Param>
+        static void print_placeholder(const Param &param) noexcept
+        {
+            printf("%s", is_optional<Param> ? " [" : " ");
+            detail::print_word(name_of(param));
+            printf("%s", is_optional<Param> ? "]" : "");
+        }
+        template <class Param>
+        static void print_values(const Param &param) noexcept
+        {
+            printf("    %-8.*s ", static_cast<int>(std::size(name_of(param))), std::data(name_of(param)));
+            param.print_values();
+            printf("\n");
+        }
+    };
+
+    /* Schema<Args, Params...>, with Params deduced */
+    template <class Args, class... Params>
+    [[nodiscard]] constexpr Schema<Args, Params...> schema(Params... params) noexcept
+    {
+        return Schema<Args, Params...>{params...};
+    }
+
+    /* the most arguments any of the schemas takes, which is all a Command needs room for */
+    template <class... Schemas>
+    inline constexpr size_t MAX_ARGUMENTS_OF{std::max({size_t{1}, Schemas::MAX_ARGUMENTS...})};
+}
+
+namespace tests
+{
+    struct Fake_Args_Command
+    {
+        std::array<std::string_view, 4> words;
+        size_t count;
+        bool too_many_arguments{false};
+
+        [[nodiscard]] constexpr size_t argument_count() const noexcept { return count; }
+        [[nodiscard]] constexpr std::string_view argument(size_t index) const noexcept { return words[index]; }
+    };
+
+    enum struct Test_Mode
+    {
+        ON,
+        OFF
+    };
+
+    struct Test_Args
+    {
+        uint8_t level;
+        Test_Mode mode;
+        std::optional<size_t> index;
+    };
+
+    struct Test_Named
+    {
+        std::string_view name;
+        int value;
+    };
+    inline constexpr command_registry::Registry TEST_NAMED{std::array{Test_Named{"one", 1}, Test_Named{"two", 2}}};
+
+    struct Test_Entry_Args
+    {
+        const Test_Named *named;
+    };
+
+    struct Test_Range_Args
+    {
+        uint32_t rate;
+    };
+
+    [[nodiscard]] constexpr bool run_command_schema_tests()
+    {
+        using namespace command_schema;
+        bool rv{true};
+
+        constexpr auto dut{schema<Test_Args>(
+            U8{"LEVEL"},
+            Keyword{"MODE", std::array{std::pair{std::string_view{"on"}, Test_Mode::ON}, std::pair{std::string_view{"off"}, Test_Mode::OFF}}},
+            Optional{Index{"INDEX", 24}})};
+        static_assert(decltype(dut)::MIN_ARGUMENTS == 2);
+        static_assert(decltype(dut)::MAX_ARGUMENTS == 3);
+        static_assert(MAX_ARGUMENTS_OF<decltype(dut), Schema<Test_Args>> == 3);
+
+        // =========================================
+        // every parameter, typed
+        auto parsed{dut.parse(Fake_Args_Command{{"200", "off", "23"}, 3})};
+        rv &= parsed.status == Parse_Status::SUCCESS;
+        rv &= parsed.args.level == 200;
+        rv &= parsed.args.mode == Test_Mode::OFF;
+        rv &= parsed.args.index == 23U;
+
+        // the optional one left off
+        parsed = dut.parse(Fake_Args_Command{{"0", "on"}, 2});
+        rv &= parsed.status == Parse_Status::SUCCESS;
+        rv &= parsed.args.mode == Test_Mode::ON;
+        rv &= !parsed.args.index.has_value();
+
+        // =========================================
+        // out of range, not a number, not a keyword
+        rv &= dut.parse(Fake_Args_Command{{"256", "on"}, 2}).status == Parse_Status::ARGUMENT_INVALID;
+        rv &= dut.parse(Fake_Args_Command{{"12x", "on"}, 2}).status == Parse_Status::ARGUMENT_INVALID;
+        rv &= dut.parse(Fake_Args_Command{{"", "on"}, 2}).status == Parse_Status::ARGUMENT_INVALID;
+        rv &= dut.parse(Fake_Args_Command{{"1", "maybe"}, 2}).status == Parse_Status::ARGUMENT_INVALID;
+        rv &= dut.parse(Fake_Args_Command{{"1", "on", "24"}, 3}).status == Parse_Status::ARGUMENT_INVALID;
+
+        // =========================================
+        // counts, including words the command had no room for
+        rv &= dut.parse(Fake_Args_Command{{"1"}, 1}).status == Parse_Status::WRONG_ARGUMENT_COUNT;
+        rv &= dut.parse(Fake_Args_Command{{"1", "on", "2", "3"}, 4}).status == Parse_Status::WRONG_ARGUMENT_COUNT;
+        rv &= dut.parse(Fake_Args_Command{{"1", "on", "2"}, 3, true}).status == Parse_Status::WRONG_ARGUMENT_COUNT;
+        rv &= dut.parse(Fake_Args_Command{{"help"}, 1}).status == Parse_Status::HELP_REQUESTED;
+
+        // =========================================
+        // a registry's names
+        constexpr auto named{schema<Test_Entry_Args>(Entry_Of{"NAME", &TEST_NAMED})};
+        const auto found{named.parse(Fake_Args_Command{{"two"}, 1})};
+        rv &= found.status == Parse_Status::SUCCESS && found.args.named->value == 2;
+        rv &= named.parse(Fake_Args_Command{{"three"}, 1}).status == Parse_Status::ARGUMENT_INVALID;
+
+        // =========================================
+        // ranges include both ends
+        constexpr auto ranged{schema<Test_Range_Args>(Range{"RATE", 1, 200})};
+        rv &= ranged.parse(Fake_Args_Command{{"1"}, 1}).args.rate == 1;
+        rv &= ranged.parse(Fake_Args_Command{{"200"}, 1}).args.rate == 200;
+        rv &= ranged.parse(Fake_Args_Command{{"0"}, 1}).status == Parse_Status::ARGUMENT_INVALID;
+        rv &= ranged.parse(Fake_Args_Command{{"201"}, 1}).status == Parse_Status::ARGUMENT_INVALID;
+
+        return rv;
+    }
+    static_assert(run_command_schema_tests());
+}
+
+#endif
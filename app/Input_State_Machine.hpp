@@ -8,165 +8,368 @@
 
 #include <numeric>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
 #include <utility>
 
 #include "pico/stdio.h"
+#include "hardware/sync.h"
 
 #include "Ring_Buffer.hpp"
 #include "Command.hpp"
 #include "variable_array.hpp"
-#include "pico_panic.hpp"
 
-template <class LineProvider, class Logger>
+/* Turns the line at the front of the line provider into a Command where it sits: the Command only records where
+ * the words are, and the line is held until the command has been popped. */
+template <class LineProvider>
 class CommandBuilder_SM
 {
 public:
-    constexpr CommandBuilder_SM(LineProvider &obj, Logger &log) noexcept : m_read_line_fn{obj}, m_logger{log} {}
+    constexpr explicit CommandBuilder_SM(LineProvider &obj) noexcept : m_read_line_fn{obj} {}
 
     constexpr void update() noexcept
     {
-        if (!available(m_read_line_fn))
+        if (m_parsed || !available(m_read_line_fn))
         {
             return;
         }
-        const auto new_line{get_next_line(m_read_line_fn)};
-        auto search_itr{std::begin(new_line)};
+        const auto &new_line{front_line(m_read_line_fn)};
+        m_cmd.line = std::string_view{std::data(new_line), std::size(new_line)};
+        m_cmd.argument_tokens.clear();
+        m_cmd.too_many_arguments = false;
 
-        const auto [word_start, word_finish]{parse_word(new_line, search_itr)};
-        add_name_to_command(word_start, word_finish);
-
-        while (search_itr != std::end(new_line))
+        size_t search{0};
+        m_cmd.name_token = parse_word(m_cmd.line, search);
+        while (search != std::size(m_cmd.line))
         {
-            const auto [word_start, word_finish]{parse_word(new_line, search_itr)};
-            add_arg_to_command(word_start, word_finish);
+            const auto token{parse_word(m_cmd.line, search)};
+            if (std::size(m_cmd.argument_tokens) == m_cmd.argument_tokens.capacity())
+            {
+                m_cmd.too_many_arguments = true;
+                break;
+            }
+            m_cmd.argument_tokens.push_back(token);
         }
-
-        enqueue_command();
+        m_parsed = true;
     }
 
     [[nodiscard]] constexpr bool command_available() const noexcept
     {
-        return !m_cmd_buffer.empty();
+        return m_parsed;
     }
 
-    [[nodiscard]] constexpr Command get_next_command() noexcept
+    /**
+     * @brief the oldest command, valid until pop_command(). Behaviour undefined if none is available.
+     */
+    [[nodiscard]] constexpr const Command &next_command() const noexcept
+    {
+        return m_cmd;
+    }
+    constexpr void pop_command() noexcept
     {
-        const auto tmp{m_cmd_buffer.dequeue()};
-        return tmp;
+        m_parsed = false;
+        pop_line(m_read_line_fn);
     }
 
 private:
     LineProvider &m_read_line_fn;
-    Fixed_Log2_Ring_Buffer<Command, 4> m_cmd_buffer;
-    Command m_tmp;
-    Logger &m_logger;
+    Command m_cmd;
+    bool m_parsed{false};
 
-    [[nodiscard]] static constexpr auto parse_word(const auto &line, auto &search_itr) noexcept
+    [[nodiscard]] static constexpr Command_Token parse_word(std::string_view line, size_t &search) noexcept
     {
         constexpr char SPACE{' '};
-        const auto search_begin{search_itr};
-        search_itr = std::find(search_itr, std::end(line), SPACE);
-        const auto search_end{search_itr};
-        while (search_itr != std::end(line) && *search_itr == SPACE)
-        {
-            ++search_itr;
-        }
-        return std::make_pair(search_begin, search_end);
-    }
-
-    constexpr void enqueue_command() noexcept
-    {
-        if (!m_cmd_buffer.enqueue(m_tmp))
-        {
-            print_error(m_logger, "PANIC Unable to enqueue the command!");
-            pico::panic::loop_forever();
-        }
-        m_tmp.arguments.clear();
-        m_tmp.name.clear();
-    }
-
-    constexpr void add_name_to_command(const auto word_start, const auto word_finish) noexcept
-    {
-        const auto ssize{std::distance(word_start, word_finish)};
-        m_tmp.name.resize(ssize);
-        memcpy(std::data(m_tmp.name), word_start, ssize);
-    }
-
-    constexpr void add_arg_to_command(const auto word_start, const auto word_finish) noexcept
-    {
-        const auto ssize{std::distance(word_start, word_finish)};
-        std::decay_t<decltype(m_tmp.arguments[0])> tmp;
-        tmp.resize(ssize);
-        memcpy(std::data(tmp), word_start, ssize);
-        m_tmp.arguments.push_back(tmp);
+        const auto word_start{search};
+        search = std::min(line.find(SPACE, search), std::size(line));
+        const auto word_end{search};
+        search = std::min(line.find_first_not_of(SPACE, search), std::size(line));
+        return Command_Token{.offset{static_cast<uint8_t>(word_start)}, .length{static_cast<uint8_t>(word_end - word_start)}};
     }
 };
 
-template <class LineProvider, class Logger>
-bool command_available(CommandBuilder_SM<LineProvider, Logger> &sm)
+template <class LineProvider>
+bool command_available(CommandBuilder_SM<LineProvider> &sm)
 {
     return sm.command_available();
 }
 
-template <class LineProvider, class Logger>
-Command get_next_command(CommandBuilder_SM<LineProvider, Logger> &sm)
+template <class LineProvider>
+const Command &next_command(CommandBuilder_SM<LineProvider> &sm)
+{
+    return sm.next_command();
+}
+
+template <class LineProvider>
+void pop_command(CommandBuilder_SM<LineProvider> &sm)
 {
-    return sm.get_next_command();
+    sm.pop_command();
 }
 
+/* Something that can take over the serial input from the line provider, e.g. for a binary upload.  While active()
+ * everything that arrives goes to consume() instead of being cut into lines. */
+class Input_Diversion
+{
+public:
+    [[nodiscard]] virtual bool active() const noexcept = 0;
+    /**
+     * @brief take what it wants of `received`
+     * @return how much was used; anything short of all of it means the diversion has ended, and the rest is for the
+     *  line provider again
+     */
+    virtual size_t consume(std::span<const char> received) noexcept = 0;
+
+protected:
+    ~Input_Diversion() = default;
+};
+
 // an example line LineProvider
-// * a line reading state machine is pretty simple, if you read a /n then stuff the current buffer
-template <size_t MAX_LINE_LENGTH>
+// * characters are moved from stdio into m_rx by the chars-available interrupt, so nothing is lost while the
+//   superloop is busy elsewhere
+// * update() then takes everything that has arrived in one pass, and cuts it into lines at each '\n'
+// * each line is built in the line buffer slot it will be read from, and read there; nothing copies it
+// * one line per update(), so the command it carries has run before anything after it is read; that is what lets a
+//   command hand what follows it to a diversion
+template <size_t MAX_LINE_LENGTH, size_t RX_BUFFER_SIZE = 256>
 class PicoLineProvider
 {
 public:
     using line_type = embp::variable_array<char, MAX_LINE_LENGTH>;
+    static_assert(MAX_LINE_LENGTH <= UINT8_MAX, "Command_Token offsets are 8 bit");
+
+    /* stdin belongs to the interrupt from here on; anything that reads it directly must do so before this */
+    void start() noexcept
+    {
+        stdio_set_chars_available_callback(on_chars_available, this);
+    }
+
+    /* from when `diversion` says it is active, what arrives is its, not the shell's */
+    void divert_to(Input_Diversion &diversion) noexcept
+    {
+        m_diversion = &diversion;
+    }
 
     void update() noexcept
     {
-        int c{getchar_timeout_us(0)};
-        if (c == PICO_ERROR_TIMEOUT)
-        {
-            return;
-        }
-        printf("%c", c); // TODO we also echo here?  need to support backspace and delete
-        if (c == '\n')
+        // at most two pieces, when what has arrived wraps around the end of the ring
+        for (auto received{m_rx.read_region()}; !std::empty(received); received = m_rx.read_region())
         {
-            if (!m_line_buffer.enqueue(m_current_line))
+            if (diverted())
             {
-                printf("PANIC hmm, couldn't enqueue?");
-                pico::panic::loop_forever();
+                const auto used{m_diversion->consume(received)};
+                m_rx.consume(used);
+                // either it has ended, and the rest are lines again, or it took everything
+                continue;
+            }
+            const auto used{take_lines(received)};
+            m_rx.consume(used);
+            if (used != std::size(received))
+            {
+                // a line is done, or there's no room for another; the rest waits in m_rx for the next pass
+                break;
             }
-            m_current_line.clear();
-            return;
         }
-        m_current_line.push_back(c);
+        if (m_rx_stalled.load(std::memory_order_acquire) && !m_rx.full())
+        {
+            // the interrupt found m_rx full and left the rest with stdio, which won't signal those characters again
+            const auto status{save_and_disable_interrupts()};
+            m_rx_stalled.store(false, std::memory_order_relaxed);
+            fill_rx();
+            restore_interrupts(status);
+        }
     }
 
     [[nodiscard]] bool line_available() const noexcept
     {
         return !m_line_buffer.empty();
     }
-    [[nodiscard]] line_type get_next_line() noexcept
+    /**
+     * @brief the oldest complete line, valid until pop_line(). Behaviour undefined if none is available.
+     */
+    [[nodiscard]] const line_type &front_line() const noexcept
     {
-        const auto tmp{m_line_buffer.dequeue()};
-        return tmp;
+        return m_line_buffer.front();
+    }
+    void pop_line() noexcept
+    {
+        m_line_buffer.pop();
     }
 
 private:
     static constexpr size_t LINE_BUFFER_CAPACITY{4};
+    // the line being typed is the buffer's tail(), which it only reaches by push()
     Fixed_Log2_Ring_Buffer<line_type, LINE_BUFFER_CAPACITY> m_line_buffer;
-    line_type m_current_line;
+    // filled in interrupt context, drained by update()
+    SPSC_Ring_Buffer<char, RX_BUFFER_SIZE> m_rx;
+    std::atomic<bool> m_rx_stalled{false};
+    Input_Diversion *m_diversion{nullptr};
+
+    [[nodiscard]] bool diverted() const noexcept
+    {
+        return m_diversion != nullptr && m_diversion->active();
+    }
+
+    static void on_chars_available(void *self) noexcept
+    {
+        static_cast<PicoLineProvider *>(self)->fill_rx();
+    }
+
+    /* the producer side of m_rx: runs in the interrupt, or in update() with interrupts off */
+    void fill_rx() noexcept
+    {
+        for (;;)
+        {
+            const auto space{m_rx.write_region()};
+            if (std::empty(space))
+            {
+                m_rx_stalled.store(true, std::memory_order_release);
+                return;
+            }
+            size_t count{0};
+            for (; count != std::size(space); ++count)
+            {
+                const int c{getchar_timeout_us(0)};
+                if (c == PICO_ERROR_TIMEOUT)
+                {
+                    break;
+                }
+                space[count] = static_cast<char>(c);
+            }
+            m_rx.commit(count);
+            if (count != std::size(space))
+            {
+                return;
+            }
+        }
+    }
+
+    /* @return how much of received was used; short when a line has been finished, or one is waiting and there's no
+     *  room for it */
+    size_t take_lines(std::span<const char> received) noexcept
+    {
+        size_t used{0};
+        while (used != std::size(received))
+        {
+            const auto rest{received.subspan(used)};
+            const auto newline{static_cast<const char *>(memchr(std::data(rest), '\n', std::size(rest)))};
+            if (newline != nullptr && m_line_buffer.full())
+            {
+                break;
+            }
+            const size_t length{newline == nullptr ? std::size(rest) : static_cast<size_t>(newline - std::data(rest))};
+            append_to_line(rest.first(length));
+            const size_t taken{length + (newline != nullptr)};
+            printf("%.*s", static_cast<int>(taken), std::data(rest)); // TODO we also echo here?  need to support backspace and delete
+            used += taken;
+            if (newline != nullptr)
+            {
+                (void)m_line_buffer.push();
+                m_line_buffer.tail().clear();
+                break;
+            }
+        }
+        return used;
+    }
+
+    void append_to_line(std::span<const char> chars) noexcept
+    {
+        // past MAX_LINE_LENGTH the rest of the line is dropped
+        auto &line{m_line_buffer.tail()};
+        const auto old_size{std::size(line)};
+        const auto count{std::min(line.capacity() - old_size, std::size(chars))};
+        line.resize(old_size + count);
+        memcpy(std::data(line) + old_size, std::data(chars), count);
+    }
 };
 
-template <size_t N>
-auto available(PicoLineProvider<N> &line_jobby)
+template <size_t N, size_t RX>
+auto available(PicoLineProvider<N, RX> &line_jobby)
 {
     return line_jobby.line_available();
 }
-template <size_t N>
-auto get_next_line(PicoLineProvider<N> &line_jobby)
+template <size_t N, size_t RX>
+const auto &front_line(PicoLineProvider<N, RX> &line_jobby)
+{
+    return line_jobby.front_line();
+}
+template <size_t N, size_t RX>
+void pop_line(PicoLineProvider<N, RX> &line_jobby)
+{
+    line_jobby.pop_line();
+}
+
+namespace tests
 {
-    return line_jobby.get_next_line();
+    struct Fake_Line_Provider
+    {
+        Fixed_Log2_Ring_Buffer<embp::variable_array<char, 40>, 4> lines;
+
+        constexpr void type(std::string_view line) noexcept
+        {
+            lines.tail().resize(std::size(line));
+            std::copy(std::begin(line), std::end(line), std::begin(lines.tail()));
+            (void)lines.push();
+        }
+    };
+    constexpr bool available(Fake_Line_Provider &provider) { return !provider.lines.empty(); }
+    constexpr const auto &front_line(Fake_Line_Provider &provider) { return provider.lines.front(); }
+    constexpr void pop_line(Fake_Line_Provider &provider) { provider.lines.pop(); }
+
+    [[nodiscard]] constexpr bool run_command_builder_tests()
+    {
+        bool rv{true};
+
+        Fake_Line_Provider lines;
+        CommandBuilder_SM dut{lines};
+
+        // =========================================
+        dut.update();
+        rv &= !dut.command_available();
+
+        lines.type("set 1 2  3 4");
+        lines.type("help  ");
+        lines.type("set 1 2 3 4 5 6 7 8 9");
+        dut.update();
+        rv &= dut.command_available();
+        {
+            const auto &cmd{dut.next_command()};
+            rv &= cmd.name() == "set";
+            rv &= cmd.argument_count() == 4;
+            rv &= cmd.argument(0) == "1";
+            rv &= cmd.argument(2) == "3";
+            rv &= cmd.argument(3) == "4";
+            // the words are the line's own characters
+            rv &= std::data(cmd.argument(3)) == std::data(lines.lines.front()) + 11;
+        }
+
+        // one at a time: the next line waits until this command is done with its own
+        dut.update();
+        rv &= dut.next_command().name() == "set";
+        rv &= lines.lines.size() == 3;
+        dut.pop_command();
+        rv &= lines.lines.size() == 2;
+        rv &= !dut.command_available();
+
+        // =========================================
+        // trailing spaces don't make an empty argument
+        dut.update();
+        rv &= dut.next_command().name() == "help";
+        rv &= dut.next_command().argument_count() == 0;
+        rv &= !dut.next_command().too_many_arguments;
+        dut.pop_command();
+
+        // =========================================
+        // more words than Command has room for is flagged, not quietly cut short
+        dut.update();
+        rv &= dut.next_command().argument_count() == dut.next_command().argument_tokens.capacity();
+        rv &= dut.next_command().too_many_arguments;
+        dut.pop_command();
+        rv &= lines.lines.empty();
+
+        return rv;
+    }
+    static_assert(run_command_builder_tests());
 }
 #endif
\ No newline at end of file
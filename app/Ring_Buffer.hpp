@@ -1,9 +1,14 @@
 #if !defined(RING_BUFFER_HPP)
 #define RING_BUFFER_HPP
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <bit>
 #include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
 
 template <class T, size_t MAX_SIZE>
     requires(std::popcount(MAX_SIZE) == 1)
@@ -51,6 +56,43 @@ public:
         return tmp;
     }
 
+    /**
+     * @brief the oldest element, where it sits. Behaviour undefined if buffer is empty.
+     */
+    [[nodiscard]] constexpr T &front() noexcept
+    {
+        return m_buf[m_get];
+    }
+    [[nodiscard]] constexpr const T &front() const noexcept
+    {
+        return m_buf[m_get];
+    }
+    /**
+     * @brief drop the oldest element, without copying it out. Behaviour undefined if buffer is empty.
+     */
+    constexpr void pop() noexcept
+    {
+        inc(m_get);
+    }
+
+    /**
+     * @brief the slot the next push() makes visible.  It is never one that is waiting, even when full(), so an
+     *  element can be built in place there before there is room to push it.
+     */
+    [[nodiscard]] constexpr T &tail() noexcept
+    {
+        return m_buf[m_put];
+    }
+    [[nodiscard]] constexpr bool push() noexcept
+    {
+        if (full())
+        {
+            return false;
+        }
+        inc(m_put);
+        return true;
+    }
+
     [[nodiscard]] std::array<T, MAX_SIZE> &array_ref() noexcept
     {
         return m_buf;
@@ -77,6 +119,174 @@ private:
     }
 };
 
+
+/* Single producer, single consumer ring that is safe across the two cores, or between an IRQ and the superloop.
+ *
+ * The indices are free running counts of everything ever written and read, so full and empty are told apart
+ * without giving up a slot; they wrap at 2^32, which MAX_SIZE divides.  Each side only stores its own index, with
+ * release, and loads the other's with acquire, so no read-modify-write is needed (the M0+ has none).
+ *
+ * Producer side: enqueue(), write(), write_region() + commit().
+ * Consumer side: dequeue(), front() + pop(), read(), read_region() + consume().
+ * The regions are contiguous, so a DMA channel can fill or drain one directly. */
+template <class T, size_t MAX_SIZE>
+    requires(std::popcount(MAX_SIZE) == 1 && MAX_SIZE <= (size_t{1} << 31U))
+class SPSC_Ring_Buffer
+{
+public:
+    // either side; a snapshot, which the other side may already have changed
+    [[nodiscard]] constexpr size_t size() const noexcept
+    {
+        return load(m_written, std::memory_order_acquire) - load(m_read, std::memory_order_acquire);
+    }
+    [[nodiscard]] constexpr bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+    [[nodiscard]] constexpr bool full() const noexcept
+    {
+        return size() == MAX_SIZE;
+    }
+    [[nodiscard]] constexpr size_t capacity() const noexcept
+    {
+        return MAX_SIZE;
+    }
+
+    // producer
+    [[nodiscard]] constexpr bool enqueue(T value) noexcept
+    {
+        const uint32_t written{load(m_written, std::memory_order_relaxed)};
+        // only look at the consumer's index when the last look says there's no room
+        if (written - m_read_seen == MAX_SIZE)
+        {
+            m_read_seen = load(m_read, std::memory_order_acquire);
+            if (written - m_read_seen == MAX_SIZE)
+            {
+                return false;
+            }
+        }
+        m_buf[written & INDEX_MASK] = std::move(value);
+        store(m_written, written + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief copy in as much of `values` as fits.
+     * @return how many were written
+     */
+    [[nodiscard]] constexpr size_t write(std::span<const T> values) noexcept
+    {
+        size_t done{0};
+        // at most twice: up to the end of the array, then from the start
+        for (auto region{write_region()}; !std::empty(region) && done < std::size(values); region = write_region())
+        {
+            const auto count{std::min(std::size(region), std::size(values) - done)};
+            std::copy_n(std::begin(values) + done, count, std::begin(region));
+            commit(count);
+            done += count;
+        }
+        return done;
+    }
+
+    /* free slots from the write position up to the end of the array; fill some, then commit() them */
+    [[nodiscard]] constexpr std::span<T> write_region() noexcept
+    {
+        const uint32_t written{load(m_written, std::memory_order_relaxed)};
+        m_read_seen = load(m_read, std::memory_order_acquire);
+        const size_t free{MAX_SIZE - (written - m_read_seen)};
+        const size_t start{written & INDEX_MASK};
+        return std::span<T>{m_buf}.subspan(start, std::min(free, MAX_SIZE - start));
+    }
+    constexpr void commit(size_t count) noexcept
+    {
+        store(m_written, static_cast<uint32_t>(load(m_written, std::memory_order_relaxed) + count), std::memory_order_release);
+    }
+
+    // consumer
+    /**
+     * @brief pop the oldest element inserted. Behaviour undefined if buffer is empty.
+     */
+    [[nodiscard]] constexpr T dequeue() noexcept
+    {
+        const uint32_t read{load(m_read, std::memory_order_relaxed)};
+        const T tmp{std::move(m_buf[read & INDEX_MASK])};
+        store(m_read, read + 1, std::memory_order_release);
+        return tmp;
+    }
+
+    /**
+     * @brief the oldest element, where it sits; it stays put until pop(). Behaviour undefined if buffer is empty.
+     */
+    [[nodiscard]] constexpr const T &front() const noexcept
+    {
+        return m_buf[load(m_read, std::memory_order_relaxed) & INDEX_MASK];
+    }
+    constexpr void pop() noexcept
+    {
+        consume(1);
+    }
+
+    /**
+     * @brief move out as many elements as are waiting, up to the size of `values`.
+     * @return how many were read
+     */
+    [[nodiscard]] constexpr size_t read(std::span<T> values) noexcept
+    {
+        size_t done{0};
+        for (auto region{read_region()}; !std::empty(region) && done < std::size(values); region = read_region())
+        {
+            const auto count{std::min(std::size(region), std::size(values) - done)};
+            std::copy_n(std::begin(region), count, std::begin(values) + done);
+            consume(count);
+            done += count;
+        }
+        return done;
+    }
+
+    /* waiting elements from the read position up to the end of the array; use some, then consume() them */
+    [[nodiscard]] constexpr std::span<const T> read_region() const noexcept
+    {
+        const uint32_t written{load(m_written, std::memory_order_acquire)};
+        const uint32_t read{load(m_read, std::memory_order_relaxed)};
+        const size_t waiting{written - read};
+        const size_t start{read & INDEX_MASK};
+        return std::span<const T>{m_buf}.subspan(start, std::min(waiting, MAX_SIZE - start));
+    }
+    constexpr void consume(size_t count) noexcept
+    {
+        store(m_read, static_cast<uint32_t>(load(m_read, std::memory_order_relaxed) + count), std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t INDEX_MASK{MAX_SIZE - 1};
+    std::array<T, MAX_SIZE> m_buf{};
+    // each stored by one side only, and only ever accessed through load() and store()
+    uint32_t m_written{0};
+    uint32_t m_read{0};
+    // the producer's last look at m_read, so enqueue() can skip the cross-core load while there's room
+    uint32_t m_read_seen{0};
+
+    // plain accesses during constant evaluation, so the tests below can run at compile time
+    [[nodiscard]] static constexpr uint32_t load(const uint32_t &index, std::memory_order order) noexcept
+    {
+        if (std::is_constant_evaluated())
+        {
+            return index;
+        }
+        // atomic_ref<const T> only arrives in C++26
+        return std::atomic_ref<uint32_t>{const_cast<uint32_t &>(index)}.load(order);
+    }
+    static constexpr void store(uint32_t &index, uint32_t value, std::memory_order order) noexcept
+    {
+        if (std::is_constant_evaluated())
+        {
+            index = value;
+            return;
+        }
+        std::atomic_ref<uint32_t>{index}.store(value, order);
+    }
+};
+
 namespace tests
 {
     [[nodiscard]] constexpr bool run_ring_buffer_tests()
@@ -165,8 +375,106 @@ namespace tests
         rv &= dut.dequeue() == 48;
         rv &= dut.empty();
 
+        // =========================================
+        // in place: build at tail(), push(), read at front(), pop()
+        dut.tail() = 50;
+        rv &= dut.push();
+        rv &= dut.front() == 50;
+        dut.front() = 51;
+        ++dut.tail();
+        rv &= dut.front() == 51;
+        rv &= dut.size() == 1;
+        for (int ii{0}; ii < 6; ++ii)
+        {
+            dut.tail() = 52 + ii;
+            rv &= dut.push();
+        }
+        rv &= dut.full();
+        // still somewhere to build the next one, and nothing waiting is touched
+        dut.tail() = 60;
+        rv &= !dut.push();
+        rv &= dut.front() == 51;
+        dut.pop();
+        rv &= dut.push();
+        rv &= dut.size() == 7;
+        for (int ii{0}; ii < 6; ++ii)
+        {
+            rv &= dut.front() == 52 + ii;
+            dut.pop();
+        }
+        rv &= dut.front() == 60;
+        dut.pop();
+        rv &= dut.empty();
+
         return rv;
     }
     static_assert(run_ring_buffer_tests());
+    [[nodiscard]] constexpr bool run_spsc_ring_buffer_tests()
+    {
+        bool rv{true};
+
+        SPSC_Ring_Buffer<int, 8> dut;
+
+        // =========================================
+        // every slot is usable
+        rv &= dut.capacity() == 8;
+        rv &= dut.empty();
+        for (int ii{0}; ii < 8; ++ii)
+        {
+            rv &= dut.enqueue(40 + ii);
+        }
+        rv &= dut.full();
+        rv &= dut.size() == 8;
+        rv &= dut.enqueue(48) == false;
+        for (int ii{0}; ii < 8; ++ii)
+        {
+            rv &= dut.dequeue() == 40 + ii;
+        }
+        rv &= dut.empty();
+
+        // =========================================
+        // bulk writes and reads split across the wrap, and stop at full/empty
+        std::array<int, 6> in{1, 2, 3, 4, 5, 6};
+        std::array<int, 6> out{};
+        rv &= dut.write(std::span<const int>{in}.first(3)) == 3;
+        rv &= dut.read(std::span<int>{out}.first(2)) == 2;
+        rv &= out[0] == 1 && out[1] == 2;
+        // positions 11..16 wrap from slot 3 round to slot 0
+        rv &= dut.write(in) == 6;
+        rv &= dut.size() == 7;
+        rv &= dut.write(in) == 1;
+        rv &= dut.full();
+        rv &= dut.read(out) == 6;
+        rv &= out == std::array<int, 6>{3, 1, 2, 3, 4, 5};
+        rv &= dut.read(out) == 2;
+        rv &= out[0] == 6 && out[1] == 1;
+        rv &= dut.read(out) == 0;
+
+        // =========================================
+        // regions end at the array's end; the rest follows once that is committed
+        // 10 written and read so far, so the write position is slot 2
+        auto region{dut.write_region()};
+        rv &= std::size(region) == 6;
+        region[0] = 99;
+        dut.commit(6);
+        rv &= std::size(dut.write_region()) == 2;
+        rv &= std::size(dut.read_region()) == 6;
+        rv &= dut.read_region()[0] == 99;
+        dut.consume(6);
+        rv &= dut.empty();
+
+        // =========================================
+        // front() and pop() walk the same order as dequeue()
+        rv &= dut.enqueue(7);
+        rv &= dut.enqueue(8);
+        rv &= dut.front() == 7;
+        dut.pop();
+        rv &= dut.front() == 8;
+        dut.pop();
+        rv &= dut.empty();
+
+        return rv;
+    }
+    static_assert(run_spsc_ring_buffer_tests());
 }
 #endif
\ No newline at end of file
@@ -5,142 +5,277 @@
 #include <bit>
 #include <cstddef>
 #include <array>
+#include <limits>
 
-// FIXME THIS IS TERRIBLE, AS WE CAN RUN INTO NUMERICAL ISSUES VERY QUICKLY
-inline constexpr double integral_pow(double value, uint exp)
+/* sin, cos, exp, log and pow for building tables at compile time.
+ *
+ * Each reduces its argument to a short interval first (a multiple of pi/2, a power of two, a power of e), and only
+ * then approximates, with the minimax polynomials fdlibm uses on those intervals, so every value costs a handful
+ * of multiplies however large the table is, and is good to near double precision everywhere.  *_MAX_ERROR are the
+ * bounds make_table() relies on; host/tools/constexpr_table_check measures them against <cmath>. */
+namespace constexpr_math
 {
-    double rv{1};
-    for (uint ii{0}; ii < exp; ++ii)
+    inline constexpr double PI{3.141592653589793};
+
+    // absolute for sin, cos and log, relative for exp and pow (with |y * log(x)| < 700)
+    inline constexpr double SIN_MAX_ERROR{1e-15};
+    inline constexpr double EXP_MAX_ERROR{1e-15};
+    inline constexpr double LOG_MAX_ERROR{1e-15};
+    inline constexpr double POW_MAX_ERROR{1e-13};
+
+    namespace detail
     {
-        rv *= value;
+        // not constexpr: reaching either at compile time stops the build there
+        inline double outside_domain() noexcept
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        inline void table_exceeds_its_error_bound() noexcept {}
+
+        /* c[0] + x * (c[1] + x * (c[2] + ...)) */
+        template <size_t N>
+        [[nodiscard]] constexpr double horner(double x, const std::array<double, N> &coefficients) noexcept
+        {
+            double rv{coefficients[N - 1]};
+            for (size_t ii{N - 1}; ii > 0; --ii)
+            {
+                rv = coefficients[ii - 1] + x * rv;
+            }
+            return rv;
+        }
+
+        [[nodiscard]] constexpr int64_t nearest_integer(double value) noexcept
+        {
+            return static_cast<int64_t>(value < 0 ? value - 0.5 : value + 0.5);
+        }
+
+        /* value * 2^exponent, for exponent in the normal range */
+        [[nodiscard]] constexpr double times_power_of_two(double value, int64_t exponent) noexcept
+        {
+            return value * std::bit_cast<double>(static_cast<uint64_t>(exponent + 1023) << 52);
+        }
+
+        // pi/2 and ln 2 in two parts, the first short enough that multiples of it are exact
+        inline constexpr double PI_OVER_2_HIGH{1.57079632673412561417e+00};
+        inline constexpr double PI_OVER_2_LOW{6.07710050650619224932e-11};
+        inline constexpr double LN2_HIGH{6.93147180369123816490e-01};
+        inline constexpr double LN2_LOW{1.90821492927058770002e-10};
+
+        // minimax on |x| <= pi/4, |r| <= ln(2)/2 and sqrt(1/2) <= m <= sqrt(2): fdlibm's k_sin, k_cos, e_exp, e_log
+        inline constexpr std::array<double, 6> SIN_COEFFICIENTS{-1.66666666666666324348e-01, 8.33333333332248946124e-03, -1.98412698298579493134e-04,
+                                                                2.75573137070700676789e-06, -2.50507602534068634195e-08, 1.58969099521155010221e-10};
+        inline constexpr std::array<double, 6> COS_COEFFICIENTS{4.16666666666666019037e-02, -1.38888888888741095749e-03, 2.48015872894767294178e-05,
+                                                                -2.75573143513906633035e-07, 2.08757232129817482790e-09, -1.13596475577881948265e-11};
+        inline constexpr std::array<double, 5> EXP_COEFFICIENTS{1.66666666666666019037e-01, -2.77777777770155933842e-03, 6.61375632143793436117e-05,
+                                                                -1.65339022054652515390e-06, 4.13813679705723846039e-08};
+        inline constexpr std::array<double, 7> LOG_COEFFICIENTS{6.666666666666735130e-01, 3.999999999940941908e-01, 2.857142874366239149e-01,
+                                                                2.222219843214978396e-01, 1.818357216161805012e-01, 1.531383769920937332e-01,
+                                                                1.479819860511658591e-01};
+
+        [[nodiscard]] constexpr double sin_kernel(double x) noexcept
+        {
+            const double z{x * x};
+            return x + x * z * horner(z, SIN_COEFFICIENTS);
+        }
+        [[nodiscard]] constexpr double cos_kernel(double x) noexcept
+        {
+            const double z{x * x};
+            return 1.0 - 0.5 * z + z * z * horner(z, COS_COEFFICIENTS);
+        }
+
+        /* sin(x + quarter_turns * pi/2) */
+        [[nodiscard]] constexpr double sin_shifted(double x, int64_t quarter_turns) noexcept
+        {
+            const auto turns{nearest_integer(x * (2.0 / PI))};
+            const double reduced{(x - static_cast<double>(turns) * PI_OVER_2_HIGH) - static_cast<double>(turns) * PI_OVER_2_LOW};
+            switch ((turns + quarter_turns) & 3)
+            {
+            case 0:
+                return sin_kernel(reduced);
+            case 1:
+                return cos_kernel(reduced);
+            case 2:
+                return -sin_kernel(reduced);
+            default:
+                return -cos_kernel(reduced);
+            }
+        }
     }
-    return rv;
-}
-static_assert(integral_pow(2.0, 4) == 2.0 * 2.0 * 2.0 * 2.0);
 
-inline constexpr uint64_t factorial(uint64_t value)
-{
-    uint64_t rv{1};
-    for (uint64_t ii{0}; ii < value; ++ii)
+    /* for |x| up to 2^20 or so; beyond that the reduction loses bits */
+    [[nodiscard]] constexpr double sin(double x) noexcept
     {
-        rv *= ii + 1;
+        return detail::sin_shifted(x, 0);
+    }
+    [[nodiscard]] constexpr double cos(double x) noexcept
+    {
+        return detail::sin_shifted(x, 1);
     }
-    return rv;
-}
-static_assert(factorial(1) == 1);
-static_assert(factorial(2) == 2);
-static_assert(factorial(3) == 1 * 2 * 3);
-static_assert(factorial(5) == 120);
 
-/* approximate sin(radian) using the Talyor-series expansion */
-inline constexpr double sine_power_series(double radian, size_t terms)
-{
-    double rv{};
-    for (size_t n{0}; n < terms; ++n)
+    [[nodiscard]] constexpr double exp(double x) noexcept
     {
-        const double numer{integral_pow(radian, 2 * n + 1)};
-        const double denom{static_cast<double>(factorial(2 * n + 1))};
-        const double factor{integral_pow(-1.0, n)};
-        rv += (numer / denom) * factor;
+        using namespace detail;
+        if (x < -708.0)
+        {
+            return 0.0;
+        }
+        if (x > 709.0)
+        {
+            return outside_domain();
+        }
+        // e^x = 2^k * e^r, |r| <= ln(2) / 2
+        const auto k{nearest_integer(x / (LN2_HIGH + LN2_LOW))};
+        const double high{x - static_cast<double>(k) * LN2_HIGH};
+        const double low{static_cast<double>(k) * LN2_LOW};
+        const double r{high - low};
+        const double z{r * r};
+        const double c{r - z * horner(z, EXP_COEFFICIENTS)};
+        const double e_r{1.0 - ((low - (r * c) / (2.0 - c)) - high)};
+        return times_power_of_two(e_r, k);
     }
-    return rv;
-}
-static_assert(sine_power_series(0.0, 5) == 0);
-static_assert(sine_power_series(3.141592653589793, 5) > 0);
-static_assert(sine_power_series(270 * 3.141592653589793 / 180, 5) < 0);
-static_assert(sine_power_series(2 * 3.141592653589793, 5) > 0);
 
-/* approximate e^(exp) using Taylor-series expansion */
-inline constexpr double exponential_power_series(double exp, size_t terms)
-{
-    double rv{};
-    for (size_t n{0}; n < terms; ++n)
+    [[nodiscard]] constexpr double log(double x) noexcept
     {
-        rv += integral_pow(exp, n) / factorial(n);
+        using namespace detail;
+        if (!(x > 0.0) || x == std::numeric_limits<double>::infinity())
+        {
+            return outside_domain();
+        }
+        // ln(x) = k ln(2) + ln(m), sqrt(1/2) <= m <= sqrt(2)
+        int64_t k{0};
+        if (x < std::numeric_limits<double>::min())
+        {
+            x *= 18014398509481984.0; // 2^54, out of the subnormals
+            k -= 54;
+        }
+        const auto bits{std::bit_cast<uint64_t>(x)};
+        k += static_cast<int64_t>(bits >> 52) - 1023;
+        double m{std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL)};
+        if (m > 1.4142135623730951)
+        {
+            m *= 0.5;
+            ++k;
+        }
+        const double f{m - 1.0};
+        const double s{f / (2.0 + f)};
+        const double z{s * s};
+        const double half_f_squared{0.5 * f * f};
+        const double ln_m{f - (half_f_squared - s * (half_f_squared + z * horner(z, LOG_COEFFICIENTS)))};
+        return static_cast<double>(k) * LN2_HIGH + (ln_m + static_cast<double>(k) * LN2_LOW);
     }
-    return rv;
-}
-static_assert(exponential_power_series(1, 11) > 2.71828);
-static_assert(exponential_power_series(1, 11) - 2.71828 < 0.001);
-static_assert(exponential_power_series(1.5, 11) > 4.481);
-static_assert(exponential_power_series(1.5, 11) - 4.481 < 0.001);
-static_assert(exponential_power_series(0.1, 11) > 1.105);
-static_assert(exponential_power_series(0.1, 11) - 1.105 < 0.001);
-
-/* approximate ln(val) using Taylor-series expansion */
-inline constexpr double logarithm_power_series(double val, size_t terms)
-{
-    double rv{};
-    for (size_t n{0}; n < terms; ++n)
+
+    /* x^y for x >= 0 */
+    [[nodiscard]] constexpr double pow(double x, double y) noexcept
     {
-        const auto exp_val{exponential_power_series(rv, terms)};
-        rv += 2 * (val - exp_val) / (val + exp_val);
+        if (x == 0.0)
+        {
+            return y > 0.0 ? 0.0 : y == 0.0 ? 1.0 : detail::outside_domain();
+        }
+        return exp(y * log(x));
     }
-    return rv;
-}
-static_assert(logarithm_power_series(2.718281828450945, 11) > 1);
-static_assert(logarithm_power_series(2.718281828450945, 11) - 1 < 0.001);
 
-template <size_t N>
-    requires(std::popcount(N) == 1)
-inline constexpr auto SINE_TABLE{
-    []()
+    /**
+     * @brief a table of fn(0) .. fn(N - 1), each in [0, 1], scaled to T's range and rounded to nearest.
+     *  fn_max_error is how far fn's results may be from exact; the table doesn't build unless that, with the
+     *  rounding, keeps every entry within max_error_lsb of the exact value.  The default is correctly rounded,
+     *  bar values within 1/1000 of a step of a tie.
+     */
+    template <class T, size_t N, class Fn>
+    [[nodiscard]] consteval std::array<T, N> make_table(Fn &&fn, double fn_max_error, double max_error_lsb = 0.501)
     {
-        constexpr auto POWER_SERIES_TERMS{11};
-        // https://math.stackexchange.com/questions/2853310/how-to-calculate-the-sine-manually-without-any-rules-calculator-or-anything-el#2853320
-        // using the power-series method
-        std::array<uint8_t, N> rv{};
-        for (size_t ii{0}; ii < std::size(rv); ++ii)
+        constexpr double FULL_SCALE{std::numeric_limits<T>::max()};
+        if (0.5 + fn_max_error * FULL_SCALE > max_error_lsb)
         {
-            const double radian{static_cast<double>(ii) / std::size(rv) * 2 * 3.141592653589793};
-            const double value{(sine_power_series(radian, POWER_SERIES_TERMS) + 1.0) / 2.0};
-            rv[ii] = static_cast<uint16_t>(value * std::numeric_limits<uint8_t>::max()) & 0xFFU;
+            detail::table_exceeds_its_error_bound();
+        }
+        std::array<T, N> rv{};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            const double value{fn(ii) * FULL_SCALE};
+            if (value < -fn_max_error * FULL_SCALE || value > (1.0 + fn_max_error) * FULL_SCALE)
+            {
+                detail::table_exceeds_its_error_bound();
+            }
+            rv[ii] = static_cast<T>(value <= 0.0 ? 0.0 : value >= FULL_SCALE ? FULL_SCALE : value + 0.5);
         }
         return rv;
-    }()};
+    }
 
-inline constexpr auto SINE_TABLE_MASK(const auto &sine_table) { return std::size(sine_table) - 1; }
+    /* a sine period over N entries, from 0 at the bottom to the type's maximum at the top */
+    template <class T, size_t N>
+    [[nodiscard]] consteval std::array<T, N> make_sine_table()
+    {
+        // the expression around sin() adds a few rounding steps of its own
+        return make_table<T, N>([](size_t ii)
+                                { return (sin(static_cast<double>(ii) * (2.0 * PI / N)) + 1.0) * 0.5; },
+                                SIN_MAX_ERROR + 4 * std::numeric_limits<double>::epsilon());
+    }
 
-template <size_t N>
-    requires(std::popcount(N) == 1)
-inline constexpr auto SRGB_GAMMA_CURVE{
-    // An sRGB gamma correction
-    []()
+    /* The sRGB transfer curve, linear to compressed, over N entries for inputs from 0 to 1
+     *        /  12.92 * Input,                     Input <= 0.0031308
+     *  Out = |
+     *        \  1.055 * (Input)^(1/2.4) - 0.055,   Input > 0.0031308 */
+    template <class T, size_t N>
+    [[nodiscard]] consteval std::array<T, N> make_srgb_gamma_curve()
     {
-        /* We transfer from linear to compressed representation
-         * Given Input is on the range [0,1]
-         *        /  12.92 * Input,                     Input <= 0.0031308
-         *  Out = |
-         *        \  1.055 * (Input)^(1/2.4) - 0.055,   Input > 0.0031308
-         */
-        // the hard part is the fractional power
-        // X ^ (1/2.4) can be done using logarithms!
-        //      ln(x^n) == n * ln(x)
-        //      exp(ln(y)) == y
-        constexpr auto POWER_SERIES_TERMS{21};
-        constexpr auto LOWER_THRESHOLD{0.0031308};
-        constexpr auto LOWER_FACTOR{12.92};
-        constexpr auto UPPER_FACTOR{1.055};
-        constexpr auto UPPER_EXP{1 / 2.4};
-        constexpr auto UPPER_OFFSET{-0.055};
-
-        constexpr auto lower_fn{[](auto val)
-                                {
-                                    return LOWER_FACTOR * val;
-                                }};
-        constexpr auto upper_fn{[](auto val)
+        return make_table<T, N>([](size_t ii)
                                 {
-                                    const auto log_val{UPPER_EXP * logarithm_power_series(val, POWER_SERIES_TERMS)};
-                                    return UPPER_FACTOR * exponential_power_series(log_val, POWER_SERIES_TERMS) + UPPER_OFFSET;
-                                }};
-        std::array<uint8_t, N> rv{};
-        for (size_t ii{0}; ii < N; ++ii)
+                                    const double linear{static_cast<double>(ii) / (N - 1)};
+                                    return linear <= 0.0031308 ? 12.92 * linear : 1.055 * pow(linear, 1 / 2.4) - 0.055;
+                                },
+                                1.055 * POW_MAX_ERROR + 4 * std::numeric_limits<double>::epsilon());
+    }
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_constexpr_math_tests()
+    {
+        using namespace constexpr_math;
+        bool rv{true};
+        const auto near{[](double value, double expected, double tolerance)
+                        { return value - expected <= tolerance && expected - value <= tolerance; }};
+
+        // =========================================
+        // known values, across the reductions
+        rv &= sin(0.0) == 0.0;
+        rv &= near(sin(PI / 6), 0.5, 1e-15);
+        rv &= near(sin(3 * PI / 2), -1.0, 1e-15);
+        rv &= near(cos(PI), -1.0, 1e-15);
+        rv &= near(sin(-100.0), 0.50636564110975879, 1e-14);
+        rv &= exp(0.0) == 1.0;
+        rv &= near(exp(1.0), 2.718281828459045, 1e-15);
+        rv &= near(exp(-20.0) / 2.0611536224385579e-09, 1.0, 1e-15);
+        rv &= log(1.0) == 0.0;
+        rv &= near(log(2.718281828459045), 1.0, 1e-15);
+        rv &= near(log(1e-300), -690.77552789821368, 1e-12);
+        rv &= near(pow(2.0, 10.0), 1024.0, 1e-12);
+        rv &= pow(0.0, 2.4) == 0.0;
+
+        // =========================================
+        // identities, over a sweep
+        for (int ii{-32}; ii <= 32; ++ii)
         {
-            const double linear{static_cast<double>(ii) / (N - 1)};
-            const double gamma{linear <= LOWER_THRESHOLD ? lower_fn(linear) : upper_fn(linear)};
-            rv[ii] = static_cast<uint8_t>(gamma * 255 > 255 ? 255 : gamma * 255);
+            const double x{ii * 0.37};
+            rv &= near(sin(x) * sin(x) + cos(x) * cos(x), 1.0, 4e-16);
+            rv &= near(log(exp(x)), x, 1e-14);
+            rv &= near(pow(exp(x), 0.5) * pow(exp(x), 0.5) / exp(x), 1.0, 1e-14);
         }
+
         return rv;
-    }()};
+    }
+    static_assert(run_constexpr_math_tests());
+}
+
+template <size_t N>
+    requires(std::popcount(N) == 1)
+inline constexpr auto SINE_TABLE{constexpr_math::make_sine_table<uint8_t, N>()};
+
+inline constexpr auto SINE_TABLE_MASK(const auto &sine_table) { return std::size(sine_table) - 1; }
+
+// An sRGB gamma correction
+template <size_t N>
+    requires(std::popcount(N) == 1)
+inline constexpr auto SRGB_GAMMA_CURVE{constexpr_math::make_srgb_gamma_curve<uint8_t, N>()};
 
-#endif
\ No newline at end of file
+#endif
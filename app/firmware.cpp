@@ -8,10 +8,13 @@
 
 #include "Command.hpp"
 #include "led_driver.hpp"
+#include "neopixel_output.hpp"
+#include "pattern_engine.hpp"
 #include "pico_chrono.hpp"
 #include "Ring_Buffer.hpp"
 #include "Input_State_Machine.hpp"
 #include "pico_logger.hpp"
+#include "stream_input.hpp"
 
 using namespace std::chrono_literals;
 
@@ -65,12 +68,19 @@ int main()
 
     // builds a full line as the user types it
     PicoLineProvider<MAX_LINE_LENGTH_PER_COMMAND_INVOCATION> line_provider;
+    // the stream command takes the input over from it until the host ends the stream
+    line_provider.divert_to(stream_input::diversion());
     // builds a command struct as lines come in
-    CommandBuilder_SM command_builder{line_provider, stdlogger};
+    CommandBuilder_SM command_builder{line_provider};
     // executes commands as command structs come in
     CommandExecutor_SM command_runner{PROMPT_STRING, command_builder, stdlogger};
 
+    // in the dual core build this hands the LEDs to core 1
+    neopixel::start();
+
     wait_for_user_sync();
+    // from here on characters are collected by interrupt, whatever the superloop is doing
+    line_provider.start();
 
     // the input state machine will read in characters from input and stuff them in the command queue when ready
     // the command state machine processes any commnds in the queue
@@ -80,6 +90,12 @@ int main()
         line_provider.update();
         command_builder.update();
         command_runner.update();
+        // draws into the canvas only when a frame is due, so it never holds up the shell
+        pattern_engine::update();
+#if !SERIAL_NEOPIXEL_DUAL_CORE
+        neopixel::update();
+#endif
+        tight_loop_contents();
     }
 }
 
@@ -0,0 +1,435 @@
+#if !defined(FRAME_CODEC_HPP)
+#define FRAME_CODEC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "stream_protocol.hpp"
+#include "ws2812/wire_frame.hpp"
+
+/* The compressed frames of the `stream` upload (KEY and DELTA packets, see stream_protocol.hpp).
+ *
+ * A frame is sent as the XOR of it with the frame before, so pixels that didn't change are zero, and that is
+ * run-length coded as a list of ops.  Each op starts with one byte, the kind in the top two bits and the number of
+ * pixels it covers, less one, in the other six:
+ *
+ *   SKIP     n pixels unchanged
+ *   FILL     n pixels set to the one pixel that follows
+ *   XOR      n pixels XORed with the one pixel that follows
+ *   LITERAL  n pixels follow, each XORed with its own
+ *
+ * Pixels are 4 bytes, white, red, green, blue, as in FRAME packets.  A KEY frame is coded against black, so it
+ * stands on its own.  The device applies ops straight to the strip's wire words: XOR with a pixel and XOR with its
+ * packed word are the same thing, since packing only moves bytes around. */
+namespace frame_codec
+{
+    enum struct Op : uint8_t
+    {
+        SKIP = 0x00,
+        FILL = 0x40,
+        XOR = 0x80,
+        LITERAL = 0xC0,
+    };
+
+    inline constexpr size_t MAX_RUN{64};
+    using stream_protocol::BYTES_PER_PIXEL;
+
+    /* the most encode() can write for `pixels` pixels: every one a literal */
+    [[nodiscard]] constexpr size_t max_encoded_size(size_t pixels) noexcept
+    {
+        return pixels * BYTES_PER_PIXEL + (pixels + MAX_RUN - 1) / MAX_RUN;
+    }
+
+    namespace detail
+    {
+        using Format = pico_ws2812::Wire_Format<pico_ws2812::WRGB>;
+
+        struct Op_Header
+        {
+            Op op;
+            size_t length; // pixels covered
+            size_t size;   // bytes, this one included
+        };
+
+        [[nodiscard]] constexpr Op_Header header_of(uint8_t byte) noexcept
+        {
+            const auto op{static_cast<Op>(byte & 0xC0U)};
+            const size_t length{(byte & 0x3FU) + 1U};
+            const size_t pixels{op == Op::SKIP ? 0 : (op == Op::LITERAL ? length : 1)};
+            return Op_Header{.op = op, .length = length, .size = 1 + pixels * BYTES_PER_PIXEL};
+        }
+
+        [[nodiscard]] constexpr uint32_t word_at(std::span<const uint8_t> bytes, size_t at) noexcept
+        {
+            return Format::pack(pico_ws2812::WRGB{.white{bytes[at]}, .red{bytes[at + 1]}, .green{bytes[at + 2]}, .blue{bytes[at + 3]}});
+        }
+
+        /* a pixel as it goes over the serial port, in one integer, for the encoder to compare and XOR */
+        [[nodiscard]] constexpr uint32_t bits_of(pico_ws2812::WRGB pixel) noexcept
+        {
+            return static_cast<uint32_t>(pixel.white) | (static_cast<uint32_t>(pixel.red) << 8) |
+                   (static_cast<uint32_t>(pixel.green) << 16) | (static_cast<uint32_t>(pixel.blue) << 24);
+        }
+        constexpr size_t put_bits(std::span<uint8_t> out, size_t at, uint32_t bits) noexcept
+        {
+            for (size_t ii{0}; ii < BYTES_PER_PIXEL; ++ii)
+            {
+                out[at + ii] = static_cast<uint8_t>(bits >> (8 * ii));
+            }
+            return at + BYTES_PER_PIXEL;
+        }
+        constexpr size_t put_op(std::span<uint8_t> out, size_t at, Op op, size_t length) noexcept
+        {
+            out[at] = static_cast<uint8_t>(static_cast<uint8_t>(op) | (length - 1));
+            return at + 1;
+        }
+    }
+
+    /**
+     * @brief whether `ops` covers exactly `pixel_count` pixels, with every op whole.  apply() trusts this, so a bad
+     *  payload is turned away before any pixel has been touched.
+     */
+    [[nodiscard]] constexpr bool valid(std::span<const uint8_t> ops, size_t pixel_count) noexcept
+    {
+        size_t at{0};
+        size_t covered{0};
+        while (at != std::size(ops))
+        {
+            const auto header{detail::header_of(ops[at])};
+            if (header.size > std::size(ops) - at || header.length > pixel_count - covered)
+            {
+                return false;
+            }
+            at += header.size;
+            covered += header.length;
+        }
+        return covered == pixel_count;
+    }
+
+    /**
+     * @brief apply `ops` to `words`, a run of the frame in wire format.
+     *  PRECONDITION: valid(ops, size(words))
+     */
+    constexpr void apply(std::span<const uint8_t> ops, std::span<uint32_t> words) noexcept
+    {
+        size_t at{0};
+        auto pixel{std::begin(words)};
+        while (at != std::size(ops))
+        {
+            const auto header{detail::header_of(ops[at])};
+            const auto data{at + 1};
+            switch (header.op)
+            {
+            case Op::SKIP:
+                break;
+            case Op::FILL:
+                std::fill_n(pixel, header.length, detail::word_at(ops, data));
+                break;
+            case Op::XOR:
+            {
+                const auto word{detail::word_at(ops, data)};
+                for (size_t ii{0}; ii < header.length; ++ii)
+                {
+                    pixel[ii] ^= word;
+                }
+                break;
+            }
+            case Op::LITERAL:
+                for (size_t ii{0}; ii < header.length; ++ii)
+                {
+                    pixel[ii] ^= detail::word_at(ops, data + ii * BYTES_PER_PIXEL);
+                }
+                break;
+            }
+            pixel += header.length;
+            at += header.size;
+        }
+    }
+
+    /**
+     * @brief the ops that turn `previous` into `current`, which are the same length, into `out`, which needs
+     *  max_encoded_size() of that length.  Greedy: any run of two or more that a FILL or XOR can cover is, and so is
+     *  any unchanged pixel; what is left goes out as literals.
+     * @return bytes written
+     */
+    constexpr size_t encode(std::span<const pico_ws2812::WRGB> previous, std::span<const pico_ws2812::WRGB> current,
+                            std::span<uint8_t> out) noexcept
+    {
+        const auto count{std::size(current)};
+        const auto delta{[&](size_t index)
+                         { return detail::bits_of(current[index]) ^ detail::bits_of(previous[index]); }};
+        const auto run_of{[&](size_t from, auto &&same)
+                          {
+                              size_t length{1};
+                              while (length < MAX_RUN && from + length < count && same(from + length))
+                              {
+                                  ++length;
+                              }
+                              return length;
+                          }};
+
+        size_t written{0};
+        size_t literal_start{0};
+        size_t literal_length{0};
+        const auto flush_literals{[&]
+                                  {
+                                      if (literal_length == 0)
+                                      {
+                                          return;
+                                      }
+                                      written = detail::put_op(out, written, Op::LITERAL, literal_length);
+                                      for (size_t ii{literal_start}; ii < literal_start + literal_length; ++ii)
+                                      {
+                                          written = detail::put_bits(out, written, delta(ii));
+                                      }
+                                      literal_length = 0;
+                                  }};
+
+        size_t index{0};
+        while (index < count)
+        {
+            const auto change{delta(index)};
+            const auto pixel{detail::bits_of(current[index])};
+            const auto skip{change == 0 ? run_of(index, [&](size_t ii)
+                                                 { return delta(ii) == 0; })
+                                        : 0};
+            const auto xor_run{run_of(index, [&](size_t ii)
+                                      { return delta(ii) == change; })};
+            const auto fill_run{run_of(index, [&](size_t ii)
+                                       { return detail::bits_of(current[ii]) == pixel; })};
+            if (skip != 0)
+            {
+                flush_literals();
+                written = detail::put_op(out, written, Op::SKIP, skip);
+                index += skip;
+            }
+            else if (std::max(xor_run, fill_run) >= 2)
+            {
+                flush_literals();
+                const bool use_xor{xor_run >= fill_run};
+                const auto length{use_xor ? xor_run : fill_run};
+                written = detail::put_op(out, written, use_xor ? Op::XOR : Op::FILL, length);
+                written = detail::put_bits(out, written, use_xor ? change : pixel);
+                index += length;
+            }
+            else
+            {
+                if (literal_length == 0)
+                {
+                    literal_start = index;
+                }
+                ++literal_length;
+                ++index;
+                if (literal_length == MAX_RUN)
+                {
+                    flush_literals();
+                }
+            }
+        }
+        flush_literals();
+        return written;
+    }
+
+    /* The host end: turns a sequence of whole frames into the smallest packets that will reproduce them, KEY every
+     * so often so a device that lost a packet can pick up again. */
+    template <size_t N>
+    class Stream_Encoder
+    {
+    public:
+        static constexpr size_t MAX_PAYLOAD{std::max(N * BYTES_PER_PIXEL, max_encoded_size(N))};
+        /* what one encode() can write */
+        static constexpr size_t MAX_WIRE_SIZE{stream_protocol::encoded_size(stream_protocol::HEADER_SIZE + MAX_PAYLOAD + stream_protocol::CRC_SIZE) + 1};
+
+        /* 0 sends a KEY first and never again */
+        constexpr explicit Stream_Encoder(size_t keyframe_interval = 0) noexcept : m_keyframe_interval{keyframe_interval} {}
+
+        /**
+         * @brief `frame` as a packet, COBS encoded with its delimiter, into `out`, which needs MAX_WIRE_SIZE bytes
+         * @return bytes written
+         */
+        constexpr size_t encode(std::span<const pico_ws2812::WRGB, N> frame, std::span<uint8_t> out) noexcept
+        {
+            using stream_protocol::Packet_Type;
+            const bool key_due{m_key_next || m_frames == 0 || (m_keyframe_interval != 0 && m_frames % m_keyframe_interval == 0)};
+            m_key_next = false;
+            ++m_frames;
+
+            if (!key_due && std::ranges::equal(frame, m_previous, [](auto a, auto b)
+                                               { return detail::bits_of(a) == detail::bits_of(b); }))
+            {
+                return packet(Packet_Type::REPEAT, 0, {}, out);
+            }
+
+            std::array<uint8_t, MAX_PAYLOAD> payload{};
+            constexpr std::array<pico_ws2812::WRGB, N> BLACK{};
+            const auto coded{frame_codec::encode(key_due ? std::span{BLACK} : std::span<const pico_ws2812::WRGB, N>{m_previous}, frame, payload)};
+            std::ranges::copy(frame, std::begin(m_previous));
+            if (coded < N * BYTES_PER_PIXEL)
+            {
+                return packet(key_due ? Packet_Type::KEY : Packet_Type::DELTA, N, std::span{payload}.first(coded), out);
+            }
+            // nothing to gain; raw pixels are as small, and quicker to apply
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                (void)detail::put_bits(payload, ii * BYTES_PER_PIXEL, detail::bits_of(frame[ii]));
+            }
+            return packet(Packet_Type::FRAME, N, std::span{payload}.first(N * BYTES_PER_PIXEL), out);
+        }
+
+        /* the next encode() sends its frame whole, a KEY or FRAME, for when the device may have lost the last one */
+        constexpr void key_next() noexcept
+        {
+            m_key_next = true;
+        }
+
+        /* the END packet */
+        constexpr size_t end(std::span<uint8_t> out) noexcept
+        {
+            return packet(stream_protocol::Packet_Type::END, 0, {}, out);
+        }
+
+        /* the type of the packet encode() last wrote */
+        [[nodiscard]] constexpr stream_protocol::Packet_Type last_type() const noexcept
+        {
+            return m_last_type;
+        }
+
+    private:
+        std::array<pico_ws2812::WRGB, N> m_previous{};
+        size_t m_keyframe_interval;
+        size_t m_frames{0};
+        bool m_key_next{false};
+        uint8_t m_sequence{0};
+        stream_protocol::Packet_Type m_last_type{stream_protocol::Packet_Type::END};
+
+        constexpr size_t packet(stream_protocol::Packet_Type type, size_t count, std::span<const uint8_t> payload,
+                                std::span<uint8_t> out) noexcept
+        {
+            m_last_type = type;
+            return stream_protocol::encode_packet<MAX_PAYLOAD>(type, m_sequence++, 0, static_cast<uint16_t>(count), payload, out);
+        }
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_frame_codec_tests()
+    {
+        using namespace frame_codec;
+        using pico_ws2812::WRGB;
+        using Format = pico_ws2812::Wire_Format<WRGB>;
+        bool rv{true};
+
+        constexpr size_t N{80};
+        const auto decodes_to{[](std::span<const uint8_t> ops, std::array<WRGB, N> from, const std::array<WRGB, N> &to)
+                              {
+                                  std::array<uint32_t, N> words{};
+                                  for (size_t ii{0}; ii < N; ++ii)
+                                  {
+                                      words[ii] = Format::pack(from[ii]);
+                                  }
+                                  if (!valid(ops, N))
+                                  {
+                                      return false;
+                                  }
+                                  frame_codec::apply(ops, words);
+                                  for (size_t ii{0}; ii < N; ++ii)
+                                  {
+                                      if (words[ii] != Format::pack(to[ii]))
+                                      {
+                                          return false;
+                                      }
+                                  }
+                                  return true;
+                              }};
+
+        std::array<WRGB, N> previous{};
+        std::array<WRGB, N> current{};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            previous[ii] = WRGB{.white{static_cast<uint8_t>(ii)}, .red{static_cast<uint8_t>(ii * 7)}, .green{1}, .blue{0}};
+        }
+        std::array<uint8_t, max_encoded_size(N)> ops{};
+
+        // =========================================
+        // nothing changed: skips, one per MAX_RUN
+        current = previous;
+        auto size{encode(previous, current, ops)};
+        rv &= size == 2;
+        rv &= ops[0] == (static_cast<uint8_t>(Op::SKIP) | 63) && ops[1] == (static_cast<uint8_t>(Op::SKIP) | 15);
+        rv &= decodes_to(std::span{ops}.first(size), previous, current);
+
+        // =========================================
+        // a solid block over a gradient is a FILL; the same change everywhere is an XOR
+        for (size_t ii{10}; ii < 20; ++ii)
+        {
+            current[ii] = WRGB{.white{0}, .red{255}, .green{0}, .blue{9}};
+        }
+        size = encode(previous, current, ops);
+        rv &= size == 1 + 1 + 4 + 1;
+        rv &= ops[1] == (static_cast<uint8_t>(Op::FILL) | 9);
+        rv &= decodes_to(std::span{ops}.first(size), previous, current);
+
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            current[ii] = previous[ii];
+            current[ii].green ^= 0x80;
+        }
+        size = encode(previous, current, ops);
+        rv &= size == 2 * 5;
+        rv &= ops[0] == (static_cast<uint8_t>(Op::XOR) | 63);
+        rv &= decodes_to(std::span{ops}.first(size), previous, current);
+
+        // =========================================
+        // every pixel different: literals, and never more than max_encoded_size()
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            current[ii] = WRGB{.white{static_cast<uint8_t>(ii * 3)}, .red{static_cast<uint8_t>(ii * ii)}, .green{2}, .blue{static_cast<uint8_t>(ii)}};
+        }
+        size = encode(previous, current, ops);
+        rv &= size == max_encoded_size(N);
+        rv &= decodes_to(std::span{ops}.first(size), previous, current);
+
+        // =========================================
+        // ops that run past the pixels, stop short of them, or are cut off are turned away
+        constexpr std::array<uint8_t, 2> too_many{static_cast<uint8_t>(Op::SKIP) | 63, static_cast<uint8_t>(Op::SKIP) | 16};
+        rv &= !valid(too_many, N);
+        rv &= !valid(std::span{too_many}.first(1), N);
+        constexpr std::array<uint8_t, 3> cut_off{static_cast<uint8_t>(Op::FILL) | 0, 1, 2};
+        rv &= !valid(cut_off, 1);
+        rv &= valid({}, 0);
+
+        // =========================================
+        // the host encoder picks the packet
+        Stream_Encoder<N> encoder{3};
+        std::array<uint8_t, Stream_Encoder<N>::MAX_WIRE_SIZE> wire{};
+        std::array<WRGB, N> solid{};
+        solid.fill(WRGB{.white{1}, .red{2}, .green{3}, .blue{4}});
+        (void)encoder.encode(solid, wire);
+        rv &= encoder.last_type() == stream_protocol::Packet_Type::KEY;
+        (void)encoder.encode(solid, wire);
+        rv &= encoder.last_type() == stream_protocol::Packet_Type::REPEAT;
+        // every pixel changed, and differently: raw is smaller
+        (void)encoder.encode(previous, wire);
+        rv &= encoder.last_type() == stream_protocol::Packet_Type::FRAME;
+        // a keyframe is due, even though nothing changed
+        (void)encoder.encode(previous, wire);
+        rv &= encoder.last_type() != stream_protocol::Packet_Type::REPEAT;
+        previous[5].red ^= 1;
+        (void)encoder.encode(previous, wire);
+        rv &= encoder.last_type() == stream_protocol::Packet_Type::DELTA;
+        // asked for, a whole frame goes out even in between, though a DELTA would be smaller
+        encoder.key_next();
+        previous[5].red ^= 1;
+        (void)encoder.encode(previous, wire);
+        rv &= encoder.last_type() == stream_protocol::Packet_Type::FRAME;
+
+        return rv;
+    }
+    static_assert(run_frame_codec_tests());
+}
+
+#endif
@@ -0,0 +1,413 @@
+#include "neopixel_output.hpp"
+
+#include "pico/time.h"
+
+#include "ws2812/framebuffer.hpp"
+#include "ws2812/ws2812.hpp"
+
+#if SERIAL_NEOPIXEL_DUAL_CORE
+#include "pico/multicore.h"
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+#endif
+
+namespace
+{
+    constexpr auto NEOPIXEL_PIN{2};
+
+    const PIO PIO_INDEX{pio0};
+    constexpr auto PIO_STATE_MACHINE{0};
+
+    using Frames = pico_ws2812::FrameBuffer<neopixel::Pixel_Frame>;
+
+    struct Output
+    {
+        pico_ws2812::PIO_NeoPixel_Driver driver{PIO_INDEX, PIO_STATE_MACHINE, NEOPIXEL_PIN};
+        pico_ws2812::WRGB_Driver<pico_ws2812::PIO_NeoPixel_Driver> pixel_driver{driver};
+        // writers render into the back buffer while the front one is on the wire
+        Frames pixel_buffer;
+        pico_ws2812::Frame_Scheduler<Frames, pico_ws2812::PIO_NeoPixel_Driver, pico_ws2812::Power_Limiter<pico_ws2812::WRGB, neopixel::LED_COUNT>,
+                                     pico_ws2812::Output_LUT<pico_ws2812::WRGB, neopixel::LED_COUNT>>
+            scheduler{pixel_buffer, driver};
+        // while set, each free moment of the wire gets the next dithered frame of `precise`
+        neopixel::Precise_Frame precise;
+        bool dithering{false};
+        // core 1 has part of a canvas and not yet its PRESENT, so neither the frame nor `precise` may go out
+        bool staging{false};
+    };
+
+    /* Built on first use, so the state machine, DMA channel and its interrupt all belong to whichever core runs
+     * the output side. */
+    Output &output() noexcept
+    {
+        static Output instance;
+        return instance;
+    }
+
+    void apply_set_pixel(size_t index, pico_ws2812::WRGB value) noexcept
+    {
+        output().dithering = false;
+        neopixel::frame().set(index, value);
+        neopixel::mark_dirty();
+    }
+
+    void apply_fill(pico_ws2812::WRGB value) noexcept
+    {
+        output().dithering = false;
+        neopixel::frame().fill(value);
+        neopixel::mark_dirty();
+    }
+
+    void apply_output_settings(const pico_ws2812::Output_Settings &settings) noexcept
+    {
+        output().scheduler.change_output([&settings](auto &lut)
+                                         { lut.set(settings); },
+                                         time_us_32());
+    }
+
+#if SERIAL_NEOPIXEL_DUAL_CORE
+    struct Output_Message
+    {
+        enum struct Kind : uint8_t
+        {
+            SET_PIXEL,
+            // present_canvas(): the changed pixels staged, then one PRESENT; nothing is sent in between, so a frame
+            // never goes out half written
+            STAGE_PIXEL,
+            PRESENT,
+            // present_precise_canvas(): the same for the 16-bit frame, a stored word at a time
+            STAGE_PRECISE,
+            PRESENT_PRECISE,
+            FILL,
+            SET_COALESCE_WINDOW,
+            // the budget in value and the idle draw in index, then the channels' draw packed like a pixel
+            SET_POWER_BUDGET,
+            SET_CHANNEL_CURRENTS,
+            // gamma x 100 in index and the brightness in value; the white balance packed like a pixel
+            SET_OUTPUT_LEVELS,
+            SET_WHITE_BALANCE,
+            REQUEST_STATS,
+        };
+        Kind kind;
+        uint16_t index;
+        uint32_t value; // a packed wire word, or the window
+    };
+
+    // deep enough that a burst of commands doesn't make the shell wait on the output core
+    constexpr uint OUTPUT_QUEUE_DEPTH{32};
+
+    queue_t to_output;
+    queue_t stats_reply;
+
+    void handle(const Output_Message &msg) noexcept
+    {
+        using Kind = Output_Message::Kind;
+        using format = neopixel::Pixel_Frame::format;
+        switch (msg.kind)
+        {
+        case Kind::SET_PIXEL:
+            apply_set_pixel(msg.index, format::unpack(msg.value));
+            break;
+        case Kind::STAGE_PIXEL:
+            // or the next dithered frame would be quantized over the pixels staged so far
+            output().dithering = false;
+            output().staging = true;
+            neopixel::frame().words()[msg.index] = msg.value;
+            break;
+        case Kind::PRESENT:
+            output().dithering = false;
+            output().staging = false;
+            neopixel::mark_dirty();
+            break;
+        case Kind::STAGE_PRECISE:
+            output().staging = true;
+            output().precise.values()[msg.index] = msg.value;
+            break;
+        case Kind::PRESENT_PRECISE:
+            output().dithering = true;
+            output().staging = false;
+            break;
+        case Kind::FILL:
+            apply_fill(format::unpack(msg.value));
+            break;
+        case Kind::SET_COALESCE_WINDOW:
+            output().scheduler.set_coalesce_window(msg.value);
+            break;
+        case Kind::SET_POWER_BUDGET:
+        {
+            auto budget{output().scheduler.power().budget()};
+            budget.budget_ma = msg.value;
+            budget.idle_ma = static_cast<uint8_t>(msg.index);
+            output().scheduler.power().set_budget(budget);
+            output().scheduler.resend(time_us_32());
+            break;
+        }
+        case Kind::SET_CHANNEL_CURRENTS:
+        {
+            auto budget{output().scheduler.power().budget()};
+            budget.full_ma = format::unpack(msg.value);
+            output().scheduler.power().set_budget(budget);
+            break;
+        }
+        case Kind::SET_OUTPUT_LEVELS:
+        {
+            auto settings{output().scheduler.output().settings()};
+            settings.gamma_x100 = msg.index;
+            settings.brightness = static_cast<uint8_t>(msg.value);
+            apply_output_settings(settings);
+            break;
+        }
+        case Kind::SET_WHITE_BALANCE:
+        {
+            auto settings{output().scheduler.output().settings()};
+            settings.balance = format::unpack(msg.value);
+            apply_output_settings(settings);
+            break;
+        }
+        case Kind::REQUEST_STATS:
+        {
+            const auto stats{output().scheduler.stats()};
+            queue_add_blocking(&stats_reply, &stats);
+            break;
+        }
+        }
+    }
+
+    /* core 1: apply whatever the shell sent, then give the frame clock its turn, unless a canvas is part way over */
+    void output_core_main()
+    {
+        (void)output();
+        for (;;)
+        {
+            Output_Message msg;
+            while (queue_try_remove(&to_output, &msg))
+            {
+                handle(msg);
+            }
+            if (!output().staging)
+            {
+                neopixel::update();
+            }
+            tight_loop_contents();
+        }
+    }
+
+    void post(const Output_Message &msg) noexcept
+    {
+        queue_add_blocking(&to_output, &msg);
+    }
+
+    // core 0's own copies: the frame as it has been posted, and the canvas whole frames are drawn on
+    neopixel::Pixel_Frame posted_frame;
+    neopixel::Pixel_Frame shell_canvas;
+    neopixel::Precise_Frame posted_precise;
+    neopixel::Precise_Frame shell_precise;
+    // core 1 is dithering, so posted_frame isn't what it has any more
+    bool posted_precise_last{false};
+    // core 1 has the one that counts; this is the last one posted to it
+    pico_ws2812::Power_Budget posted_budget{pico_ws2812::DEFAULT_POWER_BUDGET};
+    pico_ws2812::Output_Settings posted_output_settings{pico_ws2812::DEFAULT_OUTPUT_SETTINGS};
+#endif
+}
+
+namespace neopixel
+{
+#if SERIAL_NEOPIXEL_DUAL_CORE
+    void start() noexcept
+    {
+        queue_init(&to_output, sizeof(Output_Message), OUTPUT_QUEUE_DEPTH);
+        queue_init(&stats_reply, sizeof(pico_ws2812::Frame_Scheduler_Stats), 1);
+        multicore_launch_core1(output_core_main);
+    }
+
+    void set_pixel(size_t index, pico_ws2812::WRGB value) noexcept
+    {
+        posted_frame.set(index, value);
+        shell_canvas.set(index, value);
+        post(Output_Message{.kind = Output_Message::Kind::SET_PIXEL, .index = static_cast<uint16_t>(index), .value = Pixel_Frame::format::pack(value)});
+    }
+
+    Pixel_Frame &canvas() noexcept
+    {
+        return shell_canvas;
+    }
+
+    /* only the pixels that differ from what core 1 already has cross over; all of them after dithering */
+    void present_canvas() noexcept
+    {
+        for (size_t ii{0}; ii < LED_COUNT; ++ii)
+        {
+            const auto word{shell_canvas.words()[ii]};
+            if (word != posted_frame.words()[ii] || posted_precise_last)
+            {
+                posted_frame.words()[ii] = word;
+                post(Output_Message{.kind = Output_Message::Kind::STAGE_PIXEL, .index = static_cast<uint16_t>(ii), .value = word});
+            }
+        }
+        posted_precise_last = false;
+        post(Output_Message{.kind = Output_Message::Kind::PRESENT, .index = 0, .value = 0});
+    }
+
+    Precise_Frame &precise_canvas() noexcept
+    {
+        return shell_precise;
+    }
+
+    void present_precise_canvas() noexcept
+    {
+        const auto shell{shell_precise.values()};
+        const auto posted{posted_precise.values()};
+        for (size_t ii{0}; ii < std::size(shell); ++ii)
+        {
+            if (shell[ii] != posted[ii])
+            {
+                posted[ii] = shell[ii];
+                post(Output_Message{.kind = Output_Message::Kind::STAGE_PRECISE, .index = static_cast<uint16_t>(ii), .value = shell[ii]});
+            }
+        }
+        posted_precise_last = true;
+        post(Output_Message{.kind = Output_Message::Kind::PRESENT_PRECISE, .index = 0, .value = 0});
+    }
+
+    void fill(pico_ws2812::WRGB value) noexcept
+    {
+        posted_frame.fill(value);
+        shell_canvas.fill(value);
+        post(Output_Message{.kind = Output_Message::Kind::FILL, .index = 0, .value = Pixel_Frame::format::pack(value)});
+    }
+
+    void set_coalesce_window(uint32_t window_us) noexcept
+    {
+        post(Output_Message{.kind = Output_Message::Kind::SET_COALESCE_WINDOW, .index = 0, .value = window_us});
+    }
+
+    void set_power_budget(const pico_ws2812::Power_Budget &budget) noexcept
+    {
+        posted_budget = budget;
+        post(Output_Message{.kind = Output_Message::Kind::SET_CHANNEL_CURRENTS, .index = 0, .value = Pixel_Frame::format::pack(budget.full_ma)});
+        post(Output_Message{.kind = Output_Message::Kind::SET_POWER_BUDGET, .index = budget.idle_ma, .value = budget.budget_ma});
+    }
+
+    pico_ws2812::Power_Budget power_budget() noexcept
+    {
+        return posted_budget;
+    }
+
+    /* only what changed crosses over: each message rebuilds the tables */
+    void set_output_settings(const pico_ws2812::Output_Settings &settings) noexcept
+    {
+        const auto balance{Pixel_Frame::format::pack(settings.balance)};
+        if (balance != Pixel_Frame::format::pack(posted_output_settings.balance))
+        {
+            post(Output_Message{.kind = Output_Message::Kind::SET_WHITE_BALANCE, .index = 0, .value = balance});
+        }
+        if (settings.gamma_x100 != posted_output_settings.gamma_x100 || settings.brightness != posted_output_settings.brightness)
+        {
+            post(Output_Message{.kind = Output_Message::Kind::SET_OUTPUT_LEVELS, .index = settings.gamma_x100, .value = settings.brightness});
+        }
+        posted_output_settings = settings;
+    }
+
+    pico_ws2812::Output_Settings output_settings() noexcept
+    {
+        return posted_output_settings;
+    }
+
+    /* a round trip: everything posted before it has been applied by the time it returns */
+    pico_ws2812::Frame_Scheduler_Stats stats() noexcept
+    {
+        post(Output_Message{.kind = Output_Message::Kind::REQUEST_STATS, .index = 0, .value = 0});
+        pico_ws2812::Frame_Scheduler_Stats stats;
+        queue_remove_blocking(&stats_reply, &stats);
+        return stats;
+    }
+#else
+    void start() noexcept
+    {
+        (void)output();
+    }
+
+    void set_pixel(size_t index, pico_ws2812::WRGB value) noexcept
+    {
+        apply_set_pixel(index, value);
+    }
+
+    Pixel_Frame &canvas() noexcept
+    {
+        return frame();
+    }
+
+    void present_canvas() noexcept
+    {
+        output().dithering = false;
+        mark_dirty();
+    }
+
+    Precise_Frame &precise_canvas() noexcept
+    {
+        return output().precise;
+    }
+
+    void present_precise_canvas() noexcept
+    {
+        output().dithering = true;
+    }
+
+    void fill(pico_ws2812::WRGB value) noexcept
+    {
+        apply_fill(value);
+    }
+
+    void set_coalesce_window(uint32_t window_us) noexcept
+    {
+        output().scheduler.set_coalesce_window(window_us);
+    }
+
+    void set_power_budget(const pico_ws2812::Power_Budget &budget) noexcept
+    {
+        output().scheduler.power().set_budget(budget);
+        output().scheduler.resend(time_us_32());
+    }
+
+    pico_ws2812::Power_Budget power_budget() noexcept
+    {
+        return output().scheduler.power().budget();
+    }
+
+    void set_output_settings(const pico_ws2812::Output_Settings &settings) noexcept
+    {
+        apply_output_settings(settings);
+    }
+
+    pico_ws2812::Output_Settings output_settings() noexcept
+    {
+        return output().scheduler.output().settings();
+    }
+
+    pico_ws2812::Frame_Scheduler_Stats stats() noexcept
+    {
+        return output().scheduler.stats();
+    }
+#endif
+
+    Pixel_Frame &frame() noexcept
+    {
+        return output().pixel_buffer.back();
+    }
+
+    void mark_dirty() noexcept
+    {
+        output().scheduler.mark_dirty(time_us_32());
+    }
+
+    void update() noexcept
+    {
+        auto &out{output()};
+        if (out.dithering && !out.scheduler.dirty() && !out.driver.busy())
+        {
+            out.precise.quantize(frame().words());
+            mark_dirty();
+        }
+        out.scheduler.update(time_us_32());
+    }
+}
@@ -0,0 +1,62 @@
+#if !defined(NEOPIXEL_OUTPUT_HPP)
+#define NEOPIXEL_OUTPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ws2812/dither.hpp"
+#include "ws2812/frame_scheduler.hpp"
+#include "ws2812/output_lut.hpp"
+#include "ws2812/power_limiter.hpp"
+#include "ws2812/wire_frame.hpp"
+
+/* The strip, as the rest of the firmware sees it.
+ *
+ * There are two sides.  The shell side (set_pixel(), fill(), ...) is what commands call.  The output side owns the
+ * frames, the scheduler and the PIO; renderers draw into frame() and call mark_dirty(), and update() sends whatever
+ * changed.
+ *
+ * Built with SERIAL_NEOPIXEL_DUAL_CORE, the output side runs on core 1, launched by start(), and the shell side
+ * only posts messages to it, so serial handling never holds up a frame.  Otherwise both sides share the core 0
+ * superloop and the shell side writes the frame directly.
+ *
+ * A frame can also be drawn at 16 bits a channel, into precise_canvas().  Once presented, the output side sends it
+ * dithered, a new 8-bit frame each time the wire is free, until anything is drawn at 8 bits again.
+ *
+ * Whatever is drawn goes out through the output settings, gamma, brightness and white balance, as one table lookup
+ * per channel; the frames themselves stay as drawn. */
+namespace neopixel
+{
+    inline constexpr size_t LED_COUNT{24};
+    using Pixel_Frame = pico_ws2812::Wire_Frame<pico_ws2812::WRGB, LED_COUNT>;
+    using Precise_Frame = pico_ws2812::Dithered_Frame<LED_COUNT>;
+
+    // shell side
+    void start() noexcept;
+    void set_pixel(size_t index, pico_ws2812::WRGB value) noexcept;
+    void fill(pico_ws2812::WRGB value) noexcept;
+    /* The shell side's copy of the whole frame, for drawing in place: draw into canvas(), then present_canvas().
+     * It starts out as the frame last presented, whoever drew it.  Built single core it is the back buffer. */
+    [[nodiscard]] Pixel_Frame &canvas() noexcept;
+    void present_canvas() noexcept;
+    /* as canvas(), at 16 bits a channel; presenting it starts the dithering */
+    [[nodiscard]] Precise_Frame &precise_canvas() noexcept;
+    void present_precise_canvas() noexcept;
+    void set_coalesce_window(uint32_t window_us) noexcept;
+    /* frames that would draw more than the budget are sent dimmed, all pixels by the same factor; the frame up
+     * now is sent again under the new budget */
+    void set_power_budget(const pico_ws2812::Power_Budget &budget) noexcept;
+    [[nodiscard]] pico_ws2812::Power_Budget power_budget() noexcept;
+    /* the frame up now is sent again through the new settings */
+    void set_output_settings(const pico_ws2812::Output_Settings &settings) noexcept;
+    [[nodiscard]] pico_ws2812::Output_Settings output_settings() noexcept;
+    [[nodiscard]] pico_ws2812::Frame_Scheduler_Stats stats() noexcept;
+
+    // output side
+    /* the back buffer; never the frame on the wire */
+    [[nodiscard]] Pixel_Frame &frame() noexcept;
+    void mark_dirty() noexcept;
+    void update() noexcept;
+}
+
+#endif
@@ -0,0 +1,212 @@
+#include "pattern_engine.hpp"
+
+#include <algorithm>
+
+#include "pico/time.h"
+
+#include "constexpr_math.hpp"
+#include "neopixel_output.hpp"
+#include "pattern_vm.hpp"
+#include "timeline.hpp"
+#include "ws2812/color_space.hpp"
+
+namespace
+{
+    constexpr size_t SINE_TABLE_LENGTH{1024};
+    constexpr size_t SRGB_GAMMA_CURVE_LENGTH{256};
+    // a sine period every 256 steps: at DEFAULT_FPS, the speed the old blocking loop ran at
+    constexpr uint32_t SINE_INDEX_PER_STEP{4};
+    // a turn of the hue circle every 256 steps too
+    constexpr uint32_t HUE_PER_STEP{256};
+
+    [[nodiscard]] constexpr uint8_t sine_at(uint32_t index) noexcept
+    {
+        constexpr const auto &TABLE{SINE_TABLE<SINE_TABLE_LENGTH>};
+        return TABLE[index & SINE_TABLE_MASK(TABLE)];
+    }
+
+    /* a 0-255 intensity, gamma corrected and scaled to the pattern's level, as a white pixel; the scaling keeps
+     * its fraction, which is what dithering shows */
+    [[nodiscard]] constexpr pico_ws2812::WRGB16 white_at(uint8_t intensity, uint8_t level) noexcept
+    {
+        const uint32_t gamma{SRGB_GAMMA_CURVE<SRGB_GAMMA_CURVE_LENGTH>[intensity]};
+        return pico_ws2812::WRGB16{.white{static_cast<uint16_t>(gamma * (level + 1U))}, .red{0}, .green{0}, .blue{0}};
+    }
+
+    /* an 8-bit wire word scaled to the pattern's level, keeping the fraction as white_at() does */
+    [[nodiscard]] constexpr pico_ws2812::WRGB16 scaled_to(uint32_t word, uint8_t level) noexcept
+    {
+        const auto pixel{pico_ws2812::Wire_Format<pico_ws2812::WRGB>::unpack(word)};
+        const auto scaled{[level](uint8_t channel)
+                          { return static_cast<uint16_t>(channel * (level + 1U)); }};
+        return pico_ws2812::WRGB16{.white{scaled(pixel.white)}, .red{scaled(pixel.red)}, .green{scaled(pixel.green)}, .blue{scaled(pixel.blue)}};
+    }
+
+    /* the top 8 bits of each channel */
+    [[nodiscard]] constexpr pico_ws2812::WRGB truncated(pico_ws2812::WRGB16 pixel) noexcept
+    {
+        return pico_ws2812::WRGB{.white{static_cast<uint8_t>(pixel.white >> 8)},
+                                 .red{static_cast<uint8_t>(pixel.red >> 8)},
+                                 .green{static_cast<uint8_t>(pixel.green >> 8)},
+                                 .blue{static_cast<uint8_t>(pixel.blue >> 8)}};
+    }
+
+    // what runs in place of a pattern, when running is nullptr
+    enum struct Upload : uint8_t
+    {
+        NONE,
+        TIMELINE,
+        PROGRAM,
+    };
+
+    struct Engine
+    {
+        const pattern_engine::Pattern_Entry *running{nullptr};
+        pattern_engine::Pattern_Params params{};
+        uint32_t fps{0};
+        pattern_engine::Frame_Ticker ticker;
+        bool dithering{true};
+        timeline::Player<neopixel::LED_COUNT> timeline;
+        pattern_vm::Machine machine;
+        Upload upload{Upload::NONE};
+        uint32_t over_budget{0};
+    };
+
+    Engine engine;
+}
+
+namespace pattern_engine
+{
+    pico_ws2812::WRGB16 sine_chase(uint32_t step, size_t pixel, const Pattern_Params &params) noexcept
+    {
+        const auto index{step * SINE_INDEX_PER_STEP + static_cast<uint32_t>(pixel * SINE_TABLE_LENGTH / neopixel::LED_COUNT)};
+        return white_at(sine_at(index), params.level);
+    }
+
+    pico_ws2812::WRGB16 breathe(uint32_t step, [[maybe_unused]] size_t pixel, const Pattern_Params &params) noexcept
+    {
+        return white_at(sine_at(step * SINE_INDEX_PER_STEP), params.level);
+    }
+
+    pico_ws2812::WRGB16 rainbow(uint32_t step, size_t pixel, const Pattern_Params &params) noexcept
+    {
+        const auto hue{static_cast<uint16_t>(step * HUE_PER_STEP + pixel * 65536U / neopixel::LED_COUNT)};
+        return scaled_to(pico_ws2812::hsv_to_wrgb(pico_ws2812::HSV{.hue = hue, .saturation = 255, .value = 255}), params.level);
+    }
+
+    void start(const Pattern_Entry &pattern, uint32_t fps, Pattern_Params params) noexcept
+    {
+        if (pattern.pixel == nullptr)
+        {
+            stop();
+            return;
+        }
+        engine.running = &pattern;
+        engine.upload = Upload::NONE;
+        engine.params = params;
+        engine.fps = fps;
+        engine.ticker.start(time_us_64(), 1'000'000U / fps);
+    }
+
+    void play(std::span<const uint8_t> program) noexcept
+    {
+        engine.timeline.load(program);
+        engine.running = nullptr;
+        engine.upload = Upload::TIMELINE;
+        engine.fps = std::min<uint32_t>(engine.timeline.fps(), MAX_FPS);
+        engine.ticker.start(time_us_64(), 1'000'000U / engine.fps);
+    }
+
+    void run(std::span<const uint8_t> program) noexcept
+    {
+        engine.machine.load(program);
+        engine.running = nullptr;
+        engine.upload = Upload::PROGRAM;
+        engine.over_budget = 0;
+        engine.fps = std::min<uint32_t>(engine.machine.fps(), MAX_FPS);
+        engine.ticker.start(time_us_64(), 1'000'000U / engine.fps);
+    }
+
+    void stop() noexcept
+    {
+        engine.running = nullptr;
+        engine.upload = Upload::NONE;
+    }
+
+    void set_dithering(bool on) noexcept
+    {
+        engine.dithering = on;
+    }
+
+    bool dithering() noexcept
+    {
+        return engine.dithering;
+    }
+
+    /* Draws the whole frame into the canvas and presents it, if a step is due; presenting only hands the frame
+     * to the output side, which flushes it in its own time. */
+    void update() noexcept
+    {
+        if (engine.running == nullptr && engine.upload == Upload::NONE)
+        {
+            return;
+        }
+        const auto step{engine.ticker.tick(time_us_64())};
+        if (!step.has_value())
+        {
+            return;
+        }
+        if (engine.upload == Upload::TIMELINE)
+        {
+            auto &canvas{neopixel::canvas()};
+            if (engine.timeline.advance_to(*step, canvas.words()))
+            {
+                neopixel::present_canvas();
+            }
+            return;
+        }
+        if (engine.upload == Upload::PROGRAM)
+        {
+            auto &canvas{neopixel::canvas()};
+            const auto result{engine.machine.run(*step, canvas.words(), PROGRAM_BUDGET)};
+            if (result.pixels < neopixel::LED_COUNT)
+            {
+                ++engine.over_budget;
+            }
+            neopixel::present_canvas();
+            return;
+        }
+        if (engine.dithering)
+        {
+            auto &canvas{neopixel::precise_canvas()};
+            for (size_t ii{0}; ii < neopixel::LED_COUNT; ++ii)
+            {
+                canvas.set(ii, engine.running->pixel(*step, ii, engine.params));
+            }
+            neopixel::present_precise_canvas();
+            return;
+        }
+        auto &canvas{neopixel::canvas()};
+        for (size_t ii{0}; ii < neopixel::LED_COUNT; ++ii)
+        {
+            canvas.set(ii, truncated(engine.running->pixel(*step, ii, engine.params)));
+        }
+        neopixel::present_canvas();
+    }
+
+    Pattern_Stats stats() noexcept
+    {
+        if (engine.running == nullptr && engine.upload == Upload::NONE)
+        {
+            return {};
+        }
+        return Pattern_Stats{
+            .name = engine.upload == Upload::TIMELINE ? "timeline" : engine.upload == Upload::PROGRAM ? "program" : engine.running->name,
+            .target_fps = engine.fps,
+            .actual_fps_x10 = engine.ticker.actual_fps_x10(),
+            .frames = engine.ticker.frames(),
+            .skipped = engine.ticker.skipped(),
+            .over_budget = engine.over_budget,
+        };
+    }
+}
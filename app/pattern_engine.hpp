@@ -0,0 +1,193 @@
+#if !defined(PATTERN_ENGINE_HPP)
+#define PATTERN_ENGINE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "Command_Registry.hpp"
+#include "ws2812/dither.hpp"
+#include "ws2812/wire_frame.hpp"
+
+/* Animations, run from the superloop.
+ *
+ * A pattern is a function from (step, pixel) to a colour.  update() is called every pass; when the next frame is
+ * due it draws every pixel into the canvas and presents it, and otherwise returns at once, so a running pattern
+ * costs the shell one frame's drawing at most per pass and never a wait.  Steps come from the clock, not from a
+ * count of frames drawn, so a pattern that misses frames keeps its speed and skips ahead.
+ *
+ * Patterns colour at 16 bits a channel.  With dithering on (the default) the frame goes to the precise canvas and
+ * the output side dithers it down to 8 bits, so a dim pattern fades smoothly instead of in a handful of steps;
+ * with it off each channel is cut to its top 8 bits.
+ *
+ * A timeline uploaded with `stream` (timeline.hpp) runs here too, in place of a pattern, at its own frame rate.  It
+ * is moved on a frame at a time rather than drawn from scratch, and only the tracks that changed are drawn, at 8
+ * bits.  So does a pattern program (pattern_vm.hpp), run once per pixel per frame for no more than PROGRAM_BUDGET
+ * instructions in all; a frame that runs out is presented as far as it got. */
+namespace pattern_engine
+{
+    struct Pattern_Params
+    {
+        uint8_t level; // 255 is full brightness
+    };
+
+    using Pixel_Fn = pico_ws2812::WRGB16 (*)(uint32_t step, size_t pixel, const Pattern_Params &params);
+
+    struct Pattern_Entry
+    {
+        std::string_view name;
+        Pixel_Fn pixel; // nullptr stops whatever is running
+        std::string_view help;
+    };
+
+    struct Pattern_Stats
+    {
+        std::string_view name; // empty when stopped
+        uint32_t target_fps;
+        uint32_t actual_fps_x10; // frames drawn per second since the start, in tenths
+        uint32_t frames;         // drawn
+        uint32_t skipped;        // steps that came and went without being drawn
+        uint32_t over_budget;    // frames a program ran out of instructions in
+    };
+
+    /* Fixed-rate frame clock: which step is due, if any, given the time */
+    class Frame_Ticker
+    {
+    public:
+        constexpr void start(uint64_t now_us, uint32_t period_us) noexcept
+        {
+            m_start_us = now_us;
+            m_period_us = period_us;
+            m_next_us = now_us;
+            m_drawn_us = now_us;
+            m_last_step = 0;
+            m_frames = 0;
+            m_skipped = 0;
+        }
+
+        /**
+         * @brief the step to draw now, or nothing if the next one isn't due yet. When a pass comes late, the steps
+         *  in between are skipped, not drawn in a burst.
+         */
+        [[nodiscard]] constexpr std::optional<uint32_t> tick(uint64_t now_us) noexcept
+        {
+            if (now_us < m_next_us)
+            {
+                return std::nullopt;
+            }
+            const auto step{static_cast<uint32_t>((now_us - m_start_us) / m_period_us)};
+            if (m_frames != 0)
+            {
+                m_skipped += step - m_last_step - 1;
+            }
+            m_last_step = step;
+            m_drawn_us = now_us;
+            ++m_frames;
+            m_next_us = m_start_us + static_cast<uint64_t>(step + 1) * m_period_us;
+            return step;
+        }
+
+        [[nodiscard]] constexpr uint32_t frames() const noexcept { return m_frames; }
+        [[nodiscard]] constexpr uint32_t skipped() const noexcept { return m_skipped; }
+        /* up to the end of the latest frame's period, so the rate is the target's from the first frame on, and
+         * doesn't sag between frames */
+        [[nodiscard]] constexpr uint32_t actual_fps_x10() const noexcept
+        {
+            const auto elapsed{m_drawn_us - m_start_us + m_period_us};
+            return static_cast<uint32_t>(uint64_t{m_frames} * 10'000'000U / elapsed);
+        }
+
+    private:
+        uint64_t m_start_us{0};
+        uint64_t m_next_us{0};
+        uint64_t m_drawn_us{0}; // when the latest frame was drawn
+        uint32_t m_period_us{1};
+        uint32_t m_last_step{0};
+        uint32_t m_frames{0};
+        uint32_t m_skipped{0};
+    };
+
+    inline constexpr uint32_t DEFAULT_FPS{50};
+    inline constexpr uint32_t MAX_FPS{200};
+    // full brightness is far too bright to look at, so patterns start at a sixteenth of it
+    inline constexpr uint8_t DEFAULT_LEVEL{16};
+    // instructions a program may run per frame, across every pixel: over 300 a pixel for a 24 LED strip
+    inline constexpr uint32_t PROGRAM_BUDGET{8192};
+
+    /* a sine wave travelling along the strip, one period per strip length */
+    [[nodiscard]] pico_ws2812::WRGB16 sine_chase(uint32_t step, size_t pixel, const Pattern_Params &params) noexcept;
+    /* the whole strip rising and falling together */
+    [[nodiscard]] pico_ws2812::WRGB16 breathe(uint32_t step, size_t pixel, const Pattern_Params &params) noexcept;
+    /* the hue circle spread along the strip, turning */
+    [[nodiscard]] pico_ws2812::WRGB16 rainbow(uint32_t step, size_t pixel, const Pattern_Params &params) noexcept;
+
+    /* Every pattern `pattern` can run, by name */
+    inline constexpr command_registry::Registry PATTERNS{std::array{
+        Pattern_Entry{"chase", sine_chase, "a sine wave running along the strip"},
+        Pattern_Entry{"breathe", breathe, "every pixel fading in and out together"},
+        Pattern_Entry{"rainbow", rainbow, "every hue along the strip, turning"},
+        Pattern_Entry{"stop", nullptr, "stop the running pattern, leaving its last frame up"}}};
+
+    /* runs `pattern` from the next update(), or stops if it has no pixel function */
+    void start(const Pattern_Entry &pattern, uint32_t fps, Pattern_Params params) noexcept;
+    /**
+     * @brief plays `program` from the next update(), in place of any pattern; it is copied, so the caller's buffer
+     *  is free again once this returns.
+     *  PRECONDITION: timeline::validate(program, neopixel::LED_COUNT) == timeline::Status::OK
+     */
+    void play(std::span<const uint8_t> program) noexcept;
+    /**
+     * @brief runs `program` from the next update(), in place of any pattern, copied as play() copies a timeline.
+     *  PRECONDITION: pattern_vm::validate(program) == pattern_vm::Status::OK
+     */
+    void run(std::span<const uint8_t> program) noexcept;
+    void stop() noexcept;
+    void set_dithering(bool on) noexcept;
+    [[nodiscard]] bool dithering() noexcept;
+    void update() noexcept;
+    [[nodiscard]] Pattern_Stats stats() noexcept;
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_frame_ticker_tests()
+    {
+        bool rv{true};
+
+        pattern_engine::Frame_Ticker dut;
+        dut.start(1000, 100);
+
+        // =========================================
+        // the first frame is due at once, the next a period after it
+        rv &= dut.tick(1000) == 0U;
+        rv &= !dut.tick(1099).has_value();
+        rv &= dut.tick(1100) == 1U;
+        rv &= dut.tick(1150) == std::nullopt;
+
+        // =========================================
+        // a late pass draws the step it's in and skips the ones it missed
+        rv &= dut.tick(1475) == 4U;
+        rv &= dut.skipped() == 2;
+        rv &= !dut.tick(1499).has_value();
+        rv &= dut.tick(1500) == 5U;
+
+        rv &= dut.frames() == 4;
+        rv &= dut.actual_fps_x10() == 4 * 10'000'000U / 600;
+
+        // =========================================
+        // on time from the start, the rate is the target's
+        dut.start(0, 20'000);
+        rv &= dut.tick(0) == 0U;
+        rv &= dut.actual_fps_x10() == 500;
+        rv &= dut.tick(20'000) == 1U;
+        rv &= dut.actual_fps_x10() == 500;
+
+        return rv;
+    }
+    static_assert(run_frame_ticker_tests());
+}
+
+#endif
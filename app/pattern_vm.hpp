@@ -0,0 +1,534 @@
+#if !defined(PATTERN_VM_HPP)
+#define PATTERN_VM_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "constexpr_math.hpp"
+#include "stream_protocol.hpp"
+#include "ws2812/color_math.hpp"
+#include "ws2812/color_space.hpp"
+
+/* Patterns as programs: uploaded in a PROGRAM packet of the `stream` upload (stream_protocol.hpp) and run by the
+ * pattern engine once per pixel per frame, instead of compiled into the firmware.
+ *
+ * The machine has REGISTERS 32-bit registers.  Each pixel starts with r0 the pixel's index, r1 the frame's step,
+ * r2 the number of pixels, and the rest 0, and ends at an OUT, whose register is the pixel, as a wire word.  Every
+ * instruction is 4 bytes, the op first:
+ *
+ *   op d a b      registers d, a and b
+ *   op d imm16    a 16-bit constant, little endian (LDI, LDHI)
+ *   op d a k      a register and an 8-bit constant (the *I ops, CHAN)
+ *   op a off16    a jump, off16 instructions on from the next one, signed (JMP, BRZ, BRNZ)
+ *
+ * A program is a 4 byte header, VERSION, frames per second and two zero bytes, then its instructions.
+ *
+ * A program can't reach outside itself: validate() turns away an unknown op, a register past the last, a constant
+ * out of range, a jump off the end, or a last instruction that would run off it, before anything runs.  It can
+ * loop, so run() is given a budget of instructions for the whole frame, and when that is spent, the frame stops
+ * where it is; the pixels not reached keep the colour they had. */
+namespace pattern_vm
+{
+    enum struct Op : uint8_t
+    {
+        LDI,   // d = imm16
+        LDHI,  // d's top half = imm16
+        MOV,   // d = a
+        ADD,   // d = a + b, and so on, wrapping
+        SUB,
+        MUL,
+        DIV,   // 0 if b is
+        MOD,   // 0 if b is
+        AND,
+        OR,
+        XOR,
+        SHL,   // by b, up to 31
+        SHR,
+        MIN,
+        MAX,
+        SLT,   // d = a < b
+        ADDI,  // d = a + k, k signed
+        SHLI,  // by k, up to 31
+        SHRI,
+        ANDI,
+        SIN,   // d = SINE_TABLE<256>[a & 255]: 0 - 255 - 0 over a period of 256
+        GAMMA, // d = SRGB_GAMMA_CURVE<256>[a & 255]
+        CHAN,  // d = a & 255 as channel k of a wire word: 0 white, 1 red, 2 green, 3 blue
+        HSV,   // d = the wire word of hue a (65536ths of a turn), full saturation, value b & 255
+        CSCALE, // the rest are color_math on wire words: d = scale(a, b & 255)
+        CADD,   // d = add_saturating(a, b)
+        CLERP,  // d = lerp(d, a, b & 255)
+        CMAX,   // d = maximum(a, b)
+        JMP,
+        BRZ,   // jump if a is 0
+        BRNZ,  // jump if a isn't
+        OUT,   // the pixel is a; on to the next
+    };
+
+    enum struct Status : uint8_t
+    {
+        OK,
+        TOO_LONG,
+        BAD_HEADER,      // an unknown version, no frames per second, or the reserved bytes not 0
+        BAD_LENGTH,      // no instructions, or not a whole number of them
+        BAD_OP,
+        BAD_REGISTER,
+        BAD_CONSTANT,    // a shift or channel out of range
+        BAD_JUMP,        // to before the start or past the end
+        RUNS_OFF_THE_END // the last instruction isn't an OUT or a JMP
+    };
+
+    inline constexpr uint8_t VERSION{1};
+    inline constexpr size_t HEADER_SIZE{4};
+    inline constexpr size_t INSTRUCTION_SIZE{4};
+    inline constexpr size_t REGISTERS{16};
+    inline constexpr size_t MAX_INSTRUCTIONS{256};
+    inline constexpr size_t MAX_SIZE{HEADER_SIZE + MAX_INSTRUCTIONS * INSTRUCTION_SIZE};
+
+    [[nodiscard]] constexpr std::string_view describe(Status status) noexcept
+    {
+        switch (status)
+        {
+        case Status::OK:
+            return "ok";
+        case Status::TOO_LONG:
+            return "too long";
+        case Status::BAD_HEADER:
+            return "bad header";
+        case Status::BAD_LENGTH:
+            return "not a whole number of instructions";
+        case Status::BAD_OP:
+            return "an unknown op";
+        case Status::BAD_REGISTER:
+            return "a register that doesn't exist";
+        case Status::BAD_CONSTANT:
+            return "a shift or channel out of range";
+        case Status::BAD_JUMP:
+            return "a jump off the program";
+        case Status::RUNS_OFF_THE_END:
+            return "runs off the end";
+        }
+        return "?";
+    }
+
+    /* the instruction, as the 4 bytes of a program read little endian */
+    [[nodiscard]] constexpr uint32_t encode(Op op, uint8_t d, uint8_t a = 0, uint8_t b = 0) noexcept
+    {
+        return static_cast<uint32_t>(op) | (uint32_t{d} << 8) | (uint32_t{a} << 16) | (uint32_t{b} << 24);
+    }
+    [[nodiscard]] constexpr uint32_t encode_immediate(Op op, uint8_t d, uint16_t imm) noexcept
+    {
+        return static_cast<uint32_t>(op) | (uint32_t{d} << 8) | (uint32_t{imm} << 16);
+    }
+    [[nodiscard]] constexpr uint32_t encode_jump(Op op, uint8_t a, int16_t offset) noexcept
+    {
+        return encode_immediate(op, a, static_cast<uint16_t>(offset));
+    }
+
+    namespace detail
+    {
+        enum struct Form : uint8_t
+        {
+            REGISTERS, // d a b, those of them the op uses
+            IMMEDIATE,
+            CONSTANT,
+            JUMP,
+        };
+
+        struct Op_Shape
+        {
+            Form form;
+            uint8_t registers; // how many of d, a, b it reads or writes
+            uint8_t max_constant;
+        };
+
+        [[nodiscard]] constexpr Op_Shape shape_of(Op op) noexcept
+        {
+            switch (op)
+            {
+            case Op::LDI:
+            case Op::LDHI:
+                return {Form::IMMEDIATE, 1, 0};
+            case Op::MOV:
+            case Op::SIN:
+            case Op::GAMMA:
+                return {Form::REGISTERS, 2, 0};
+            case Op::ADDI:
+            case Op::ANDI:
+                return {Form::CONSTANT, 2, 255};
+            case Op::SHLI:
+            case Op::SHRI:
+                return {Form::CONSTANT, 2, 31};
+            case Op::CHAN:
+                return {Form::CONSTANT, 2, 3};
+            case Op::JMP:
+                return {Form::JUMP, 0, 0};
+            case Op::BRZ:
+            case Op::BRNZ:
+                return {Form::JUMP, 1, 0};
+            case Op::OUT:
+                return {Form::REGISTERS, 1, 0};
+            default:
+                return {Form::REGISTERS, 3, 0};
+            }
+        }
+
+        [[nodiscard]] constexpr uint32_t word_at(std::span<const uint8_t> program, size_t index) noexcept
+        {
+            return stream_protocol::detail::get_u32(program, HEADER_SIZE + index * INSTRUCTION_SIZE);
+        }
+
+        // where a channel sits in a wire word (Wire_Format<WRGB>), by CHAN's numbering
+        inline constexpr std::array<uint8_t, 4> CHANNEL_SHIFT{0, 16, 24, 8};
+    }
+
+    /**
+     * @brief whether `program` is one Machine can run.  Machine trusts this, so a bad upload is turned away before
+     *  it has run at all.
+     */
+    [[nodiscard]] constexpr Status validate(std::span<const uint8_t> program) noexcept
+    {
+        if (std::size(program) > MAX_SIZE)
+        {
+            return Status::TOO_LONG;
+        }
+        if (std::size(program) < HEADER_SIZE || program[0] != VERSION || program[1] == 0 || program[2] != 0 || program[3] != 0)
+        {
+            return Status::BAD_HEADER;
+        }
+        const size_t count{(std::size(program) - HEADER_SIZE) / INSTRUCTION_SIZE};
+        if (count == 0 || (std::size(program) - HEADER_SIZE) % INSTRUCTION_SIZE != 0)
+        {
+            return Status::BAD_LENGTH;
+        }
+        for (size_t pc{0}; pc < count; ++pc)
+        {
+            const uint32_t word{detail::word_at(program, pc)};
+            const auto op{static_cast<Op>(word & 0xFFU)};
+            if (op > Op::OUT)
+            {
+                return Status::BAD_OP;
+            }
+            const auto shape{detail::shape_of(op)};
+            const std::array<uint8_t, 3> fields{static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word >> 16), static_cast<uint8_t>(word >> 24)};
+            for (size_t ii{0}; ii < shape.registers; ++ii)
+            {
+                if (fields[ii] >= REGISTERS)
+                {
+                    return Status::BAD_REGISTER;
+                }
+            }
+            if (shape.form == detail::Form::CONSTANT && fields[2] > shape.max_constant)
+            {
+                return Status::BAD_CONSTANT;
+            }
+            if (shape.form == detail::Form::JUMP)
+            {
+                const auto target{static_cast<int32_t>(pc) + 1 + static_cast<int16_t>(word >> 16)};
+                if (target < 0 || target >= static_cast<int32_t>(count))
+                {
+                    return Status::BAD_JUMP;
+                }
+            }
+        }
+        const auto last{static_cast<Op>(detail::word_at(program, count - 1) & 0xFFU)};
+        return last == Op::OUT || last == Op::JMP ? Status::OK : Status::RUNS_OFF_THE_END;
+    }
+
+    struct Run_Result
+    {
+        size_t pixels;         // drawn; fewer than asked for if the budget ran out
+        uint32_t instructions; // run
+    };
+
+    /* Runs a program over a frame's pixels; see the top of the file. */
+    class Machine
+    {
+    public:
+        /**
+         * @brief copy `program` in, ready to run.
+         *  PRECONDITION: validate(program) == Status::OK
+         */
+        constexpr void load(std::span<const uint8_t> program) noexcept
+        {
+            m_fps = program[1];
+            m_count = (std::size(program) - HEADER_SIZE) / INSTRUCTION_SIZE;
+            for (size_t pc{0}; pc < m_count; ++pc)
+            {
+                m_code[pc] = detail::word_at(program, pc);
+            }
+        }
+
+        [[nodiscard]] constexpr uint8_t fps() const noexcept
+        {
+            return m_fps;
+        }
+
+        /* step `step` of every pixel in `words`, in order, for no more than `budget` instructions in all */
+        constexpr Run_Result run(uint32_t step, std::span<uint32_t> words, uint32_t budget) const noexcept
+        {
+            using namespace pico_ws2812;
+            constexpr const auto &SINE{SINE_TABLE<256>};
+            constexpr const auto &GAMMA{SRGB_GAMMA_CURVE<256>};
+            Run_Result rv{.pixels = 0, .instructions = 0};
+            for (; rv.pixels < std::size(words); ++rv.pixels)
+            {
+                std::array<uint32_t, REGISTERS> r{};
+                r[0] = static_cast<uint32_t>(rv.pixels);
+                r[1] = step;
+                r[2] = static_cast<uint32_t>(std::size(words));
+                size_t pc{0};
+                bool done{false};
+                while (!done)
+                {
+                    if (rv.instructions == budget)
+                    {
+                        return rv;
+                    }
+                    ++rv.instructions;
+                    const uint32_t word{m_code[pc++]};
+                    const auto d{static_cast<uint8_t>(word >> 8)};
+                    const auto a{static_cast<uint8_t>(word >> 16)};
+                    const auto b{static_cast<uint8_t>(word >> 24)};
+                    const auto imm{static_cast<uint16_t>(word >> 16)};
+                    switch (static_cast<Op>(word & 0xFFU))
+                    {
+                    case Op::LDI:
+                        r[d] = imm;
+                        break;
+                    case Op::LDHI:
+                        r[d] = (r[d] & 0xFFFFU) | (uint32_t{imm} << 16);
+                        break;
+                    case Op::MOV:
+                        r[d] = r[a];
+                        break;
+                    case Op::ADD:
+                        r[d] = r[a] + r[b];
+                        break;
+                    case Op::SUB:
+                        r[d] = r[a] - r[b];
+                        break;
+                    case Op::MUL:
+                        r[d] = r[a] * r[b];
+                        break;
+                    case Op::DIV:
+                        r[d] = r[b] == 0 ? 0 : r[a] / r[b];
+                        break;
+                    case Op::MOD:
+                        r[d] = r[b] == 0 ? 0 : r[a] % r[b];
+                        break;
+                    case Op::AND:
+                        r[d] = r[a] & r[b];
+                        break;
+                    case Op::OR:
+                        r[d] = r[a] | r[b];
+                        break;
+                    case Op::XOR:
+                        r[d] = r[a] ^ r[b];
+                        break;
+                    case Op::SHL:
+                        r[d] = r[a] << (r[b] & 31U);
+                        break;
+                    case Op::SHR:
+                        r[d] = r[a] >> (r[b] & 31U);
+                        break;
+                    case Op::MIN:
+                        r[d] = r[a] < r[b] ? r[a] : r[b];
+                        break;
+                    case Op::MAX:
+                        r[d] = r[a] < r[b] ? r[b] : r[a];
+                        break;
+                    case Op::SLT:
+                        r[d] = r[a] < r[b] ? 1 : 0;
+                        break;
+                    case Op::ADDI:
+                        r[d] = r[a] + static_cast<uint32_t>(static_cast<int8_t>(b));
+                        break;
+                    case Op::SHLI:
+                        r[d] = r[a] << b;
+                        break;
+                    case Op::SHRI:
+                        r[d] = r[a] >> b;
+                        break;
+                    case Op::ANDI:
+                        r[d] = r[a] & b;
+                        break;
+                    case Op::SIN:
+                        r[d] = SINE[r[a] & 0xFFU];
+                        break;
+                    case Op::GAMMA:
+                        r[d] = GAMMA[r[a] & 0xFFU];
+                        break;
+                    case Op::CHAN:
+                        r[d] = (r[a] & 0xFFU) << detail::CHANNEL_SHIFT[b];
+                        break;
+                    case Op::HSV:
+                        r[d] = hsv_to_wrgb(HSV{.hue = static_cast<uint16_t>(r[a]), .saturation = 255, .value = static_cast<uint8_t>(r[b])});
+                        break;
+                    case Op::CSCALE:
+                        r[d] = color_math::scale(r[a], static_cast<uint8_t>(r[b]));
+                        break;
+                    case Op::CADD:
+                        r[d] = color_math::add_saturating(r[a], r[b]);
+                        break;
+                    case Op::CLERP:
+                        r[d] = color_math::lerp(r[d], r[a], static_cast<uint8_t>(r[b]));
+                        break;
+                    case Op::CMAX:
+                        r[d] = color_math::maximum(r[a], r[b]);
+                        break;
+                    case Op::JMP:
+                        pc += static_cast<int16_t>(imm);
+                        break;
+                    case Op::BRZ:
+                        pc += r[d] == 0 ? static_cast<int16_t>(imm) : 0;
+                        break;
+                    case Op::BRNZ:
+                        pc += r[d] != 0 ? static_cast<int16_t>(imm) : 0;
+                        break;
+                    case Op::OUT:
+                        words[rv.pixels] = r[d];
+                        done = true;
+                        break;
+                    }
+                }
+            }
+            return rv;
+        }
+
+    private:
+        std::array<uint32_t, MAX_INSTRUCTIONS> m_code{};
+        size_t m_count{0};
+        uint8_t m_fps{1};
+    };
+
+    /* The host end: a program an instruction at a time, for the assembler and the tests. */
+    template <size_t MAX = MAX_INSTRUCTIONS>
+    class Program
+    {
+    public:
+        constexpr explicit Program(uint8_t fps) noexcept
+        {
+            m_bytes[0] = VERSION;
+            m_bytes[1] = fps;
+        }
+
+        constexpr Program &add(uint32_t instruction) noexcept
+        {
+            if (m_count == MAX)
+            {
+                m_overflowed = true;
+                return *this;
+            }
+            stream_protocol::detail::put_u32(m_bytes, HEADER_SIZE + m_count * INSTRUCTION_SIZE, instruction);
+            ++m_count;
+            return *this;
+        }
+
+        [[nodiscard]] constexpr std::span<const uint8_t> bytes() const noexcept
+        {
+            return std::span{m_bytes}.first(HEADER_SIZE + m_count * INSTRUCTION_SIZE);
+        }
+        [[nodiscard]] constexpr size_t count() const noexcept
+        {
+            return m_count;
+        }
+        [[nodiscard]] constexpr bool overflowed() const noexcept
+        {
+            return m_overflowed;
+        }
+
+    private:
+        std::array<uint8_t, HEADER_SIZE + MAX * INSTRUCTION_SIZE> m_bytes{};
+        size_t m_count{0};
+        bool m_overflowed{false};
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_pattern_vm_tests()
+    {
+        using namespace pattern_vm;
+        bool rv{true};
+
+        // =========================================
+        // a gradient: pixel * 255 / (count - 1) on red, and white from a table by the step
+        Program<16> gradient{50};
+        gradient.add(encode(Op::LDI, 4))
+            .add(encode_immediate(Op::LDI, 4, 255))
+            .add(encode(Op::MUL, 4, 0, 4))
+            .add(encode(Op::ADDI, 5, 2, static_cast<uint8_t>(-1)))
+            .add(encode(Op::DIV, 4, 4, 5))
+            .add(encode(Op::CHAN, 4, 4, 1))
+            .add(encode(Op::GAMMA, 6, 1))
+            .add(encode(Op::CHAN, 6, 6, 0))
+            .add(encode(Op::OR, 4, 4, 6))
+            .add(encode(Op::OUT, 4));
+        rv &= validate(gradient.bytes()) == Status::OK;
+        Machine dut;
+        dut.load(gradient.bytes());
+        rv &= dut.fps() == 50;
+        std::array<uint32_t, 4> words{};
+        const auto result{dut.run(255, words, 1000)};
+        rv &= result.pixels == 4 && result.instructions == 40;
+        rv &= words[0] == 0x000000FFU && words[1] == 0x005500FFU && words[3] == 0x00FF00FFU;
+
+        // =========================================
+        // a loop: r4 counts down from the pixel's index, r5 adds up 16 a turn; a branch over the loop for pixel 0
+        Program<16> counted{50};
+        counted.add(encode(Op::MOV, 4, 0))
+            .add(encode_jump(Op::BRZ, 4, 3))
+            .add(encode(Op::ADDI, 5, 5, 16))
+            .add(encode(Op::ADDI, 4, 4, static_cast<uint8_t>(-1)))
+            .add(encode_jump(Op::BRNZ, 4, -3))
+            .add(encode(Op::OUT, 5));
+        rv &= validate(counted.bytes()) == Status::OK;
+        dut.load(counted.bytes());
+        (void)dut.run(0, words, 1000);
+        rv &= words == std::array<uint32_t, 4>{0, 16, 32, 48};
+
+        // =========================================
+        // the budget stops the frame part way, leaving the rest of the pixels as they were
+        words.fill(0xAAAAAAAAU);
+        const auto cut{dut.run(0, words, 12)};
+        rv &= cut.pixels == 2 && cut.instructions == 12;
+        rv &= words[1] == 16 && words[2] == 0xAAAAAAAAU;
+        // and a program that never ends is only ever as costly as the budget
+        Program<2> forever{50};
+        forever.add(encode_jump(Op::JMP, 0, -1));
+        rv &= validate(forever.bytes()) == Status::OK;
+        dut.load(forever.bytes());
+        rv &= dut.run(0, words, 500).instructions == 500;
+
+        // =========================================
+        // what the validator turns away
+        const auto with{[](uint32_t instruction)
+                        {
+                            Program<2> program{50};
+                            program.add(instruction).add(encode(Op::OUT, 0));
+                            return validate(program.bytes());
+                        }};
+        rv &= with(encode(static_cast<Op>(200), 0)) == Status::BAD_OP;
+        rv &= with(encode(Op::ADD, 0, 1, 16)) == Status::BAD_REGISTER;
+        rv &= with(encode(Op::SHLI, 0, 1, 32)) == Status::BAD_CONSTANT;
+        rv &= with(encode(Op::CHAN, 0, 1, 4)) == Status::BAD_CONSTANT;
+        rv &= with(encode_jump(Op::BRZ, 0, 1)) == Status::BAD_JUMP;
+        rv &= with(encode_jump(Op::BRZ, 0, -2)) == Status::BAD_JUMP;
+        rv &= with(encode_immediate(Op::LDI, 0, 0xFFFF)) == Status::OK;
+        Program<2> off_the_end{50};
+        off_the_end.add(encode(Op::OUT, 0)).add(encode(Op::MOV, 0, 1));
+        rv &= validate(off_the_end.bytes()) == Status::RUNS_OFF_THE_END;
+        rv &= validate(Program<1>{50}.bytes()) == Status::BAD_LENGTH;
+        rv &= validate(std::span{gradient.bytes()}.first(HEADER_SIZE + 5)) == Status::BAD_LENGTH;
+        rv &= validate(Program<1>{0}.add(encode(Op::OUT, 0)).bytes()) == Status::BAD_HEADER;
+
+        return rv;
+    }
+    static_assert(run_pattern_vm_tests());
+}
+
+#endif
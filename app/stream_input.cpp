@@ -0,0 +1,261 @@
+#include "stream_input.hpp"
+
+#include <algorithm>
+#include <span>
+
+#include "pico/printf.h"
+
+#include "frame_codec.hpp"
+#include "neopixel_output.hpp"
+#include "pattern_engine.hpp"
+#include "pattern_vm.hpp"
+#include "stream_protocol.hpp"
+#include "timeline.hpp"
+
+namespace
+{
+    using namespace stream_protocol;
+
+    constexpr size_t MAX_PACKET{HEADER_SIZE + std::max({BYTES_PER_PIXEL * neopixel::LED_COUNT, frame_codec::max_encoded_size(neopixel::LED_COUNT), timeline::MAX_SIZE, pattern_vm::MAX_SIZE}) + CRC_SIZE};
+
+    class Stream_Diversion final : public Input_Diversion
+    {
+    public:
+        void begin() noexcept
+        {
+            m_decoder = {};
+            m_stats = {};
+            m_have_sequence = false;
+            lose_reference();
+            m_active = true;
+        }
+
+        [[nodiscard]] bool active() const noexcept override
+        {
+            return m_active;
+        }
+
+        size_t consume(std::span<const char> received) noexcept override
+        {
+            for (size_t ii{0}; ii < std::size(received); ++ii)
+            {
+                switch (m_decoder.push(static_cast<uint8_t>(received[ii])))
+                {
+                case Cobs_Decoder<MAX_PACKET>::Event::NONE:
+                    break;
+                case Cobs_Decoder<MAX_PACKET>::Event::PACKET:
+                    handle(m_decoder.packet());
+                    if (!m_active)
+                    {
+                        return ii + 1;
+                    }
+                    break;
+                case Cobs_Decoder<MAX_PACKET>::Event::MALFORMED:
+                    report_malformed("bad framing");
+                    break;
+                }
+            }
+            return std::size(received);
+        }
+
+        [[nodiscard]] const stream_input::Stream_Stats &stats() const noexcept
+        {
+            return m_stats;
+        }
+
+    private:
+        Cobs_Decoder<MAX_PACKET> m_decoder;
+        stream_input::Stream_Stats m_stats{};
+        uint8_t m_next_sequence{0};
+        bool m_have_sequence{false};
+        // the canvas holds the frame the host last sent, so a DELTA or REPEAT can be applied to it; a timeline or
+        // program draws over it, so loading one loses it
+        bool m_have_reference{false};
+        bool m_reported_unreferenced{false};
+        bool m_active{false};
+
+        void handle(std::span<const uint8_t> bytes) noexcept
+        {
+            const auto packet{parse_packet(bytes)};
+            switch (packet.status)
+            {
+            case Parse_Status::OK:
+                break;
+            case Parse_Status::MALFORMED:
+                report_malformed("bad header or length");
+                return;
+            case Parse_Status::CRC_FAILED:
+                ++m_stats.crc_failed;
+                lose_reference();
+                printf("stream: CRC failed\n");
+                return;
+            }
+
+            track_sequence(packet.sequence);
+            if (packet.type == Packet_Type::END)
+            {
+                m_active = false;
+                printf("stream: ended, %lu frames, %lu malformed, %lu CRC failed, %lu missing, %lu without a reference\n",
+                       static_cast<unsigned long>(m_stats.frames), static_cast<unsigned long>(m_stats.malformed),
+                       static_cast<unsigned long>(m_stats.crc_failed), static_cast<unsigned long>(m_stats.missing),
+                       static_cast<unsigned long>(m_stats.unreferenced));
+                return;
+            }
+            if (packet.type == Packet_Type::TIMELINE)
+            {
+                load_timeline(packet.payload);
+                return;
+            }
+            if (packet.type == Packet_Type::PROGRAM)
+            {
+                load_program(packet.payload);
+                return;
+            }
+            if (packet.first_pixel + packet.pixel_count > neopixel::LED_COUNT)
+            {
+                report_malformed("pixels off the end of the strip");
+                return;
+            }
+            // a frame takes over from a timeline or program
+            pattern_engine::stop();
+            const bool whole_strip{packet.first_pixel == 0 && packet.pixel_count == neopixel::LED_COUNT};
+            auto pixels{neopixel::canvas().words().subspan(packet.first_pixel, packet.pixel_count)};
+            switch (packet.type)
+            {
+            case Packet_Type::FRAME:
+                write_raw(packet.payload, pixels);
+                break;
+            case Packet_Type::KEY:
+            case Packet_Type::DELTA:
+                if (!frame_codec::valid(packet.payload, packet.pixel_count))
+                {
+                    report_malformed("bad ops");
+                    return;
+                }
+                if (packet.type == Packet_Type::DELTA && !m_have_reference)
+                {
+                    skip_unreferenced();
+                    return;
+                }
+                if (packet.type == Packet_Type::KEY)
+                {
+                    std::fill(std::begin(pixels), std::end(pixels), 0U);
+                }
+                frame_codec::apply(packet.payload, pixels);
+                break;
+            case Packet_Type::REPEAT:
+                if (!m_have_reference)
+                {
+                    skip_unreferenced();
+                    return;
+                }
+                break;
+            case Packet_Type::END:
+            case Packet_Type::TIMELINE:
+            case Packet_Type::PROGRAM:
+                break;
+            }
+            // only a whole frame can restore the reference; a partial one keeps it if it was good
+            m_have_reference |= whole_strip && packet.type != Packet_Type::REPEAT;
+            neopixel::present_canvas();
+            ++m_stats.frames;
+        }
+
+        void load_timeline(std::span<const uint8_t> program) noexcept
+        {
+            const auto status{timeline::validate(program, neopixel::LED_COUNT)};
+            if (status != timeline::Status::OK)
+            {
+                const auto why{timeline::describe(status)};
+                ++m_stats.malformed;
+                printf("stream: bad timeline, %.*s\n", static_cast<int>(std::size(why)), std::data(why));
+                return;
+            }
+            pattern_engine::play(program);
+            lose_reference();
+            ++m_stats.timelines;
+            printf("stream: playing a timeline of %u tracks, %u bytes\n", static_cast<unsigned>(program[3]), static_cast<unsigned>(std::size(program)));
+        }
+
+        void load_program(std::span<const uint8_t> program) noexcept
+        {
+            const auto status{pattern_vm::validate(program)};
+            if (status != pattern_vm::Status::OK)
+            {
+                const auto why{pattern_vm::describe(status)};
+                ++m_stats.malformed;
+                printf("stream: bad program, %.*s\n", static_cast<int>(std::size(why)), std::data(why));
+                return;
+            }
+            pattern_engine::run(program);
+            lose_reference();
+            ++m_stats.programs;
+            printf("stream: running a program of %u instructions\n", static_cast<unsigned>((std::size(program) - pattern_vm::HEADER_SIZE) / pattern_vm::INSTRUCTION_SIZE));
+        }
+
+        static void write_raw(std::span<const uint8_t> payload, std::span<uint32_t> pixels) noexcept
+        {
+            for (size_t ii{0}; ii < std::size(pixels); ++ii)
+            {
+                const auto wrgb{payload.subspan(ii * BYTES_PER_PIXEL, BYTES_PER_PIXEL)};
+                pixels[ii] = neopixel::Pixel_Frame::format::pack(pico_ws2812::WRGB{.white{wrgb[0]}, .red{wrgb[1]}, .green{wrgb[2]}, .blue{wrgb[3]}});
+            }
+        }
+
+        void lose_reference() noexcept
+        {
+            m_have_reference = false;
+            m_reported_unreferenced = false;
+        }
+
+        void skip_unreferenced() noexcept
+        {
+            ++m_stats.unreferenced;
+            if (!m_reported_unreferenced)
+            {
+                m_reported_unreferenced = true;
+                printf("stream: waiting for a KEY or FRAME to apply deltas to\n");
+            }
+        }
+
+        void track_sequence(uint8_t sequence) noexcept
+        {
+            if (m_have_sequence && sequence != m_next_sequence)
+            {
+                const auto gap{static_cast<uint8_t>(sequence - m_next_sequence)};
+                m_stats.missing += gap;
+                lose_reference();
+                printf("stream: %u missing before #%u\n", static_cast<unsigned>(gap), static_cast<unsigned>(sequence));
+            }
+            m_have_sequence = true;
+            m_next_sequence = static_cast<uint8_t>(sequence + 1);
+        }
+
+        void report_malformed(const char *why) noexcept
+        {
+            ++m_stats.malformed;
+            lose_reference();
+            printf("stream: malformed packet, %s\n", why);
+        }
+    };
+
+    Stream_Diversion the_stream;
+}
+
+namespace stream_input
+{
+    void begin() noexcept
+    {
+        the_stream.begin();
+    }
+
+    Input_Diversion &diversion() noexcept
+    {
+        return the_stream;
+    }
+
+    Stream_Stats stats() noexcept
+    {
+        return the_stream.stats();
+    }
+}
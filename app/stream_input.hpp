@@ -0,0 +1,34 @@
+#if !defined(STREAM_INPUT_HPP)
+#define STREAM_INPUT_HPP
+
+#include <cstdint>
+
+#include "Input_State_Machine.hpp"
+
+/* The device end of the `stream` upload (see stream_protocol.hpp).
+ *
+ * begin() switches the serial input over: the line provider, which has been told to divert_to(diversion()), hands
+ * every byte to the decoder instead of the shell.  Each good packet is decoded straight into the canvas and
+ * presented, or for a timeline or program, handed to the pattern engine to run; bad ones are reported and counted.
+ * An END packet switches back to the shell. */
+namespace stream_input
+{
+    struct Stream_Stats
+    {
+        uint32_t frames;     // presented
+        uint32_t timelines;  // loaded and started
+        uint32_t programs;   // likewise
+        uint32_t malformed;  // not valid COBS, the wrong length, or pixels off the end of the strip
+        uint32_t crc_failed; // well formed, but damaged on the way
+        uint32_t missing;    // gaps in the sequence numbers; the packets rejected above are in here too
+        // DELTA or REPEAT packets dropped because a packet before them was lost, until the next KEY or whole FRAME
+        uint32_t unreferenced;
+    };
+
+    /* counts restart here, so stats() covers the latest stream */
+    void begin() noexcept;
+    [[nodiscard]] Input_Diversion &diversion() noexcept;
+    [[nodiscard]] Stream_Stats stats() noexcept;
+}
+
+#endif
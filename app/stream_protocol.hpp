@@ -0,0 +1,412 @@
+#if !defined(STREAM_PROTOCOL_HPP)
+#define STREAM_PROTOCOL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/* The binary upload the `stream` command switches the serial port to.
+ *
+ * Packets are COBS encoded, so they contain no zero bytes, and each is followed by a single 0x00.  Decoded:
+ *
+ *   offset  size        field
+ *   0       1           type, below
+ *   1       1           sequence, +1 per packet, so the device can count what went missing
+ *   2       2           first pixel, little endian
+ *   4       2           pixel count, little endian (0 for END and REPEAT)
+ *   6       n           payload
+ *   6+n     4           CRC-32 (zlib's) of everything before it, little endian
+ *
+ * FRAME's payload is the pixels, 4 bytes each: white, red, green, blue.  KEY and DELTA carry frame_codec ops for
+ * the pixels instead, applied to black or to the previous frame respectively (frame_codec.hpp).  REPEAT shows the
+ * previous frame again, and END goes back to the shell.  TIMELINE's payload is a whole timeline (timeline.hpp),
+ * first pixel and count 0, which plays from then on, until a frame is sent or a pattern started; PROGRAM's is a
+ * pattern program (pattern_vm.hpp) that runs the same way.
+ *
+ * Both ends use this header: the device decodes with Cobs_Decoder and parse_packet(), the host tools encode with
+ * encode_packet(). */
+namespace stream_protocol
+{
+    enum struct Packet_Type : uint8_t
+    {
+        FRAME = 1,
+        END = 2,
+        KEY = 3,
+        DELTA = 4,
+        REPEAT = 5,
+        TIMELINE = 6,
+        PROGRAM = 7,
+    };
+
+    /* whether the payload is frame_codec ops rather than raw pixels */
+    [[nodiscard]] constexpr bool is_coded(Packet_Type type) noexcept
+    {
+        return type == Packet_Type::KEY || type == Packet_Type::DELTA;
+    }
+
+    /* whether the payload is something for the pattern engine to run rather than pixels */
+    [[nodiscard]] constexpr bool is_animation(Packet_Type type) noexcept
+    {
+        return type == Packet_Type::TIMELINE || type == Packet_Type::PROGRAM;
+    }
+
+    inline constexpr size_t HEADER_SIZE{6};
+    inline constexpr size_t CRC_SIZE{4};
+    inline constexpr size_t BYTES_PER_PIXEL{4};
+
+    /* of a FRAME packet, or any other with count 0 */
+    [[nodiscard]] constexpr size_t packet_size(size_t pixel_count) noexcept
+    {
+        return HEADER_SIZE + BYTES_PER_PIXEL * pixel_count + CRC_SIZE;
+    }
+    /* worst case COBS output for `size` bytes, not counting the 0x00 that ends it */
+    [[nodiscard]] constexpr size_t encoded_size(size_t size) noexcept
+    {
+        return size + size / 254 + 1;
+    }
+
+    namespace detail
+    {
+        inline constexpr auto CRC32_TABLE{[]
+                                          {
+                                              std::array<uint32_t, 256> table{};
+                                              for (uint32_t ii{0}; ii < 256; ++ii)
+                                              {
+                                                  uint32_t crc{ii};
+                                                  for (int bit{0}; bit < 8; ++bit)
+                                                  {
+                                                      crc = (crc >> 1) ^ ((crc & 1U) != 0 ? 0xEDB88320U : 0U);
+                                                  }
+                                                  table[ii] = crc;
+                                              }
+                                              return table;
+                                          }()};
+
+        [[nodiscard]] constexpr uint16_t get_u16(std::span<const uint8_t> bytes, size_t at) noexcept
+        {
+            return static_cast<uint16_t>(bytes[at] | (bytes[at + 1] << 8));
+        }
+        [[nodiscard]] constexpr uint32_t get_u32(std::span<const uint8_t> bytes, size_t at) noexcept
+        {
+            return static_cast<uint32_t>(get_u16(bytes, at)) | (static_cast<uint32_t>(get_u16(bytes, at + 2)) << 16);
+        }
+        constexpr void put_u16(std::span<uint8_t> bytes, size_t at, uint16_t value) noexcept
+        {
+            bytes[at] = static_cast<uint8_t>(value);
+            bytes[at + 1] = static_cast<uint8_t>(value >> 8);
+        }
+        constexpr void put_u32(std::span<uint8_t> bytes, size_t at, uint32_t value) noexcept
+        {
+            put_u16(bytes, at, static_cast<uint16_t>(value));
+            put_u16(bytes, at + 2, static_cast<uint16_t>(value >> 16));
+        }
+    }
+
+    [[nodiscard]] constexpr uint32_t crc32(std::span<const uint8_t> bytes) noexcept
+    {
+        uint32_t crc{0xFFFFFFFFU};
+        for (const auto byte : bytes)
+        {
+            crc = (crc >> 8) ^ detail::CRC32_TABLE[(crc ^ byte) & 0xFFU];
+        }
+        return ~crc;
+    }
+
+    /**
+     * @brief COBS encode `in` into `out`, which needs encoded_size(size(in)) bytes; the 0x00 delimiter is not added.
+     * @return bytes written
+     */
+    constexpr size_t cobs_encode(std::span<const uint8_t> in, std::span<uint8_t> out) noexcept
+    {
+        size_t code_at{0};
+        size_t written{1};
+        uint8_t code{1};
+        for (const auto byte : in)
+        {
+            if (byte != 0)
+            {
+                out[written++] = byte;
+                ++code;
+            }
+            if (byte == 0 || code == 0xFF)
+            {
+                out[code_at] = code;
+                code_at = written++;
+                code = 1;
+            }
+        }
+        out[code_at] = code;
+        return written;
+    }
+
+    /* Takes the byte stream one byte at a time and reassembles the packets between the delimiters. */
+    template <size_t MAX_PACKET>
+    class Cobs_Decoder
+    {
+    public:
+        enum struct Event
+        {
+            NONE,     // mid packet
+            PACKET,   // packet() holds a whole decoded packet
+            MALFORMED // the bytes since the last delimiter weren't valid COBS, or too long
+        };
+
+        constexpr Event push(uint8_t byte) noexcept
+        {
+            if (byte == 0)
+            {
+                const bool valid{!m_overflow && m_remaining == 0};
+                const bool empty{m_size == 0 && !m_overflow && !m_pending_zero};
+                m_packet_size = m_size;
+                reset();
+                if (empty)
+                {
+                    // back to back delimiters are allowed, and used to resynchronise
+                    return Event::NONE;
+                }
+                return valid ? Event::PACKET : Event::MALFORMED;
+            }
+            if (m_remaining == 0)
+            {
+                // a code byte: the zero the previous one implied, then code - 1 data bytes
+                if (m_pending_zero)
+                {
+                    append(0);
+                }
+                m_remaining = static_cast<uint8_t>(byte - 1);
+                m_pending_zero = byte != 0xFF;
+                return Event::NONE;
+            }
+            append(byte);
+            --m_remaining;
+            return Event::NONE;
+        }
+
+        /* the last PACKET, until the next one completes */
+        [[nodiscard]] constexpr std::span<const uint8_t> packet() const noexcept
+        {
+            return std::span{m_buffer}.first(m_packet_size);
+        }
+
+    private:
+        std::array<uint8_t, MAX_PACKET> m_buffer{};
+        size_t m_size{0};
+        size_t m_packet_size{0};
+        uint8_t m_remaining{0};
+        bool m_pending_zero{false};
+        bool m_overflow{false};
+
+        constexpr void append(uint8_t byte) noexcept
+        {
+            if (m_size == MAX_PACKET)
+            {
+                m_overflow = true;
+                return;
+            }
+            m_buffer[m_size++] = byte;
+        }
+        constexpr void reset() noexcept
+        {
+            m_size = 0;
+            m_remaining = 0;
+            m_pending_zero = false;
+            m_overflow = false;
+        }
+    };
+
+    enum struct Parse_Status
+    {
+        OK,
+        MALFORMED, // too short, an unknown type, or a raw pixel count that doesn't match the length
+        CRC_FAILED
+    };
+
+    struct Packet
+    {
+        Parse_Status status;
+        Packet_Type type{};
+        uint8_t sequence{0};
+        uint16_t first_pixel{0};
+        uint16_t pixel_count{0};
+        std::span<const uint8_t> payload{}; // in the decoder's buffer
+    };
+
+    [[nodiscard]] constexpr Packet parse_packet(std::span<const uint8_t> bytes) noexcept
+    {
+        if (std::size(bytes) < HEADER_SIZE + CRC_SIZE)
+        {
+            return {Parse_Status::MALFORMED};
+        }
+        const auto type{static_cast<Packet_Type>(bytes[0])};
+        const auto count{detail::get_u16(bytes, 4)};
+        if (type < Packet_Type::FRAME || type > Packet_Type::PROGRAM)
+        {
+            return {Parse_Status::MALFORMED};
+        }
+        // coded payloads are checked against the count when they are decoded, and animations when they are loaded
+        if (!is_coded(type) && !is_animation(type) && std::size(bytes) != packet_size(type == Packet_Type::FRAME ? count : 0))
+        {
+            return {Parse_Status::MALFORMED};
+        }
+        const auto body{bytes.first(std::size(bytes) - CRC_SIZE)};
+        if (crc32(body) != detail::get_u32(bytes, std::size(body)))
+        {
+            return {Parse_Status::CRC_FAILED};
+        }
+        return Packet{.status = Parse_Status::OK,
+                      .type = type,
+                      .sequence = bytes[1],
+                      .first_pixel = detail::get_u16(bytes, 2),
+                      .pixel_count = count,
+                      .payload = body.subspan(HEADER_SIZE)};
+    }
+
+    /**
+     * @brief build a packet around `payload` and COBS encode it, delimiter included, into `out`, which needs
+     *  encoded_size(HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE) + 1 bytes.
+     * @return bytes written
+     */
+    template <size_t MAX_PAYLOAD>
+    constexpr size_t encode_packet(Packet_Type type, uint8_t sequence, uint16_t first_pixel, uint16_t pixel_count,
+                                   std::span<const uint8_t> payload, std::span<uint8_t> out) noexcept
+    {
+        std::array<uint8_t, HEADER_SIZE + MAX_PAYLOAD + CRC_SIZE> packet{};
+        const auto size{HEADER_SIZE + std::size(payload) + CRC_SIZE};
+        packet[0] = static_cast<uint8_t>(type);
+        packet[1] = sequence;
+        detail::put_u16(packet, 2, first_pixel);
+        detail::put_u16(packet, 4, pixel_count);
+        std::ranges::copy(payload, std::begin(packet) + HEADER_SIZE);
+        const auto body{std::span<const uint8_t>{packet}.first(size - CRC_SIZE)};
+        detail::put_u32(packet, size - CRC_SIZE, crc32(body));
+        const auto written{cobs_encode(std::span<const uint8_t>{packet}.first(size), out)};
+        out[written] = 0;
+        return written + 1;
+    }
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_stream_protocol_tests()
+    {
+        using namespace stream_protocol;
+        bool rv{true};
+
+        // =========================================
+        // the usual check value
+        constexpr std::array<uint8_t, 9> check{'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+        rv &= crc32(check) == 0xCBF43926U;
+
+        // =========================================
+        // COBS, from the paper's examples
+        std::array<uint8_t, 8> encoded{};
+        constexpr std::array<uint8_t, 4> zeros_between{0x11, 0x00, 0x00, 0x22};
+        rv &= cobs_encode(zeros_between, encoded) == 5;
+        rv &= encoded[0] == 0x02 && encoded[1] == 0x11 && encoded[2] == 0x01 && encoded[3] == 0x02 && encoded[4] == 0x22;
+
+        Cobs_Decoder<8> decoder;
+        for (size_t ii{0}; ii < 5; ++ii)
+        {
+            rv &= decoder.push(encoded[ii]) == Cobs_Decoder<8>::Event::NONE;
+        }
+        rv &= decoder.push(0) == Cobs_Decoder<8>::Event::PACKET;
+        rv &= std::size(decoder.packet()) == 4 && decoder.packet()[2] == 0x00 && decoder.packet()[3] == 0x22;
+
+        // runs of 254 non-zero bytes need a 0xFF code with no implied zero after it
+        std::array<uint8_t, 300> long_run{};
+        for (size_t ii{0}; ii < std::size(long_run); ++ii)
+        {
+            long_run[ii] = static_cast<uint8_t>(ii % 255 + 1);
+        }
+        std::array<uint8_t, encoded_size(300)> long_encoded{};
+        const auto long_size{cobs_encode(long_run, long_encoded)};
+        Cobs_Decoder<300> long_decoder;
+        for (size_t ii{0}; ii < long_size; ++ii)
+        {
+            rv &= long_encoded[ii] != 0;
+            (void)long_decoder.push(long_encoded[ii]);
+        }
+        rv &= long_decoder.push(0) == Cobs_Decoder<300>::Event::PACKET;
+        rv &= std::ranges::equal(long_decoder.packet(), long_run);
+
+        // =========================================
+        // a packet, there and back
+        constexpr std::array<uint8_t, 8> pixels{1, 2, 3, 4, 0, 0, 0, 255};
+        std::array<uint8_t, encoded_size(packet_size(2)) + 1> wire{};
+        const auto wire_size{encode_packet<8>(Packet_Type::FRAME, 7, 300, 2, pixels, wire)};
+        rv &= wire[wire_size - 1] == 0;
+        Cobs_Decoder<packet_size(2)> dut;
+        auto event{Cobs_Decoder<packet_size(2)>::Event::NONE};
+        for (size_t ii{0}; ii < wire_size; ++ii)
+        {
+            event = dut.push(wire[ii]);
+        }
+        rv &= event == Cobs_Decoder<packet_size(2)>::Event::PACKET;
+        const auto packet{parse_packet(dut.packet())};
+        rv &= packet.status == Parse_Status::OK;
+        rv &= packet.type == Packet_Type::FRAME && packet.sequence == 7;
+        rv &= packet.first_pixel == 300 && packet.pixel_count == 2;
+        rv &= std::ranges::equal(packet.payload, pixels);
+
+        // =========================================
+        // a flipped bit fails the CRC; a cut short packet doesn't parse; a truncated COBS block is malformed
+        std::array<uint8_t, packet_size(2)> damaged{};
+        std::ranges::copy(dut.packet(), std::begin(damaged));
+        damaged[HEADER_SIZE + 3] ^= 0x10;
+        rv &= parse_packet(damaged).status == Parse_Status::CRC_FAILED;
+        rv &= parse_packet(std::span<const uint8_t>{damaged}.first(packet_size(1))).status == Parse_Status::MALFORMED;
+        damaged[0] = 9;
+        rv &= parse_packet(damaged).status == Parse_Status::MALFORMED;
+        // a coded payload's length isn't tied to the count, but a REPEAT has none
+        std::array<uint8_t, encoded_size(packet_size(2)) + 1> coded{};
+        const auto coded_size{encode_packet<3>(Packet_Type::DELTA, 8, 0, 24, std::array<uint8_t, 3>{0x17, 0, 0}, coded)};
+        Cobs_Decoder<packet_size(2)> coded_decoder;
+        for (size_t ii{0}; ii < coded_size; ++ii)
+        {
+            (void)coded_decoder.push(coded[ii]);
+        }
+        rv &= parse_packet(coded_decoder.packet()).status == Parse_Status::OK;
+        rv &= std::size(parse_packet(coded_decoder.packet()).payload) == 3;
+        damaged[0] = static_cast<uint8_t>(Packet_Type::REPEAT);
+        rv &= parse_packet(damaged).status == Parse_Status::MALFORMED;
+        // nor is a timeline's
+        const auto timeline_size{encode_packet<5>(Packet_Type::TIMELINE, 9, 0, 0, std::array<uint8_t, 5>{1, 50, 0, 0, 0}, coded)};
+        for (size_t ii{0}; ii < timeline_size; ++ii)
+        {
+            (void)coded_decoder.push(coded[ii]);
+        }
+        rv &= parse_packet(coded_decoder.packet()).type == Packet_Type::TIMELINE;
+        rv &= std::size(parse_packet(coded_decoder.packet()).payload) == 5;
+        // or a program's
+        const auto program_size{encode_packet<8>(Packet_Type::PROGRAM, 10, 0, 0, std::array<uint8_t, 8>{1, 50, 0, 0, 31, 0, 0, 0}, coded)};
+        for (size_t ii{0}; ii < program_size; ++ii)
+        {
+            (void)coded_decoder.push(coded[ii]);
+        }
+        rv &= parse_packet(coded_decoder.packet()).type == Packet_Type::PROGRAM;
+        rv &= std::size(parse_packet(coded_decoder.packet()).payload) == 8;
+
+        (void)dut.push(0x05);
+        (void)dut.push(0x01);
+        rv &= dut.push(0) == Cobs_Decoder<packet_size(2)>::Event::MALFORMED;
+        // too long for the buffer
+        for (size_t ii{0}; ii < packet_size(2) + 2; ++ii)
+        {
+            (void)dut.push(0x01);
+        }
+        rv &= dut.push(0) == Cobs_Decoder<packet_size(2)>::Event::MALFORMED;
+        // and it picks up again after the delimiter
+        for (size_t ii{0}; ii < wire_size; ++ii)
+        {
+            event = dut.push(wire[ii]);
+        }
+        rv &= event == Cobs_Decoder<packet_size(2)>::Event::PACKET;
+
+        return rv;
+    }
+    static_assert(run_stream_protocol_tests());
+}
+
+#endif
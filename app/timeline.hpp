@@ -0,0 +1,598 @@
+#if !defined(TIMELINE_HPP)
+#define TIMELINE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+
+#include "constexpr_math.hpp"
+#include "stream_protocol.hpp"
+#include "ws2812/color_math.hpp"
+#include "ws2812/wire_frame.hpp"
+
+/* Keyframed animations, as data: uploaded in a TIMELINE packet of the `stream` upload (stream_protocol.hpp) and
+ * played by the pattern engine, instead of compiled into the firmware.
+ *
+ * A timeline is a list of tracks, each a run of pixels that show one colour at a time, and each track a list of
+ * keys.  A key is a colour, a duration in frames, and the easing curve that takes the track from it to the next
+ * key's colour over that duration.  The last key goes back to the first if the timeline loops, and otherwise is
+ * where the track stays.  A per-pixel animation is a track per pixel.  Little endian throughout:
+ *
+ *   offset  size        field
+ *   0       1           VERSION
+ *   1       1           frames per second, 1 or more
+ *   2       1           flags, LOOP or none
+ *   3       1           track count
+ *   4                   the tracks, each:
+ *     0     2             first pixel
+ *     2     2             pixel count, 1 or more
+ *     4     1             key count, 1 or more
+ *     5     7 each        the keys, each:
+ *       0   4               colour: white, red, green, blue
+ *       4   2               frames to the next key, 1 or more (ignored for the last key of a timeline that doesn't loop)
+ *       6   1               Easing
+ *
+ * Tracks may not overlap, so each pixel has at most one; pixels with none are left as they were.
+ *
+ * Player keeps each track's place, the colours either side of it and its step through the transition, so a frame
+ * moves each track on rather than finding its place again, costs a division only when a track reaches a key, and
+ * writes only the tracks whose colour changed.  evaluate() works a frame out from the start, and is what Player
+ * is checked against. */
+namespace timeline
+{
+    enum struct Easing : uint8_t
+    {
+        LINEAR,
+        EASE_IN,     // starts slowly: t squared
+        EASE_OUT,    // ends slowly
+        EASE_IN_OUT, // both: smoothstep
+        HOLD         // stays on the key's colour, and jumps to the next one's at the end
+    };
+
+    enum struct Status : uint8_t
+    {
+        OK,
+        TOO_LONG,
+        TRUNCATED,
+        TRAILING_BYTES,
+        BAD_HEADER,         // an unknown version or flag, or no frames per second
+        BAD_TRACK,          // no pixels, no keys, or pixels off the end of the strip
+        OVERLAPPING_TRACKS, // two tracks share a pixel
+        BAD_KEY             // no frames, or an unknown easing
+    };
+
+    inline constexpr uint8_t VERSION{1};
+    inline constexpr uint8_t LOOP{0x01};
+    inline constexpr size_t HEADER_SIZE{4};
+    inline constexpr size_t TRACK_HEADER_SIZE{5};
+    inline constexpr size_t KEY_SIZE{7};
+    // what a device keeps; it fits a single packet of the upload
+    inline constexpr size_t MAX_SIZE{2048};
+
+    [[nodiscard]] constexpr std::string_view describe(Status status) noexcept
+    {
+        switch (status)
+        {
+        case Status::OK:
+            return "ok";
+        case Status::TOO_LONG:
+            return "too long";
+        case Status::TRUNCATED:
+            return "cut short";
+        case Status::TRAILING_BYTES:
+            return "bytes after the last track";
+        case Status::BAD_HEADER:
+            return "bad header";
+        case Status::BAD_TRACK:
+            return "a track with no pixels, no keys, or pixels off the strip";
+        case Status::OVERLAPPING_TRACKS:
+            return "tracks overlap";
+        case Status::BAD_KEY:
+            return "a key with no frames, or an unknown easing";
+        }
+        return "?";
+    }
+
+    namespace detail
+    {
+        using Format = pico_ws2812::Wire_Format<pico_ws2812::WRGB>;
+        using stream_protocol::detail::get_u16;
+
+        // 0-255 of the way through a transition, to 0-255 of the way between the colours, for each Easing; a
+        // table even for LINEAR and HOLD, so a track's easing is never a branch
+        inline constexpr std::array<std::array<uint8_t, 256>, 5> EASING_CURVES{
+            []
+            {
+                std::array<uint8_t, 256> straight{};
+                for (size_t ii{0}; ii < std::size(straight); ++ii)
+                {
+                    straight[ii] = static_cast<uint8_t>(ii);
+                }
+                return straight;
+            }(),
+            constexpr_math::make_table<uint8_t, 256>([](size_t ii)
+                                                     {
+                                                         const double t{static_cast<double>(ii) / 255};
+                                                         return t * t;
+                                                     },
+                                                     4 * std::numeric_limits<double>::epsilon()),
+            constexpr_math::make_table<uint8_t, 256>([](size_t ii)
+                                                     {
+                                                         const double t{static_cast<double>(ii) / 255};
+                                                         return t * (2.0 - t);
+                                                     },
+                                                     4 * std::numeric_limits<double>::epsilon()),
+            constexpr_math::make_table<uint8_t, 256>([](size_t ii)
+                                                     {
+                                                         const double t{static_cast<double>(ii) / 255};
+                                                         return t * t * (3.0 - 2.0 * t);
+                                                     },
+                                                     8 * std::numeric_limits<double>::epsilon()),
+            std::array<uint8_t, 256>{}};
+
+        struct Key
+        {
+            uint32_t word;
+            uint16_t frames;
+            Easing easing;
+        };
+
+        [[nodiscard]] constexpr Key key_at(std::span<const uint8_t> program, size_t at) noexcept
+        {
+            return Key{.word = Format::pack(pico_ws2812::WRGB{.white{program[at]}, .red{program[at + 1]}, .green{program[at + 2]}, .blue{program[at + 3]}}),
+                       .frames = get_u16(program, at + 4),
+                       .easing = static_cast<Easing>(program[at + 6])};
+        }
+
+        /* Q16 of the way through a transition each frame: the same in Player and evaluate(), so they agree */
+        [[nodiscard]] constexpr uint32_t progress_per_frame(uint16_t frames) noexcept
+        {
+            return 65536U / frames;
+        }
+
+        /* `elapsed` frames into the transition from `from` to `to` */
+        [[nodiscard]] constexpr uint32_t between(uint32_t from, uint32_t to, Easing easing, uint32_t elapsed, uint32_t per_frame) noexcept
+        {
+            const auto through{(elapsed * per_frame) >> 8};
+            return pico_ws2812::color_math::lerp(from, to, EASING_CURVES[static_cast<size_t>(easing)][through]);
+        }
+
+        /* what a track is to walk its keys with */
+        struct Track
+        {
+            uint16_t first;
+            uint16_t count;
+            uint8_t keys;
+            size_t keys_at; // in the program
+        };
+
+        [[nodiscard]] constexpr Track track_at(std::span<const uint8_t> program, size_t at) noexcept
+        {
+            return Track{.first = get_u16(program, at), .count = get_u16(program, at + 2), .keys = program[at + 4], .keys_at = at + TRACK_HEADER_SIZE};
+        }
+    }
+
+    /**
+     * @brief whether `program` is a timeline a strip of `led_count` pixels can play.  Player and evaluate() trust
+     *  this, so a bad upload is turned away before anything is drawn.
+     */
+    [[nodiscard]] constexpr Status validate(std::span<const uint8_t> program, size_t led_count) noexcept
+    {
+        if (std::size(program) > MAX_SIZE)
+        {
+            return Status::TOO_LONG;
+        }
+        if (std::size(program) < HEADER_SIZE)
+        {
+            return Status::TRUNCATED;
+        }
+        if (program[0] != VERSION || program[1] == 0 || (program[2] & ~LOOP) != 0)
+        {
+            return Status::BAD_HEADER;
+        }
+        size_t at{HEADER_SIZE};
+        for (size_t track{0}; track < program[3]; ++track)
+        {
+            if (std::size(program) - at < TRACK_HEADER_SIZE)
+            {
+                return Status::TRUNCATED;
+            }
+            const auto header{detail::track_at(program, at)};
+            if (header.count == 0 || header.keys == 0 || header.first + header.count > led_count)
+            {
+                return Status::BAD_TRACK;
+            }
+            if (std::size(program) - header.keys_at < header.keys * KEY_SIZE)
+            {
+                return Status::TRUNCATED;
+            }
+            for (size_t key{0}; key < header.keys; ++key)
+            {
+                const auto fields{detail::key_at(program, header.keys_at + key * KEY_SIZE)};
+                if (fields.frames == 0 || fields.easing > Easing::HOLD)
+                {
+                    return Status::BAD_KEY;
+                }
+            }
+            // against the ones before it; there are few tracks
+            for (size_t other{HEADER_SIZE}; other != at;)
+            {
+                const auto earlier{detail::track_at(program, other)};
+                if (header.first < earlier.first + earlier.count && earlier.first < header.first + header.count)
+                {
+                    return Status::OVERLAPPING_TRACKS;
+                }
+                other = earlier.keys_at + earlier.keys * KEY_SIZE;
+            }
+            at = header.keys_at + header.keys * KEY_SIZE;
+        }
+        return at == std::size(program) ? Status::OK : Status::TRAILING_BYTES;
+    }
+
+    /**
+     * @brief frame `frame` of `program`, worked out from the start, into `words`; pixels no track covers are left
+     *  as they are.
+     *  PRECONDITION: validate(program, size(words)) == Status::OK
+     */
+    constexpr void evaluate(std::span<const uint8_t> program, uint32_t frame, std::span<uint32_t> words) noexcept
+    {
+        const bool loops{(program[2] & LOOP) != 0};
+        size_t at{HEADER_SIZE};
+        for (size_t track{0}; track < program[3]; ++track)
+        {
+            const auto header{detail::track_at(program, at)};
+            const auto key{[&](size_t index)
+                           { return detail::key_at(program, header.keys_at + index * KEY_SIZE); }};
+            const size_t transitions{loops ? header.keys : header.keys - 1U};
+            uint32_t period{0};
+            for (size_t ii{0}; ii < transitions; ++ii)
+            {
+                period += key(ii).frames;
+            }
+
+            uint32_t word{key(header.keys - 1U).word};
+            if (loops || frame < period)
+            {
+                uint32_t left{loops ? frame % period : frame};
+                size_t index{0};
+                while (left >= key(index).frames)
+                {
+                    left -= key(index).frames;
+                    ++index;
+                }
+                const auto from{key(index)};
+                word = detail::between(from.word, key((index + 1) % header.keys).word, from.easing, left, detail::progress_per_frame(from.frames));
+            }
+            for (size_t ii{header.first}; ii < header.first + header.count; ++ii)
+            {
+                words[ii] = word;
+            }
+            at = header.keys_at + header.keys * KEY_SIZE;
+        }
+    }
+
+    /* Plays a timeline a frame at a time onto a strip of N pixels; see the top of the file. */
+    template <size_t N>
+    class Player
+    {
+    public:
+        /**
+         * @brief copy `program` in and go back to frame 0; the next advance_to() draws every track.
+         *  PRECONDITION: validate(program, N) == Status::OK
+         */
+        constexpr void load(std::span<const uint8_t> program) noexcept
+        {
+            std::ranges::copy(program, std::begin(m_program));
+            m_size = std::size(program);
+            const auto bytes{this->program()};
+            m_loops = (bytes[2] & LOOP) != 0;
+            m_track_count = bytes[3];
+            size_t at{HEADER_SIZE};
+            for (size_t ii{0}; ii < m_track_count; ++ii)
+            {
+                auto &track{m_tracks[ii]};
+                const auto header{detail::track_at(bytes, at)};
+                track.first = header.first;
+                track.count = header.count;
+                track.keys_at = static_cast<uint16_t>(header.keys_at);
+                track.keys = header.keys;
+                track.period = 0;
+                for (size_t key{0}; key < (m_loops ? header.keys : header.keys - 1U); ++key)
+                {
+                    track.period += detail::key_at(bytes, header.keys_at + key * KEY_SIZE).frames;
+                }
+                enter(track, 0);
+                at = header.keys_at + header.keys * KEY_SIZE;
+            }
+            m_frame = 0;
+            m_drawn = false;
+        }
+
+        [[nodiscard]] constexpr std::span<const uint8_t> program() const noexcept
+        {
+            return std::span{m_program}.first(m_size);
+        }
+        [[nodiscard]] constexpr uint8_t fps() const noexcept
+        {
+            return m_program[1];
+        }
+        [[nodiscard]] constexpr uint32_t frame() const noexcept
+        {
+            return m_frame;
+        }
+
+        /**
+         * @brief move on to `frame`, no earlier than the last one, and draw the tracks whose colour that changed
+         *  into `words`, which should hold what was drawn last time.
+         * @return whether anything was drawn
+         */
+        constexpr bool advance_to(uint32_t frame, std::span<uint32_t, N> words) noexcept
+        {
+            const uint32_t frames{frame - m_frame};
+            m_frame = frame;
+            bool drew{false};
+            for (size_t ii{0}; ii < m_track_count; ++ii)
+            {
+                auto &track{m_tracks[ii]};
+                if (!track.stopped)
+                {
+                    // whole turns of a loop change nothing; there's only a division to do when frames were skipped
+                    track.elapsed += m_loops && frames >= track.period ? frames % track.period : frames;
+                    while (!track.stopped && track.elapsed >= track.frames)
+                    {
+                        const uint32_t over{track.elapsed - track.frames};
+                        enter(track, static_cast<uint8_t>(track.key + 1U == track.keys ? 0 : track.key + 1U));
+                        track.elapsed = over;
+                    }
+                }
+                const auto word{track.stopped ? track.from : detail::between(track.from, track.to, track.easing, track.elapsed, track.per_frame)};
+                if (word != track.shown || !m_drawn)
+                {
+                    track.shown = word;
+                    std::fill_n(std::begin(words) + track.first, track.count, word);
+                    drew = true;
+                }
+            }
+            m_drawn = true;
+            return drew;
+        }
+
+    private:
+        struct Track_State
+        {
+            uint16_t first;
+            uint16_t count;
+            uint16_t keys_at;
+            uint8_t keys;
+            uint8_t key;          // the one the track is leaving
+            uint32_t period;      // frames through every key, once
+            uint32_t elapsed;     // frames since it left it
+            uint32_t from;        // its colour
+            uint32_t to;          // and the next one's
+            uint32_t shown;       // the colour drawn last
+            uint32_t per_frame;   // progress_per_frame() of its frames
+            uint16_t frames;      // to the next key
+            Easing easing;
+            bool stopped;         // at the last key of a timeline that doesn't loop
+        };
+
+        std::array<uint8_t, MAX_SIZE> m_program{};
+        size_t m_size{0};
+        // tracks don't overlap, so there are no more than pixels
+        std::array<Track_State, N> m_tracks{};
+        size_t m_track_count{0};
+        uint32_t m_frame{0};
+        bool m_loops{false};
+        bool m_drawn{false};
+
+        /* the track leaves key `index`: one division here, none per frame */
+        constexpr void enter(Track_State &track, uint8_t index) const noexcept
+        {
+            const auto bytes{program()};
+            const auto key{detail::key_at(bytes, track.keys_at + index * KEY_SIZE)};
+            track.key = index;
+            track.elapsed = 0;
+            track.from = key.word;
+            track.stopped = !m_loops && index + 1U == track.keys;
+            if (track.stopped)
+            {
+                return;
+            }
+            track.to = detail::key_at(bytes, track.keys_at + ((index + 1U) % track.keys) * KEY_SIZE).word;
+            track.frames = key.frames;
+            track.per_frame = detail::progress_per_frame(key.frames);
+            track.easing = key.easing;
+        }
+    };
+
+    /* The host end: a timeline, a track and a key at a time, in the layout above. */
+    template <size_t MAX = MAX_SIZE>
+    class Builder
+    {
+    public:
+        constexpr Builder(uint8_t fps, bool loops) noexcept
+        {
+            m_bytes[0] = VERSION;
+            m_bytes[1] = fps;
+            m_bytes[2] = loops ? LOOP : 0;
+        }
+
+        /* starts a track; the keys that follow are its */
+        constexpr Builder &track(uint16_t first, uint16_t count) noexcept
+        {
+            if (!room(TRACK_HEADER_SIZE) || m_bytes[3] == 255)
+            {
+                return *this;
+            }
+            ++m_bytes[3];
+            m_track_at = m_size;
+            stream_protocol::detail::put_u16(m_bytes, m_size, first);
+            stream_protocol::detail::put_u16(m_bytes, m_size + 2, count);
+            m_bytes[m_size + 4] = 0;
+            m_size += TRACK_HEADER_SIZE;
+            return *this;
+        }
+
+        constexpr Builder &key(pico_ws2812::WRGB colour, uint16_t frames, Easing easing = Easing::LINEAR) noexcept
+        {
+            if (m_track_at == 0 || !room(KEY_SIZE) || m_bytes[m_track_at + 4] == 255)
+            {
+                m_overflowed = true;
+                return *this;
+            }
+            ++m_bytes[m_track_at + 4];
+            m_bytes[m_size] = colour.white;
+            m_bytes[m_size + 1] = colour.red;
+            m_bytes[m_size + 2] = colour.green;
+            m_bytes[m_size + 3] = colour.blue;
+            stream_protocol::detail::put_u16(m_bytes, m_size + 4, frames);
+            m_bytes[m_size + 6] = static_cast<uint8_t>(easing);
+            m_size += KEY_SIZE;
+            return *this;
+        }
+
+        [[nodiscard]] constexpr std::span<const uint8_t> bytes() const noexcept
+        {
+            return std::span{m_bytes}.first(m_size);
+        }
+        /* a track or key didn't fit, or a key came before any track, and was left out */
+        [[nodiscard]] constexpr bool overflowed() const noexcept
+        {
+            return m_overflowed;
+        }
+
+    private:
+        std::array<uint8_t, MAX> m_bytes{};
+        size_t m_size{HEADER_SIZE};
+        size_t m_track_at{0};
+        bool m_overflowed{false};
+
+        constexpr bool room(size_t size) noexcept
+        {
+            m_overflowed |= MAX - m_size < size;
+            return !m_overflowed;
+        }
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_timeline_tests()
+    {
+        using namespace timeline;
+        using pico_ws2812::WRGB;
+        bool rv{true};
+        constexpr auto word{[](WRGB colour)
+                            { return pico_ws2812::Wire_Format<WRGB>::pack(colour); }};
+        constexpr WRGB BLACK{.white{0}, .red{0}, .green{0}, .blue{0}};
+        constexpr WRGB RED{.white{0}, .red{200}, .green{0}, .blue{0}};
+        constexpr WRGB BLUE{.white{0}, .red{0}, .green{0}, .blue{100}};
+
+        // =========================================
+        // the curves start at the start and end at the end; the eased ones are below, above, and either side of
+        // a straight line
+        for (const auto easing : {Easing::LINEAR, Easing::EASE_IN, Easing::EASE_OUT, Easing::EASE_IN_OUT})
+        {
+            const auto &curve{detail::EASING_CURVES[static_cast<size_t>(easing)]};
+            rv &= curve[0] == 0 && curve[255] == 255;
+        }
+        rv &= detail::EASING_CURVES[1][128] == 64 && detail::EASING_CURVES[2][128] == 192;
+        rv &= detail::EASING_CURVES[3][64] < 64 && detail::EASING_CURVES[3][191] > 191;
+
+        // =========================================
+        // a looping fade on the first half of a strip of 6, and two keys held on the last pixel
+        Builder<128> builder{50, true};
+        builder.track(0, 3).key(BLACK, 4).key(RED, 2, Easing::HOLD);
+        builder.track(5, 1).key(BLUE, 3, Easing::EASE_IN).key(RED, 1);
+        rv &= !builder.overflowed();
+        rv &= std::size(builder.bytes()) == HEADER_SIZE + 2 * TRACK_HEADER_SIZE + 4 * KEY_SIZE;
+        rv &= validate(builder.bytes(), 6) == Status::OK;
+
+        std::array<uint32_t, 6> words{};
+        evaluate(builder.bytes(), 2, words);
+        rv &= words[0] == word(WRGB{.white{0}, .red{100}, .green{0}, .blue{0}}) && words[2] == words[0];
+        rv &= words[3] == 0 && words[4] == 0;
+        rv &= words[5] == pico_ws2812::color_math::lerp(word(BLUE), word(RED), detail::EASING_CURVES[1][170]);
+        // HOLD keeps red until the loop comes round
+        evaluate(builder.bytes(), 5, words);
+        rv &= words[0] == word(RED);
+        evaluate(builder.bytes(), 6, words);
+        rv &= words[0] == 0;
+
+        // =========================================
+        // the player agrees with evaluate() frame by frame, skipping frames, and around the loop many times
+        Player<6> player;
+        player.load(builder.bytes());
+        std::array<uint32_t, 6> played{};
+        std::array<uint32_t, 6> expected{};
+        for (const uint32_t frame : {0U, 1U, 2U, 3U, 4U, 5U, 6U, 9U, 10U, 25U, 26U, 1000U, 1001U, 1003U})
+        {
+            (void)player.advance_to(frame, played);
+            evaluate(builder.bytes(), frame, expected);
+            rv &= played == expected;
+        }
+        // a held colour isn't drawn again
+        player.load(builder.bytes());
+        rv &= player.advance_to(4, played);
+        rv &= player.advance_to(5, played);
+        played.fill(0x12345678U);
+        rv &= !player.advance_to(5 + 12, played);
+        rv &= played[0] == 0x12345678U;
+
+        // =========================================
+        // without the loop, a track stops on its last key
+        Builder<64> once{50, false};
+        once.track(1, 2).key(RED, 10).key(BLUE, 1).key(BLACK, 99);
+        rv &= validate(once.bytes(), 3) == Status::OK;
+        player.load(once.bytes());
+        played.fill(0);
+        expected.fill(0);
+        for (const uint32_t frame : {0U, 5U, 10U, 11U, 12U, 5000U})
+        {
+            (void)player.advance_to(frame, played);
+            evaluate(once.bytes(), frame, expected);
+            rv &= played == expected;
+        }
+        rv &= played[1] == 0 && played[2] == 0 && played[0] == 0;
+        rv &= !player.advance_to(6000, played);
+
+        // =========================================
+        // what the validator turns away
+        rv &= validate(std::span{builder.bytes()}.first(3), 6) == Status::TRUNCATED;
+        rv &= validate(std::span{builder.bytes()}.first(HEADER_SIZE + TRACK_HEADER_SIZE + KEY_SIZE), 6) == Status::TRUNCATED;
+        rv &= validate(builder.bytes(), 5) == Status::BAD_TRACK;
+        std::array<uint8_t, 128> bad{};
+        std::ranges::copy(builder.bytes(), std::begin(bad));
+        const auto with{[&](size_t at, uint8_t value)
+                        {
+                            auto copy{bad};
+                            copy[at] = value;
+                            return validate(std::span{copy}.first(std::size(builder.bytes())), 6);
+                        }};
+        rv &= with(0, 2) == Status::BAD_HEADER;
+        rv &= with(1, 0) == Status::BAD_HEADER;
+        rv &= with(2, 0x81) == Status::BAD_HEADER;
+        rv &= with(HEADER_SIZE + 2, 0) == Status::BAD_TRACK;
+        rv &= with(HEADER_SIZE + TRACK_HEADER_SIZE + 4, 0) == Status::BAD_KEY;
+        rv &= with(HEADER_SIZE + TRACK_HEADER_SIZE + 6, 5) == Status::BAD_KEY;
+        // the second track moved onto the first
+        rv &= with(HEADER_SIZE + TRACK_HEADER_SIZE + 2 * KEY_SIZE, 2) == Status::OVERLAPPING_TRACKS;
+        rv &= validate(std::span{bad}.first(std::size(builder.bytes()) + 1), 6) == Status::TRAILING_BYTES;
+
+        // a key with no track, and one too many for the space, are left out
+        Builder<HEADER_SIZE + TRACK_HEADER_SIZE + KEY_SIZE> small{1, false};
+        rv &= small.key(RED, 1).overflowed();
+        Builder<HEADER_SIZE + TRACK_HEADER_SIZE + KEY_SIZE> full{1, false};
+        full.track(0, 1).key(RED, 1);
+        rv &= !full.overflowed() && full.key(RED, 1).overflowed();
+        rv &= validate(full.bytes(), 1) == Status::OK;
+
+        return rv;
+    }
+    static_assert(run_timeline_tests());
+}
+
+#endif
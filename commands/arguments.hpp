@@ -0,0 +1,125 @@
+#if !defined(COMMAND_ARGUMENTS_HPP)
+#define COMMAND_ARGUMENTS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "app/Command_Limits.hpp"
+#include "app/Command_Schema.hpp"
+#include "app/neopixel_output.hpp"
+#include "app/pattern_engine.hpp"
+
+/* What each command takes, for its handler; handlers get the struct, already checked.  Command is sized by
+ * command_limits::MAX_ARGUMENTS, which is checked here to be exactly what the schemas need. */
+namespace command_arguments
+{
+    struct Set_Args
+    {
+        uint8_t white;
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+        std::optional<size_t> index;
+    };
+    inline constexpr auto SET{command_schema::schema<Set_Args>(
+        command_schema::U8{"WHITE"},
+        command_schema::U8{"RED"},
+        command_schema::U8{"GREEN"},
+        command_schema::U8{"BLUE"},
+        command_schema::Optional{command_schema::Index{"INDEX", neopixel::LED_COUNT}})};
+
+    struct Set_Hsv_Args
+    {
+        uint32_t hue;
+        uint8_t saturation;
+        uint8_t value;
+        std::optional<size_t> index;
+    };
+    // what follows `set hsv`: the hue in degrees; the colour goes out with its white part on the white LED
+    inline constexpr auto SET_HSV{command_schema::schema<Set_Hsv_Args>(
+        command_schema::Range{"HUE", 0, 359},
+        command_schema::U8{"SAT"},
+        command_schema::U8{"VAL"},
+        command_schema::Optional{command_schema::Index{"INDEX", neopixel::LED_COUNT}})};
+
+    struct Stream_Args
+    {
+    };
+    inline constexpr auto STREAM{command_schema::schema<Stream_Args>()};
+
+    struct Pattern_Args
+    {
+        const pattern_engine::Pattern_Entry *pattern;
+        std::optional<uint8_t> level;
+        std::optional<uint32_t> fps;
+    };
+    inline constexpr auto PATTERN{command_schema::schema<Pattern_Args>(
+        command_schema::Entry_Of{"NAME", &pattern_engine::PATTERNS},
+        command_schema::Optional{command_schema::U8{"LEVEL"}},
+        command_schema::Optional{command_schema::Range{"FPS", 1, pattern_engine::MAX_FPS}})};
+
+    enum struct Dither_Mode
+    {
+        ON,
+        OFF
+    };
+    struct Dither_Args
+    {
+        std::optional<Dither_Mode> mode;
+    };
+    inline constexpr auto DITHER{command_schema::schema<Dither_Args>(
+        command_schema::Optional{command_schema::Keyword{"MODE", std::array{std::pair{std::string_view{"on"}, Dither_Mode::ON},
+                                                                               std::pair{std::string_view{"off"}, Dither_Mode::OFF}}}})};
+
+    struct Power_Args
+    {
+        std::optional<uint32_t> budget_ma;
+        std::optional<uint8_t> white;
+        std::optional<uint8_t> red;
+        std::optional<uint8_t> green;
+        std::optional<uint8_t> blue;
+    };
+    // 0 mA is no limit; the channels are each one LED's draw at 255
+    inline constexpr auto POWER{command_schema::schema<Power_Args>(
+        command_schema::Optional{command_schema::Range{"BUDGET_MA", 0, 100'000}},
+        command_schema::Optional{command_schema::U8{"WHITE_MA"}},
+        command_schema::Optional{command_schema::U8{"RED_MA"}},
+        command_schema::Optional{command_schema::U8{"GREEN_MA"}},
+        command_schema::Optional{command_schema::U8{"BLUE_MA"}})};
+
+    struct Brightness_Args
+    {
+        std::optional<uint8_t> level;
+        std::optional<uint8_t> white;
+        std::optional<uint8_t> red;
+        std::optional<uint8_t> green;
+        std::optional<uint8_t> blue;
+    };
+    // 255 is full; the channels are the white balance, each a gain where 255 is full
+    inline constexpr auto BRIGHTNESS{command_schema::schema<Brightness_Args>(
+        command_schema::Optional{command_schema::U8{"LEVEL"}},
+        command_schema::Optional{command_schema::U8{"WHITE"}},
+        command_schema::Optional{command_schema::U8{"RED"}},
+        command_schema::Optional{command_schema::U8{"GREEN"}},
+        command_schema::Optional{command_schema::U8{"BLUE"}})};
+
+    struct Gamma_Args
+    {
+        std::optional<uint32_t> gamma_x100;
+    };
+    // 100 is a straight line, 220 the usual LED curve
+    inline constexpr auto GAMMA{command_schema::schema<Gamma_Args>(
+        command_schema::Optional{command_schema::Range{"GAMMA_X100", 10, 400}})};
+
+    // SET_HSV comes after the word `hsv`
+    inline constexpr size_t MAX_ARGUMENTS_NEEDED{std::max(command_schema::MAX_ARGUMENTS_OF<decltype(SET), decltype(STREAM), decltype(PATTERN), decltype(POWER), decltype(DITHER),
+                                                                                           decltype(BRIGHTNESS), decltype(GAMMA)>,
+                                                          decltype(SET_HSV)::MAX_ARGUMENTS + 1)};
+    static_assert(command_limits::MAX_ARGUMENTS == MAX_ARGUMENTS_NEEDED, "Command has room for exactly the longest argument list");
+}
+
+#endif
@@ -0,0 +1,36 @@
+#include "app/Command.hpp"
+
+#include "app/neopixel_output.hpp"
+
+#include "commands/arguments.hpp"
+
+#include "pico/printf.h"
+
+/* Shows or changes the brightness frames go out at, and the white balance with it.  As with `power`, the balance
+ * is all four channels or none. */
+Command_Result brightness_fn(const Command &cmd)
+{
+    return handle_with(cmd, command_arguments::BRIGHTNESS, [&cmd](const command_arguments::Brightness_Args &args)
+                       {
+                           auto settings{neopixel::output_settings()};
+                           const bool some_gains{args.white.has_value()};
+                           const bool all_gains{args.blue.has_value()};
+                           if (some_gains != all_gains)
+                           {
+                               command_arguments::BRIGHTNESS.print_usage(cmd.name());
+                               return Command_Result::ARG_INVALID;
+                           }
+                           if (args.level.has_value())
+                           {
+                               settings.brightness = *args.level;
+                               if (all_gains)
+                               {
+                                   settings.balance = pico_ws2812::WRGB{.white{*args.white}, .red{*args.red}, .green{*args.green}, .blue{*args.blue}};
+                               }
+                               neopixel::set_output_settings(settings);
+                           }
+                           printf("brightness: %u, white balance W %u R %u G %u B %u\n", settings.brightness,
+                                  settings.balance.white, settings.balance.red, settings.balance.green, settings.balance.blue);
+                           return Command_Result::SUCCESS;
+                       });
+}
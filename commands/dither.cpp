@@ -0,0 +1,21 @@
+#include "app/Command.hpp"
+
+#include "app/pattern_engine.hpp"
+
+#include "commands/arguments.hpp"
+
+#include "pico/printf.h"
+
+/* Whether patterns are drawn at 16 bits and dithered, or cut to 8; the running pattern switches from its next frame */
+Command_Result dither_fn(const Command &cmd)
+{
+    return handle_with(cmd, command_arguments::DITHER, [](const command_arguments::Dither_Args &args)
+                       {
+                           if (args.mode.has_value())
+                           {
+                               pattern_engine::set_dithering(*args.mode == command_arguments::Dither_Mode::ON);
+                           }
+                           printf("dither: %s\n", pattern_engine::dithering() ? "on" : "off");
+                           return Command_Result::SUCCESS;
+                       });
+}
@@ -0,0 +1,24 @@
+#include "app/Command.hpp"
+
+#include "app/neopixel_output.hpp"
+
+#include "commands/arguments.hpp"
+
+#include "pico/printf.h"
+
+/* Shows or changes the gamma curve frames go out through, in hundredths */
+Command_Result gamma_fn(const Command &cmd)
+{
+    return handle_with(cmd, command_arguments::GAMMA, [](const command_arguments::Gamma_Args &args)
+                       {
+                           auto settings{neopixel::output_settings()};
+                           if (args.gamma_x100.has_value())
+                           {
+                               settings.gamma_x100 = static_cast<uint16_t>(*args.gamma_x100);
+                               neopixel::set_output_settings(settings);
+                           }
+                           printf("gamma: %u.%02u%s\n", settings.gamma_x100 / 100U, settings.gamma_x100 % 100U,
+                                  settings.gamma_x100 == 100 ? " (none)" : "");
+                           return Command_Result::SUCCESS;
+                       });
+}
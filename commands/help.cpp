@@ -10,9 +10,10 @@ namespace
         printf("Welcome to the Meven Light 5000.\n");
         printf("We'll keep the light on for ya.\n");
         printf("Available commands:\n");
-        for (const auto &key : BASECMDS)
+        for (const auto &entry : COMMANDS.entries())
         {
-            printf("  %s\n", std::data(key));
+            printf("  %-8.*s %.*s\n", static_cast<int>(std::size(entry.name)), std::data(entry.name),
+                   static_cast<int>(std::size(entry.help)), std::data(entry.help));
         }
         printf("\nIn general, type CMD help to see command specific help.\n");
     }
@@ -1,9 +1,36 @@
 #include "app/Command.hpp"
 
+#include "app/pattern_engine.hpp"
+
+#include "commands/arguments.hpp"
+
 #include "pico/printf.h"
 
-Command_Result pattern_fn([[maybe_unused]] const Command &args)
+namespace
+{
+    void print_rate(const pattern_engine::Pattern_Stats &stats) noexcept
+    {
+        printf("pattern: %.*s at %lu.%lu of %lu fps, %lu frames, %lu skipped\n",
+               static_cast<int>(std::size(stats.name)), std::data(stats.name),
+               static_cast<unsigned long>(stats.actual_fps_x10 / 10), static_cast<unsigned long>(stats.actual_fps_x10 % 10),
+               static_cast<unsigned long>(stats.target_fps),
+               static_cast<unsigned long>(stats.frames), static_cast<unsigned long>(stats.skipped));
+    }
+}
+
+/* Starts one of pattern_engine::PATTERNS, which the superloop then draws a frame of whenever one is due; the
+ * shell stays usable while it runs.  `pattern stop` stops it and reports the frame rate it managed. */
+Command_Result pattern_fn(const Command &cmd)
 {
-    printf("Not implemented yet\n");
-    return Command_Result::SUCCESS;
-}
\ No newline at end of file
+    return handle_with(cmd, command_arguments::PATTERN, [](const command_arguments::Pattern_Args &args)
+                       {
+                           if (const auto previous{pattern_engine::stats()}; !std::empty(previous.name))
+                           {
+                               print_rate(previous);
+                           }
+                           pattern_engine::start(*args.pattern,
+                                                 args.fps.value_or(pattern_engine::DEFAULT_FPS),
+                                                 pattern_engine::Pattern_Params{.level = args.level.value_or(pattern_engine::DEFAULT_LEVEL)});
+                           return Command_Result::SUCCESS;
+                       });
+}
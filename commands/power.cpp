@@ -0,0 +1,37 @@
+#include "app/Command.hpp"
+
+#include "app/neopixel_output.hpp"
+
+#include "commands/arguments.hpp"
+
+#include "pico/printf.h"
+
+/* Shows or changes the power budget.  The channel currents are all or nothing: with only some of them there is no
+ * telling which were meant. */
+Command_Result power_fn(const Command &cmd)
+{
+    return handle_with(cmd, command_arguments::POWER, [&cmd](const command_arguments::Power_Args &args)
+                       {
+                           auto budget{neopixel::power_budget()};
+                           const bool some_currents{args.white.has_value()};
+                           const bool all_currents{args.blue.has_value()};
+                           if (some_currents != all_currents)
+                           {
+                               command_arguments::POWER.print_usage(cmd.name());
+                               return Command_Result::ARG_INVALID;
+                           }
+                           if (args.budget_ma.has_value())
+                           {
+                               budget.budget_ma = *args.budget_ma;
+                               if (all_currents)
+                               {
+                                   budget.full_ma = pico_ws2812::WRGB{.white{*args.white}, .red{*args.red}, .green{*args.green}, .blue{*args.blue}};
+                               }
+                               neopixel::set_power_budget(budget);
+                           }
+                           printf("power: budget %lu mA%s, per LED at full W %u R %u G %u B %u mA, %u mA idle\n",
+                                  static_cast<unsigned long>(budget.budget_ma), budget.budget_ma == 0 ? " (no limit)" : "",
+                                  budget.full_ma.white, budget.full_ma.red, budget.full_ma.green, budget.full_ma.blue, budget.idle_ma);
+                           return Command_Result::SUCCESS;
+                       });
+}
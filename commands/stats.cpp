@@ -0,0 +1,36 @@
+#include "app/Command.hpp"
+
+#include "app/neopixel_output.hpp"
+#include "app/pattern_engine.hpp"
+#include "app/stream_input.hpp"
+
+#include "pico/printf.h"
+
+Command_Result stats_fn([[maybe_unused]] const Command &args)
+{
+    const auto frames{neopixel::stats()};
+    printf("frames flushed:             %lu\n", static_cast<unsigned long>(frames.flushes));
+    printf("flushes avoided, unchanged: %lu\n", static_cast<unsigned long>(frames.skipped_unchanged));
+    printf("flushes avoided, coalesced: %lu\n", static_cast<unsigned long>(frames.coalesced));
+    printf("power drawn, estimated:     %lu mA\n", static_cast<unsigned long>(frames.power.requested_ma));
+    printf("power drawn, after limit:   %lu mA\n", static_cast<unsigned long>(frames.power.delivered_ma));
+    printf("frames limited to budget:   %lu\n", static_cast<unsigned long>(frames.power.limited));
+    const auto stream{stream_input::stats()};
+    printf("stream frames presented:    %lu\n", static_cast<unsigned long>(stream.frames));
+    printf("stream timelines loaded:    %lu\n", static_cast<unsigned long>(stream.timelines));
+    printf("stream programs loaded:     %lu\n", static_cast<unsigned long>(stream.programs));
+    printf("stream packets malformed:   %lu\n", static_cast<unsigned long>(stream.malformed));
+    printf("stream packets CRC failed:  %lu\n", static_cast<unsigned long>(stream.crc_failed));
+    printf("stream packets missing:     %lu\n", static_cast<unsigned long>(stream.missing));
+    printf("stream deltas unreferenced: %lu\n", static_cast<unsigned long>(stream.unreferenced));
+    const auto pattern{pattern_engine::stats()};
+    if (!std::empty(pattern.name))
+    {
+        printf("pattern:                    %.*s\n", static_cast<int>(std::size(pattern.name)), std::data(pattern.name));
+        printf("pattern fps, target:        %lu\n", static_cast<unsigned long>(pattern.target_fps));
+        printf("pattern fps, actual:        %lu.%lu\n", static_cast<unsigned long>(pattern.actual_fps_x10 / 10), static_cast<unsigned long>(pattern.actual_fps_x10 % 10));
+        printf("pattern frames skipped:     %lu\n", static_cast<unsigned long>(pattern.skipped));
+        printf("pattern frames over budget: %lu\n", static_cast<unsigned long>(pattern.over_budget));
+    }
+    return Command_Result::SUCCESS;
+}
@@ -0,0 +1,22 @@
+#include "app/Command.hpp"
+
+#include "app/pattern_engine.hpp"
+#include "app/stream_input.hpp"
+
+#include "commands/arguments.hpp"
+
+#include "pico/printf.h"
+
+/* Switches the serial input to COBS framed binary packets, laid out in app/stream_protocol.hpp.  The shell is back
+ * once the host sends an END packet; until then nothing typed reaches it. */
+Command_Result stream_fn(const Command &cmd)
+{
+    return handle_with(cmd, command_arguments::STREAM, [](const command_arguments::Stream_Args &)
+                       {
+                           // the host's frames would be drawn over otherwise
+                           pattern_engine::stop();
+                           stream_input::begin();
+                           printf("stream: ready\n");
+                           return Command_Result::SUCCESS;
+                       });
+}
@@ -0,0 +1,64 @@
+#if !defined(BENCH_HPP)
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Just enough harness for the host benchmarks: repeat a body until enough wall time has passed, and report the
+ * mean per call.  Numbers are for the development machine, so compare rows with each other, not with the RP2040. */
+namespace bench
+{
+    template <class T>
+    inline void do_not_optimize(const T &value) noexcept
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void clobber_memory() noexcept
+    {
+        asm volatile("" : : : "memory");
+    }
+
+    template <class Body>
+    [[nodiscard]] double ns_per_call(Body &&body, std::chrono::nanoseconds min_time = std::chrono::milliseconds{200})
+    {
+        using clock = std::chrono::steady_clock;
+        uint64_t calls{0};
+        uint64_t batch{1};
+        const auto start{clock::now()};
+        auto elapsed{clock::duration{}};
+        while (elapsed < min_time)
+        {
+            for (uint64_t ii{0}; ii < batch; ++ii)
+            {
+                body();
+            }
+            calls += batch;
+            batch *= 2;
+            elapsed = clock::now() - start;
+        }
+        return std::chrono::duration<double, std::nano>(elapsed).count() / calls;
+    }
+
+    /* time stamp counter ticks per nanosecond, to turn ns_per_call() into (reference) cycles; 0 if there's no TSC */
+    [[nodiscard]] inline double cycles_per_ns()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        using clock = std::chrono::steady_clock;
+        const auto start{clock::now()};
+        const uint64_t start_tsc{__rdtsc()};
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+        const uint64_t tsc{__rdtsc() - start_tsc};
+        return static_cast<double>(tsc) / std::chrono::duration<double, std::nano>(clock::now() - start).count();
+#else
+        return 0.0;
+#endif
+    }
+}
+
+#endif
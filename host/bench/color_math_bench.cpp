@@ -0,0 +1,133 @@
+/* The packed colour operations against the same operations a channel at a time, per pixel, over a strip's worth
+ * of wire words.  Every input is checked against the reference first; a mismatch fails the run. */
+#include "bench.hpp"
+
+#include "ws2812/color_math.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    namespace cm = pico_ws2812::color_math;
+    namespace ref = pico_ws2812::color_math::reference;
+
+    /* every pair of channel values, in each of the four byte positions, with every amount */
+    [[nodiscard]] bool check_exhaustively()
+    {
+        size_t failures{0};
+        for (uint32_t x{0}; x < 256; ++x)
+        {
+            for (uint32_t y{0}; y < 256; ++y)
+            {
+                const uint32_t a{x | (y << 8) | ((255 - x) << 16) | ((x ^ 0x5A) << 24)};
+                const uint32_t b{y | (x << 8) | ((255 - y) << 16) | ((y ^ 0xA5) << 24)};
+                failures += cm::add_saturating(a, b) != ref::per_channel_pair(ref::add_saturating, a, b);
+                failures += cm::multiply(a, b) != ref::per_channel_pair(ref::multiply, a, b);
+                failures += cm::maximum(a, b) != ref::per_channel_pair(ref::maximum, a, b);
+                for (uint32_t amount{0}; amount < 256; ++amount)
+                {
+                    const auto t{static_cast<uint8_t>(amount)};
+                    failures += cm::lerp(a, b, t) != ref::per_channel_pair(ref::lerp, a, b, t);
+                    if (y == 0)
+                    {
+                        failures += cm::scale(a, t) != ref::per_channel(ref::scale, a, t);
+                        failures += cm::fade_to_black(a, t) != ref::per_channel(ref::fade_to_black, a, t);
+                    }
+                }
+            }
+        }
+        if (failures != 0)
+        {
+            std::printf("%zu results differ from the reference\n", failures);
+        }
+        return failures == 0;
+    }
+
+    template <size_t N>
+    struct Strip
+    {
+        std::array<uint32_t, N> a;
+        std::array<uint32_t, N> b;
+        std::array<uint32_t, N> out;
+    };
+
+    template <size_t N, class Packed, class Reference>
+    void row(const char *name, Strip<N> &strip, double cycles_per_ns, Packed &&packed, Reference &&reference)
+    {
+        const double swar{bench::ns_per_call([&]
+                                             {
+                                                 for (size_t ii{0}; ii < N; ++ii)
+                                                 {
+                                                     strip.out[ii] = packed(strip.a[ii], strip.b[ii]);
+                                                 }
+                                                 bench::do_not_optimize(strip.out);
+                                             })};
+        const double scalar{bench::ns_per_call([&]
+                                               {
+                                                   for (size_t ii{0}; ii < N; ++ii)
+                                                   {
+                                                       strip.out[ii] = reference(strip.a[ii], strip.b[ii]);
+                                                   }
+                                                   bench::do_not_optimize(strip.out);
+                                               })};
+        std::printf("%-15s %5zu   %7.3f ns %7.2f cyc   %7.3f ns %7.2f cyc\n", name, N,
+                    swar / N, swar / N * cycles_per_ns, scalar / N, scalar / N * cycles_per_ns);
+    }
+
+    template <size_t N>
+    void run(double cycles_per_ns)
+    {
+        auto strip{std::make_unique<Strip<N>>()};
+        uint32_t lcg{1};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            lcg = lcg * 1664525U + 1013904223U;
+            strip->a[ii] = lcg;
+            lcg = lcg * 1664525U + 1013904223U;
+            strip->b[ii] = lcg;
+        }
+        // the amount is read through a volatile so it isn't folded into the loop
+        volatile uint8_t amount_source{77};
+        const uint8_t amount{amount_source};
+
+        row("add_saturating", *strip, cycles_per_ns, [](uint32_t a, uint32_t b)
+            { return cm::add_saturating(a, b); }, [](uint32_t a, uint32_t b)
+            { return ref::per_channel_pair(ref::add_saturating, a, b); });
+        row("scale", *strip, cycles_per_ns, [=](uint32_t a, uint32_t)
+            { return cm::scale(a, amount); }, [=](uint32_t a, uint32_t)
+            { return ref::per_channel(ref::scale, a, amount); });
+        row("lerp", *strip, cycles_per_ns, [=](uint32_t a, uint32_t b)
+            { return cm::lerp(a, b, amount); }, [=](uint32_t a, uint32_t b)
+            { return ref::per_channel_pair(ref::lerp, a, b, amount); });
+        row("multiply", *strip, cycles_per_ns, [](uint32_t a, uint32_t b)
+            { return cm::multiply(a, b); }, [](uint32_t a, uint32_t b)
+            { return ref::per_channel_pair(ref::multiply, a, b); });
+        row("maximum", *strip, cycles_per_ns, [](uint32_t a, uint32_t b)
+            { return cm::maximum(a, b); }, [](uint32_t a, uint32_t b)
+            { return ref::per_channel_pair(ref::maximum, a, b); });
+        row("fade_to_black", *strip, cycles_per_ns, [=](uint32_t a, uint32_t)
+            { return cm::fade_to_black(a, amount); }, [=](uint32_t a, uint32_t)
+            { return ref::per_channel(ref::fade_to_black, a, amount); });
+    }
+}
+
+int main()
+{
+    if (!check_exhaustively())
+    {
+        return 1;
+    }
+    std::printf("every input matches the per-channel reference\n");
+
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("per pixel         LEDs   packed                   per channel\n");
+    run<24>(cycles_per_ns);
+    run<300>(cycles_per_ns);
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return 0;
+}
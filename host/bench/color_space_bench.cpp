@@ -0,0 +1,140 @@
+/* Cost per pixel of turning a span of HSV colours into wire words with white pulled out: the integer batch kernel
+ * against the textbook float conversion followed by the same white extraction.  Every hue step, saturation and
+ * value is first checked against the float version, which the integer one must stay within MAX_DIFFERENCE of. */
+#include "bench.hpp"
+
+#include "ws2812/color_space.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    using namespace pico_ws2812;
+    using format = Wire_Format<WRGB>;
+
+    constexpr int MAX_DIFFERENCE{2};
+
+    [[nodiscard]] uint32_t float_hsv_to_wrgb(HSV colour) noexcept
+    {
+        const float hue{colour.hue / 65536.0F * 6.0F};
+        const float saturation{colour.saturation / 255.0F};
+        const float value{colour.value / 255.0F};
+        const int sector{static_cast<int>(hue)};
+        const float fraction{hue - static_cast<float>(sector)};
+        const float low{value * (1.0F - saturation)};
+        const float falling{value * (1.0F - saturation * fraction)};
+        const float rising{value * (1.0F - saturation * (1.0F - fraction))};
+        float red{0.0F};
+        float green{0.0F};
+        float blue{0.0F};
+        switch (sector)
+        {
+        case 0:
+            red = value, green = rising, blue = low;
+            break;
+        case 1:
+            red = falling, green = value, blue = low;
+            break;
+        case 2:
+            red = low, green = value, blue = rising;
+            break;
+        case 3:
+            red = low, green = falling, blue = value;
+            break;
+        case 4:
+            red = rising, green = low, blue = value;
+            break;
+        default:
+            red = value, green = low, blue = falling;
+            break;
+        }
+        const auto channel{[](float level)
+                           { return static_cast<uint8_t>(std::lround(level * 255.0F)); }};
+        return format::pack(extract_white(WRGB{.white{0}, .red{channel(red)}, .green{channel(green)}, .blue{channel(blue)}}));
+    }
+
+    [[nodiscard]] int difference(uint32_t a, uint32_t b) noexcept
+    {
+        int rv{0};
+        for (unsigned shift{0}; shift < 32; shift += 8)
+        {
+            rv = std::max(rv, std::abs(static_cast<int>((a >> shift) & 0xFFU) - static_cast<int>((b >> shift) & 0xFFU)));
+        }
+        return rv;
+    }
+
+    [[nodiscard]] bool check() noexcept
+    {
+        int worst{0};
+        for (uint32_t hue{0}; hue < 65536; hue += 17)
+        {
+            for (uint32_t saturation{0}; saturation < 256; saturation += 5)
+            {
+                for (uint32_t value{0}; value < 256; value += 5)
+                {
+                    const HSV colour{.hue = static_cast<uint16_t>(hue), .saturation = static_cast<uint8_t>(saturation), .value = static_cast<uint8_t>(value)};
+                    worst = std::max(worst, difference(hsv_to_wrgb(colour), float_hsv_to_wrgb(colour)));
+                }
+            }
+        }
+        std::printf("integer against float: at most %d apart in any channel\n", worst);
+        return worst <= MAX_DIFFERENCE;
+    }
+
+    template <size_t N>
+    struct Setup
+    {
+        std::array<HSV, N> colours;
+        std::array<uint32_t, N> out;
+    };
+
+    template <size_t N>
+    void run(double cycles_per_ns)
+    {
+        auto setup{std::make_unique<Setup<N>>()};
+        uint32_t lcg{1};
+        for (auto &colour : setup->colours)
+        {
+            lcg = lcg * 1664525U + 1013904223U;
+            colour = HSV{.hue = static_cast<uint16_t>(lcg >> 16), .saturation = static_cast<uint8_t>(lcg >> 8), .value = static_cast<uint8_t>(lcg)};
+        }
+
+        const double integer{bench::ns_per_call([&]
+                                                {
+                                                    hsv_to_wrgb(setup->colours, setup->out);
+                                                    bench::do_not_optimize(setup->out);
+                                                })};
+        const double floating{bench::ns_per_call([&]
+                                                 {
+                                                     for (size_t ii{0}; ii < N; ++ii)
+                                                     {
+                                                         setup->out[ii] = float_hsv_to_wrgb(setup->colours[ii]);
+                                                     }
+                                                     bench::do_not_optimize(setup->out);
+                                                 })};
+        std::printf("%5zu   %7.3f ns %7.2f cyc   %7.3f ns %7.2f cyc\n", N,
+                    integer / N, integer / N * cycles_per_ns, floating / N, floating / N * cycles_per_ns);
+    }
+}
+
+int main()
+{
+    if (!check())
+    {
+        return 1;
+    }
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("pixels  integer, white fused     float, then white\n");
+    run<24>(cycles_per_ns);
+    run<300>(cycles_per_ns);
+    run<1000>(cycles_per_ns);
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+/* Cost per command from a finished line to the handler returning, and the RAM behind it, for the zero-copy
+ * pipeline (Command_Token views into the line, handled in place) against the copying one it replaced, which is
+ * reproduced in `before` below as it was: the line copied out of its ring, each word copied into a temporary and
+ * again into the Command, and the Command copied into its ring, out of it, and into the executor. */
+#include "bench.hpp"
+
+#include "app/Input_State_Machine.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+namespace
+{
+    constexpr std::string_view LINE{"set 255 128 0 7 12"};
+
+    namespace before
+    {
+        using line_type = embp::variable_array<char, 40>;
+
+        template <size_t ARG_LENGTH, size_t ARG_MAX_COUNT>
+        struct Command_T
+        {
+            using arg_type = embp::variable_array<char, ARG_LENGTH>;
+            embp::variable_array<char, ARG_LENGTH> name;
+            embp::variable_array<arg_type, ARG_MAX_COUNT> arguments;
+        };
+        using Command = Command_T<16, 16>;
+
+        struct Pipeline
+        {
+            line_type current_line;
+            Fixed_Log2_Ring_Buffer<line_type, 4> lines;
+            Fixed_Log2_Ring_Buffer<Command, 4> commands;
+            Command tmp;
+
+            void type(std::string_view line)
+            {
+                current_line.resize(std::size(line));
+                memcpy(std::data(current_line), std::data(line), std::size(line));
+                (void)lines.enqueue(current_line);
+                current_line.clear();
+            }
+
+            static auto parse_word(const auto &line, auto &search_itr)
+            {
+                constexpr char SPACE{' '};
+                const auto search_begin{search_itr};
+                search_itr = std::find(search_itr, std::end(line), SPACE);
+                const auto search_end{search_itr};
+                while (search_itr != std::end(line) && *search_itr == SPACE)
+                {
+                    ++search_itr;
+                }
+                return std::make_pair(search_begin, search_end);
+            }
+
+            void build()
+            {
+                const auto get_next_line{[this]
+                                         {
+                                             const auto line{lines.dequeue()};
+                                             return line;
+                                         }};
+                const auto new_line{get_next_line()};
+                auto search_itr{std::begin(new_line)};
+                const auto [name_start, name_finish]{parse_word(new_line, search_itr)};
+                tmp.name.resize(std::distance(name_start, name_finish));
+                memcpy(std::data(tmp.name), name_start, std::size(tmp.name));
+                while (search_itr != std::end(new_line))
+                {
+                    const auto [word_start, word_finish]{parse_word(new_line, search_itr)};
+                    Command::arg_type arg;
+                    arg.resize(std::distance(word_start, word_finish));
+                    memcpy(std::data(arg), word_start, std::size(arg));
+                    tmp.arguments.push_back(arg);
+                }
+                (void)commands.enqueue(tmp);
+                tmp.arguments.clear();
+                tmp.name.clear();
+            }
+
+            Command get_next_command()
+            {
+                const auto cmd{commands.dequeue()};
+                return cmd;
+            }
+        };
+    }
+
+    size_t handler(std::string_view name, size_t argument_count, std::string_view last_argument)
+    {
+        return std::size(name) + argument_count + static_cast<size_t>(last_argument[0]);
+    }
+
+    double copying()
+    {
+        auto pipeline{std::make_unique<before::Pipeline>()};
+        return bench::ns_per_call([&]
+                                  {
+                                      pipeline->type(LINE);
+                                      pipeline->build();
+                                      const before::Command cmd{pipeline->get_next_command()};
+                                      const auto &last{cmd.arguments[std::size(cmd.arguments) - 1]};
+                                      bench::do_not_optimize(handler(std::string_view{std::data(cmd.name), std::size(cmd.name)},
+                                                                     std::size(cmd.arguments),
+                                                                     std::string_view{std::data(last), std::size(last)}));
+                                  });
+    }
+
+    double in_place()
+    {
+        auto lines{std::make_unique<tests::Fake_Line_Provider>()};
+        CommandBuilder_SM builder{*lines};
+        return bench::ns_per_call([&]
+                                  {
+                                      lines->type(LINE);
+                                      builder.update();
+                                      const Command &cmd{next_command(builder)};
+                                      bench::do_not_optimize(handler(cmd.name(), cmd.argument_count(), cmd.argument(cmd.argument_count() - 1)));
+                                      pop_command(builder);
+                                  });
+    }
+}
+
+int main()
+{
+    const auto cycles{bench::cycles_per_ns()};
+    const auto report{[cycles](const char *name, double ns)
+                      {
+                          std::printf("%-26s %8.1f ns %8.0f cycles\n", name, ns, ns * cycles);
+                      }};
+    std::printf("per command, line \"%.*s\" to handler\n", static_cast<int>(std::size(LINE)), std::data(LINE));
+    report("copying (before)", copying());
+    report("tokens in place", in_place());
+
+    // the pipeline's own storage: line queue, command queue or builder, and the Command the executor held
+    const auto before_ram{sizeof(before::Pipeline) + sizeof(before::Command)};
+    const auto after_ram{sizeof(tests::Fake_Line_Provider) + sizeof(CommandBuilder_SM<tests::Fake_Line_Provider>)};
+    std::printf("\nbytes on this host (pointers and size_t are half as wide on the RP2040)\n");
+    std::printf("sizeof(Command)            %8zu -> %zu\n", sizeof(before::Command), sizeof(Command));
+    std::printf("pipeline storage           %8zu -> %zu\n", before_ram, after_ram);
+}
@@ -0,0 +1,165 @@
+/* Command lookup: the registry's perfect hash against the two linear passes it replaced (a character by character
+ * validity check over every name, then std::find for the handler), with the shell's own 5 commands and with 56.
+ * Lookups cycle through every registered name, with one unknown name in eight. */
+#include "bench.hpp"
+
+#include "app/Command_Registry.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string_view>
+
+namespace
+{
+    using Handler = int (*)(int);
+    int handler(int x) { return x + 1; }
+
+    struct Entry
+    {
+        std::string_view name;
+        Handler handler;
+        std::string_view help;
+    };
+
+    template <size_t N>
+    consteval std::array<Entry, N> entries(const std::array<std::string_view, N> &names)
+    {
+        std::array<Entry, N> rv{};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            rv[ii] = Entry{names[ii], handler, ""};
+        }
+        return rv;
+    }
+
+    constexpr std::array SHELL_NAMES{
+        std::string_view{"help"}, std::string_view{"set"}, std::string_view{"pattern"}, std::string_view{"clock"},
+        std::string_view{"stats"}};
+
+    constexpr std::array MANY_NAMES{
+        std::string_view{"help"}, std::string_view{"set"}, std::string_view{"pattern"}, std::string_view{"clock"},
+        std::string_view{"stats"}, std::string_view{"fill"}, std::string_view{"clear"}, std::string_view{"brightness"},
+        std::string_view{"gamma"}, std::string_view{"hsv"}, std::string_view{"rgb"}, std::string_view{"stream"},
+        std::string_view{"layer"}, std::string_view{"blend"}, std::string_view{"opacity"}, std::string_view{"mask"},
+        std::string_view{"timeline"}, std::string_view{"play"}, std::string_view{"pause"}, std::string_view{"stop"},
+        std::string_view{"seek"}, std::string_view{"loop"}, std::string_view{"speed"}, std::string_view{"limit"},
+        std::string_view{"power"}, std::string_view{"dither"}, std::string_view{"white"}, std::string_view{"balance"},
+        std::string_view{"lut"}, std::string_view{"save"}, std::string_view{"load"}, std::string_view{"reset"},
+        std::string_view{"info"}, std::string_view{"version"}, std::string_view{"echo"}, std::string_view{"count"},
+        std::string_view{"strip"}, std::string_view{"pin"}, std::string_view{"mode"}, std::string_view{"rgbw"},
+        std::string_view{"upload"}, std::string_view{"vm"}, std::string_view{"run"}, std::string_view{"step"},
+        std::string_view{"trace"}, std::string_view{"budget"}, std::string_view{"fps"}, std::string_view{"coalesce"},
+        std::string_view{"window"}, std::string_view{"chase"}, std::string_view{"breathe"}, std::string_view{"sine"},
+        std::string_view{"rainbow"}, std::string_view{"twinkle"}, std::string_view{"fire"}, std::string_view{"sparkle"}};
+
+    /* what Command.hpp did before the registry, for any number of names */
+    template <size_t N>
+    struct Linear_Lookup
+    {
+        const std::array<std::string_view, N> &names;
+        std::array<Handler, N> handlers{};
+        size_t longest{std::ranges::max(names, {}, [](auto name)
+                                        { return std::size(name); })
+                           .size()};
+
+        [[nodiscard]] bool check_command_is_valid(std::string_view name) const
+        {
+            auto start{std::begin(name)};
+            const size_t word_dis{std::size(name)};
+            std::array<bool, N> failed{};
+            for (size_t cmdidx{0}; cmdidx < N; ++cmdidx)
+            {
+                failed[cmdidx] = word_dis != std::size(names[cmdidx]);
+            }
+            for (size_t charidx{0}; charidx < longest; ++charidx, ++start)
+            {
+                for (size_t cmdidx{0}; cmdidx < N; ++cmdidx)
+                {
+                    if (failed[cmdidx] || !(charidx < std::size(names[cmdidx])))
+                    {
+                        continue;
+                    }
+                    if (*start != names[cmdidx][charidx])
+                    {
+                        failed[cmdidx] = true;
+                    }
+                }
+            }
+            return !std::all_of(std::begin(failed), std::end(failed), [](auto val)
+                                { return val; });
+        }
+
+        [[nodiscard]] Handler find(std::string_view name) const
+        {
+            if (!check_command_is_valid(name))
+            {
+                return nullptr;
+            }
+            const auto itr{std::find(std::begin(names), std::end(names), name)};
+            return handlers[std::distance(std::begin(names), itr)];
+        }
+    };
+
+    template <size_t N>
+    std::array<std::string_view, N + N / 8> lookups(const std::array<std::string_view, N> &names)
+    {
+        std::array<std::string_view, N + N / 8> rv{};
+        size_t out{0};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            rv[out++] = names[ii];
+            if (ii % 8 == 7)
+            {
+                rv[out++] = "bogus";
+            }
+        }
+        return rv;
+    }
+
+    template <size_t N>
+    double linear(const std::array<std::string_view, N> &names)
+    {
+        Linear_Lookup<N> dut{names};
+        dut.handlers.fill(handler);
+        const auto queries{lookups(names)};
+        return bench::ns_per_call([&]
+                                  {
+                                      for (const auto name : queries)
+                                      {
+                                          bench::do_not_optimize(dut.find(name));
+                                      }
+                                  }) /
+               std::size(queries);
+    }
+
+    template <size_t N>
+    double hashed(const auto &registry, const std::array<std::string_view, N> &names)
+    {
+        const auto queries{lookups(names)};
+        return bench::ns_per_call([&]
+                                  {
+                                      for (const auto name : queries)
+                                      {
+                                          bench::do_not_optimize(registry.find(name));
+                                      }
+                                  }) /
+               std::size(queries);
+    }
+
+    constexpr command_registry::Registry SHELL{entries(SHELL_NAMES)};
+    constexpr command_registry::Registry MANY{entries(MANY_NAMES)};
+}
+
+int main()
+{
+    const auto cycles{bench::cycles_per_ns()};
+    std::printf("ns (cycles) per lookup     %zu commands          %zu commands\n", std::size(SHELL_NAMES), std::size(MANY_NAMES));
+    const auto row{[cycles](const char *name, double few, double many)
+                   {
+                       std::printf("%-24s %7.1f (%5.0f)      %7.1f (%5.0f)\n", name, few, few * cycles, many, many * cycles);
+                   }};
+    row("linear, two passes", linear(SHELL_NAMES), linear(MANY_NAMES));
+    row("perfect hash", hashed(SHELL, SHELL_NAMES), hashed(MANY, MANY_NAMES));
+    std::printf("\nregistry tables: %zu slots, %zu buckets for %zu commands\n", MANY.SLOTS, MANY.BUCKETS, std::size(MANY_NAMES));
+}
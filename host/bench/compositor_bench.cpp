@@ -0,0 +1,208 @@
+/* Cost of Compositor::flatten() per layer per LED, for each blend mode, against stacking the same layers a layer at
+ * a time (a whole pass over the frame for each).  First every flatten() of a run of random changes to random
+ * layers is checked against stacking every layer again with color_math's per-channel reference; a mismatch fails
+ * the run. */
+#include "bench.hpp"
+
+#include "ws2812/compositor.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    using namespace pico_ws2812;
+    namespace ref = color_math::reference;
+
+    constexpr size_t LEDS{300};
+    constexpr size_t LAYERS{4};
+    using Stack = Compositor<LEDS, LAYERS>;
+
+    struct Lcg
+    {
+        uint32_t state{1};
+        uint32_t operator()() noexcept
+        {
+            state = state * 1664525U + 1013904223U;
+            return state;
+        }
+    };
+
+    [[nodiscard]] uint32_t reference_blend(Blend mode, uint32_t below, uint32_t above, uint8_t alpha) noexcept
+    {
+        switch (mode)
+        {
+        case Blend::ADD:
+            return ref::per_channel_pair(ref::add_saturating, below, ref::per_channel(ref::scale, above, alpha));
+        case Blend::MULTIPLY:
+            return ref::per_channel_pair(ref::lerp, below, ref::per_channel_pair(ref::multiply, below, above), alpha);
+        case Blend::MAX:
+            return ref::per_channel_pair(ref::lerp, below, ref::per_channel_pair(ref::maximum, below, above), alpha);
+        case Blend::NORMAL:
+        default:
+            return ref::per_channel_pair(ref::lerp, below, above, alpha);
+        }
+    }
+
+    /* every layer, every time, a layer at a time: with `reference` the per-channel operations and no skipping at
+     * all, otherwise the packed ones, leaving out only see-through layers */
+    void stack_a_layer_at_a_time(const Stack &stack, std::span<uint32_t, LEDS> out, bool reference)
+    {
+        std::ranges::fill(out, 0U);
+        for (size_t ii{0}; ii < LAYERS; ++ii)
+        {
+            const auto &layer{stack.layer(ii)};
+            if (!reference && layer.opacity() == 0)
+            {
+                continue;
+            }
+            for (size_t pixel{0}; pixel < LEDS; ++pixel)
+            {
+                const auto alpha{layer.masked() ? ref::scale(layer.mask()[pixel], layer.opacity()) : layer.opacity()};
+                out[pixel] = reference ? reference_blend(layer.blend(), out[pixel], layer.words()[pixel], alpha)
+                                       : blend(layer.blend(), out[pixel], layer.words()[pixel], alpha);
+            }
+        }
+    }
+
+    [[nodiscard]] bool check()
+    {
+        auto stack{std::make_unique<Stack>()};
+        std::array<uint32_t, LEDS> out{};
+        std::array<uint32_t, LEDS> expected{};
+        Lcg lcg;
+        size_t failures{0};
+        for (int frame{0}; frame < 20'000; ++frame)
+        {
+            // one to three changes, mostly to the top layers, some of which change nothing
+            for (uint32_t changes{lcg() % 3 + 1}; changes != 0; --changes)
+            {
+                const uint32_t roll{lcg()};
+                auto &layer{stack->layer(LAYERS - 1 - (roll >> 8) % (roll % 2 == 0 ? 2 : LAYERS))};
+                switch ((roll >> 16) % 7)
+                {
+                case 0:
+                    layer.set_opacity(static_cast<uint8_t>((roll >> 24) < 64 ? 0 : (roll >> 24) < 128 ? 255 : roll >> 24));
+                    break;
+                case 1:
+                    layer.set_blend(static_cast<Blend>((roll >> 24) % 4));
+                    break;
+                case 2:
+                    if ((roll >> 24) < 128)
+                    {
+                        layer.clear_mask();
+                        break;
+                    }
+                    for (auto &alpha : layer.mask())
+                    {
+                        alpha = static_cast<uint8_t>(lcg() >> 24);
+                    }
+                    break;
+                case 3:
+                    layer.fill(lcg());
+                    break;
+                default:
+                    for (size_t count{lcg() % 8}; count != 0; --count)
+                    {
+                        layer.set(lcg() % LEDS, lcg());
+                    }
+                    break;
+                }
+            }
+            if (stack->flatten(out))
+            {
+                stack_a_layer_at_a_time(*stack, expected, true);
+                failures += out != expected;
+            }
+        }
+        if (failures != 0)
+        {
+            std::printf("%zu frames differ from stacking every layer again\n", failures);
+        }
+        return failures == 0;
+    }
+
+    [[nodiscard]] std::unique_ptr<Stack> make_stack(Blend mode, bool masked)
+    {
+        auto stack{std::make_unique<Stack>()};
+        Lcg lcg;
+        for (size_t ii{0}; ii < LAYERS; ++ii)
+        {
+            auto &layer{stack->layer(ii)};
+            for (auto &word : layer.words())
+            {
+                word = lcg();
+            }
+            // a background the others go over, so none of them covers it
+            layer.set_opacity(ii == 0 ? 255 : 200);
+            layer.set_blend(ii == 0 ? Blend::NORMAL : mode);
+            if (masked && ii != 0)
+            {
+                for (auto &alpha : layer.mask())
+                {
+                    alpha = static_cast<uint8_t>(lcg() >> 24);
+                }
+            }
+        }
+        return stack;
+    }
+
+    void row(const char *name, Blend mode, bool masked, double cycles_per_ns)
+    {
+        auto stack{make_stack(mode, masked)};
+        std::array<uint32_t, LEDS> out{};
+        constexpr double PER{LEDS * LAYERS};
+
+        // every layer changed every frame, the most flatten() can have to do
+        const double one_pass{bench::ns_per_call([&]
+                                                 {
+                                                     for (size_t ii{0}; ii < LAYERS; ++ii)
+                                                     {
+                                                         (void)stack->layer(ii).words();
+                                                     }
+                                                     (void)stack->flatten(out);
+                                                     bench::do_not_optimize(out);
+                                                 })};
+        const double per_layer{bench::ns_per_call([&]
+                                                  {
+                                                      stack_a_layer_at_a_time(*stack, out, false);
+                                                      bench::do_not_optimize(out);
+                                                  })};
+        // only the top layer changed; the three under it come from what was kept
+        const double top_only{bench::ns_per_call([&]
+                                                 {
+                                                     (void)stack->layer(LAYERS - 1).words();
+                                                     (void)stack->flatten(out);
+                                                     bench::do_not_optimize(out);
+                                                 })};
+        std::printf("%-15s %7.3f ns %6.2f cyc   %7.3f ns %6.2f cyc   %7.3f ns %6.2f cyc\n", name,
+                    one_pass / PER, one_pass / PER * cycles_per_ns,
+                    per_layer / PER, per_layer / PER * cycles_per_ns,
+                    top_only / LEDS, top_only / LEDS * cycles_per_ns);
+    }
+}
+
+int main()
+{
+    if (!check())
+    {
+        return 1;
+    }
+    std::printf("every frame matches stacking every layer again\n");
+
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("%zu LEDs, %zu layers   per layer per LED                            per LED\n", LEDS, LAYERS);
+    std::printf("                one pass               a pass per layer        top layer changed\n");
+    row("normal", Blend::NORMAL, false, cycles_per_ns);
+    row("add", Blend::ADD, false, cycles_per_ns);
+    row("multiply", Blend::MULTIPLY, false, cycles_per_ns);
+    row("max", Blend::MAX, false, cycles_per_ns);
+    row("normal, masked", Blend::NORMAL, true, cycles_per_ns);
+    row("max, masked", Blend::MAX, true, cycles_per_ns);
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return 0;
+}
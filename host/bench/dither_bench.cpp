@@ -0,0 +1,94 @@
+/* Cost of turning a 16-bit frame into the next dithered 8-bit one, per LED: Dithered_Frame's two words a pixel
+ * against the same arithmetic a channel at a time.  Both are run side by side first and must agree. */
+#include "bench.hpp"
+
+#include "ws2812/dither.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    using namespace pico_ws2812;
+    using format = Wire_Format<WRGB>;
+
+    template <size_t N>
+    struct Channelwise
+    {
+        std::array<WRGB16, N> pixels;
+        std::array<std::array<uint8_t, 4>, N> errors{};
+
+        void quantize(std::span<uint32_t, N> out) noexcept
+        {
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                auto &error{errors[ii]};
+                out[ii] = format::pack(WRGB{.white{reference::quantize(pixels[ii].white, error[0])},
+                                            .red{reference::quantize(pixels[ii].red, error[1])},
+                                            .green{reference::quantize(pixels[ii].green, error[2])},
+                                            .blue{reference::quantize(pixels[ii].blue, error[3])}});
+            }
+        }
+    };
+
+    template <size_t N>
+    struct Setup
+    {
+        Dithered_Frame<N> frame{0};
+        Channelwise<N> channelwise;
+        std::array<uint32_t, N> out;
+        std::array<uint32_t, N> reference_out;
+    };
+
+    template <size_t N>
+    [[nodiscard]] bool run(double cycles_per_ns)
+    {
+        auto setup{std::make_unique<Setup<N>>()};
+        uint32_t lcg{1};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            lcg = lcg * 1664525U + 1013904223U;
+            const WRGB16 pixel{.white{static_cast<uint16_t>(lcg)}, .red{static_cast<uint16_t>(lcg >> 16)},
+                               .green{static_cast<uint16_t>(lcg >> 5)}, .blue{static_cast<uint16_t>(lcg >> 11)}};
+            setup->frame.set(ii, pixel);
+            setup->channelwise.pixels[ii] = pixel;
+        }
+        for (int frame{0}; frame < 512; ++frame)
+        {
+            setup->frame.quantize(setup->out);
+            setup->channelwise.quantize(setup->reference_out);
+            if (setup->out != setup->reference_out)
+            {
+                std::printf("%zu LEDs: frame %d differs from the channel at a time version\n", N, frame);
+                return false;
+            }
+        }
+
+        const double packed{bench::ns_per_call([&]
+                                               {
+                                                   setup->frame.quantize(setup->out);
+                                                   bench::do_not_optimize(setup->out);
+                                               })};
+        const double channelwise{bench::ns_per_call([&]
+                                                    {
+                                                        setup->channelwise.quantize(setup->out);
+                                                        bench::do_not_optimize(setup->out);
+                                                    })};
+        std::printf("%5zu   %7.3f ns %7.2f cyc   %7.3f ns %7.2f cyc   %8.2f us/frame\n", N,
+                    packed / N, packed / N * cycles_per_ns, channelwise / N, channelwise / N * cycles_per_ns, packed / 1000);
+        return true;
+    }
+}
+
+int main()
+{
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("LEDs    two words a pixel        a channel at a time\n");
+    const bool ok{run<24>(cycles_per_ns) && run<300>(cycles_per_ns) && run<1000>(cycles_per_ns)};
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/* Cost per LED of getting a frame to the driver: packing WRGB on every flush (the old put_pixel path) against
+ * sending a Wire_Frame that was packed when it was written. */
+#include "bench.hpp"
+
+#include "ws2812/wire_frame.hpp"
+#include "ws2812/ws2812.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    volatile uint32_t fake_tx_fifo;
+
+    /* a string_interface that just stores to a register, like pio_sm_put would without the wait */
+    struct Register_Driver
+    {
+        void put_pixel(uint32_t value) noexcept { fake_tx_fifo = value; }
+        void set_rgb_mode() noexcept {}
+        void set_wrgb_mode() noexcept {}
+    };
+
+    template <size_t N>
+    void run()
+    {
+        Register_Driver raw;
+        pico_ws2812::WRGB_Driver pixel_driver{raw};
+
+        auto pixels{std::make_unique<std::array<pico_ws2812::WRGB, N>>()};
+        auto frame{std::make_unique<pico_ws2812::Wire_Frame<pico_ws2812::WRGB, N>>()};
+        auto dma_target{std::make_unique<std::array<uint32_t, N>>()};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            const pico_ws2812::WRGB pixel{.white{static_cast<uint8_t>(ii)}, .red{static_cast<uint8_t>(ii * 3)}, .green{static_cast<uint8_t>(ii * 5)}, .blue{static_cast<uint8_t>(ii * 7)}};
+            (*pixels)[ii] = pixel;
+            frame->set(ii, pixel);
+        }
+
+        const double pack_each_flush{bench::ns_per_call([&]
+                                                        {
+                                                            for (const auto &pixel : *pixels)
+                                                            {
+                                                                pixel_driver.put_pixel(pixel);
+                                                            }
+                                                            bench::clobber_memory();
+                                                        })};
+        const double prepacked{bench::ns_per_call([&]
+                                                  {
+                                                      for (const auto word : frame->words())
+                                                      {
+                                                          raw.put_pixel(word);
+                                                      }
+                                                      bench::clobber_memory();
+                                                  })};
+        const double prepacked_copy{bench::ns_per_call([&]
+                                                       {
+                                                           std::copy(std::begin(frame->words()), std::end(frame->words()), std::begin(*dma_target));
+                                                           bench::do_not_optimize(*dma_target);
+                                                       })};
+
+        std::printf("%6zu LEDs   %8.3f   %8.3f   %8.3f\n", N, pack_each_flush / N, prepacked / N, prepacked_copy / N);
+    }
+}
+
+int main()
+{
+    std::printf("ns per LED   pack/flush  prepacked  prepacked copy\n");
+    run<24>();
+    run<300>();
+    run<1000>();
+}
@@ -0,0 +1,218 @@
+/* The `stream` upload's compressed frames against raw ones, on a few sample animations at the firmware's strip
+ * length and at 300 LEDs: bytes on the serial port per frame, and the device's cost per LED to turn them into wire
+ * words (COBS, CRC, then the ops or the raw pixels).  Compressed streams have a KEY every 30 frames. */
+#include "bench.hpp"
+
+#include "app/frame_codec.hpp"
+#include "app/neopixel_output.hpp"
+#include "app/stream_protocol.hpp"
+
+#include <array>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+    using namespace stream_protocol;
+    using pico_ws2812::WRGB;
+    using Format = pico_ws2812::Wire_Format<WRGB>;
+
+    constexpr size_t FRAMES{240};
+    constexpr size_t KEYFRAME_INTERVAL{30};
+
+    template <size_t N>
+    using Frame = std::array<WRGB, N>;
+
+    template <size_t N>
+    Frame<N> still(size_t, std::minstd_rand &)
+    {
+        Frame<N> frame{};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            frame[ii] = WRGB{.white{static_cast<uint8_t>(ii * 5)}, .red{40}, .green{0}, .blue{static_cast<uint8_t>(ii)}};
+        }
+        return frame;
+    }
+
+    /* three lit pixels moving over black */
+    template <size_t N>
+    Frame<N> comet(size_t index, std::minstd_rand &)
+    {
+        Frame<N> frame{};
+        for (size_t tail{0}; tail < 3; ++tail)
+        {
+            frame[(index + N - tail) % N] = WRGB{.white{0}, .red{static_cast<uint8_t>(255 >> tail)}, .green{0}, .blue{0}};
+        }
+        return frame;
+    }
+
+    /* the whole strip one colour, fading up and down */
+    template <size_t N>
+    Frame<N> breathe(size_t index, std::minstd_rand &)
+    {
+        const auto level{static_cast<uint8_t>(index % 128 < 64 ? index % 64 * 4 : 255 - index % 64 * 4)};
+        Frame<N> frame{};
+        frame.fill(WRGB{.white{level}, .red{0}, .green{static_cast<uint8_t>(level / 2)}, .blue{0}});
+        return frame;
+    }
+
+    /* a few pixels change each frame */
+    template <size_t N>
+    Frame<N> sparkle(size_t, std::minstd_rand &rng)
+    {
+        static Frame<N> frame{};
+        for (size_t ii{0}; ii < 1 + N / 24; ++ii)
+        {
+            const auto value{static_cast<uint8_t>(rng())};
+            frame[rng() % N] = WRGB{.white{value}, .red{value}, .green{value}, .blue{value}};
+        }
+        return frame;
+    }
+
+    /* every pixel changes every frame */
+    template <size_t N>
+    Frame<N> rainbow(size_t index, std::minstd_rand &)
+    {
+        Frame<N> frame{};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            const auto hue{static_cast<uint8_t>(index * 3 + ii * 256 / N)};
+            frame[ii] = WRGB{.white{0}, .red{hue}, .green{static_cast<uint8_t>(255 - hue)}, .blue{static_cast<uint8_t>(hue * 2)}};
+        }
+        return frame;
+    }
+
+    template <size_t N>
+    std::vector<uint8_t> raw_stream(const std::vector<Frame<N>> &frames)
+    {
+        std::vector<uint8_t> stream;
+        std::array<uint8_t, N * BYTES_PER_PIXEL> pixels{};
+        std::array<uint8_t, encoded_size(packet_size(N)) + 1> wire{};
+        uint8_t sequence{0};
+        for (const auto &frame : frames)
+        {
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                pixels[ii * 4 + 0] = frame[ii].white;
+                pixels[ii * 4 + 1] = frame[ii].red;
+                pixels[ii * 4 + 2] = frame[ii].green;
+                pixels[ii * 4 + 3] = frame[ii].blue;
+            }
+            const auto size{encode_packet<std::size(pixels)>(Packet_Type::FRAME, sequence++, 0, N, pixels, wire)};
+            stream.insert(std::end(stream), std::begin(wire), std::begin(wire) + size);
+        }
+        return stream;
+    }
+
+    template <size_t N>
+    std::vector<uint8_t> coded_stream(const std::vector<Frame<N>> &frames)
+    {
+        std::vector<uint8_t> stream;
+        frame_codec::Stream_Encoder<N> encoder{KEYFRAME_INTERVAL};
+        std::array<uint8_t, frame_codec::Stream_Encoder<N>::MAX_WIRE_SIZE> wire{};
+        for (const auto &frame : frames)
+        {
+            const auto size{encoder.encode(frame, wire)};
+            stream.insert(std::end(stream), std::begin(wire), std::begin(wire) + size);
+        }
+        return stream;
+    }
+
+    /* what stream_input does with each packet, minus the printing and the bookkeeping */
+    template <size_t N>
+    void decode(const std::vector<uint8_t> &stream, std::array<uint32_t, N> &words)
+    {
+        static Cobs_Decoder<HEADER_SIZE + frame_codec::Stream_Encoder<N>::MAX_PAYLOAD + CRC_SIZE> decoder;
+        for (const auto byte : stream)
+        {
+            if (decoder.push(byte) != decltype(decoder)::Event::PACKET)
+            {
+                continue;
+            }
+            const auto packet{parse_packet(decoder.packet())};
+            if (packet.status != Parse_Status::OK)
+            {
+                continue;
+            }
+            switch (packet.type)
+            {
+            case Packet_Type::FRAME:
+                for (size_t ii{0}; ii < N; ++ii)
+                {
+                    const auto *pixel{&packet.payload[ii * BYTES_PER_PIXEL]};
+                    words[ii] = Format::pack(WRGB{.white{pixel[0]}, .red{pixel[1]}, .green{pixel[2]}, .blue{pixel[3]}});
+                }
+                break;
+            case Packet_Type::KEY:
+            case Packet_Type::DELTA:
+                if (frame_codec::valid(packet.payload, N))
+                {
+                    if (packet.type == Packet_Type::KEY)
+                    {
+                        words.fill(0);
+                    }
+                    frame_codec::apply(packet.payload, words);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    template <size_t N>
+    void row(const char *name, Frame<N> (*animation)(size_t, std::minstd_rand &), double cycles)
+    {
+        std::minstd_rand rng{1};
+        std::vector<Frame<N>> frames;
+        for (size_t ii{0}; ii < FRAMES; ++ii)
+        {
+            frames.push_back(animation(ii, rng));
+        }
+        const auto raw{raw_stream<N>(frames)};
+        const auto coded{coded_stream<N>(frames)};
+
+        // both streams have to end on the same frame
+        std::array<uint32_t, N> from_raw{};
+        std::array<uint32_t, N> from_coded{};
+        decode<N>(raw, from_raw);
+        decode<N>(coded, from_coded);
+        if (from_raw != from_coded)
+        {
+            std::printf("%-10s %4zu  MISMATCH\n", name, N);
+            return;
+        }
+
+        std::array<uint32_t, N> words{};
+        const double raw_ns{bench::ns_per_call([&]
+                                               { decode<N>(raw, words); bench::do_not_optimize(words); }) /
+                            (FRAMES * N)};
+        const double coded_ns{bench::ns_per_call([&]
+                                                 { decode<N>(coded, words); bench::do_not_optimize(words); }) /
+                              (FRAMES * N)};
+        std::printf("%-10s %4zu  %8.1f %8.1f %6.1fx   %6.2f (%5.1f)  %6.2f (%5.1f)\n", name, N,
+                    static_cast<double>(std::size(raw)) / FRAMES, static_cast<double>(std::size(coded)) / FRAMES,
+                    static_cast<double>(std::size(raw)) / std::size(coded),
+                    raw_ns, raw_ns * cycles, coded_ns, coded_ns * cycles);
+    }
+
+    template <size_t N>
+    void rows(double cycles)
+    {
+        row<N>("still", still<N>, cycles);
+        row<N>("comet", comet<N>, cycles);
+        row<N>("breathe", breathe<N>, cycles);
+        row<N>("sparkle", sparkle<N>, cycles);
+        row<N>("rainbow", rainbow<N>, cycles);
+    }
+}
+
+int main()
+{
+    const auto cycles{bench::cycles_per_ns()};
+    std::printf("%zu frames each           bytes/frame               decode ns (cycles) per LED\n", FRAMES);
+    std::printf("animation  LEDs       raw    coded  ratio      raw             coded\n");
+    rows<neopixel::LED_COUNT>(cycles);
+    rows<300>(cycles);
+}
@@ -0,0 +1,167 @@
+/* Output_LUT: what a rebuild costs, whole (gamma changed) and without the curve (brightness or balance changed), and
+ * what the fused lookup costs per LED against doing gamma, brightness and balance as arithmetic on each channel.
+ *
+ * First checks the integer curve against std::pow for a range of gammas, and that the lookup and the arithmetic
+ * give the same frame. */
+#include "bench.hpp"
+
+#include "ws2812/output_lut.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    using namespace pico_ws2812;
+    using format = Wire_Format<WRGB>;
+
+    // the error allowed of gamma_q16(), in 65536ths
+    constexpr double MAX_CURVE_ERROR{4.0};
+
+    [[nodiscard]] bool check_curve()
+    {
+        double worst{0.0};
+        uint16_t worst_gamma{0};
+        for (uint16_t gamma_x100{10}; gamma_x100 <= 400; gamma_x100 += 5)
+        {
+            for (unsigned ii{0}; ii < 256; ++ii)
+            {
+                const double expected{std::pow(ii / 255.0, gamma_x100 / 100.0) * 65536.0};
+                const double error{std::fabs(gamma_q16(static_cast<uint8_t>(ii), gamma_x100) - expected)};
+                if (error > worst)
+                {
+                    worst = error;
+                    worst_gamma = gamma_x100;
+                }
+            }
+        }
+        std::printf("curve: worst error %.2f / 65536 (gamma %u.%02u), against std::pow\n", worst, worst_gamma / 100U, worst_gamma % 100U);
+        return worst <= MAX_CURVE_ERROR;
+    }
+
+    /* the same settings worked out for each channel of each pixel, with only the gamma curve in a table */
+    template <size_t N>
+    struct Arithmetic
+    {
+        std::array<uint32_t, 256> curve{};
+        uint32_t brightness{0};
+        std::array<uint32_t, 4> gains{};
+
+        void set(const Output_Settings &settings) noexcept
+        {
+            for (size_t ii{0}; ii < 256; ++ii)
+            {
+                curve[ii] = gamma_q16(static_cast<uint8_t>(ii), settings.gamma_x100);
+            }
+            brightness = color_math::detail::weight(settings.brightness);
+            const auto packed{format::pack(settings.balance)};
+            for (unsigned lane{0}; lane < 4; ++lane)
+            {
+                gains[lane] = color_math::detail::weight(static_cast<uint8_t>(packed >> (8 * lane)));
+            }
+        }
+
+        void apply(std::span<const uint32_t, N> frame, std::span<uint32_t, N> out) const noexcept
+        {
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                uint32_t word{0};
+                for (unsigned lane{0}; lane < 4; ++lane)
+                {
+                    const uint32_t level{(((curve[(frame[ii] >> (8 * lane)) & 0xFFU] * brightness) >> 8) * gains[lane]) >> 8};
+                    const uint32_t value{(level * 255 + (1U << 15)) >> 16};
+                    word |= (value > 255 ? 255 : value) << (8 * lane);
+                }
+                out[ii] = word;
+            }
+        }
+    };
+
+    template <size_t N>
+    struct Setup
+    {
+        Output_LUT<WRGB, N> lut;
+        Arithmetic<N> arithmetic;
+        std::array<uint32_t, N> frame;
+        std::array<uint32_t, N> out;
+    };
+
+    template <size_t N>
+    [[nodiscard]] bool run(double cycles_per_ns)
+    {
+        const Output_Settings settings{.gamma_x100 = 220, .brightness = 200, .balance{.white{230}, .red{255}, .green{210}, .blue{190}}};
+        auto setup{std::make_unique<Setup<N>>()};
+        uint32_t lcg{1};
+        for (auto &word : setup->frame)
+        {
+            lcg = lcg * 1664525U + 1013904223U;
+            word = lcg;
+        }
+        setup->lut.set(settings);
+        setup->arithmetic.set(settings);
+        setup->arithmetic.apply(setup->frame, setup->out);
+        const auto looked_up{setup->lut.apply(setup->frame)};
+        for (size_t ii{0}; ii < N; ++ii)
+        {
+            if (looked_up[ii] != setup->out[ii])
+            {
+                std::printf("%zu LEDs: pixel %zu is %08x looked up, %08x worked out\n", N, ii, looked_up[ii], setup->out[ii]);
+                return false;
+            }
+        }
+
+        const double lookup{bench::ns_per_call([&]
+                                               {
+                                                   bench::clobber_memory();
+                                                   bench::do_not_optimize(setup->lut.apply(setup->frame).data());
+                                               })};
+        const double arithmetic{bench::ns_per_call([&]
+                                                   {
+                                                       setup->arithmetic.apply(setup->frame, setup->out);
+                                                       bench::do_not_optimize(setup->out);
+                                                   })};
+        std::printf("%5zu   %7.3f ns %7.2f cyc   %7.3f ns %7.2f cyc\n", N,
+                    lookup / N, lookup / N * cycles_per_ns, arithmetic / N, arithmetic / N * cycles_per_ns);
+        return true;
+    }
+
+    void rebuilds(double cycles_per_ns)
+    {
+        auto lut{std::make_unique<Output_LUT<WRGB, 1>>()};
+        Output_Settings settings{DEFAULT_OUTPUT_SETTINGS};
+        // alternate between two values so every set() has something to rebuild
+        const double whole{bench::ns_per_call([&]
+                                              {
+                                                  settings.gamma_x100 = settings.gamma_x100 == 220 ? 250 : 220;
+                                                  lut->set(settings);
+                                                  bench::clobber_memory();
+                                              })};
+        const double tables{bench::ns_per_call([&]
+                                               {
+                                                   settings.brightness = settings.brightness == 200 ? 100 : 200;
+                                                   lut->set(settings);
+                                                   bench::clobber_memory();
+                                               })};
+        std::printf("rebuild: gamma changed %8.2f us %10.0f cyc, brightness changed %8.2f us %10.0f cyc\n",
+                    whole / 1000, whole * cycles_per_ns, tables / 1000, tables * cycles_per_ns);
+    }
+}
+
+int main()
+{
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    if (!check_curve())
+    {
+        return 1;
+    }
+    rebuilds(cycles_per_ns);
+    std::printf("LEDs    one lookup a channel     gamma, brightness, balance worked out\n");
+    const bool ok{run<24>(cycles_per_ns) && run<300>(cycles_per_ns) && run<1000>(cycles_per_ns)};
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+/* Cost of running a pattern as a program (app/pattern_vm.hpp) rather than compiled in: instructions per pixel, time
+ * per instruction, and time per pixel against the same pattern in C++, for the programs in host/tools/patterns.
+ * Every pixel of a few thousand frames is first checked to be the same both ways. */
+#include "bench.hpp"
+
+#include "app/constexpr_math.hpp"
+#include "app/pattern_vm.hpp"
+#include "tools/pattern_assembler.hpp"
+#include "ws2812/color_space.hpp"
+
+#include <array>
+#include <cstdio>
+#include <string_view>
+
+namespace
+{
+    constexpr size_t LEDS{24};
+    constexpr uint32_t CHECKED_FRAMES{5000};
+    constexpr uint32_t UNLIMITED{UINT32_MAX};
+
+    using Native_Fn = uint32_t (*)(uint32_t step, uint32_t pixel, uint32_t count);
+
+    struct Case
+    {
+        const char *name;
+        std::string_view source; // as in host/tools/patterns
+        Native_Fn native;
+    };
+
+    constexpr Case CASES[]{
+        {"chase", R"(
+            shli r4, pixel, 8
+            div r4, r4, count
+            add r4, r4, step
+            sin r4, r4
+            gamma r4, r4
+            chan r4, r4, w
+            out r4
+        )",
+         [](uint32_t step, uint32_t pixel, uint32_t count) -> uint32_t
+         {
+             const auto intensity{SINE_TABLE<256>[((pixel << 8) / count + step) & 0xFFU]};
+             return SRGB_GAMMA_CURVE<256>[intensity];
+         }},
+        {"rainbow", R"(
+            shli r4, step, 8
+            li r5, 65536
+            mul r5, pixel, r5
+            div r5, r5, count
+            add r4, r4, r5
+            ldi r6, 255
+            hsv r7, r4, r6
+            out r7
+        )",
+         [](uint32_t step, uint32_t pixel, uint32_t count)
+         {
+             const auto hue{static_cast<uint16_t>((step << 8) + pixel * 65536U / count)};
+             return pico_ws2812::hsv_to_wrgb(pico_ws2812::HSV{.hue = hue, .saturation = 255, .value = 255});
+         }},
+        {"comet", R"(
+            mod r4, step, count
+            add r4, r4, count
+            sub r4, r4, pixel
+            mod r4, r4, count
+            ldi r5, 4
+            slt r6, r4, r5
+            brz r6, background
+            ldi r5, 255
+            shr r5, r5, r4
+            chan r5, r5, r
+            out r5
+        background:
+            ldi r5, 8
+            chan r5, r5, b
+            out r5
+        )",
+         [](uint32_t step, uint32_t pixel, uint32_t count)
+         {
+             const uint32_t behind{(step % count + count - pixel) % count};
+             return behind < 4 ? (255U >> behind) << 16 : 8U << 8;
+         }},
+    };
+
+    [[nodiscard]] bool check(const Case &test, const pattern_vm::Machine &machine)
+    {
+        std::array<uint32_t, LEDS> words{};
+        for (uint32_t step{0}; step < CHECKED_FRAMES; ++step)
+        {
+            (void)machine.run(step, words, UNLIMITED);
+            for (uint32_t pixel{0}; pixel < LEDS; ++pixel)
+            {
+                if (words[pixel] != test.native(step, pixel, LEDS))
+                {
+                    std::printf("%s: step %u pixel %u is %08X, %08X natively\n", test.name, step, pixel, words[pixel], test.native(step, pixel, LEDS));
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void row(const Case &test, const pattern_vm::Machine &machine, double cycles_per_ns)
+    {
+        std::array<uint32_t, LEDS> words{};
+        const auto instructions_per_pixel{static_cast<double>(machine.run(0, words, UNLIMITED).instructions) / LEDS};
+        uint32_t step{0};
+        const double program{bench::ns_per_call([&]
+                                                {
+                                                    (void)machine.run(step++, words, UNLIMITED);
+                                                    bench::do_not_optimize(words);
+                                                }) /
+                             LEDS};
+        step = 0;
+        const double native{bench::ns_per_call([&]
+                                               {
+                                                   for (uint32_t pixel{0}; pixel < LEDS; ++pixel)
+                                                   {
+                                                       words[pixel] = test.native(step, pixel, LEDS);
+                                                   }
+                                                   ++step;
+                                                   bench::do_not_optimize(words);
+                                               }) /
+                            LEDS};
+        const double per_instruction{program / instructions_per_pixel};
+        std::printf("%-8s %6.1f   %6.3f ns %6.2f cyc   %7.3f ns %7.2f cyc   %7.3f ns %7.2f cyc\n", test.name, instructions_per_pixel,
+                    per_instruction, per_instruction * cycles_per_ns, program, program * cycles_per_ns, native, native * cycles_per_ns);
+    }
+}
+
+int main()
+{
+    std::array<pattern_vm::Machine, std::size(CASES)> machines{};
+    for (size_t ii{0}; ii < std::size(CASES); ++ii)
+    {
+        const auto assembly{pattern_assembler::assemble(CASES[ii].source)};
+        if (std::empty(assembly.bytes))
+        {
+            std::printf("%s: line %zu: %s\n", CASES[ii].name, assembly.error_line, assembly.error.c_str());
+            return 1;
+        }
+        machines[ii].load(assembly.bytes);
+        if (!check(CASES[ii], machines[ii]))
+        {
+            return 1;
+        }
+    }
+    std::printf("every pixel the programs draw matches the patterns in C++\n");
+
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("program  instr/px   per instruction          program, per pixel       C++, per pixel\n");
+    for (size_t ii{0}; ii < std::size(CASES); ++ii)
+    {
+        row(CASES[ii], machines[ii], cycles_per_ns);
+    }
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return 0;
+}
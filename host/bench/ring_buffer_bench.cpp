@@ -0,0 +1,94 @@
+/* Throughput of SPSC_Ring_Buffer against Fixed_Log2_Ring_Buffer, per element.  Single-threaded rows are the
+ * same fill-then-drain loop for both; the last row is the SPSC ring between two threads, which the old buffer
+ * can't do at all; on a single CPU that row mostly measures thread switches. */
+#include "bench.hpp"
+
+#include "app/Ring_Buffer.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace
+{
+    constexpr size_t RING_SIZE{256};
+    // fill and drain this many at a time; the old buffer only holds RING_SIZE - 1
+    constexpr size_t BATCH{RING_SIZE - 1};
+
+    template <class Ring>
+    double element_at_a_time()
+    {
+        auto ring{std::make_unique<Ring>()};
+        return bench::ns_per_call([&]
+                                  {
+                                      for (uint32_t ii{0}; ii < BATCH; ++ii)
+                                      {
+                                          (void)ring->enqueue(ii);
+                                      }
+                                      uint32_t sum{0};
+                                      while (!ring->empty())
+                                      {
+                                          sum += ring->dequeue();
+                                      }
+                                      bench::do_not_optimize(sum);
+                                  }) /
+               BATCH;
+    }
+
+    double spsc_bulk()
+    {
+        auto ring{std::make_unique<SPSC_Ring_Buffer<uint32_t, RING_SIZE>>()};
+        std::array<uint32_t, BATCH> in{};
+        std::array<uint32_t, BATCH> out{};
+        return bench::ns_per_call([&]
+                                  {
+                                      (void)ring->write(in);
+                                      (void)ring->read(out);
+                                      bench::do_not_optimize(out);
+                                  }) /
+               BATCH;
+    }
+
+    double spsc_two_threads()
+    {
+        constexpr uint32_t ITEMS{20000000};
+        auto ring{std::make_unique<SPSC_Ring_Buffer<uint32_t, RING_SIZE>>()};
+        const auto start{std::chrono::steady_clock::now()};
+        std::thread producer{[&]
+                             {
+                                 std::array<uint32_t, 32> chunk{};
+                                 for (uint32_t sent{0}; sent < ITEMS;)
+                                 {
+                                     const auto count{ring->write(std::span<const uint32_t>{chunk}.first(std::min<size_t>(32, ITEMS - sent)))};
+                                     if (count == 0)
+                                     {
+                                         // full; on a single CPU spinning would only hold the consumer off
+                                         std::this_thread::yield();
+                                     }
+                                     sent += static_cast<uint32_t>(count);
+                                 }
+                             }};
+        std::array<uint32_t, 32> chunk{};
+        for (uint32_t received{0}; received < ITEMS;)
+        {
+            const auto count{ring->read(chunk)};
+            if (count == 0)
+            {
+                std::this_thread::yield();
+            }
+            received += static_cast<uint32_t>(count);
+        }
+        producer.join();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ITEMS;
+    }
+}
+
+int main()
+{
+    std::printf("ns per element\n");
+    std::printf("Fixed_Log2_Ring_Buffer enqueue/dequeue   %8.3f\n", element_at_a_time<Fixed_Log2_Ring_Buffer<uint32_t, RING_SIZE>>());
+    std::printf("SPSC_Ring_Buffer enqueue/dequeue         %8.3f\n", element_at_a_time<SPSC_Ring_Buffer<uint32_t, RING_SIZE>>());
+    std::printf("SPSC_Ring_Buffer write/read              %8.3f\n", spsc_bulk());
+    std::printf("SPSC_Ring_Buffer write/read, 2 threads   %8.3f\n", spsc_two_threads());
+}
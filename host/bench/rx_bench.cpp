@@ -0,0 +1,106 @@
+/* Sustained serial input rate, in virtual time on the emulated SDK: PicoLineProvider fed by the chars-available
+ * interrupt, against polling one getchar_timeout_us per superloop pass the way it used to.  Each pass also spends
+ * WORK_US elsewhere, standing in for command handling and frame output.  Input is offered either all at once (as
+ * fast as USB will take it) or at 115200 baud, and the rate is counted until the last line has been handed out.
+ *
+ * Unlike the other benchmarks these are emulated RP2040 numbers, so they don't depend on the host. */
+#include "emulated_sdk.hpp"
+#include "app/Input_State_Machine.hpp"
+
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t LINES{2000};
+    constexpr auto LINE{"set 12 255 128 0 7\n"};
+    constexpr uint64_t UART_115200_BYTES_PER_S{11520};
+
+    size_t offer_input(uint64_t bytes_per_second)
+    {
+        std::FILE *input{std::tmpfile()};
+        for (size_t ii{0}; ii < LINES; ++ii)
+        {
+            std::fputs(LINE, input);
+        }
+        std::rewind(input);
+        emulated_sdk::set_input(input, bytes_per_second);
+        return LINES * std::size(std::string_view{LINE});
+    }
+
+    void rest_of_pass(uint32_t work_us)
+    {
+        if (work_us != 0)
+        {
+            sleep_us(work_us);
+        }
+        tight_loop_contents();
+    }
+
+    template <class Pass>
+    double bytes_per_second(uint64_t offered, Pass &&pass)
+    {
+        const auto bytes{offer_input(offered)};
+        const auto start{emulated_sdk::now_ns()};
+        for (size_t lines{0}; lines < LINES;)
+        {
+            lines += pass();
+        }
+        return bytes * 1e9 / (emulated_sdk::now_ns() - start);
+    }
+
+    double polled(uint64_t offered, uint32_t work_us)
+    {
+        return bytes_per_second(offered, [&]
+                                {
+                                    const int c{getchar_timeout_us(0)};
+                                    rest_of_pass(work_us);
+                                    return static_cast<size_t>(c == '\n');
+                                });
+    }
+
+    double interrupt_fed(uint64_t offered, uint32_t work_us)
+    {
+        auto provider{std::make_unique<PicoLineProvider<40>>()};
+        provider->start();
+        const auto rate{bytes_per_second(offered, [&]
+                                         {
+                                             provider->update();
+                                             size_t lines{0};
+                                             for (; provider->line_available(); ++lines)
+                                             {
+                                                 provider->pop_line();
+                                             }
+                                             rest_of_pass(work_us);
+                                             return lines;
+                                         })};
+        stdio_set_chars_available_callback(nullptr, nullptr);
+        return rate;
+    }
+}
+
+int main()
+{
+    // the line provider echoes everything it reads; keep that out of the table
+    std::FILE *table{fdopen(dup(fileno(stdout)), "w")};
+    (void)std::freopen("/dev/null", "w", stdout);
+    emulated_sdk::set_drain_polls(0);
+
+    std::fprintf(table, "sustained input, bytes/s of virtual time (%zu lines of %zu bytes)\n", LINES, std::size(std::string_view{LINE}));
+    std::fprintf(table, "offered      work/pass   polled getchar   interrupt + ring\n");
+    for (const uint64_t offered : {uint64_t{0}, UART_115200_BYTES_PER_S})
+    {
+        for (const uint32_t work_us : {0U, 20U, 100U, 500U})
+        {
+            std::fprintf(table, "%-12s %6u us   %14.0f   %16.0f\n", offered == 0 ? "at once" : "115200 baud", work_us,
+                         polled(offered, work_us), interrupt_fed(offered, work_us));
+        }
+    }
+    std::fclose(table);
+}
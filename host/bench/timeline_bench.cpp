@@ -0,0 +1,120 @@
+/* Cost per frame of playing a timeline (app/timeline.hpp): Player moving every track on from the last frame against
+ * evaluate() working each frame out from the start, for a timeline with a track per pixel and one with a few long
+ * tracks.  Every frame of a long run, with frames skipped, is first checked to be the same both ways. */
+#include "bench.hpp"
+
+#include "app/timeline.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+
+namespace
+{
+    using pico_ws2812::WRGB;
+
+    struct Lcg
+    {
+        uint32_t state{1};
+        uint32_t operator()() noexcept
+        {
+            state = state * 1664525U + 1013904223U;
+            return state;
+        }
+    };
+
+    [[nodiscard]] WRGB colour(Lcg &lcg) noexcept
+    {
+        const auto bits{lcg()};
+        return WRGB{.white{static_cast<uint8_t>(bits)}, .red{static_cast<uint8_t>(bits >> 8)}, .green{static_cast<uint8_t>(bits >> 16)}, .blue{static_cast<uint8_t>(bits >> 24)}};
+    }
+
+    /* LEDS pixels in tracks of TRACK_LENGTH, each KEYS keys of random colours, lengths and easings */
+    template <size_t LEDS>
+    [[nodiscard]] timeline::Builder<> make_timeline(size_t track_length, size_t keys)
+    {
+        timeline::Builder<> builder{50, true};
+        Lcg lcg;
+        for (size_t first{0}; first < LEDS; first += track_length)
+        {
+            builder.track(static_cast<uint16_t>(first), static_cast<uint16_t>(track_length));
+            for (size_t key{0}; key < keys; ++key)
+            {
+                builder.key(colour(lcg), static_cast<uint16_t>(lcg() % 100 + 1), static_cast<timeline::Easing>(lcg() % 5));
+            }
+        }
+        return builder;
+    }
+
+    template <size_t LEDS>
+    [[nodiscard]] bool check(const timeline::Builder<> &builder)
+    {
+        auto player{std::make_unique<timeline::Player<LEDS>>()};
+        player->load(builder.bytes());
+        std::array<uint32_t, LEDS> played{};
+        std::array<uint32_t, LEDS> expected{};
+        Lcg lcg;
+        uint32_t frame{0};
+        for (int ii{0}; ii < 20'000; ++ii)
+        {
+            (void)player->advance_to(frame, played);
+            timeline::evaluate(builder.bytes(), frame, expected);
+            if (played != expected)
+            {
+                std::printf("frame %u differs from evaluate()\n", frame);
+                return false;
+            }
+            // mostly the next frame, sometimes a few later, now and then a long way on
+            const auto roll{lcg() % 100};
+            frame += roll < 80 ? 1 : roll < 99 ? roll % 8 + 2 : lcg() % 100'000;
+        }
+        return true;
+    }
+
+    template <size_t LEDS>
+    void row(const char *name, const timeline::Builder<> &builder, double cycles_per_ns)
+    {
+        const auto program{builder.bytes()};
+        auto player{std::make_unique<timeline::Player<LEDS>>()};
+        player->load(program);
+        std::array<uint32_t, LEDS> words{};
+        uint32_t frame{0};
+        const double incremental{bench::ns_per_call([&]
+                                                    {
+                                                        (void)player->advance_to(frame++, words);
+                                                        bench::do_not_optimize(words);
+                                                    })};
+        frame = 0;
+        const double from_scratch{bench::ns_per_call([&]
+                                                     {
+                                                         timeline::evaluate(program, frame++, words);
+                                                         bench::do_not_optimize(words);
+                                                     })};
+        std::printf("%-22s %5zu %5zu   %7.3f ns %7.2f cyc   %7.3f ns %7.2f cyc\n", name, LEDS, std::size(program),
+                    incremental / LEDS, incremental / LEDS * cycles_per_ns, from_scratch / LEDS, from_scratch / LEDS * cycles_per_ns);
+    }
+}
+
+int main()
+{
+    // as many tracks of four keys as fit timeline::MAX_SIZE
+    constexpr size_t PER_PIXEL_LEDS{60};
+    constexpr size_t RANGES_LEDS{300};
+    const auto per_pixel{make_timeline<PER_PIXEL_LEDS>(1, 4)};
+    const auto ranges{make_timeline<RANGES_LEDS>(30, 16)};
+    if (per_pixel.overflowed() || ranges.overflowed() || !check<PER_PIXEL_LEDS>(per_pixel) || !check<RANGES_LEDS>(ranges))
+    {
+        return 1;
+    }
+    std::printf("every frame the player draws matches evaluate()\n");
+
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("per LED, per frame       LEDs bytes   player                   from the start\n");
+    row<PER_PIXEL_LEDS>("a track a pixel, 4 keys", per_pixel, cycles_per_ns);
+    row<RANGES_LEDS>("10 tracks, 16 keys", ranges, cycles_per_ns);
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+/* Cost of turning 8 strands of wire words into ws2812_parallel bit-planes: the 8x8 block transpose against
+ * gathering one bit at a time.  "per pixel" is per LED of one strand, so a full 8-strand index is 8 pixels. */
+#include "bench.hpp"
+
+#include "ws2812/transpose.hpp"
+
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <span>
+
+namespace
+{
+    template <class Pixel, size_t N>
+    void run(const char *name, double cycles_per_ns)
+    {
+        using namespace pico_ws2812;
+
+        auto words{std::make_unique<std::array<std::array<uint32_t, N>, PARALLEL_STRANDS>>()};
+        auto planes{std::make_unique<std::array<uint32_t, N * PLANE_WORDS_PER_PIXEL<Pixel>>>()};
+        uint32_t lcg{1};
+        std::array<std::span<const uint32_t>, PARALLEL_STRANDS> strands{};
+        for (size_t ss{0}; ss < PARALLEL_STRANDS; ++ss)
+        {
+            for (auto &word : (*words)[ss])
+            {
+                lcg = lcg * 1664525U + 1013904223U;
+                word = lcg;
+            }
+            strands[ss] = (*words)[ss];
+        }
+
+        const double block{bench::ns_per_call([&]
+                                              {
+                                                  transpose_strands<Pixel>(strands, *planes);
+                                                  bench::do_not_optimize(*planes);
+                                              })};
+        const double bitwise{bench::ns_per_call([&]
+                                                {
+                                                    transpose_strands_reference<Pixel>(strands, *planes);
+                                                    bench::do_not_optimize(*planes);
+                                                })};
+
+        constexpr double PIXELS{static_cast<double>(N * PARALLEL_STRANDS)};
+        std::printf("%-5s %5zu x 8   %8.3f ns %8.2f cyc   %8.3f ns %8.2f cyc\n", name, N,
+                    block / PIXELS, block / PIXELS * cycles_per_ns, bitwise / PIXELS, bitwise / PIXELS * cycles_per_ns);
+    }
+}
+
+int main()
+{
+    const double cycles_per_ns{bench::cycles_per_ns()};
+    std::printf("per pixel              8x8 block                bit at a time\n");
+    run<pico_ws2812::WRGB, 24>("WRGB", cycles_per_ns);
+    run<pico_ws2812::WRGB, 300>("WRGB", cycles_per_ns);
+    run<pico_ws2812::RGB, 300>("RGB", cycles_per_ns);
+    run<pico_ws2812::WRGB, 1000>("WRGB", cycles_per_ns);
+    if (cycles_per_ns == 0.0)
+    {
+        std::printf("(no time stamp counter here, cycle columns are meaningless)\n");
+    }
+}
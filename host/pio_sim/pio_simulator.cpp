@@ -0,0 +1,439 @@
+#include "pio_simulator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace pio_sim
+{
+    namespace
+    {
+        enum Opcode : uint32_t
+        {
+            JMP = 0,
+            WAIT = 1,
+            IN = 2,
+            OUT = 3,
+            PUSH_PULL = 4,
+            MOV = 5,
+            IRQ = 6,
+            SET = 7,
+        };
+
+        constexpr uint32_t bit_count(uint32_t field) noexcept
+        {
+            return field == 0 ? 32 : field;
+        }
+
+        constexpr uint32_t low_mask(uint32_t count) noexcept
+        {
+            return count >= 32 ? 0xFFFFFFFFU : (1U << count) - 1;
+        }
+    }
+
+    State_Machine::State_Machine(const Program &program, const Config &config) noexcept : m_program{program}, m_config{config}, m_pc{program.wrap_target}
+    {
+        m_changes.push_back(Pin_Change{.tick = 0, .pins = m_pins});
+    }
+
+    bool State_Machine::tx_fifo_full() const noexcept
+    {
+        return std::size(m_tx_fifo) >= fifo_depth();
+    }
+
+    size_t State_Machine::tx_fifo_level() const noexcept
+    {
+        return std::size(m_tx_fifo);
+    }
+
+    void State_Machine::push(uint32_t word) noexcept
+    {
+        if (!tx_fifo_full())
+        {
+            m_tx_fifo.push_back(word);
+        }
+    }
+
+    void State_Machine::tick() noexcept
+    {
+        ++m_ticks;
+        // 16.8 fractional divider: a state machine cycle every int + frac/256 system clocks, on average
+        const uint32_t divisor{(m_config.clkdiv_int == 0 ? 0x10000U : m_config.clkdiv_int << 8U) + m_config.clkdiv_frac};
+        m_divider_acc += 1U << 8U;
+        if (m_divider_acc < divisor)
+        {
+            return;
+        }
+        m_divider_acc -= divisor;
+        cycle();
+    }
+
+    void State_Machine::cycle() noexcept
+    {
+        ++m_cycles;
+        if (m_delay != 0)
+        {
+            --m_delay;
+            return;
+        }
+
+        const bool from_exec{m_exec_pending};
+        const uint16_t instruction{from_exec ? m_exec_instruction : m_program.instructions[m_pc]};
+        m_exec_pending = false;
+
+        const uint32_t side_bits{m_program.sideset_bits};
+        const uint32_t delay_bits{5 - side_bits};
+        const uint32_t side_field{side_bits == 0 ? 0 : (instruction >> (13 - side_bits)) & low_mask(side_bits)};
+        const uint32_t delay{(instruction >> 8U) & low_mask(delay_bits)};
+
+        // side-set lands on the first cycle of the instruction, stalled or not
+        if (side_bits != 0)
+        {
+            const bool enabled{!m_program.sideset_optional || ((side_field >> (side_bits - 1)) & 1U) != 0};
+            const uint32_t value_bits{m_program.sideset_optional ? side_bits - 1 : side_bits};
+            if (enabled && value_bits != 0)
+            {
+                write_pins(m_config.sideset_base, value_bits, side_field & low_mask(value_bits));
+            }
+        }
+
+        bool jumped{false};
+        if (!execute(instruction, jumped))
+        {
+            if (from_exec)
+            {
+                m_exec_pending = true;
+                m_exec_instruction = instruction;
+            }
+            return;
+        }
+        m_starving = false;
+
+        if (m_exec_pending)
+        {
+            // OUT EXEC / MOV EXEC: the new instruction runs next cycle, delay of the current one is ignored
+            return;
+        }
+        m_delay = delay;
+        if (!jumped && !from_exec)
+        {
+            m_pc = m_pc == m_program.wrap ? m_program.wrap_target : (m_pc + 1) % std::size(m_program.instructions);
+        }
+    }
+
+    bool State_Machine::autopull_ready() noexcept
+    {
+        if (!m_config.autopull || m_osr_count < m_config.pull_threshold)
+        {
+            return true;
+        }
+        if (m_tx_fifo.empty())
+        {
+            m_starving = true;
+            return false;
+        }
+        m_osr = m_tx_fifo.front();
+        m_tx_fifo.pop_front();
+        m_osr_count = 0;
+        return true;
+    }
+
+    uint32_t State_Machine::shift_out(uint32_t count) noexcept
+    {
+        uint32_t data{};
+        if (m_config.out_shift_right)
+        {
+            data = m_osr & low_mask(count);
+            m_osr = count >= 32 ? 0 : m_osr >> count;
+        }
+        else
+        {
+            data = count >= 32 ? m_osr : m_osr >> (32 - count);
+            m_osr = count >= 32 ? 0 : m_osr << count;
+        }
+        m_osr_count = std::min<uint32_t>(32, m_osr_count + count);
+        return data;
+    }
+
+    void State_Machine::shift_in(uint32_t value, uint32_t count) noexcept
+    {
+        value &= low_mask(count);
+        // IN always shifts left here; the NeoPixel programs never read back
+        m_isr = count >= 32 ? value : (m_isr << count) | value;
+        m_isr_count = std::min<uint32_t>(32, m_isr_count + count);
+    }
+
+    void State_Machine::write_pins(uint32_t base, uint32_t count, uint32_t value) noexcept
+    {
+        uint32_t pins{m_pins};
+        for (uint32_t ii{0}; ii < count; ++ii)
+        {
+            const uint32_t pin{(base + ii) % 32};
+            pins = (pins & ~(1U << pin)) | (((value >> ii) & 1U) << pin);
+        }
+        if (pins != m_pins)
+        {
+            m_pins = pins;
+            m_changes.push_back(Pin_Change{.tick = m_ticks, .pins = m_pins});
+        }
+    }
+
+    uint32_t State_Machine::read_pins() const noexcept
+    {
+        return std::rotr(m_pins, static_cast<int>(m_config.out_base));
+    }
+
+    bool State_Machine::execute(uint16_t instruction, bool &jumped) noexcept
+    {
+        const uint32_t opcode{static_cast<uint32_t>(instruction >> 13U)};
+        const uint32_t arg1{static_cast<uint32_t>((instruction >> 5U) & 7U)};
+        const uint32_t arg2{static_cast<uint32_t>(instruction & 0x1FU)};
+
+        switch (opcode)
+        {
+        case JMP:
+        {
+            bool taken{false};
+            switch (arg1)
+            {
+            case 0: taken = true; break;
+            case 1: taken = m_x == 0; break;
+            case 2: taken = m_x-- != 0; break;
+            case 3: taken = m_y == 0; break;
+            case 4: taken = m_y-- != 0; break;
+            case 5: taken = m_x != m_y; break;
+            case 6: taken = ((m_pins >> m_config.jmp_pin) & 1U) != 0; break;
+            case 7: taken = m_osr_count < m_config.pull_threshold; break;
+            }
+            if (taken)
+            {
+                m_pc = arg2;
+                jumped = true;
+            }
+            return true;
+        }
+        case WAIT:
+        {
+            const uint32_t polarity{(instruction >> 7U) & 1U};
+            const uint32_t source{(instruction >> 5U) & 3U};
+            if (source == 2)
+            {
+                const uint32_t flag{1U << (arg2 & 7U)};
+                if (((m_irq_flags & flag) != 0) != (polarity != 0))
+                {
+                    return false;
+                }
+                if (polarity != 0)
+                {
+                    m_irq_flags &= ~flag;
+                }
+                return true;
+            }
+            const uint32_t pin{source == 0 ? arg2 : (m_config.out_base + arg2) % 32};
+            return ((m_pins >> pin) & 1U) == polarity;
+        }
+        case IN:
+        {
+            uint32_t value{0};
+            switch (arg1)
+            {
+            case 0: value = read_pins(); break;
+            case 1: value = m_x; break;
+            case 2: value = m_y; break;
+            case 6: value = m_isr; break;
+            case 7: value = m_osr; break;
+            default: value = 0; break;
+            }
+            shift_in(value, bit_count(arg2));
+            return true;
+        }
+        case OUT:
+        {
+            if (!autopull_ready())
+            {
+                return false;
+            }
+            const uint32_t count{bit_count(arg2)};
+            const uint32_t data{shift_out(count)};
+            switch (arg1)
+            {
+            case 0: write_pins(m_config.out_base, std::min(count, m_config.out_count), data); break;
+            case 1: m_x = data; break;
+            case 2: m_y = data; break;
+            case 3: break;
+            case 4: break; // pindirs aren't modelled
+            case 5:
+                m_pc = data & 0x1FU;
+                jumped = true;
+                break;
+            case 6:
+                m_isr = data;
+                m_isr_count = count;
+                break;
+            case 7:
+                m_exec_pending = true;
+                m_exec_instruction = static_cast<uint16_t>(data);
+                break;
+            }
+            // autopull refills in the background as soon as the threshold is reached, if there is data
+            if (m_config.autopull && m_osr_count >= m_config.pull_threshold && !m_tx_fifo.empty())
+            {
+                m_osr = m_tx_fifo.front();
+                m_tx_fifo.pop_front();
+                m_osr_count = 0;
+            }
+            return true;
+        }
+        case PUSH_PULL:
+        {
+            const bool is_pull{((instruction >> 7U) & 1U) != 0};
+            const bool if_condition{((instruction >> 6U) & 1U) != 0};
+            const bool block{((instruction >> 5U) & 1U) != 0};
+            if (is_pull)
+            {
+                if (if_condition && m_osr_count < m_config.pull_threshold)
+                {
+                    return true;
+                }
+                if (m_tx_fifo.empty())
+                {
+                    if (block)
+                    {
+                        m_starving = true;
+                        return false;
+                    }
+                    m_osr = m_x;
+                    m_osr_count = 0;
+                    return true;
+                }
+                m_osr = m_tx_fifo.front();
+                m_tx_fifo.pop_front();
+                m_osr_count = 0;
+                return true;
+            }
+            if (if_condition && m_isr_count < 32)
+            {
+                return true;
+            }
+            if (std::size(m_rx_fifo) >= 4)
+            {
+                return !block;
+            }
+            m_rx_fifo.push_back(m_isr);
+            m_isr = 0;
+            m_isr_count = 0;
+            return true;
+        }
+        case MOV:
+        {
+            const uint32_t op{(instruction >> 3U) & 3U};
+            const uint32_t source{instruction & 7U};
+            uint32_t value{0};
+            switch (source)
+            {
+            case 0: value = read_pins(); break;
+            case 1: value = m_x; break;
+            case 2: value = m_y; break;
+            case 3: value = 0; break;
+            case 5: value = m_tx_fifo.empty() ? 0xFFFFFFFFU : 0; break;
+            case 6: value = m_isr; break;
+            case 7: value = m_osr; break;
+            default: value = 0; break;
+            }
+            if (op == 1)
+            {
+                value = ~value;
+            }
+            else if (op == 2)
+            {
+                uint32_t reversed{0};
+                for (uint32_t ii{0}; ii < 32; ++ii)
+                {
+                    reversed |= ((value >> ii) & 1U) << (31 - ii);
+                }
+                value = reversed;
+            }
+            switch (arg1)
+            {
+            case 0: write_pins(m_config.out_base, m_config.out_count, value); break;
+            case 1: m_x = value; break;
+            case 2: m_y = value; break;
+            case 4:
+                m_exec_pending = true;
+                m_exec_instruction = static_cast<uint16_t>(value);
+                break;
+            case 5:
+                m_pc = value & 0x1FU;
+                jumped = true;
+                break;
+            case 6:
+                m_isr = value;
+                m_isr_count = 0;
+                break;
+            case 7:
+                m_osr = value;
+                m_osr_count = 0;
+                break;
+            default: break;
+            }
+            return true;
+        }
+        case IRQ:
+        {
+            const bool clear{((instruction >> 6U) & 1U) != 0};
+            const bool wait{((instruction >> 5U) & 1U) != 0};
+            const uint32_t flag{1U << (arg2 & 7U)};
+            if (clear)
+            {
+                m_irq_flags &= ~flag;
+                return true;
+            }
+            m_irq_flags |= flag;
+            // nothing else clears it in a single state machine model, so don't wait on ourselves forever
+            (void)wait;
+            return true;
+        }
+        case SET:
+        {
+            switch (arg1)
+            {
+            case 0: write_pins(m_config.set_base, m_config.set_count, arg2); break;
+            case 1: m_x = arg2; break;
+            case 2: m_y = arg2; break;
+            default: break;
+            }
+            return true;
+        }
+        }
+        return true;
+    }
+
+    void write_vcd(std::FILE *out, std::span<const Pin_Change> changes, uint32_t base, uint32_t count, uint64_t ps_per_tick) noexcept
+    {
+        auto &&id{[](uint32_t index)
+                  { return static_cast<char>('!' + index); }};
+        std::fprintf(out, "$timescale 1ps $end\n$scope module pio $end\n");
+        for (uint32_t ii{0}; ii < count; ++ii)
+        {
+            std::fprintf(out, "$var wire 1 %c gpio%u $end\n", id(ii), (base + ii) % 32);
+        }
+        std::fprintf(out, "$upscope $end\n$enddefinitions $end\n");
+
+        uint32_t previous{0};
+        bool first{true};
+        for (const auto &change : changes)
+        {
+            std::fprintf(out, "#%llu\n", static_cast<unsigned long long>(change.tick * ps_per_tick));
+            for (uint32_t ii{0}; ii < count; ++ii)
+            {
+                const uint32_t pin{(base + ii) % 32};
+                const uint32_t level{(change.pins >> pin) & 1U};
+                if (first || level != ((previous >> pin) & 1U))
+                {
+                    std::fprintf(out, "%u%c\n", level, id(ii));
+                }
+            }
+            previous = change.pins;
+            first = false;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#if !defined(PIO_SIMULATOR_HPP)
+#define PIO_SIMULATOR_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <span>
+#include <vector>
+
+/* Cycle-accurate model of one RP2040 PIO state machine, clocked at system clock rate.
+ *
+ * Covers what the NeoPixel programs lean on: side-set (optional or not) applied on the first cycle of an
+ * instruction even when it stalls, delay cycles, autopull with either shift direction, wrap, a 16.8 fractional
+ * clock divider and the joined/unjoined TX FIFO depth.  The rest of the instruction set is there, but pindirs,
+ * autopush and inter-state-machine IRQs are only sketched.  Pin levels are recorded as a list of changes so callers
+ * can write a waveform or measure pulses. */
+namespace pio_sim
+{
+    struct Program
+    {
+        std::span<const uint16_t> instructions;
+        uint32_t wrap_target;
+        uint32_t wrap;
+        uint32_t sideset_bits{0}; // including the enable bit when optional, as pioasm counts them
+        bool sideset_optional{false};
+    };
+
+    struct Config
+    {
+        uint32_t clkdiv_int{1};
+        uint32_t clkdiv_frac{0};
+        uint32_t sideset_base{0};
+        uint32_t out_base{0};
+        uint32_t out_count{32};
+        uint32_t set_base{0};
+        uint32_t set_count{5};
+        uint32_t jmp_pin{0};
+        bool out_shift_right{true};
+        bool autopull{false};
+        uint32_t pull_threshold{32};
+        bool join_tx{false};
+
+        /* the same conversion sm_config_set_clkdiv does */
+        static constexpr void split_clkdiv(float div, uint32_t &div_int, uint32_t &div_frac) noexcept
+        {
+            div_int = static_cast<uint32_t>(div);
+            div_frac = div_int == 0 ? 0 : static_cast<uint32_t>((div - static_cast<float>(div_int)) * (1U << 8U));
+        }
+    };
+
+    struct Pin_Change
+    {
+        uint64_t tick; // system clock ticks since the start of the run
+        uint32_t pins; // every GPIO level after the change
+    };
+
+    class State_Machine
+    {
+    public:
+        State_Machine(const Program &program, const Config &config) noexcept;
+
+        [[nodiscard]] bool tx_fifo_full() const noexcept;
+        [[nodiscard]] size_t tx_fifo_level() const noexcept;
+        void push(uint32_t word) noexcept;
+
+        /* advance one system clock */
+        void tick() noexcept;
+
+        [[nodiscard]] uint64_t ticks() const noexcept { return m_ticks; }
+        [[nodiscard]] uint64_t sm_cycles() const noexcept { return m_cycles; }
+        [[nodiscard]] uint32_t pins() const noexcept { return m_pins; }
+        [[nodiscard]] uint32_t pc() const noexcept { return m_pc; }
+        [[nodiscard]] std::span<const Pin_Change> pin_changes() const noexcept { return m_changes; }
+
+        /* the current instruction is an OUT or PULL stalled on an empty TX FIFO */
+        [[nodiscard]] bool starving() const noexcept { return m_starving; }
+
+    private:
+        Program m_program;
+        Config m_config;
+        std::deque<uint32_t> m_tx_fifo;
+        std::deque<uint32_t> m_rx_fifo;
+
+        uint32_t m_pc;
+        uint32_t m_x{0};
+        uint32_t m_y{0};
+        uint32_t m_osr{0};
+        uint32_t m_osr_count{32};
+        uint32_t m_isr{0};
+        uint32_t m_isr_count{0};
+        uint32_t m_delay{0};
+        uint32_t m_pins{0};
+        uint32_t m_irq_flags{0};
+        bool m_exec_pending{false};
+        uint16_t m_exec_instruction{0};
+
+        uint32_t m_divider_acc{0};
+        uint64_t m_ticks{0};
+        uint64_t m_cycles{0};
+        bool m_starving{false};
+        std::vector<Pin_Change> m_changes;
+
+        void cycle() noexcept;
+        /* returns false when the instruction stalls */
+        bool execute(uint16_t instruction, bool &jumped) noexcept;
+        bool autopull_ready() noexcept;
+        uint32_t shift_out(uint32_t count) noexcept;
+        void shift_in(uint32_t value, uint32_t count) noexcept;
+        void write_pins(uint32_t base, uint32_t count, uint32_t value) noexcept;
+        [[nodiscard]] uint32_t read_pins() const noexcept;
+        [[nodiscard]] uint32_t fifo_depth() const noexcept { return m_config.join_tx ? 8 : 4; }
+    };
+
+    /* Value Change Dump of `count` pins starting at `base`, one wire per pin, loadable in GTKWave et al. */
+    void write_vcd(std::FILE *out, std::span<const Pin_Change> changes, uint32_t base, uint32_t count, uint64_t ps_per_tick) noexcept;
+}
+
+#endif
@@ -0,0 +1,1331 @@
+#include "emulated_sdk.hpp"
+
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+#include "pico/stdio.h"
+#include "pico/stdlib.h"
+#include "pico/time.h"
+
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+pio_hw_t emulated_pio_hw[NUM_PIOS];
+
+namespace
+{
+    constexpr uint64_t NS_PER_US{1000};
+    // a gap on the wire at least this long latches the strip, so it ends a frame rather than stalling one
+    constexpr uint64_t LATCH_GAP_NS{50 * NS_PER_US};
+
+    struct State_Machine
+    {
+        bool claimed{false};
+        bool enabled{false};
+        pio_sm_config config{};
+        uint64_t word_ns{0};
+        uint fifo_depth{4};
+        // start times of the words still sitting in the TX FIFO, oldest first
+        std::deque<uint64_t> waiting{};
+        uint64_t wire_free_ns{0};
+        uint64_t stalls{0};
+    };
+
+    struct Pio_Block
+    {
+        std::array<uint16_t, PIO_INSTRUCTION_COUNT> instructions{};
+        uint32_t used_instructions{0};
+        std::array<State_Machine, NUM_PIO_STATE_MACHINES> sm{};
+    };
+
+    struct Dma_Channel
+    {
+        bool claimed{false};
+        dma_channel_config config{};
+        volatile void *write_addr{nullptr};
+        const volatile void *read_addr{nullptr};
+        uint32_t transfer_count{0};
+        uint32_t remaining{0};
+        bool busy{false};
+        bool irq0_enabled{false};
+        bool irq1_enabled{false};
+        bool irq0_status{false};
+        bool irq1_status{false};
+    };
+
+    struct Irq_Line
+    {
+        bool enabled{false};
+        uint core{0}; // the core that enabled it, which is the one that takes the interrupt
+        std::vector<irq_handler_t> handlers{};
+    };
+
+    struct Emulator
+    {
+        // the whole chip sits behind one lock; every SDK call holds it, see Bus
+        std::recursive_mutex bus;
+        std::condition_variable_any clock_moved;
+        // each core's own virtual time; a core only runs while it isn't ahead of the other
+        std::array<uint64_t, NUM_CORES> core_ns{};
+        std::array<bool, NUM_CORES> core_running{true, false};
+        std::array<uint32_t, NUM_CORES> pending_irqs{};
+        std::array<bool, NUM_CORES> irqs_masked{};
+
+        // the peripherals' time: DMA and the FIFOs have been run up to here
+        uint64_t now_ns{0};
+        bool servicing{false};
+        std::array<Pio_Block, NUM_PIOS> pio{};
+        std::array<Dma_Channel, NUM_DMA_CHANNELS> dma{};
+        std::array<Irq_Line, NUM_IRQS> irq{};
+        std::vector<emulated_sdk::Pio_Push> pushes{};
+
+        bool configured{false};
+        std::FILE *input{nullptr};
+        uint64_t input_byte_ns{0};
+        uint64_t input_start_ns{0}; // arrival times count from here
+        uint64_t bytes_read{0};
+        int peeked{EOF};
+        bool exhausted{false};
+        uint64_t exhausted_polls{0};
+        uint64_t drain_polls{20000};
+        uint64_t poll_ns{2 * NS_PER_US};
+        // stdio_set_chars_available_callback
+        void (*rx_callback)(void *){nullptr};
+        void *rx_param{nullptr};
+        uint rx_core{0};
+        bool in_rx_callback{false};
+        uint64_t rx_signalled{0}; // bytes before this one have been signalled to rx_callback
+        std::vector<uint64_t> newlines{};
+        const char *pio_log_path{nullptr};
+        bool report_registered{false};
+    };
+
+    Emulator &emu()
+    {
+        // never destroyed: core 1's thread may still be parked on the bus when the process exits
+        static Emulator &instance{*new Emulator};
+        return instance;
+    }
+
+    thread_local uint this_core{0};
+    thread_local uint bus_depth{0};
+    thread_local std::unique_lock<std::recursive_mutex> *outer_bus{nullptr};
+
+    /* Held for the duration of every emulated SDK call, so the two cores' threads see one consistent chip.
+     * Firmware code between SDK calls runs truly concurrently, which is the point for the core to core handoff. */
+    class Bus
+    {
+    public:
+        Bus() : m_lock{emu().bus}
+        {
+            if (bus_depth++ == 0)
+            {
+                outer_bus = &m_lock;
+            }
+        }
+        ~Bus()
+        {
+            if (--bus_depth == 0)
+            {
+                outer_bus = nullptr;
+            }
+        }
+        Bus(const Bus &) = delete;
+        Bus &operator=(const Bus &) = delete;
+
+    private:
+        std::unique_lock<std::recursive_mutex> m_lock;
+    };
+
+    uint64_t &core_now()
+    {
+        return emu().core_ns[this_core];
+    }
+
+    uint64_t env_u64(const char *name, uint64_t fallback)
+    {
+        const char *value{std::getenv(name)};
+        if (value == nullptr || *value == '\0')
+        {
+            return fallback;
+        }
+        return std::strtoull(value, nullptr, 10);
+    }
+
+    void configure_from_environment()
+    {
+        auto &e{emu()};
+        if (e.configured)
+        {
+            return;
+        }
+        e.configured = true;
+        if (e.input == nullptr)
+        {
+            const char *path{std::getenv("NEOPIXEL_HOST_INPUT")};
+            e.input = path != nullptr ? std::fopen(path, "rb") : stdin;
+            if (e.input == nullptr)
+            {
+                std::fprintf(stderr, "[host] unable to open NEOPIXEL_HOST_INPUT=%s\n", path);
+                std::exit(1);
+            }
+            const auto rate{env_u64("NEOPIXEL_HOST_INPUT_RATE", 0)};
+            e.input_byte_ns = rate == 0 ? 0 : 1000000000ULL / rate;
+        }
+        e.poll_ns = env_u64("NEOPIXEL_HOST_POLL_US", e.poll_ns / NS_PER_US) * NS_PER_US;
+        e.drain_polls = env_u64("NEOPIXEL_HOST_DRAIN_POLLS", e.drain_polls);
+        e.pio_log_path = std::getenv("NEOPIXEL_HOST_PIO_LOG");
+    }
+
+    // ---------------------------------------------------------------------------------------------------------
+    // PIO
+
+    uint pio_index_of(PIO pio)
+    {
+        return static_cast<uint>(pio - emulated_pio_hw);
+    }
+
+    State_Machine &state_machine(PIO pio, uint sm)
+    {
+        return emu().pio[pio_index_of(pio)].sm[sm];
+    }
+
+    /* Follow the program from its first OUT to the next one, for each value the OUT could shift into X, and
+     * return the longest time that takes along with how many bits the OUT consumes.  That's enough to clock
+     * the NeoPixel programs word by word; it is not a general PIO model. */
+    std::pair<uint64_t, uint> cycles_per_out(const Pio_Block &block, const pio_sm_config &config, uint initial_pc)
+    {
+        const uint delay_bits{5 - config.sideset_bit_count};
+        const uint delay_mask{(1U << delay_bits) - 1};
+        auto &&advance{[&](uint pc)
+                       { return pc == config.wrap ? config.wrap_target : (pc + 1) % PIO_INSTRUCTION_COUNT; }};
+
+        uint64_t worst{0};
+        uint bits{0};
+        for (const uint32_t x_value : {0U, 1U})
+        {
+            uint pc{initial_pc};
+            uint32_t x{0};
+            uint32_t y{0};
+            uint64_t cycles{0};
+            bool counting{false};
+            for (int step{0}; step < 4 * PIO_INSTRUCTION_COUNT; ++step)
+            {
+                const uint16_t instr{block.instructions[pc]};
+                const uint opcode{static_cast<uint>(instr >> 13)};
+                if (opcode == 3) // OUT
+                {
+                    if (counting)
+                    {
+                        break;
+                    }
+                    counting = true;
+                    bits = (instr & 0x1FU) == 0 ? 32 : (instr & 0x1FU);
+                    const uint destination{static_cast<uint>((instr >> 5) & 7U)};
+                    if (destination == 1)
+                    {
+                        x = x_value;
+                    }
+                    else if (destination == 2)
+                    {
+                        y = x_value;
+                    }
+                }
+                if (counting)
+                {
+                    cycles += 1 + ((instr >> 8) & delay_mask);
+                }
+                if (opcode == 0) // JMP
+                {
+                    const uint condition{static_cast<uint>((instr >> 5) & 7U)};
+                    bool taken{false};
+                    switch (condition)
+                    {
+                    case 0: taken = true; break;
+                    case 1: taken = x == 0; break;
+                    case 2: taken = x-- != 0; break;
+                    case 3: taken = y == 0; break;
+                    case 4: taken = y-- != 0; break;
+                    case 5: taken = x != y; break;
+                    default: taken = false; break;
+                    }
+                    pc = taken ? (instr & 0x1FU) : advance(pc);
+                }
+                else
+                {
+                    pc = advance(pc);
+                }
+            }
+            worst = std::max(worst, cycles);
+        }
+        return std::make_pair(worst, bits);
+    }
+
+    /* pop words that the state machine has pulled out of the FIFO by `now` */
+    void retire(State_Machine &sm, uint64_t now)
+    {
+        while (!sm.waiting.empty() && sm.waiting.front() <= now)
+        {
+            sm.waiting.pop_front();
+        }
+    }
+
+    bool fifo_full(State_Machine &sm, uint64_t now)
+    {
+        retire(sm, now);
+        return std::size(sm.waiting) >= sm.fifo_depth;
+    }
+
+    void push_word(uint pio, uint sm_index, uint32_t word)
+    {
+        auto &e{emu()};
+        auto &sm{e.pio[pio].sm[sm_index]};
+        retire(sm, e.now_ns);
+        const auto start{std::max(e.now_ns, sm.wire_free_ns)};
+        // the wire went idle part way through a stream, but not long enough to latch
+        if (sm.wire_free_ns != 0 && start > sm.wire_free_ns && start - sm.wire_free_ns < LATCH_GAP_NS)
+        {
+            ++sm.stalls;
+        }
+        sm.wire_free_ns = start + sm.word_ns;
+        sm.waiting.push_back(start);
+        e.pushes.push_back(emulated_sdk::Pio_Push{
+            .pushed_ns = e.now_ns,
+            .on_wire_ns = start,
+            .word_ns = sm.word_ns,
+            .pio = static_cast<uint8_t>(pio),
+            .sm = static_cast<uint8_t>(sm_index),
+            .word = word});
+    }
+
+    // ---------------------------------------------------------------------------------------------------------
+    // DMA and interrupts
+
+    bool is_pio_dreq(uint dreq)
+    {
+        return dreq < DREQ_PIO1_TX0 + NUM_PIO_STATE_MACHINES;
+    }
+
+    std::pair<uint, uint> pio_of_dreq(uint dreq)
+    {
+        return std::make_pair(dreq / 8, dreq % 8);
+    }
+
+    void call_handlers(uint num)
+    {
+        // handlers may add or remove handlers; walk a copy
+        const auto handlers{emu().irq[num].handlers};
+        for (const auto handler : handlers)
+        {
+            handler();
+        }
+    }
+
+    void raise_irq(uint num)
+    {
+        auto &e{emu()};
+        auto &line{e.irq[num]};
+        if (!line.enabled)
+        {
+            return;
+        }
+        if (line.core != this_core || e.irqs_masked[this_core])
+        {
+            // the other core takes it, next time it is in the SDK; or this one, once it unmasks
+            e.pending_irqs[line.core] |= 1U << num;
+            e.clock_moved.notify_all();
+            return;
+        }
+        call_handlers(num);
+    }
+
+    void run_pending_irqs()
+    {
+        auto &e{emu()};
+        auto &pending{e.pending_irqs[this_core]};
+        while (pending != 0 && !e.irqs_masked[this_core])
+        {
+            const uint num{static_cast<uint>(std::countr_zero(pending))};
+            pending &= ~(1U << num);
+            call_handlers(num);
+        }
+    }
+
+    void finish_transfer(uint channel)
+    {
+        auto &ch{emu().dma[channel]};
+        ch.busy = false;
+        if (ch.irq0_enabled)
+        {
+            ch.irq0_status = true;
+            raise_irq(DMA_IRQ_0);
+        }
+        if (ch.irq1_enabled)
+        {
+            ch.irq1_status = true;
+            raise_irq(DMA_IRQ_1);
+        }
+    }
+
+    uint32_t element_size(const Dma_Channel &ch)
+    {
+        return 1U << static_cast<uint>(ch.config.size);
+    }
+
+    uint32_t read_element(Dma_Channel &ch)
+    {
+        uint32_t value{0};
+        std::memcpy(&value, const_cast<const void *>(ch.read_addr), element_size(ch));
+        if (ch.config.read_increment)
+        {
+            ch.read_addr = static_cast<const volatile uint8_t *>(ch.read_addr) + element_size(ch);
+        }
+        return value;
+    }
+
+    void start_transfer(uint channel)
+    {
+        auto &ch{emu().dma[channel]};
+        ch.remaining = ch.transfer_count;
+        ch.busy = ch.remaining != 0;
+        if (!ch.busy)
+        {
+            finish_transfer(channel);
+            return;
+        }
+        if (is_pio_dreq(ch.config.dreq))
+        {
+            return; // paced by the FIFO; service() moves the words
+        }
+        // unpaced memory to memory: done at once
+        while (ch.remaining != 0)
+        {
+            const auto value{read_element(ch)};
+            std::memcpy(const_cast<void *>(ch.write_addr), &value, element_size(ch));
+            if (ch.config.write_increment)
+            {
+                ch.write_addr = static_cast<volatile uint8_t *>(ch.write_addr) + element_size(ch);
+            }
+            --ch.remaining;
+        }
+        finish_transfer(channel);
+    }
+
+    /* earliest time a paced channel can move its next word, or UINT64_MAX if it isn't active */
+    uint64_t next_dma_event(uint channel)
+    {
+        auto &e{emu()};
+        auto &ch{e.dma[channel]};
+        if (!ch.busy || !is_pio_dreq(ch.config.dreq))
+        {
+            return UINT64_MAX;
+        }
+        const auto [pio, sm_index]{pio_of_dreq(ch.config.dreq)};
+        auto &sm{e.pio[pio].sm[sm_index]};
+        if (!sm.enabled)
+        {
+            return UINT64_MAX;
+        }
+        if (!fifo_full(sm, e.now_ns))
+        {
+            return e.now_ns;
+        }
+        return sm.waiting.front();
+    }
+
+    /* move the peripherals forward to `target`, running every DMA beat and completion interrupt on the way, in order */
+    void run_peripherals_to(uint64_t target)
+    {
+        auto &e{emu()};
+        if (e.servicing)
+        {
+            // called from inside an interrupt handler; the outer loop will get there
+            e.now_ns = std::max(e.now_ns, target);
+            return;
+        }
+        e.servicing = true;
+        for (;;)
+        {
+            uint64_t soonest{UINT64_MAX};
+            uint soonest_channel{0};
+            for (uint channel{0}; channel < NUM_DMA_CHANNELS; ++channel)
+            {
+                const auto when{next_dma_event(channel)};
+                if (when < soonest)
+                {
+                    soonest = when;
+                    soonest_channel = channel;
+                }
+            }
+            if (soonest > target)
+            {
+                break;
+            }
+            e.now_ns = std::max(e.now_ns, soonest);
+            auto &ch{e.dma[soonest_channel]};
+            const auto [pio, sm_index]{pio_of_dreq(ch.config.dreq)};
+            push_word(pio, sm_index, read_element(ch));
+            if (--ch.remaining == 0)
+            {
+                e.servicing = false;
+                finish_transfer(soonest_channel);
+                e.servicing = true;
+            }
+        }
+        e.now_ns = std::max(e.now_ns, target);
+        e.servicing = false;
+    }
+
+    /* The slowest running core's time; nothing can happen on the chip before it */
+    uint64_t horizon()
+    {
+        auto &e{emu()};
+        uint64_t soonest{UINT64_MAX};
+        for (uint core{0}; core < NUM_CORES; ++core)
+        {
+            if (e.core_running[core])
+            {
+                soonest = std::min(soonest, e.core_ns[core]);
+            }
+        }
+        return soonest;
+    }
+
+    bool behind_other_core()
+    {
+        auto &e{emu()};
+        for (uint core{0}; core < NUM_CORES; ++core)
+        {
+            if (core != this_core && e.core_running[core] && e.core_ns[core] < e.core_ns[this_core])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // ---------------------------------------------------------------------------------------------------------
+    // stdio input
+
+    void report_at_exit();
+
+    void finish_run()
+    {
+        // not exit(): core 1's thread never returns, and static destructors would run under it
+        report_at_exit();
+        std::fflush(nullptr);
+        std::_Exit(0);
+    }
+
+    /* once input is exhausted, every poll of an idle firmware counts towards the drain */
+    void count_idle_poll()
+    {
+        auto &e{emu()};
+        if (e.exhausted && e.drain_polls != 0 && ++e.exhausted_polls >= e.drain_polls)
+        {
+            finish_run();
+        }
+    }
+
+    /* @return false at end of input; otherwise the next byte is in peeked */
+    bool peek_input()
+    {
+        auto &e{emu()};
+        if (e.peeked == EOF && !e.exhausted)
+        {
+            e.peeked = std::fgetc(e.input);
+            e.exhausted = e.peeked == EOF;
+        }
+        return !e.exhausted;
+    }
+
+    uint64_t next_byte_arrival()
+    {
+        auto &e{emu()};
+        return e.input_start_ns + e.bytes_read * e.input_byte_ns;
+    }
+
+    /* Take the chars-available interrupt if a byte has arrived that the callback hasn't heard about.  Like the
+     * stdio drivers, it is edge triggered: a byte left unread isn't signalled again until something reads it. */
+    void deliver_rx()
+    {
+        auto &e{emu()};
+        if (e.rx_callback == nullptr || e.rx_core != this_core || e.in_rx_callback || e.irqs_masked[this_core] ||
+            e.servicing || e.bytes_read < e.rx_signalled || !peek_input() || next_byte_arrival() > core_now())
+        {
+            return;
+        }
+        e.rx_signalled = e.bytes_read + 1;
+        e.in_rx_callback = true;
+        e.rx_callback(e.rx_param);
+        e.in_rx_callback = false;
+    }
+
+    /* Spend time on the calling core.  With both cores running, the one ahead waits (for real) until the other
+     * catches up, so the two threads move through virtual time in lockstep and see each other's effects in order. */
+    void advance_to(uint64_t target)
+    {
+        auto &e{emu()};
+        auto &mine{core_now()};
+        mine = std::max(mine, target);
+        run_peripherals_to(horizon());
+        e.clock_moved.notify_all();
+        // waiting needs the bus released, which only the outermost call can do
+        if (outer_bus != nullptr && bus_depth == 1 && !e.servicing)
+        {
+            while (behind_other_core())
+            {
+                e.clock_moved.wait(*outer_bus);
+                run_pending_irqs();
+            }
+        }
+        run_pending_irqs();
+        deliver_rx();
+    }
+
+    // ---------------------------------------------------------------------------------------------------------
+    // reporting
+
+    void write_pio_log()
+    {
+        auto &e{emu()};
+        if (e.pio_log_path == nullptr)
+        {
+            return;
+        }
+        std::FILE *log{std::fopen(e.pio_log_path, "w")};
+        if (log == nullptr)
+        {
+            std::fprintf(stderr, "[host] unable to write NEOPIXEL_HOST_PIO_LOG=%s\n", e.pio_log_path);
+            return;
+        }
+        std::fprintf(log, "pushed_us,on_wire_us,pio,sm,word\n");
+        for (const auto &push : e.pushes)
+        {
+            std::fprintf(log, "%.3f,%.3f,%u,%u,0x%08X\n",
+                         push.pushed_ns / 1000.0, push.on_wire_ns / 1000.0, push.pio, push.sm, push.word);
+        }
+        std::fclose(log);
+    }
+
+    void report_at_exit()
+    {
+        std::fflush(stdout);
+        emulated_sdk::print_report(stderr);
+        write_pio_log();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// emulated_sdk host API
+
+namespace emulated_sdk
+{
+    uint64_t now_ns() noexcept
+    {
+        const Bus bus{};
+        return core_now();
+    }
+    void advance_ns(uint64_t duration) noexcept
+    {
+        const Bus bus{};
+        advance_to(core_now() + duration);
+    }
+    std::vector<Pio_Push> pio_pushes() noexcept
+    {
+        const Bus bus{};
+        return emu().pushes;
+    }
+    void clear_pio_pushes() noexcept
+    {
+        const Bus bus{};
+        emu().pushes.clear();
+    }
+    std::vector<uint64_t> newline_times() noexcept
+    {
+        const Bus bus{};
+        return emu().newlines;
+    }
+    void set_input(std::FILE *input, uint64_t bytes_per_second) noexcept
+    {
+        const Bus bus{};
+        auto &e{emu()};
+        e.input = input;
+        e.input_byte_ns = bytes_per_second == 0 ? 0 : 1000000000ULL / bytes_per_second;
+        e.input_start_ns = core_now();
+        e.bytes_read = 0;
+        e.peeked = EOF;
+        e.exhausted = false;
+        e.exhausted_polls = 0;
+        e.rx_signalled = 0;
+    }
+    void set_drain_polls(uint64_t polls) noexcept
+    {
+        const Bus bus{};
+        configure_from_environment();
+        emu().drain_polls = polls;
+    }
+    void set_poll_cost_ns(uint64_t cost) noexcept
+    {
+        const Bus bus{};
+        configure_from_environment();
+        emu().poll_ns = cost;
+    }
+
+    void print_report(std::FILE *out) noexcept
+    {
+        const Bus bus{};
+        auto &e{emu()};
+        const double seconds{e.now_ns / 1e9};
+        std::fprintf(out, "[host] virtual time        %.3f ms\n", e.now_ns / 1e6);
+        std::fprintf(out, "[host] input               %llu bytes, %zu lines",
+                     static_cast<unsigned long long>(e.bytes_read), std::size(e.newlines));
+        if (seconds > 0)
+        {
+            std::fprintf(out, " (%.1f lines/s)", std::size(e.newlines) / seconds);
+        }
+        std::fprintf(out, "\n");
+
+        for (uint pio{0}; pio < NUM_PIOS; ++pio)
+        {
+            for (uint sm_index{0}; sm_index < NUM_PIO_STATE_MACHINES; ++sm_index)
+            {
+                const auto &sm{e.pio[pio].sm[sm_index]};
+                uint64_t words{0};
+                uint64_t frames{0};
+                uint64_t busy_ns{0};
+                uint64_t previous_end{0};
+                for (const auto &push : e.pushes)
+                {
+                    if (push.pio != pio || push.sm != sm_index)
+                    {
+                        continue;
+                    }
+                    if (words == 0 || push.on_wire_ns - previous_end >= LATCH_GAP_NS)
+                    {
+                        ++frames;
+                    }
+                    ++words;
+                    busy_ns += push.word_ns;
+                    previous_end = push.on_wire_ns + push.word_ns;
+                }
+                if (words == 0)
+                {
+                    continue;
+                }
+                std::fprintf(out, "[host] pio%u sm%u              %llu words, %llu frames, wire busy %.3f ms, %llu mid-frame stalls\n",
+                             pio, sm_index, static_cast<unsigned long long>(words), static_cast<unsigned long long>(frames),
+                             busy_ns / 1e6, static_cast<unsigned long long>(sm.stalls));
+            }
+        }
+
+        // for each line, how long until the superloop put the first word of a response into a FIFO
+        uint64_t count{0};
+        uint64_t total{0};
+        uint64_t worst{0};
+        uint64_t best{UINT64_MAX};
+        auto push_itr{std::begin(e.pushes)};
+        for (size_t ii{0}; ii < std::size(e.newlines); ++ii)
+        {
+            const auto start{e.newlines[ii]};
+            const auto next_line{ii + 1 < std::size(e.newlines) ? e.newlines[ii + 1] : UINT64_MAX};
+            push_itr = std::find_if(push_itr, std::end(e.pushes), [start](const auto &push)
+                                    { return push.pushed_ns >= start; });
+            if (push_itr == std::end(e.pushes) || push_itr->pushed_ns >= next_line)
+            {
+                continue;
+            }
+            const auto latency{push_itr->pushed_ns - start};
+            ++count;
+            total += latency;
+            worst = std::max(worst, latency);
+            best = std::min(best, latency);
+        }
+        if (count != 0)
+        {
+            std::fprintf(out, "[host] line -> first push   min %.3f us, mean %.3f us, max %.3f us over %llu lines\n",
+                         best / 1e3, total / 1e3 / count, worst / 1e3, static_cast<unsigned long long>(count));
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// pico/time.h, pico/stdlib.h, pico/stdio.h
+
+uint64_t time_us_64()
+{
+    const Bus bus{};
+    return core_now() / NS_PER_US;
+}
+uint32_t time_us_32()
+{
+    const Bus bus{};
+    return static_cast<uint32_t>(time_us_64());
+}
+void sleep_us(uint64_t us)
+{
+    const Bus bus{};
+    advance_to(core_now() + us * NS_PER_US);
+}
+void sleep_ms(uint32_t ms)
+{
+    sleep_us(1000ULL * ms);
+}
+void tight_loop_contents()
+{
+    const Bus bus{};
+    advance_to(core_now() + NS_PER_US);
+    count_idle_poll();
+}
+
+bool stdio_init_all()
+{
+    const Bus bus{};
+    configure_from_environment();
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    const Bus bus{};
+    configure_from_environment();
+    auto &e{emu()};
+    if (!e.report_registered)
+    {
+        e.report_registered = true;
+        std::atexit(report_at_exit);
+    }
+
+    advance_to(core_now() + e.poll_ns);
+
+    if (!peek_input())
+    {
+        advance_to(core_now() + uint64_t{timeout_us} * NS_PER_US);
+        count_idle_poll();
+        return PICO_ERROR_TIMEOUT;
+    }
+
+    const auto ready{next_byte_arrival()};
+    if (ready > core_now())
+    {
+        const auto deadline{core_now() + uint64_t{timeout_us} * NS_PER_US};
+        if (ready > deadline)
+        {
+            advance_to(deadline);
+            return PICO_ERROR_TIMEOUT;
+        }
+        advance_to(ready);
+    }
+
+    const int c{e.peeked};
+    e.peeked = EOF;
+    ++e.bytes_read;
+    if (c == '\n')
+    {
+        e.newlines.push_back(core_now());
+    }
+    return c;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param)
+{
+    const Bus bus{};
+    configure_from_environment();
+    auto &e{emu()};
+    if (!e.report_registered)
+    {
+        e.report_registered = true;
+        std::atexit(report_at_exit);
+    }
+    e.rx_callback = fn;
+    e.rx_param = param;
+    e.rx_core = this_core;
+    e.rx_signalled = e.bytes_read;
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// hardware/sync.h
+
+uint32_t save_and_disable_interrupts()
+{
+    const Bus bus{};
+    auto &e{emu()};
+    const bool was_masked{e.irqs_masked[this_core]};
+    e.irqs_masked[this_core] = true;
+    return was_masked;
+}
+void restore_interrupts(uint32_t status)
+{
+    const Bus bus{};
+    auto &e{emu()};
+    e.irqs_masked[this_core] = status != 0;
+    run_pending_irqs();
+    deliver_rx();
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// hardware/irq.h
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    const Bus bus{};
+    emu().irq[num].handlers.assign(1, handler);
+}
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t)
+{
+    const Bus bus{};
+    emu().irq[num].handlers.push_back(handler);
+}
+void irq_remove_handler(uint num, irq_handler_t handler)
+{
+    const Bus bus{};
+    auto &handlers{emu().irq[num].handlers};
+    handlers.erase(std::remove(std::begin(handlers), std::end(handlers), handler), std::end(handlers));
+}
+void irq_set_enabled(uint num, bool enabled)
+{
+    const Bus bus{};
+    emu().irq[num].enabled = enabled;
+    emu().irq[num].core = this_core;
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// hardware/pio.h
+
+pio_sm_config pio_get_default_sm_config()
+{
+    const Bus bus{};
+    pio_sm_config c{};
+    c.clkdiv = 1.0F;
+    c.wrap_target = 0;
+    c.wrap = PIO_INSTRUCTION_COUNT - 1;
+    c.pull_threshold = 32;
+    c.out_count = 32;
+    return c;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program *program)
+{
+    const Bus bus{};
+    const auto &block{emu().pio[pio_index_of(pio)]};
+    const uint32_t mask{(1U << program->length) - 1};
+    for (uint offset{0}; offset + program->length <= PIO_INSTRUCTION_COUNT; ++offset)
+    {
+        if ((block.used_instructions & (mask << offset)) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint pio_add_program(PIO pio, const pio_program *program)
+{
+    const Bus bus{};
+    auto &block{emu().pio[pio_index_of(pio)]};
+    const uint32_t mask{(1U << program->length) - 1};
+    // like the SDK, fill from the top of instruction memory down
+    for (int offset{PIO_INSTRUCTION_COUNT - program->length}; offset >= 0; --offset)
+    {
+        if ((block.used_instructions & (mask << offset)) != 0)
+        {
+            continue;
+        }
+        block.used_instructions |= mask << offset;
+        for (uint ii{0}; ii < program->length; ++ii)
+        {
+            uint16_t instr{program->instructions[ii]};
+            // relocate JMP targets
+            if ((instr >> 13) == 0)
+            {
+                instr = static_cast<uint16_t>(instr + offset);
+            }
+            block.instructions[offset + ii] = instr;
+        }
+        return static_cast<uint>(offset);
+    }
+    std::fprintf(stderr, "[host] PIO%u out of instruction memory\n", pio_index_of(pio));
+    std::abort();
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    const Bus bus{};
+    auto &block{emu().pio[pio_index_of(pio)]};
+    for (uint sm{0}; sm < NUM_PIO_STATE_MACHINES; ++sm)
+    {
+        if (!block.sm[sm].claimed)
+        {
+            block.sm[sm].claimed = true;
+            return static_cast<int>(sm);
+        }
+    }
+    if (required)
+    {
+        std::fprintf(stderr, "[host] no free state machine on PIO%u\n", pio_index_of(pio));
+        std::abort();
+    }
+    return -1;
+}
+
+void pio_sm_claim(PIO pio, uint sm)
+{
+    const Bus bus{};
+    state_machine(pio, sm).claimed = true;
+}
+
+void pio_sm_init(PIO pio, uint sm_index, uint initial_pc, const pio_sm_config *config)
+{
+    const Bus bus{};
+    auto &block{emu().pio[pio_index_of(pio)]};
+    auto &sm{block.sm[sm_index]};
+    sm.config = *config;
+    sm.enabled = false;
+    sm.waiting.clear();
+    sm.fifo_depth = config->fifo_join == PIO_FIFO_JOIN_TX ? 8 : 4;
+
+    // the hardware divider is 16.8 fixed point
+    const auto div_int{static_cast<uint32_t>(config->clkdiv)};
+    const auto div_frac{static_cast<uint32_t>(std::lround((config->clkdiv - div_int) * 256))};
+    const double divider{div_int + div_frac / 256.0};
+
+    const auto [cycles, bits]{cycles_per_out(block, *config, initial_pc)};
+    const double outs_per_word{bits == 0 ? 0.0 : static_cast<double>(config->pull_threshold) / bits};
+    sm.word_ns = static_cast<uint64_t>(std::llround(outs_per_word * cycles * divider * 1e9 / clock_get_hz(clk_sys)));
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+    const Bus bus{};
+    state_machine(pio, sm).enabled = enabled;
+}
+
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm)
+{
+    const Bus bus{};
+    return fifo_full(state_machine(pio, sm), emu().now_ns);
+}
+
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm)
+{
+    const Bus bus{};
+    auto &state{state_machine(pio, sm)};
+    retire(state, emu().now_ns);
+    return state.waiting.empty();
+}
+
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm)
+{
+    const Bus bus{};
+    auto &state{state_machine(pio, sm)};
+    retire(state, emu().now_ns);
+    return static_cast<uint>(std::size(state.waiting));
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data)
+{
+    const Bus bus{};
+    if (pio_sm_is_tx_fifo_full(pio, sm))
+    {
+        return; // the hardware drops it
+    }
+    push_word(pio_index_of(pio), sm, data);
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+    const Bus bus{};
+    auto &state{state_machine(pio, sm)};
+    while (fifo_full(state, emu().now_ns))
+    {
+        advance_to(state.waiting.front());
+    }
+    push_word(pio_index_of(pio), sm, data);
+}
+
+uint pio_get_index(PIO pio)
+{
+    const Bus bus{};
+    return pio_index_of(pio);
+}
+
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+    const Bus bus{};
+    return pio_index_of(pio) * 8 + sm + (is_tx ? 0 : 4);
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// hardware/dma.h
+
+int dma_claim_unused_channel(bool required)
+{
+    const Bus bus{};
+    auto &e{emu()};
+    for (uint channel{0}; channel < NUM_DMA_CHANNELS; ++channel)
+    {
+        if (!e.dma[channel].claimed)
+        {
+            e.dma[channel].claimed = true;
+            return static_cast<int>(channel);
+        }
+    }
+    if (required)
+    {
+        std::fprintf(stderr, "[host] no free DMA channel\n");
+        std::abort();
+    }
+    return -1;
+}
+
+void dma_channel_claim(uint channel)
+{
+    const Bus bus{};
+    emu().dma[channel].claimed = true;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    const Bus bus{};
+    emu().dma[channel].claimed = false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    const Bus bus{};
+    return dma_channel_config{
+        .size = DMA_SIZE_32,
+        .read_increment = true,
+        .write_increment = false,
+        .dreq = DREQ_FORCE,
+        .chain_to = channel,
+        .enable = true};
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    const Bus bus{};
+    auto &ch{emu().dma[channel]};
+    ch.config = *config;
+    ch.write_addr = write_addr;
+    ch.read_addr = read_addr;
+    ch.transfer_count = transfer_count;
+    if (trigger)
+    {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger)
+{
+    const Bus bus{};
+    emu().dma[channel].read_addr = read_addr;
+    if (trigger)
+    {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger)
+{
+    const Bus bus{};
+    emu().dma[channel].transfer_count = trans_count;
+    if (trigger)
+    {
+        start_transfer(channel);
+    }
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count)
+{
+    const Bus bus{};
+    auto &ch{emu().dma[channel]};
+    ch.read_addr = read_addr;
+    ch.transfer_count = transfer_count;
+    start_transfer(channel);
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+    const Bus bus{};
+    return emu().dma[channel].busy;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel)
+{
+    while (dma_channel_is_busy(channel))
+    {
+        tight_loop_contents();
+    }
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+    const Bus bus{};
+    emu().dma[channel].irq0_enabled = enabled;
+}
+void dma_channel_set_irq1_enabled(uint channel, bool enabled)
+{
+    const Bus bus{};
+    emu().dma[channel].irq1_enabled = enabled;
+}
+bool dma_channel_get_irq0_status(uint channel)
+{
+    const Bus bus{};
+    return emu().dma[channel].irq0_status;
+}
+bool dma_channel_get_irq1_status(uint channel)
+{
+    const Bus bus{};
+    return emu().dma[channel].irq1_status;
+}
+void dma_channel_acknowledge_irq0(uint channel)
+{
+    const Bus bus{};
+    emu().dma[channel].irq0_status = false;
+}
+void dma_channel_acknowledge_irq1(uint channel)
+{
+    const Bus bus{};
+    emu().dma[channel].irq1_status = false;
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// pico/platform.h, pico/multicore.h
+
+uint get_core_num()
+{
+    return this_core;
+}
+
+void multicore_launch_core1(void (*entry)(void))
+{
+    const Bus bus{};
+    auto &e{emu()};
+    e.core_ns[1] = core_now();
+    e.core_running[1] = true;
+    std::thread{[entry]
+                {
+                    this_core = 1;
+                    entry();
+                    const Bus bus{};
+                    emu().core_running[1] = false;
+                    emu().clock_moved.notify_all();
+                }}
+        .detach();
+}
+
+// -------------------------------------------------------------------------------------------------------------
+// pico/util/queue.h
+//
+// The blocking calls don't hold the bus themselves: a core can only wait for the other to catch up from the
+// outermost SDK call, and the other core is what they are waiting on.
+
+namespace
+{
+    // one slot more than asked for, so full and empty don't look alike
+    uint queue_slots(const queue_t *q)
+    {
+        return q->element_count + 1U;
+    }
+    uint8_t *queue_slot(queue_t *q, uint index)
+    {
+        return q->data + index * q->element_size;
+    }
+}
+
+void queue_init(queue_t *q, uint element_size, uint element_count)
+{
+    const Bus bus{};
+    q->element_size = static_cast<uint16_t>(element_size);
+    q->element_count = static_cast<uint16_t>(element_count);
+    q->data = new uint8_t[(element_count + 1U) * element_size];
+    q->wptr = 0;
+    q->rptr = 0;
+}
+
+void queue_free(queue_t *q)
+{
+    const Bus bus{};
+    delete[] q->data;
+    q->data = nullptr;
+}
+
+uint queue_get_level(queue_t *q)
+{
+    const Bus bus{};
+    return (q->wptr + queue_slots(q) - q->rptr) % queue_slots(q);
+}
+
+bool queue_try_add(queue_t *q, const void *data)
+{
+    const Bus bus{};
+    if (queue_get_level(q) == q->element_count)
+    {
+        return false;
+    }
+    std::memcpy(queue_slot(q, q->wptr), data, q->element_size);
+    q->wptr = static_cast<uint16_t>((q->wptr + 1U) % queue_slots(q));
+    return true;
+}
+
+bool queue_try_peek(queue_t *q, void *data)
+{
+    const Bus bus{};
+    if (q->wptr == q->rptr)
+    {
+        return false;
+    }
+    std::memcpy(data, queue_slot(q, q->rptr), q->element_size);
+    return true;
+}
+
+bool queue_try_remove(queue_t *q, void *data)
+{
+    const Bus bus{};
+    if (!queue_try_peek(q, data))
+    {
+        return false;
+    }
+    q->rptr = static_cast<uint16_t>((q->rptr + 1U) % queue_slots(q));
+    return true;
+}
+
+void queue_add_blocking(queue_t *q, const void *data)
+{
+    while (!queue_try_add(q, data))
+    {
+        tight_loop_contents();
+    }
+}
+
+void queue_remove_blocking(queue_t *q, void *data)
+{
+    while (!queue_try_remove(q, data))
+    {
+        tight_loop_contents();
+    }
+}
+
+void queue_peek_blocking(queue_t *q, void *data)
+{
+    while (!queue_try_peek(q, data))
+    {
+        tight_loop_contents();
+    }
+}
@@ -0,0 +1,51 @@
+#if !defined(EMULATED_SDK_HPP)
+#define EMULATED_SDK_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/* Host-side knobs and recordings of the emulated Pico SDK.  Firmware code never includes this; host tools do.
+ *
+ * Environment (read on first use, all optional):
+ *   NEOPIXEL_HOST_INPUT           file or fifo that feeds getchar_timeout_us (default: stdin)
+ *   NEOPIXEL_HOST_INPUT_RATE      input arrival rate in bytes/s (default: everything is available at boot)
+ *   NEOPIXEL_HOST_POLL_US         virtual time charged per getchar_timeout_us call (default: 2)
+ *   NEOPIXEL_HOST_DRAIN_POLLS     idle polls to keep running once input is exhausted, before exiting (default: 20000);
+ *                                 an idle poll is an empty getchar_timeout_us or a tight_loop_contents
+ *   NEOPIXEL_HOST_PIO_LOG         write every PIO FIFO push as CSV to this path
+ */
+namespace emulated_sdk
+{
+    struct Pio_Push
+    {
+        uint64_t pushed_ns;  // when the word entered the TX FIFO
+        uint64_t on_wire_ns; // when the state machine pulled it and started shifting
+        uint64_t word_ns;    // how long it takes to shift out
+        uint8_t pio;
+        uint8_t sm;
+        uint32_t word;
+    };
+
+    /* the calling core's virtual time */
+    [[nodiscard]] uint64_t now_ns() noexcept;
+    void advance_ns(uint64_t duration) noexcept;
+
+    /* every word that has gone into any TX FIFO so far, in push order; a copy, so it is safe with core 1 running */
+    [[nodiscard]] std::vector<Pio_Push> pio_pushes() noexcept;
+    void clear_pio_pushes() noexcept;
+
+    /* time stamps at which a '\n' was handed out by getchar_timeout_us */
+    [[nodiscard]] std::vector<uint64_t> newline_times() noexcept;
+
+    /* replaces the input; its bytes start arriving at the calling core's now_ns() */
+    void set_input(std::FILE *input, uint64_t bytes_per_second = 0) noexcept;
+    /* exit(0) after this many idle polls once input hits EOF; 0 never exits */
+    void set_drain_polls(uint64_t polls) noexcept;
+    void set_poll_cost_ns(uint64_t cost) noexcept;
+
+    /* throughput/latency summary of the run; printed to stderr at exit when firmware consumed input */
+    void print_report(std::FILE *out) noexcept;
+}
+
+#endif
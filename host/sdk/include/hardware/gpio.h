@@ -0,0 +1,22 @@
+#if !defined(EMULATED_HARDWARE_GPIO_H)
+#define EMULATED_HARDWARE_GPIO_H
+
+#include "pico/types.h"
+
+enum gpio_function
+{
+    GPIO_FUNC_XIP = 0,
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+inline void gpio_set_function(uint, enum gpio_function) {}
+inline void gpio_init(uint) {}
+
+#endif
@@ -0,0 +1,24 @@
+#if !defined(EMULATED_HARDWARE_IRQ_H)
+#define EMULATED_HARDWARE_IRQ_H
+
+#include "pico/types.h"
+
+enum
+{
+    DMA_IRQ_0 = 11,
+    DMA_IRQ_1 = 12,
+    UART0_IRQ = 20,
+    UART1_IRQ = 21,
+    NUM_IRQS = 32,
+};
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)();
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+void irq_remove_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+
+#endif
@@ -0,0 +1,101 @@
+#if !defined(EMULATED_HARDWARE_PIO_H)
+#define EMULATED_HARDWARE_PIO_H
+
+#include "pico/types.h"
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+
+/* Only the TX FIFO registers are modelled; their addresses are what DMA targets */
+struct pio_hw_t
+{
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+};
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t emulated_pio_hw[NUM_PIOS];
+#define pio0 (&emulated_pio_hw[0])
+#define pio1 (&emulated_pio_hw[1])
+
+struct pio_program
+{
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+};
+
+struct pio_sm_config
+{
+    float clkdiv;
+    uint wrap_target;
+    uint wrap;
+    uint sideset_bit_count; // including the enable bit, when optional
+    bool sideset_optional;
+    bool out_shift_right;
+    bool autopull;
+    uint pull_threshold;
+    uint out_base;
+    uint out_count;
+    uint set_base;
+    uint set_count;
+    uint sideset_base;
+    uint fifo_join;
+};
+
+enum pio_fifo_join
+{
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2,
+};
+
+pio_sm_config pio_get_default_sm_config();
+inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap)
+{
+    c->wrap_target = wrap_target;
+    c->wrap = wrap;
+}
+inline void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool)
+{
+    c->sideset_bit_count = bit_count;
+    c->sideset_optional = optional;
+}
+inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) { c->sideset_base = sideset_base; }
+inline void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count)
+{
+    c->out_base = out_base;
+    c->out_count = out_count;
+}
+inline void sm_config_set_set_pins(pio_sm_config *c, uint set_base, uint set_count)
+{
+    c->set_base = set_base;
+    c->set_count = set_count;
+}
+inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold)
+{
+    c->out_shift_right = shift_right;
+    c->autopull = autopull;
+    c->pull_threshold = pull_threshold == 0 ? 32 : pull_threshold;
+}
+inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) { c->fifo_join = join; }
+inline void sm_config_set_clkdiv(pio_sm_config *c, float div) { c->clkdiv = div; }
+
+bool pio_can_add_program(PIO pio, const pio_program *program);
+uint pio_add_program(PIO pio, const pio_program *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_claim(PIO pio, uint sm);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_put(PIO pio, uint sm, uint32_t data);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+bool pio_sm_is_tx_fifo_full(PIO pio, uint sm);
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm);
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm);
+uint pio_get_index(PIO pio);
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx);
+
+inline void pio_gpio_init(PIO, uint) {}
+inline void pio_sm_set_consecutive_pindirs(PIO, uint, uint, uint, bool) {}
+
+#endif
@@ -0,0 +1,20 @@
+#if !defined(EMULATED_HARDWARE_PWM_H)
+#define EMULATED_HARDWARE_PWM_H
+
+#include "pico/types.h"
+
+struct pwm_config
+{
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+};
+
+inline uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1U) & 7U; }
+inline uint pwm_gpio_to_channel(uint gpio) { return gpio & 1U; }
+inline pwm_config pwm_get_default_config() { return pwm_config{0, 1U << 4U, 0xFFFFU}; }
+inline void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) { c->top = wrap; }
+inline void pwm_init(uint, pwm_config *, bool) {}
+inline void pwm_set_chan_level(uint, uint, uint16_t) {}
+
+#endif
@@ -0,0 +1,10 @@
+#if !defined(EMULATED_HARDWARE_SYNC_H)
+#define EMULATED_HARDWARE_SYNC_H
+
+#include "pico/types.h"
+
+/* Masks interrupts on the calling core only, as on the chip.  Anything raised meanwhile runs on restore. */
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+#endif
@@ -0,0 +1,9 @@
+#if !defined(EMULATED_PICO_MULTICORE_H)
+#define EMULATED_PICO_MULTICORE_H
+
+#include "pico/platform.h"
+
+/* core 1 is a thread; it starts at core 0's current virtual time and the two are kept in lockstep from there */
+void multicore_launch_core1(void (*entry)(void));
+
+#endif
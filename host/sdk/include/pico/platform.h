@@ -0,0 +1,11 @@
+#if !defined(EMULATED_PICO_PLATFORM_H)
+#define EMULATED_PICO_PLATFORM_H
+
+#include "pico/types.h"
+
+#define NUM_CORES 2
+
+/* which core's thread the caller is on */
+uint get_core_num();
+
+#endif
@@ -0,0 +1,6 @@
+#if !defined(EMULATED_PICO_PRINTF_H)
+#define EMULATED_PICO_PRINTF_H
+
+#include <cstdio>
+
+#endif
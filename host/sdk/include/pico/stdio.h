@@ -0,0 +1,20 @@
+#if !defined(EMULATED_PICO_STDIO_H)
+#define EMULATED_PICO_STDIO_H
+
+#include "pico/types.h"
+
+#include <cstdio>
+
+enum
+{
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+};
+
+bool stdio_init_all();
+int getchar_timeout_us(uint32_t timeout_us);
+/* fn runs, as an interrupt on the registering core, when input arrives that it hasn't been told about yet.
+ * It is told once per arrival: characters it leaves unread aren't signalled again. */
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+
+#endif
@@ -0,0 +1,14 @@
+#if !defined(EMULATED_PICO_STDLIB_H)
+#define EMULATED_PICO_STDLIB_H
+
+#include "pico/types.h"
+#include "pico/stdio.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#define PICO_DEFAULT_LED_PIN 25
+
+/* the emulator charges a microsecond of virtual time per spin, so busy-waits make progress */
+void tight_loop_contents();
+
+#endif
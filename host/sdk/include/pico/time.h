@@ -0,0 +1,18 @@
+#if !defined(EMULATED_PICO_TIME_H)
+#define EMULATED_PICO_TIME_H
+
+#include "pico/types.h"
+
+/* virtual time; only advances inside emulated SDK calls that would take time on the device */
+uint64_t time_us_64();
+uint32_t time_us_32();
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+
+inline absolute_time_t get_absolute_time() { return time_us_64(); }
+inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+inline absolute_time_t make_timeout_time_us(uint64_t us) { return time_us_64() + us; }
+inline absolute_time_t make_timeout_time_ms(uint32_t ms) { return time_us_64() + 1000ULL * ms; }
+inline bool time_reached(absolute_time_t t) { return time_us_64() >= t; }
+
+#endif
@@ -0,0 +1,10 @@
+#if !defined(EMULATED_PICO_TYPES_H)
+#define EMULATED_PICO_TYPES_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#endif
@@ -0,0 +1,31 @@
+#if !defined(EMULATED_PICO_UTIL_QUEUE_H)
+#define EMULATED_PICO_UTIL_QUEUE_H
+
+#include "pico/types.h"
+
+/* Same shape as the SDK's: a fixed ring of fixed size elements, copied in and out, safe between cores.
+ *  The blocking calls spin on tight_loop_contents(), so they take virtual time like the SDK's do. */
+typedef struct
+{
+    uint8_t *data;
+    uint16_t wptr;
+    uint16_t rptr;
+    uint16_t element_size;
+    uint16_t element_count;
+} queue_t;
+
+void queue_init(queue_t *q, uint element_size, uint element_count);
+void queue_free(queue_t *q);
+
+uint queue_get_level(queue_t *q);
+inline bool queue_is_empty(queue_t *q) { return queue_get_level(q) == 0; }
+inline bool queue_is_full(queue_t *q) { return queue_get_level(q) == q->element_count; }
+
+bool queue_try_add(queue_t *q, const void *data);
+bool queue_try_remove(queue_t *q, void *data);
+bool queue_try_peek(queue_t *q, void *data);
+void queue_add_blocking(queue_t *q, const void *data);
+void queue_remove_blocking(queue_t *q, void *data);
+void queue_peek_blocking(queue_t *q, void *data);
+
+#endif
@@ -0,0 +1,98 @@
+/* Checks constexpr_math against <cmath>: every *_MAX_ERROR bound over a sweep of each function's range, and 4096
+ * entry 16-bit tables of sin, exp, log and pow, built at compile time with make_table() (so this file also shows
+ * they build within the compiler's default constexpr limits), entry by entry against the same tables built with
+ * <cmath>.
+ *
+ *   constexpr_table_check
+ *
+ * Exits non-zero if a bound is exceeded or an entry is more than a rounding step off. */
+#include "app/constexpr_math.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+    constexpr size_t TABLE_LENGTH{4096};
+    constexpr double FULL_SCALE{65535.0};
+
+    // a decay over 8 time constants, ln(1 + x) over an octave, and a 2.2 gamma curve
+    constexpr double exp_entry(size_t ii) { return constexpr_math::exp(-8.0 * ii / (TABLE_LENGTH - 1)); }
+    constexpr double log_entry(size_t ii) { return constexpr_math::log(1.0 + static_cast<double>(ii) / (TABLE_LENGTH - 1)) / 0.6931471805599453; }
+    constexpr double pow_entry(size_t ii) { return constexpr_math::pow(static_cast<double>(ii) / (TABLE_LENGTH - 1), 2.2); }
+
+    constexpr auto SINE{constexpr_math::make_sine_table<uint16_t, TABLE_LENGTH>()};
+    constexpr auto DECAY{constexpr_math::make_table<uint16_t, TABLE_LENGTH>(exp_entry, constexpr_math::EXP_MAX_ERROR + 4 * std::numeric_limits<double>::epsilon())};
+    constexpr auto LOG{constexpr_math::make_table<uint16_t, TABLE_LENGTH>(log_entry, 2 * constexpr_math::LOG_MAX_ERROR)};
+    constexpr auto GAMMA{constexpr_math::make_table<uint16_t, TABLE_LENGTH>(pow_entry, constexpr_math::POW_MAX_ERROR)};
+
+    /* the worst of error(x) over `steps` points from `from` to `to` */
+    template <class Error>
+    [[nodiscard]] double worst_error(double from, double to, int steps, Error &&error)
+    {
+        double worst{0.0};
+        for (int ii{0}; ii <= steps; ++ii)
+        {
+            worst = std::fmax(worst, error(from + (to - from) * ii / steps));
+        }
+        return worst;
+    }
+
+    [[nodiscard]] bool check_bound(const char *name, double worst, double bound)
+    {
+        std::printf("%-4s worst error %9.3g, bound %9.3g%s\n", name, worst, bound, worst <= bound ? "" : "   EXCEEDED");
+        return worst <= bound;
+    }
+
+    /* entries more than half a step from the exact value, and the furthest */
+    template <class Exact>
+    [[nodiscard]] bool check_table(const char *name, const std::array<uint16_t, TABLE_LENGTH> &table, Exact &&exact)
+    {
+        double worst{0.0};
+        for (size_t ii{0}; ii < TABLE_LENGTH; ++ii)
+        {
+            worst = std::fmax(worst, std::fabs(table[ii] - exact(static_cast<double>(ii)) * FULL_SCALE));
+        }
+        std::printf("%-6s %zu x 16-bit, furthest entry %.4f steps from exact\n", name, TABLE_LENGTH, worst);
+        return worst <= 0.501;
+    }
+}
+
+int main()
+{
+    namespace cm = constexpr_math;
+    bool ok{true};
+
+    ok &= check_bound("sin", worst_error(-1000.0, 1000.0, 2'000'003, [](double x)
+                                         { return std::fmax(std::fabs(cm::sin(x) - std::sin(x)), std::fabs(cm::cos(x) - std::cos(x))); }),
+                      cm::SIN_MAX_ERROR);
+    ok &= check_bound("exp", worst_error(-700.0, 700.0, 2'000'003, [](double x)
+                                         { return std::fabs(cm::exp(x) / std::exp(x) - 1.0); }),
+                      cm::EXP_MAX_ERROR);
+    ok &= check_bound("log", worst_error(-700.0, 700.0, 2'000'003, [](double e)
+                                         {
+                                             const double x{std::exp(e)};
+                                             return std::fabs(cm::log(x) - std::log(x));
+                                         }),
+                      cm::LOG_MAX_ERROR);
+    ok &= check_bound("pow", worst_error(0.001, 1.0, 200'003, [](double x)
+                                         {
+                                             double worst{0.0};
+                                             for (const double y : {1 / 2.4, 2.2, 3.0, 0.1, 50.0})
+                                             {
+                                                 worst = std::fmax(worst, std::fabs(cm::pow(x, y) / std::pow(x, y) - 1.0));
+                                             }
+                                             return worst;
+                                         }),
+                      cm::POW_MAX_ERROR);
+
+    ok &= check_table("sin", SINE, [](double ii)
+                      { return (std::sin(ii * 2.0 * cm::PI / TABLE_LENGTH) + 1.0) * 0.5; });
+    ok &= check_table("exp", DECAY, [](double ii)
+                      { return std::exp(-8.0 * ii / (TABLE_LENGTH - 1)); });
+    ok &= check_table("log", LOG, [](double ii)
+                      { return std::log2(1.0 + ii / (TABLE_LENGTH - 1)); });
+    ok &= check_table("pow", GAMMA, [](double ii)
+                      { return std::pow(ii / (TABLE_LENGTH - 1), 2.2); });
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+/* What the eye makes of a slow, dim fade, with and without dithering.
+ *
+ * A fade from dark to a sixteenth of full white over FADE_MS is sent at the strip's refresh rate, once cut to 8
+ * bits and once through Dithered_Frame.  The eye is modelled as the average over the last EYE_MS of frames; the
+ * run fails if the dithered fade, so seen, strays from the intended brightness by more than MAX_ERROR levels.
+ * Cut to 8 bits it is a staircase, up to a whole level out.  With a path, it also writes a PGM picture of both, time going
+ * down, truncated LEDs on the left and dithered ones on the right, brightened to be seen.
+ *
+ *   ./build-host/dither_regression [fade.pgm] */
+#include "ws2812/dither.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+namespace
+{
+    using namespace pico_ws2812;
+
+    constexpr size_t LEDS{24};
+    // 24 LEDs take 0.96 ms on the wire
+    constexpr double FRAME_MS{0.96};
+    constexpr double FADE_MS{4000};
+    constexpr double EYE_MS{20};
+    constexpr uint16_t TOP{0x1000}; // 16 levels out of 255
+    constexpr double MAX_ERROR{0.25};
+
+    struct Seen
+    {
+        double max_error{0};
+        double max_step{0};
+    };
+
+    class Eye
+    {
+    public:
+        double see(double level)
+        {
+            m_window.push_back(level);
+            m_sum += level;
+            if (std::size(m_window) > WINDOW)
+            {
+                m_sum -= m_window.front();
+                m_window.pop_front();
+            }
+            return m_sum / std::size(m_window);
+        }
+        [[nodiscard]] bool settled() const
+        {
+            return std::size(m_window) == WINDOW;
+        }
+
+    private:
+        static constexpr size_t WINDOW{static_cast<size_t>(EYE_MS / FRAME_MS)};
+        std::deque<double> m_window;
+        double m_sum{0};
+    };
+}
+
+int main(int argc, char **argv)
+{
+    using format = Wire_Format<WRGB>;
+    const size_t frames{static_cast<size_t>(FADE_MS / FRAME_MS)};
+
+    Dithered_Frame<LEDS> dithered;
+    std::array<uint32_t, LEDS> words{};
+    std::array<Eye, LEDS> truncated_eyes;
+    std::array<Eye, LEDS> dithered_eyes;
+    std::array<double, LEDS> last_truncated{};
+    std::array<double, LEDS> last_dithered{};
+    Seen truncated_seen;
+    Seen dithered_seen;
+    std::vector<uint8_t> picture;
+
+    for (size_t frame{0}; frame < frames; ++frame)
+    {
+        const auto value{static_cast<uint16_t>(TOP * frame / frames)};
+        // what an 8-bit pipeline shows for it, and what it means
+        const double intended{(value - (value >> 8)) / 256.0};
+        dithered.fill(WRGB16{.white{value}, .red{0}, .green{0}, .blue{0}});
+        dithered.quantize(words);
+        const auto truncated{static_cast<uint8_t>(value >> 8)};
+
+        for (size_t ii{0}; ii < LEDS; ++ii)
+        {
+            const double seen_truncated{truncated_eyes[ii].see(truncated)};
+            const double seen_dithered{dithered_eyes[ii].see(format::unpack(words[ii]).white)};
+            if (dithered_eyes[ii].settled())
+            {
+                // the eye lags by half its window; compare with what was intended then
+                const double lagged{intended - (TOP / 256.0) * (EYE_MS / 2) / FADE_MS};
+                truncated_seen.max_error = std::max(truncated_seen.max_error, std::abs(seen_truncated - lagged));
+                dithered_seen.max_error = std::max(dithered_seen.max_error, std::abs(seen_dithered - lagged));
+                truncated_seen.max_step = std::max(truncated_seen.max_step, std::abs(seen_truncated - last_truncated[ii]));
+                dithered_seen.max_step = std::max(dithered_seen.max_step, std::abs(seen_dithered - last_dithered[ii]));
+            }
+            last_truncated[ii] = seen_truncated;
+            last_dithered[ii] = seen_dithered;
+        }
+        if (frame % 4 == 0)
+        {
+            for (size_t ii{0}; ii < LEDS; ++ii)
+            {
+                picture.push_back(static_cast<uint8_t>(truncated * 15));
+            }
+            for (size_t ii{0}; ii < LEDS; ++ii)
+            {
+                picture.push_back(static_cast<uint8_t>(format::unpack(words[ii]).white * 15));
+            }
+        }
+    }
+
+    std::printf("fade to %.1f levels over %.0f ms, seen over %.0f ms\n", TOP / 256.0, FADE_MS, EYE_MS);
+    std::printf("              worst error   worst change in a frame\n");
+    std::printf("truncated      %6.3f        %6.3f\n", truncated_seen.max_error, truncated_seen.max_step);
+    std::printf("dithered       %6.3f        %6.3f\n", dithered_seen.max_error, dithered_seen.max_step);
+
+    if (argc > 1)
+    {
+        if (std::FILE *out{std::fopen(argv[1], "wb")}; out != nullptr)
+        {
+            std::fprintf(out, "P5\n%zu %zu\n255\n", 2 * LEDS, std::size(picture) / (2 * LEDS));
+            std::fwrite(std::data(picture), 1, std::size(picture), out);
+            std::fclose(out);
+        }
+        else
+        {
+            std::fprintf(stderr, "can't write %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    if (dithered_seen.max_error > MAX_ERROR)
+    {
+        std::printf("FAIL: the dithered fade strays more than %.2f levels\n", MAX_ERROR);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+/* Stress test for the SERIAL_NEOPIXEL_DUAL_CORE handoff.  This thread plays core 0: it throws random bursts of
+ * set_pixel/fill/coalesce-window messages at the output core, with real thread scheduling noise between them, then
+ * lets the strip settle and checks that the last frame on the wire is exactly what it asked for.
+ *
+ * Some bursts redraw the canvas, or the precise canvas, and present it, a few times over, so the staged pixels
+ * overrun the queue and core 1 is partway through a frame while it runs.  Precise pixels are whole 8-bit values,
+ * which dither to themselves every frame, so they can be checked word for word too.  A precise burst is followed by a
+ * canvas, staged whole while core 1 may be dithering, or ends its round, since a pixel set after it is drawn on
+ * whichever frame was dithered last.
+ *
+ *   dual_core_stress [ROUNDS] [SEED]          (defaults: 2000 rounds, seed 1)
+ *
+ * Exits non-zero on the first frame that doesn't match.
+ */
+#include "app/neopixel_output.hpp"
+
+#include "emulated_sdk.hpp"
+#include "pico/time.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+namespace
+{
+    using pico_ws2812::WRGB;
+
+    // comfortably longer than the worst coalescing window, latch wait and frame time together, twice over: after a
+    // precise canvas the 8-bit frame under it may still go out first, then the first dithered one
+    constexpr uint32_t SETTLE_US{6000};
+    constexpr uint32_t MAX_WINDOW_US{500};
+    // bigger than the message queue, so some bursts block on it
+    constexpr int MAX_BURST{64};
+    // canvases drawn and presented back to back; each can stage every pixel, so a run of them overruns the queue
+    constexpr uint32_t MAX_PRESENTS{4};
+
+    [[noreturn]] void finish(int status)
+    {
+        std::fflush(nullptr);
+        // core 1 never returns, so skip the static destructors it would be running under
+        std::_Exit(status);
+    }
+
+    /* a whole 8-bit value at 16 bits, so it dithers to exactly that */
+    [[nodiscard]] constexpr pico_ws2812::WRGB16 widened(WRGB pixel) noexcept
+    {
+        const auto wide{[](uint8_t channel)
+                        { return static_cast<uint16_t>(channel * 0x101U); }};
+        return pico_ws2812::WRGB16{.white{wide(pixel.white)}, .red{wide(pixel.red)}, .green{wide(pixel.green)}, .blue{wide(pixel.blue)}};
+    }
+
+    /* the last whole frame pushed to the strip's state machine, or all zeros if nothing has been; while dithering,
+     * frames go out back to back, so the one after it may be part way through */
+    [[nodiscard]] neopixel::Pixel_Frame last_frame_on_wire()
+    {
+        neopixel::Pixel_Frame shown;
+        const auto pushes{emulated_sdk::pio_pushes()};
+        if (std::size(pushes) < neopixel::LED_COUNT)
+        {
+            return shown;
+        }
+        // every flush sends the whole strip
+        const auto first{(std::size(pushes) / neopixel::LED_COUNT - 1) * neopixel::LED_COUNT};
+        for (size_t ii{0}; ii < neopixel::LED_COUNT; ++ii)
+        {
+            shown.words()[ii] = pushes[first + ii].word;
+        }
+        return shown;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const unsigned long rounds{argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000UL};
+    const unsigned long seed{argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1UL};
+
+    std::mt19937 rng{static_cast<std::mt19937::result_type>(seed)};
+    auto &&uniform{[&](uint32_t lo, uint32_t hi)
+                   { return std::uniform_int_distribution<uint32_t>{lo, hi}(rng); }};
+    auto &&random_pixel{[&]
+                        { return WRGB{.white{static_cast<uint8_t>(uniform(0, 255))}, .red{static_cast<uint8_t>(uniform(0, 255))},
+                                      .green{static_cast<uint8_t>(uniform(0, 255))}, .blue{static_cast<uint8_t>(uniform(0, 255))}}; }};
+
+    neopixel::start();
+    // every frame is checked word for word, so none may be dimmed
+    auto budget{neopixel::power_budget()};
+    budget.budget_ma = 0;
+    neopixel::set_power_budget(budget);
+
+    neopixel::Pixel_Frame expected;
+    // what the precise canvas dithers to; the 16-bit canvas itself is only written, never read back
+    neopixel::Pixel_Frame expected_precise;
+    unsigned long messages{0};
+    unsigned long presents{0};
+    auto &&draw_canvases{[&](uint32_t count)
+                         {
+                             for (; count > 0; --count)
+                             {
+                                 for (uint32_t drawn{uniform(1, neopixel::LED_COUNT)}; drawn > 0; --drawn)
+                                 {
+                                     neopixel::canvas().set(uniform(0, neopixel::LED_COUNT - 1), random_pixel());
+                                 }
+                                 neopixel::present_canvas();
+                                 ++presents;
+                             }
+                             expected = neopixel::canvas();
+                         }};
+    for (unsigned long round{0}; round < rounds; ++round)
+    {
+        const int burst{static_cast<int>(uniform(1, MAX_BURST))};
+        for (int ii{0}; ii < burst; ++ii)
+        {
+            const auto roll{uniform(0, 99)};
+            if (roll < 70)
+            {
+                const size_t index{uniform(0, neopixel::LED_COUNT - 1)};
+                const auto pixel{random_pixel()};
+                expected.set(index, pixel);
+                neopixel::set_pixel(index, pixel);
+            }
+            else if (roll < 85)
+            {
+                const auto pixel{random_pixel()};
+                expected.fill(pixel);
+                neopixel::fill(pixel);
+            }
+            else if (roll < 90)
+            {
+                draw_canvases(uniform(1, MAX_PRESENTS));
+            }
+            else if (roll < 95)
+            {
+                for (uint32_t present{uniform(1, MAX_PRESENTS)}; present > 0; --present)
+                {
+                    for (uint32_t drawn{uniform(1, neopixel::LED_COUNT)}; drawn > 0; --drawn)
+                    {
+                        const size_t index{uniform(0, neopixel::LED_COUNT - 1)};
+                        const auto pixel{random_pixel()};
+                        expected_precise.set(index, pixel);
+                        neopixel::precise_canvas().set(index, widened(pixel));
+                    }
+                    neopixel::present_precise_canvas();
+                    ++presents;
+                }
+                expected = expected_precise;
+                if (uniform(0, 1) == 0)
+                {
+                    // staged whole behind the precise frame, while core 1 may already be dithering it
+                    draw_canvases(1);
+                }
+                else
+                {
+                    // a set_pixel now would land on whichever 8-bit frame core 1 last dithered, so let this one settle
+                    ++messages;
+                    break;
+                }
+            }
+            else
+            {
+                neopixel::set_coalesce_window(uniform(0, MAX_WINDOW_US));
+            }
+            ++messages;
+            if (uniform(0, 7) == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        // a round trip, so everything above has been applied; then let it reach the wire
+        (void)neopixel::stats();
+        sleep_us(SETTLE_US);
+
+        const auto shown{last_frame_on_wire()};
+        if (shown != expected)
+        {
+            std::printf("round %lu: frame on the wire doesn't match\n", round);
+            for (size_t ii{0}; ii < neopixel::LED_COUNT; ++ii)
+            {
+                std::printf("  %2zu  expected 0x%08X  shown 0x%08X\n", ii, expected.words()[ii], shown.words()[ii]);
+            }
+            finish(1);
+        }
+    }
+
+    const auto stats{neopixel::stats()};
+    std::printf("%lu rounds, %lu messages, %lu canvases presented, %lu frames flushed, %lu unchanged, %lu coalesced, %.3f ms virtual: ok\n",
+                rounds, messages, presents, static_cast<unsigned long>(stats.flushes), static_cast<unsigned long>(stats.skipped_unchanged),
+                static_cast<unsigned long>(stats.coalesced), emulated_sdk::now_ns() / 1e6);
+    finish(0);
+}
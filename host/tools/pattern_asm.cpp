@@ -0,0 +1,197 @@
+/* The host end of pattern programs (app/pattern_vm.hpp): assembles one from text (the format is at the top of
+ * pattern_assembler.hpp), runs it offline, and uploads it to the emulated firmware.
+ *
+ *   pattern_asm assemble SOURCE > program.bin
+ *       the bytecode alone
+ *   pattern_asm session SOURCE > session.bin
+ *       a shell session for NEOPIXEL_HOST_INPUT: sync, `stream`, the PROGRAM packet, END, then `stats`
+ *   pattern_asm eval SOURCE FRAMES
+ *       every frame's wire words as the firmware would draw them, and the instructions each took per pixel; fails
+ *       if a frame runs out of pattern_engine::PROGRAM_BUDGET
+ *   pattern_asm check SOURCE PIO_LOG
+ *       checks that the last whole frame NEOPIXEL_HOST_PIO_LOG recorded on the wire is a step of the program
+ *
+ *   ./pattern_asm session comet.pasm > session.bin
+ *   NEOPIXEL_HOST_INPUT=session.bin NEOPIXEL_HOST_PIO_LOG=pio.csv ./serial-neopixel-host
+ *   ./pattern_asm check comet.pasm pio.csv
+ */
+#include "app/neopixel_output.hpp"
+#include "app/pattern_engine.hpp"
+#include "app/pattern_vm.hpp"
+#include "app/stream_protocol.hpp"
+#include "pattern_assembler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    constexpr size_t LED_COUNT{neopixel::LED_COUNT};
+    // how far check looks for the step on the wire
+    constexpr uint32_t MAX_CHECKED_STEP{1'000'000};
+
+    /* the program in `path`, assembled and validated, or nothing after saying why */
+    [[nodiscard]] std::optional<std::vector<uint8_t>> assemble(const char *path)
+    {
+        std::FILE *source{std::fopen(path, "r")};
+        if (source == nullptr)
+        {
+            std::fprintf(stderr, "can't read %s\n", path);
+            return std::nullopt;
+        }
+        std::string text;
+        std::array<char, 256> chunk{};
+        for (size_t got; (got = std::fread(std::data(chunk), 1, std::size(chunk), source)) != 0;)
+        {
+            text.append(std::data(chunk), got);
+        }
+        std::fclose(source);
+        auto assembly{pattern_assembler::assemble(text)};
+        if (std::empty(assembly.bytes))
+        {
+            if (assembly.error_line == 0)
+            {
+                std::fprintf(stderr, "%s: %s\n", path, assembly.error.c_str());
+            }
+            else
+            {
+                std::fprintf(stderr, "%s:%zu: %s\n", path, assembly.error_line, assembly.error.c_str());
+            }
+            return std::nullopt;
+        }
+        return std::move(assembly.bytes);
+    }
+
+    void write(const void *bytes, size_t count)
+    {
+        std::fwrite(bytes, 1, count, stdout);
+    }
+
+    int session(const std::vector<uint8_t> &program)
+    {
+        // no power limit, so the frames reach the wire exactly as drawn
+        constexpr char SHELL_START[]{"\npower 0\nstream\n"};
+        write(SHELL_START, std::strlen(SHELL_START));
+        using namespace stream_protocol;
+        std::array<uint8_t, encoded_size(HEADER_SIZE + pattern_vm::MAX_SIZE + CRC_SIZE) + 1> wire{};
+        write(std::data(wire), encode_packet<pattern_vm::MAX_SIZE>(Packet_Type::PROGRAM, 0, 0, 0, program, wire));
+        write(std::data(wire), encode_packet<0>(Packet_Type::END, 1, 0, 0, {}, wire));
+        constexpr char SHELL_END[]{"stats\n"};
+        write(SHELL_END, std::strlen(SHELL_END));
+        std::fprintf(stderr, "%zu byte program\n", std::size(program));
+        return EXIT_SUCCESS;
+    }
+
+    int eval(const std::vector<uint8_t> &program, uint32_t frames)
+    {
+        pattern_vm::Machine machine;
+        machine.load(program);
+        std::array<uint32_t, LED_COUNT> words{};
+        for (uint32_t frame{0}; frame < frames; ++frame)
+        {
+            const auto result{machine.run(frame, words, pattern_engine::PROGRAM_BUDGET)};
+            std::printf("%6u %6.1f", frame, static_cast<double>(result.instructions) / LED_COUNT);
+            for (const auto word : words)
+            {
+                std::printf(" %08X", word);
+            }
+            std::printf("\n");
+            if (result.pixels != LED_COUNT)
+            {
+                std::fprintf(stderr, "frame %u: out of instructions at pixel %zu\n", frame, result.pixels);
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int check(const std::vector<uint8_t> &program, const char *log_path)
+    {
+        std::FILE *log{std::fopen(log_path, "r")};
+        if (log == nullptr)
+        {
+            std::fprintf(stderr, "can't read %s\n", log_path);
+            return EXIT_FAILURE;
+        }
+        std::vector<uint32_t> words;
+        char line[128];
+        while (std::fgets(line, sizeof(line), log) != nullptr)
+        {
+            double pushed_us{};
+            double on_wire_us{};
+            unsigned pio{};
+            unsigned sm{};
+            unsigned word{};
+            if (std::sscanf(line, "%lf,%lf,%u,%u,0x%X", &pushed_us, &on_wire_us, &pio, &sm, &word) == 5)
+            {
+                words.push_back(word);
+            }
+        }
+        std::fclose(log);
+        if (std::size(words) < LED_COUNT)
+        {
+            std::fprintf(stderr, "no whole frame in %s\n", log_path);
+            return EXIT_FAILURE;
+        }
+
+        // every flush sends the whole strip, but the emulator may stop part way through the last one
+        const auto first{(std::size(words) / LED_COUNT - 1) * LED_COUNT};
+        pattern_vm::Machine machine;
+        machine.load(program);
+        std::array<uint32_t, LED_COUNT> drawn{};
+        for (uint32_t step{0}; step < MAX_CHECKED_STEP; ++step)
+        {
+            (void)machine.run(step, drawn, pattern_engine::PROGRAM_BUDGET);
+            if (std::equal(std::begin(drawn), std::end(drawn), std::begin(words) + static_cast<std::ptrdiff_t>(first)))
+            {
+                std::printf("last frame on the wire is step %u of the program\n", step);
+                return EXIT_SUCCESS;
+            }
+        }
+        std::fprintf(stderr, "the last frame on the wire is none of the program's first %u steps\n", MAX_CHECKED_STEP);
+        return EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s assemble SOURCE | session SOURCE | eval SOURCE FRAMES | check SOURCE PIO_LOG\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const auto program{assemble(argv[2])};
+    if (!program.has_value())
+    {
+        return EXIT_FAILURE;
+    }
+    const std::string_view mode{argv[1]};
+    if (mode == "assemble" && argc == 3)
+    {
+        write(std::data(*program), std::size(*program));
+        std::fprintf(stderr, "%zu bytes\n", std::size(*program));
+        return EXIT_SUCCESS;
+    }
+    if (mode == "session" && argc == 3)
+    {
+        return session(*program);
+    }
+    if (mode == "eval" && argc == 4)
+    {
+        return eval(*program, static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)));
+    }
+    if (mode == "check" && argc == 4)
+    {
+        return check(*program, argv[3]);
+    }
+    std::fprintf(stderr, "usage: %s assemble SOURCE | session SOURCE | eval SOURCE FRAMES | check SOURCE PIO_LOG\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,282 @@
+#if !defined(PATTERN_ASSEMBLER_HPP)
+#define PATTERN_ASSEMBLER_HPP
+
+/* Pattern programs (app/pattern_vm.hpp) from text, for pattern_asm and pattern_vm_bench.
+ *
+ * A line at a time, # to the end of a line is a comment:
+ *
+ *   fps 50                 frames per second, before the first instruction; 50 if not given
+ *   name:                  a label, alone or before an instruction
+ *   add r4, r0, r1         an op, lower case, then its operands as the top of pattern_vm.hpp lists them
+ *
+ * Registers are r0 to r15, or pixel, step and count for r0 to r2.  Constants are decimal or 0x hex; ADDI's may be
+ * negative.  CHAN's channel is w, r, g or b.  Jumps take a label.  `li d, VALUE` is LDI, then LDHI too if VALUE
+ * doesn't fit 16 bits. */
+#include "app/pattern_engine.hpp"
+#include "app/pattern_vm.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace pattern_assembler
+{
+    struct Assembly
+    {
+        std::vector<uint8_t> bytes; // empty if it didn't assemble
+        size_t error_line{0};       // from 1; 0 for the whole program
+        std::string error;
+    };
+
+    namespace detail
+    {
+        using pattern_vm::Op;
+
+        inline constexpr std::array<std::pair<std::string_view, Op>, 32> MNEMONICS{{
+            {"ldi", Op::LDI},       {"ldhi", Op::LDHI},   {"mov", Op::MOV},     {"add", Op::ADD},
+            {"sub", Op::SUB},       {"mul", Op::MUL},     {"div", Op::DIV},     {"mod", Op::MOD},
+            {"and", Op::AND},       {"or", Op::OR},       {"xor", Op::XOR},     {"shl", Op::SHL},
+            {"shr", Op::SHR},       {"min", Op::MIN},     {"max", Op::MAX},     {"slt", Op::SLT},
+            {"addi", Op::ADDI},     {"shli", Op::SHLI},   {"shri", Op::SHRI},   {"andi", Op::ANDI},
+            {"sin", Op::SIN},       {"gamma", Op::GAMMA}, {"chan", Op::CHAN},   {"hsv", Op::HSV},
+            {"cscale", Op::CSCALE}, {"cadd", Op::CADD},   {"clerp", Op::CLERP}, {"cmax", Op::CMAX},
+            {"jmp", Op::JMP},       {"brz", Op::BRZ},     {"brnz", Op::BRNZ},   {"out", Op::OUT},
+        }};
+
+        [[nodiscard]] inline std::vector<std::string_view> split(std::string_view line)
+        {
+            std::vector<std::string_view> words;
+            size_t at{0};
+            while (at < std::size(line))
+            {
+                const auto start{line.find_first_not_of(" \t\r\n,", at)};
+                if (start == std::string_view::npos)
+                {
+                    break;
+                }
+                const auto end{std::min(line.find_first_of(" \t\r\n,", start), std::size(line))};
+                words.push_back(line.substr(start, end - start));
+                at = end;
+            }
+            return words;
+        }
+
+        [[nodiscard]] inline std::optional<long> number(std::string_view text)
+        {
+            const bool negative{!std::empty(text) && text.front() == '-'};
+            text.remove_prefix(negative ? 1 : 0);
+            const bool hex{text.starts_with("0x")};
+            text.remove_prefix(hex ? 2 : 0);
+            long value{};
+            const auto [end, error]{std::from_chars(std::data(text), std::data(text) + std::size(text), value, hex ? 16 : 10)};
+            if (std::empty(text) || error != std::errc{} || end != std::data(text) + std::size(text))
+            {
+                return std::nullopt;
+            }
+            return negative ? -value : value;
+        }
+
+        [[nodiscard]] inline std::optional<uint8_t> reg(std::string_view text)
+        {
+            constexpr std::array<std::string_view, 3> INPUTS{"pixel", "step", "count"};
+            for (size_t ii{0}; ii < std::size(INPUTS); ++ii)
+            {
+                if (text == INPUTS[ii])
+                {
+                    return static_cast<uint8_t>(ii);
+                }
+            }
+            if (!text.starts_with("r"))
+            {
+                return std::nullopt;
+            }
+            const auto index{number(text.substr(1))};
+            if (!index.has_value() || *index < 0 || *index >= static_cast<long>(pattern_vm::REGISTERS))
+            {
+                return std::nullopt;
+            }
+            return static_cast<uint8_t>(*index);
+        }
+
+        [[nodiscard]] inline std::optional<uint8_t> channel(std::string_view text)
+        {
+            constexpr std::array<std::string_view, 4> CHANNELS{"w", "r", "g", "b"};
+            for (size_t ii{0}; ii < std::size(CHANNELS); ++ii)
+            {
+                if (text == CHANNELS[ii])
+                {
+                    return static_cast<uint8_t>(ii);
+                }
+            }
+            return std::nullopt;
+        }
+    }
+
+    [[nodiscard]] inline Assembly assemble(std::string_view source)
+    {
+        using namespace detail;
+        Assembly rv;
+        uint8_t fps{static_cast<uint8_t>(pattern_engine::DEFAULT_FPS)};
+        std::vector<uint32_t> code;
+        std::vector<std::pair<std::string_view, size_t>> labels;
+        struct Fixup
+        {
+            size_t at;
+            std::string_view label;
+            size_t line;
+        };
+        std::vector<Fixup> fixups;
+        const auto fail{[&rv](size_t line, std::string why)
+                        {
+                            rv.bytes.clear();
+                            rv.error_line = line;
+                            rv.error = std::move(why);
+                            return rv;
+                        }};
+
+        size_t number_of_line{0};
+        while (!std::empty(source))
+        {
+            ++number_of_line;
+            const auto end{std::min(source.find('\n'), std::size(source))};
+            auto line{source.substr(0, end)};
+            source.remove_prefix(std::min(end + 1, std::size(source)));
+            line = line.substr(0, line.find('#'));
+            auto words{split(line)};
+            if (!std::empty(words) && words.front().ends_with(':'))
+            {
+                const auto label{words.front().substr(0, std::size(words.front()) - 1)};
+                for (const auto &[name, at] : labels)
+                {
+                    if (name == label)
+                    {
+                        return fail(number_of_line, "label defined twice");
+                    }
+                }
+                labels.emplace_back(label, std::size(code));
+                words.erase(std::begin(words));
+            }
+            if (std::empty(words))
+            {
+                continue;
+            }
+            const auto mnemonic{words.front()};
+            const std::vector<std::string_view> operands(std::begin(words) + 1, std::end(words));
+            if (mnemonic == "fps")
+            {
+                const auto value{std::size(operands) == 1 ? number(operands[0]) : std::nullopt};
+                if (!std::empty(code) || !value.has_value() || *value < 1 || *value > 255)
+                {
+                    return fail(number_of_line, "fps needs a rate from 1 to 255, before the first instruction");
+                }
+                fps = static_cast<uint8_t>(*value);
+                continue;
+            }
+            if (mnemonic == "li")
+            {
+                const auto d{std::size(operands) == 2 ? reg(operands[0]) : std::nullopt};
+                const auto value{std::size(operands) == 2 ? number(operands[1]) : std::nullopt};
+                if (!d.has_value() || !value.has_value() || *value < 0 || *value > 0xFFFF'FFFFL)
+                {
+                    return fail(number_of_line, "li needs a register and a value from 0 to 0xFFFFFFFF");
+                }
+                code.push_back(pattern_vm::encode_immediate(Op::LDI, *d, static_cast<uint16_t>(*value)));
+                if (*value > 0xFFFF)
+                {
+                    code.push_back(pattern_vm::encode_immediate(Op::LDHI, *d, static_cast<uint16_t>(*value >> 16)));
+                }
+                continue;
+            }
+            const auto entry{std::ranges::find(MNEMONICS, mnemonic, &std::pair<std::string_view, Op>::first)};
+            if (entry == std::end(MNEMONICS))
+            {
+                return fail(number_of_line, "unknown op " + std::string{mnemonic});
+            }
+            const Op op{entry->second};
+            const auto shape{pattern_vm::detail::shape_of(op)};
+            const size_t wanted{shape.registers + (shape.form == pattern_vm::detail::Form::REGISTERS ? 0U : 1U)};
+            if (std::size(operands) != wanted)
+            {
+                return fail(number_of_line, std::string{mnemonic} + " takes " + std::to_string(wanted) + " operands");
+            }
+            std::array<uint8_t, 3> fields{};
+            for (size_t ii{0}; ii < shape.registers; ++ii)
+            {
+                const auto r{reg(operands[ii])};
+                if (!r.has_value())
+                {
+                    return fail(number_of_line, "no register " + std::string{operands[ii]});
+                }
+                fields[ii] = *r;
+            }
+            switch (shape.form)
+            {
+            case pattern_vm::detail::Form::REGISTERS:
+                code.push_back(pattern_vm::encode(op, fields[0], fields[1], fields[2]));
+                break;
+            case pattern_vm::detail::Form::IMMEDIATE:
+            {
+                const auto value{number(operands[1])};
+                if (!value.has_value() || *value < 0 || *value > 0xFFFF)
+                {
+                    return fail(number_of_line, "the constant is 0 to 65535");
+                }
+                code.push_back(pattern_vm::encode_immediate(op, fields[0], static_cast<uint16_t>(*value)));
+                break;
+            }
+            case pattern_vm::detail::Form::CONSTANT:
+            {
+                const auto chan{channel(operands[2])};
+                const auto value{op == Op::CHAN ? (chan.has_value() ? std::optional<long>{*chan} : std::nullopt) : number(operands[2])};
+                const long low{op == Op::ADDI ? -128 : 0};
+                const long high{op == Op::ADDI ? 127 : long{shape.max_constant}};
+                if (!value.has_value() || *value < low || *value > high)
+                {
+                    return fail(number_of_line, op == Op::CHAN ? "the channel is w, r, g or b" : "the constant is " + std::to_string(low) + " to " + std::to_string(high));
+                }
+                code.push_back(pattern_vm::encode(op, fields[0], fields[1], static_cast<uint8_t>(*value)));
+                break;
+            }
+            case pattern_vm::detail::Form::JUMP:
+                fixups.push_back(Fixup{.at = std::size(code), .label = operands.back(), .line = number_of_line});
+                code.push_back(pattern_vm::encode_jump(op, fields[0], 0));
+                break;
+            }
+        }
+
+        for (const auto &fixup : fixups)
+        {
+            const auto label{std::ranges::find(labels, fixup.label, &std::pair<std::string_view, size_t>::first)};
+            if (label == std::end(labels))
+            {
+                return fail(fixup.line, "no label " + std::string{fixup.label});
+            }
+            const auto offset{static_cast<long>(label->second) - static_cast<long>(fixup.at) - 1};
+            code[fixup.at] |= static_cast<uint32_t>(static_cast<uint16_t>(offset)) << 16;
+        }
+        if (std::size(code) > pattern_vm::MAX_INSTRUCTIONS)
+        {
+            return fail(0, "more than " + std::to_string(pattern_vm::MAX_INSTRUCTIONS) + " instructions");
+        }
+        pattern_vm::Program<> program{fps};
+        for (const auto instruction : code)
+        {
+            program.add(instruction);
+        }
+        if (const auto status{pattern_vm::validate(program.bytes())}; status != pattern_vm::Status::OK)
+        {
+            return fail(0, std::string{pattern_vm::describe(status)});
+        }
+        rv.bytes.assign(std::begin(program.bytes()), std::end(program.bytes()));
+        return rv;
+    }
+}
+
+#endif
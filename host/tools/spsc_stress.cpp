@@ -0,0 +1,144 @@
+/* Two threads through one SPSC_Ring_Buffer, each side picking at random between the element, bulk and region
+ * calls, with the odd yield to shake up the interleaving.  The producer sends a running count; the consumer
+ * checks that it sees every value exactly once and in order.
+ *
+ *   spsc_stress [ITEMS] [SEED]          (defaults: 50000000 items, seed 1)
+ *
+ * Exits non-zero on the first value out of sequence.
+ */
+#include "app/Ring_Buffer.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+namespace
+{
+    // small, so both sides keep running into full and empty, and wrap constantly
+    using Ring = SPSC_Ring_Buffer<uint32_t, 64>;
+    constexpr size_t MAX_BULK{48};
+
+    void produce(Ring &ring, uint32_t items, uint32_t seed)
+    {
+        std::minstd_rand rng{seed};
+        std::array<uint32_t, MAX_BULK> chunk{};
+        uint32_t next{0};
+        while (next < items)
+        {
+            switch (rng() % 4)
+            {
+            case 0:
+                if (ring.enqueue(next))
+                {
+                    ++next;
+                }
+                break;
+            case 1:
+            {
+                const auto count{std::min<size_t>(1 + rng() % MAX_BULK, items - next)};
+                for (size_t ii{0}; ii < count; ++ii)
+                {
+                    chunk[ii] = next + static_cast<uint32_t>(ii);
+                }
+                next += static_cast<uint32_t>(ring.write(std::span<const uint32_t>{chunk}.first(count)));
+                break;
+            }
+            case 2:
+            {
+                // like a DMA channel filling the region in place
+                const auto region{ring.write_region()};
+                const auto count{std::min<size_t>(std::size(region), items - next)};
+                for (size_t ii{0}; ii < count; ++ii)
+                {
+                    region[ii] = next + static_cast<uint32_t>(ii);
+                }
+                ring.commit(count);
+                next += static_cast<uint32_t>(count);
+                break;
+            }
+            default:
+                std::this_thread::yield();
+                break;
+            }
+        }
+    }
+
+    bool consume(Ring &ring, uint32_t items, uint32_t seed)
+    {
+        std::minstd_rand rng{seed};
+        std::array<uint32_t, MAX_BULK> chunk{};
+        uint32_t expected{0};
+        auto &&check{[&](uint32_t value)
+                     {
+                         if (value != expected)
+                         {
+                             std::printf("expected %u, got %u\n", expected, value);
+                             return false;
+                         }
+                         ++expected;
+                         return true;
+                     }};
+        while (expected < items)
+        {
+            switch (rng() % 4)
+            {
+            case 0:
+                if (!ring.empty() && !check(ring.dequeue()))
+                {
+                    return false;
+                }
+                break;
+            case 1:
+            {
+                const auto count{ring.read(std::span<uint32_t>{chunk}.first(1 + rng() % MAX_BULK))};
+                for (size_t ii{0}; ii < count; ++ii)
+                {
+                    if (!check(chunk[ii]))
+                    {
+                        return false;
+                    }
+                }
+                break;
+            }
+            case 2:
+            {
+                const auto region{ring.read_region()};
+                for (const auto value : region)
+                {
+                    if (!check(value))
+                    {
+                        return false;
+                    }
+                }
+                ring.consume(std::size(region));
+                break;
+            }
+            default:
+                std::this_thread::yield();
+                break;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const auto items{static_cast<uint32_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000000UL)};
+    const auto seed{static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1UL)};
+
+    auto ring{std::make_unique<Ring>()};
+    const auto start{std::chrono::steady_clock::now()};
+    std::thread producer{[&]
+                         { produce(*ring, items, seed); }};
+    const bool ok{consume(*ring, items, seed + 1)};
+    producer.join();
+    const std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+
+    std::printf("%u items in %.3f s (%.1f M/s): %s\n", items, elapsed.count(), items / elapsed.count() / 1e6, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+/* The host end of the `stream` upload, for driving the emulated firmware end to end.
+ *
+ *   stream_encode capture [FRAMES] [CORRUPT_EVERY] [raw] > capture.bin
+ *       a shell session: sync, `stream`, FRAMES packets of a test animation, END, then `stats`.  Frames go out
+ *       compressed (frame_codec.hpp, a KEY every KEYFRAME_INTERVAL), or with `raw` as FRAME packets.  With
+ *       CORRUPT_EVERY, every CORRUPT_EVERY'th packet has its CRC damaged, and the one after it is cut short; the
+ *       last frame is always sent clean, and whole (KEY or FRAME), so it doesn't rest on a frame that was lost.
+ *   stream_encode check FRAMES PIO_LOG
+ *       checks that the last frame NEOPIXEL_HOST_PIO_LOG recorded on the wire is the animation's last frame.
+ *
+ *   ./stream_encode capture 2000 100 > capture.bin
+ *   NEOPIXEL_HOST_INPUT=capture.bin NEOPIXEL_HOST_INPUT_RATE=200000 NEOPIXEL_HOST_PIO_LOG=pio.csv \
+ *       ./serial-neopixel-host
+ *   ./stream_encode check 2000 pio.csv
+ */
+#include "app/frame_codec.hpp"
+#include "app/neopixel_output.hpp"
+#include "app/stream_protocol.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    using namespace stream_protocol;
+    using pico_ws2812::WRGB;
+
+    constexpr size_t LED_COUNT{neopixel::LED_COUNT};
+    constexpr size_t KEYFRAME_INTERVAL{30};
+    using Encoder = frame_codec::Stream_Encoder<LED_COUNT>;
+
+    /* a comet over a background that steps brighter every 16 frames; the comet moves every other frame */
+    [[nodiscard]] WRGB animation(uint32_t frame, size_t pixel)
+    {
+        const auto head{(frame / 2) % LED_COUNT};
+        const auto behind{(head + LED_COUNT - pixel) % LED_COUNT};
+        if (behind < 3)
+        {
+            return WRGB{.white{0}, .red{static_cast<uint8_t>(255 >> behind)}, .green{static_cast<uint8_t>(frame)}, .blue{0}};
+        }
+        return WRGB{.white{0}, .red{0}, .green{0}, .blue{static_cast<uint8_t>(frame / 16)}};
+    }
+
+    void write(const void *bytes, size_t count)
+    {
+        std::fwrite(bytes, 1, count, stdout);
+    }
+
+    /* decode `packet`, flip a bit of its CRC, and encode it again; the framing is fine but the CRC no longer is */
+    [[nodiscard]] size_t damage_crc(std::span<const uint8_t> packet, std::span<uint8_t> out)
+    {
+        Cobs_Decoder<HEADER_SIZE + Encoder::MAX_PAYLOAD + CRC_SIZE> decoder;
+        for (const auto byte : packet)
+        {
+            (void)decoder.push(byte);
+        }
+        std::array<uint8_t, HEADER_SIZE + Encoder::MAX_PAYLOAD + CRC_SIZE> damaged{};
+        const auto decoded{decoder.packet()};
+        std::copy(std::begin(decoded), std::end(decoded), std::begin(damaged));
+        damaged[std::size(decoded) - 1] ^= 0x40;
+        const auto size{cobs_encode(std::span<const uint8_t>{damaged}.first(std::size(decoded)), out)};
+        out[size] = 0;
+        return size + 1;
+    }
+
+    int capture(uint32_t frames, uint32_t corrupt_every, bool raw)
+    {
+        // no power limit, so the frames reach the wire exactly as sent
+        constexpr char SHELL_START[]{"\npower 0\nstream\n"};
+        write(SHELL_START, std::strlen(SHELL_START));
+
+        Encoder encoder{KEYFRAME_INTERVAL};
+        uint8_t raw_sequence{0};
+        std::array<uint8_t, LED_COUNT * BYTES_PER_PIXEL> raw_pixels{};
+        const auto encode_raw{[&](std::span<const WRGB> pixels, std::span<uint8_t> out)
+                              {
+                                  for (size_t ii{0}; ii < LED_COUNT; ++ii)
+                                  {
+                                      raw_pixels[ii * BYTES_PER_PIXEL + 0] = pixels[ii].white;
+                                      raw_pixels[ii * BYTES_PER_PIXEL + 1] = pixels[ii].red;
+                                      raw_pixels[ii * BYTES_PER_PIXEL + 2] = pixels[ii].green;
+                                      raw_pixels[ii * BYTES_PER_PIXEL + 3] = pixels[ii].blue;
+                                  }
+                                  return encode_packet<std::size(raw_pixels)>(Packet_Type::FRAME, raw_sequence++, 0, LED_COUNT, raw_pixels, out);
+                              }};
+        std::array<WRGB, LED_COUNT> pixels{};
+        std::array<uint8_t, Encoder::MAX_WIRE_SIZE> wire{};
+        size_t sent{0};
+        for (uint32_t frame{0}; frame < frames; ++frame)
+        {
+            for (size_t ii{0}; ii < LED_COUNT; ++ii)
+            {
+                pixels[ii] = animation(frame, ii);
+            }
+            const bool last{frame + 1 == frames};
+            if (corrupt_every != 0 && last)
+            {
+                encoder.key_next();
+            }
+            auto size{raw ? encode_raw(pixels, wire) : encoder.encode(pixels, wire)};
+            if (corrupt_every != 0 && !last && frame % corrupt_every == corrupt_every - 1)
+            {
+                size = damage_crc(std::span{wire}.first(size), wire);
+            }
+            if (corrupt_every != 0 && !last && frame % corrupt_every == 0 && frame != 0)
+            {
+                wire[size / 2] = 0;
+                size = size / 2 + 1;
+            }
+            write(std::data(wire), size);
+            sent += size;
+        }
+        const auto size{raw ? encode_packet<0>(Packet_Type::END, raw_sequence, 0, 0, {}, wire) : encoder.end(wire)};
+        write(std::data(wire), size);
+
+        constexpr char SHELL_END[]{"stats\n"};
+        write(SHELL_END, std::strlen(SHELL_END));
+        std::fprintf(stderr, "%u frames in %zu bytes, %.1f bytes per frame\n", frames, sent, static_cast<double>(sent) / frames);
+        return EXIT_SUCCESS;
+    }
+
+    int check(uint32_t frames, const char *log_path)
+    {
+        std::FILE *log{std::fopen(log_path, "r")};
+        if (log == nullptr)
+        {
+            std::fprintf(stderr, "can't read %s\n", log_path);
+            return EXIT_FAILURE;
+        }
+        std::vector<uint32_t> words;
+        char line[128];
+        while (std::fgets(line, sizeof(line), log) != nullptr)
+        {
+            double pushed_us{};
+            double on_wire_us{};
+            unsigned pio{};
+            unsigned sm{};
+            unsigned word{};
+            if (std::sscanf(line, "%lf,%lf,%u,%u,0x%X", &pushed_us, &on_wire_us, &pio, &sm, &word) == 5)
+            {
+                words.push_back(word);
+            }
+        }
+        std::fclose(log);
+        if (std::size(words) < LED_COUNT)
+        {
+            std::fprintf(stderr, "no whole frame in %s\n", log_path);
+            return EXIT_FAILURE;
+        }
+
+        const auto first{std::size(words) - LED_COUNT};
+        for (size_t ii{0}; ii < LED_COUNT; ++ii)
+        {
+            const auto expected{neopixel::Pixel_Frame::format::pack(animation(frames - 1, ii))};
+            if (words[first + ii] != expected)
+            {
+                std::fprintf(stderr, "pixel %zu: 0x%08X on the wire, 0x%08X sent\n", ii, words[first + ii], expected);
+                return EXIT_FAILURE;
+            }
+        }
+        std::printf("last frame on the wire matches frame %u\n", frames - 1);
+        return EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 2 && std::strcmp(argv[1], "capture") == 0)
+    {
+        const auto frames{argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1000U};
+        const auto corrupt_every{argc > 3 ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : 0U};
+        const bool raw{argc > 4 && std::strcmp(argv[4], "raw") == 0};
+        return capture(frames == 0 ? 1 : frames, corrupt_every, raw);
+    }
+    if (argc == 4 && std::strcmp(argv[1], "check") == 0)
+    {
+        const auto frames{static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10))};
+        return check(frames == 0 ? 1 : frames, argv[3]);
+    }
+    std::fprintf(stderr, "usage: %s capture [FRAMES] [CORRUPT_EVERY] [raw] | check FRAMES PIO_LOG\n", argv[0]);
+    return EXIT_FAILURE;
+}
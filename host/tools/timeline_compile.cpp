@@ -0,0 +1,356 @@
+/* The host end of timelines (app/timeline.hpp): compiles one from text, plays it offline, and uploads it to the
+ * emulated firmware.
+ *
+ *   timeline_compile compile SOURCE > timeline.bin
+ *       the bytecode alone
+ *   timeline_compile session SOURCE > session.bin
+ *       a shell session for NEOPIXEL_HOST_INPUT: sync, `stream`, the TIMELINE packet, END, then `stats`
+ *   timeline_compile eval SOURCE FRAMES
+ *       every frame's wire words as Player draws them, each checked against evaluate(); fails on a difference
+ *   timeline_compile check SOURCE PIO_LOG
+ *       checks that the last frame NEOPIXEL_HOST_PIO_LOG recorded on the wire is where the timeline ends (so it
+ *       mustn't loop)
+ *   timeline_compile delta-session SOURCE > session.bin
+ *       as session, but with a FRAME before the TIMELINE and, once the timeline has ended (at
+ *       NEOPIXEL_HOST_INPUT_RATE=200000), a DELTA after it.  The timeline has drawn over the frame the DELTA
+ *       would apply to, so the device must refuse it, and `check` still finds the timeline's end on the wire
+ *
+ * The source, a line at a time, # to the end of a line is a comment:
+ *
+ *   fps 50                        frames per second, before the first track; 50 if not given
+ *   loop                          the tracks start again after their last key, rather than stay on it
+ *   track FIRST COUNT             the pixels the keys that follow colour
+ *   key WWRRGGBB FRAMES [EASING]  a colour in hex, frames to the next key, and linear (the default), ease-in,
+ *                                 ease-out, ease-in-out or hold
+ *
+ *   ./timeline_compile session sunrise.txt > session.bin
+ *   NEOPIXEL_HOST_INPUT=session.bin NEOPIXEL_HOST_PIO_LOG=pio.csv NEOPIXEL_HOST_DRAIN_POLLS=20000000 \
+ *       ./serial-neopixel-host
+ *   ./timeline_compile check sunrise.txt pio.csv
+ */
+#include "app/frame_codec.hpp"
+#include "app/neopixel_output.hpp"
+#include "app/pattern_engine.hpp"
+#include "app/stream_protocol.hpp"
+#include "app/timeline.hpp"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    constexpr size_t LED_COUNT{neopixel::LED_COUNT};
+    // the input rate delta-session's pause is measured at
+    constexpr size_t DELTA_SESSION_RATE{200'000};
+    constexpr std::array<std::string_view, 5> EASINGS{"linear", "ease-in", "ease-out", "ease-in-out", "hold"};
+
+    using Timeline_Builder = timeline::Builder<>;
+
+    /* the timeline in `path`, built and validated, or nothing after saying why */
+    [[nodiscard]] std::optional<std::vector<uint8_t>> compile(const char *path)
+    {
+        std::FILE *source{std::fopen(path, "r")};
+        if (source == nullptr)
+        {
+            std::fprintf(stderr, "can't read %s\n", path);
+            return std::nullopt;
+        }
+        unsigned fps{0};
+        bool loops{false};
+        std::optional<Timeline_Builder> builder;
+        std::array<char, 256> line{};
+        const auto fail{[&](size_t number, const char *why)
+                        {
+                            std::fprintf(stderr, "%s:%zu: %s\n", path, number, why);
+                            std::fclose(source);
+                            return std::nullopt;
+                        }};
+        for (size_t number{1}; std::fgets(std::data(line), std::size(line), source) != nullptr; ++number)
+        {
+            std::string text{std::data(line)};
+            text = text.substr(0, text.find('#'));
+            char word[32]{};
+            if (std::sscanf(text.c_str(), "%31s", word) != 1)
+            {
+                continue;
+            }
+            const std::string_view keyword{word};
+            if (keyword == "fps" || keyword == "loop")
+            {
+                if (builder.has_value())
+                {
+                    return fail(number, "fps and loop go before the first track");
+                }
+                if (keyword == "loop")
+                {
+                    loops = true;
+                }
+                else if (std::sscanf(text.c_str(), "%*s %u", &fps) != 1 || fps == 0 || fps > 255)
+                {
+                    return fail(number, "fps needs a rate from 1 to 255");
+                }
+                continue;
+            }
+            if (!builder.has_value())
+            {
+                builder.emplace(static_cast<uint8_t>(fps == 0 ? pattern_engine::DEFAULT_FPS : fps), loops);
+            }
+            if (keyword == "track")
+            {
+                unsigned first{};
+                unsigned count{};
+                if (std::sscanf(text.c_str(), "%*s %u %u", &first, &count) != 2 || count == 0 || first + count > LED_COUNT)
+                {
+                    return fail(number, "track needs a first pixel and a count that fit the strip");
+                }
+                builder->track(static_cast<uint16_t>(first), static_cast<uint16_t>(count));
+            }
+            else if (keyword == "key")
+            {
+                unsigned long colour{};
+                unsigned frames{};
+                char easing_name[32]{"linear"};
+                if (std::sscanf(text.c_str(), "%*s %lx %u %31s", &colour, &frames, easing_name) < 2 || frames == 0 || frames > 65535)
+                {
+                    return fail(number, "key needs a colour and 1 to 65535 frames");
+                }
+                size_t easing{0};
+                while (easing < std::size(EASINGS) && EASINGS[easing] != easing_name)
+                {
+                    ++easing;
+                }
+                if (easing == std::size(EASINGS))
+                {
+                    return fail(number, "easing is one of linear, ease-in, ease-out, ease-in-out or hold");
+                }
+                builder->key(pico_ws2812::WRGB{.white{static_cast<uint8_t>(colour >> 24)},
+                                               .red{static_cast<uint8_t>(colour >> 16)},
+                                               .green{static_cast<uint8_t>(colour >> 8)},
+                                               .blue{static_cast<uint8_t>(colour)}},
+                             static_cast<uint16_t>(frames), static_cast<timeline::Easing>(easing));
+            }
+            else
+            {
+                return fail(number, "expected fps, loop, track or key");
+            }
+            if (builder->overflowed())
+            {
+                return fail(number, "too big: a key before any track, more than 255 keys or tracks, or over timeline::MAX_SIZE bytes");
+            }
+        }
+        std::fclose(source);
+        if (!builder.has_value())
+        {
+            std::fprintf(stderr, "%s: no tracks\n", path);
+            return std::nullopt;
+        }
+        const auto bytes{builder->bytes()};
+        if (const auto status{timeline::validate(bytes, LED_COUNT)}; status != timeline::Status::OK)
+        {
+            const auto why{timeline::describe(status)};
+            std::fprintf(stderr, "%s: %.*s\n", path, static_cast<int>(std::size(why)), std::data(why));
+            return std::nullopt;
+        }
+        return std::vector<uint8_t>(std::begin(bytes), std::end(bytes));
+    }
+
+    void write(const void *bytes, size_t count)
+    {
+        std::fwrite(bytes, 1, count, stdout);
+    }
+
+    int session(const std::vector<uint8_t> &program)
+    {
+        // no power limit, so the frames reach the wire exactly as drawn
+        constexpr char SHELL_START[]{"\npower 0\nstream\n"};
+        write(SHELL_START, std::strlen(SHELL_START));
+        using namespace stream_protocol;
+        std::array<uint8_t, encoded_size(HEADER_SIZE + timeline::MAX_SIZE + CRC_SIZE) + 1> wire{};
+        write(std::data(wire), encode_packet<timeline::MAX_SIZE>(Packet_Type::TIMELINE, 0, 0, 0, program, wire));
+        write(std::data(wire), encode_packet<0>(Packet_Type::END, 1, 0, 0, {}, wire));
+        constexpr char SHELL_END[]{"stats\n"};
+        write(SHELL_END, std::strlen(SHELL_END));
+        std::fprintf(stderr, "%zu byte timeline\n", std::size(program));
+        return EXIT_SUCCESS;
+    }
+
+    /* the frames until the timeline stays where it ends */
+    [[nodiscard]] uint32_t length_of(const std::vector<uint8_t> &program)
+    {
+        std::array<uint32_t, LED_COUNT> end{};
+        timeline::evaluate(program, UINT32_MAX, end);
+        std::array<uint32_t, LED_COUNT> words{};
+        uint32_t frame{0};
+        for (;; ++frame)
+        {
+            timeline::evaluate(program, frame, words);
+            if (words == end)
+            {
+                return frame;
+            }
+        }
+    }
+
+    int delta_session(const std::vector<uint8_t> &program)
+    {
+        if ((program[2] & timeline::LOOP) != 0)
+        {
+            std::fprintf(stderr, "a timeline that loops never ends for the DELTA to follow\n");
+            return EXIT_FAILURE;
+        }
+        constexpr char SHELL_START[]{"\npower 0\nstream\n"};
+        write(SHELL_START, std::strlen(SHELL_START));
+        using namespace stream_protocol;
+        std::array<uint8_t, encoded_size(HEADER_SIZE + timeline::MAX_SIZE + CRC_SIZE) + 1> wire{};
+
+        // a dim blue frame, the reference the DELTA is made against
+        constexpr pico_ws2812::WRGB BACKGROUND{.white{0}, .red{0}, .green{0}, .blue{0x10}};
+        std::array<uint8_t, LED_COUNT * BYTES_PER_PIXEL> pixels{};
+        for (size_t ii{0}; ii < LED_COUNT; ++ii)
+        {
+            pixels[ii * BYTES_PER_PIXEL + 3] = BACKGROUND.blue;
+        }
+        write(std::data(wire), encode_packet<LED_COUNT * BYTES_PER_PIXEL>(Packet_Type::FRAME, 0, 0, LED_COUNT, pixels, wire));
+        write(std::data(wire), encode_packet<timeline::MAX_SIZE>(Packet_Type::TIMELINE, 1, 0, 0, program, wire));
+
+        // empty packets, ignored, until the timeline has ended with a second to spare
+        const auto frames{length_of(program)};
+        const size_t pause{(frames / program[1] + 1) * DELTA_SESSION_RATE};
+        const std::vector<uint8_t> nothing(pause, 0);
+        write(std::data(nothing), std::size(nothing));
+
+        std::array<pico_ws2812::WRGB, LED_COUNT> previous{};
+        previous.fill(BACKGROUND);
+        auto current{previous};
+        current[0].red = 0x20;
+        std::array<uint8_t, frame_codec::max_encoded_size(LED_COUNT)> ops{};
+        const auto ops_size{frame_codec::encode(previous, current, ops)};
+        write(std::data(wire), encode_packet<frame_codec::max_encoded_size(LED_COUNT)>(Packet_Type::DELTA, 2, 0, LED_COUNT, std::span{ops}.first(ops_size), wire));
+        write(std::data(wire), encode_packet<0>(Packet_Type::END, 3, 0, 0, {}, wire));
+        constexpr char SHELL_END[]{"stats\n"};
+        write(SHELL_END, std::strlen(SHELL_END));
+        std::fprintf(stderr, "%zu byte timeline of %u frames, between a FRAME and a DELTA\n", std::size(program), frames);
+        return EXIT_SUCCESS;
+    }
+
+    int eval(const std::vector<uint8_t> &program, uint32_t frames)
+    {
+        auto player{std::make_unique<timeline::Player<LED_COUNT>>()};
+        player->load(program);
+        std::array<uint32_t, LED_COUNT> played{};
+        std::array<uint32_t, LED_COUNT> expected{};
+        for (uint32_t frame{0}; frame < frames; ++frame)
+        {
+            (void)player->advance_to(frame, played);
+            timeline::evaluate(program, frame, expected);
+            std::printf("%6u", frame);
+            for (const auto word : played)
+            {
+                std::printf(" %08X", word);
+            }
+            std::printf("\n");
+            if (played != expected)
+            {
+                std::fprintf(stderr, "frame %u: the player and evaluate() differ\n", frame);
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    int check(const std::vector<uint8_t> &program, const char *log_path)
+    {
+        if ((program[2] & timeline::LOOP) != 0)
+        {
+            std::fprintf(stderr, "a timeline that loops has no end to check\n");
+            return EXIT_FAILURE;
+        }
+        std::FILE *log{std::fopen(log_path, "r")};
+        if (log == nullptr)
+        {
+            std::fprintf(stderr, "can't read %s\n", log_path);
+            return EXIT_FAILURE;
+        }
+        std::vector<uint32_t> words;
+        char line[128];
+        while (std::fgets(line, sizeof(line), log) != nullptr)
+        {
+            double pushed_us{};
+            double on_wire_us{};
+            unsigned pio{};
+            unsigned sm{};
+            unsigned word{};
+            if (std::sscanf(line, "%lf,%lf,%u,%u,0x%X", &pushed_us, &on_wire_us, &pio, &sm, &word) == 5)
+            {
+                words.push_back(word);
+            }
+        }
+        std::fclose(log);
+        if (std::size(words) < LED_COUNT)
+        {
+            std::fprintf(stderr, "no whole frame in %s\n", log_path);
+            return EXIT_FAILURE;
+        }
+
+        // pixels without a track stay black, as the firmware starts
+        std::array<uint32_t, LED_COUNT> end{};
+        timeline::evaluate(program, UINT32_MAX, end);
+        const auto first{std::size(words) - LED_COUNT};
+        for (size_t ii{0}; ii < LED_COUNT; ++ii)
+        {
+            if (words[first + ii] != end[ii])
+            {
+                std::fprintf(stderr, "pixel %zu: 0x%08X on the wire, 0x%08X at the end of the timeline\n", ii, words[first + ii], end[ii]);
+                return EXIT_FAILURE;
+            }
+        }
+        std::printf("last frame on the wire is where the timeline ends\n");
+        return EXIT_SUCCESS;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s compile SOURCE | session SOURCE | delta-session SOURCE | eval SOURCE FRAMES | check SOURCE PIO_LOG\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const auto program{compile(argv[2])};
+    if (!program.has_value())
+    {
+        return EXIT_FAILURE;
+    }
+    const std::string_view mode{argv[1]};
+    if (mode == "compile" && argc == 3)
+    {
+        write(std::data(*program), std::size(*program));
+        std::fprintf(stderr, "%zu bytes\n", std::size(*program));
+        return EXIT_SUCCESS;
+    }
+    if (mode == "session" && argc == 3)
+    {
+        return session(*program);
+    }
+    if (mode == "delta-session" && argc == 3)
+    {
+        return delta_session(*program);
+    }
+    if (mode == "eval" && argc == 4)
+    {
+        return eval(*program, static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)));
+    }
+    if (mode == "check" && argc == 4)
+    {
+        return check(*program, argv[3]);
+    }
+    std::fprintf(stderr, "usage: %s compile SOURCE | session SOURCE | delta-session SOURCE | eval SOURCE FRAMES | check SOURCE PIO_LOG\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,354 @@
+/* Runs the assembled ws2812 program through the PIO simulator for a stream of pixel words, and reports the
+ * pulse widths, frame time and any FIFO starvation against a LED's datasheet limits.
+ *
+ *   ws2812_sim [options] [WORD ...]          WORDs are hex, already packed as the driver pushes them
+ *     --rgb                 24-bit pixels (default: 32-bit WRGB)
+ *     --freq HZ             bit rate handed to ws2812_program_init (default: 800000)
+ *     --sys-hz HZ           system clock (default: 125000000)
+ *     --timing T1,T2,T3     patch the program's delays instead of using the values in ws2812.pio
+ *     --feed-interval-ns N  push one word every N ns, like a CPU loop would (default: DMA, whenever there's room)
+ *     --no-join             4-deep TX FIFO instead of the joined 8
+ *     --spec sk6812|ws2812  datasheet limits to check against (default: sk6812)
+ *     --pixels N            with no WORDs, this many pixels of a test pattern (default: 24)
+ *     --vcd PATH            write the waveform
+ *
+ * Exits non-zero if a pulse is out of spec, the decoded bits differ from the input, or the stream latched early.
+ */
+#include <cstdint>
+
+#define PICO_NO_HARDWARE 1
+#include "ws2812/generated/ws2812.pio.h"
+
+#include "pio_sim/pio_simulator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    struct Spec
+    {
+        const char *name;
+        double t0h_ns, t0l_ns, t1h_ns, t1l_ns, tolerance_ns, reset_ns;
+    };
+
+    constexpr std::array SPECS{
+        Spec{"sk6812", 300, 900, 600, 600, 150, 80000},
+        Spec{"ws2812", 400, 850, 800, 450, 150, 50000},
+    };
+
+    struct Range
+    {
+        double min{std::numeric_limits<double>::max()};
+        double max{0};
+        uint64_t count{0};
+
+        void add(double value) noexcept
+        {
+            min = std::min(min, value);
+            max = std::max(max, value);
+            ++count;
+        }
+        [[nodiscard]] bool within(double nominal, double tolerance) const noexcept
+        {
+            return count == 0 || (min >= nominal - tolerance && max <= nominal + tolerance);
+        }
+    };
+
+    struct Options
+    {
+        bool rgbw{true};
+        double freq{800000};
+        uint32_t sys_hz{125000000};
+        bool patch_timing{false};
+        std::array<uint32_t, 3> timing{ws2812_T1, ws2812_T2, ws2812_T3};
+        uint64_t feed_interval_ns{0};
+        bool join{true};
+        const Spec *spec{&SPECS[0]};
+        size_t pixels{24};
+        const char *vcd_path{nullptr};
+        std::vector<uint32_t> words;
+    };
+
+    [[noreturn]] void usage()
+    {
+        std::fprintf(stderr, "usage: ws2812_sim [--rgb] [--freq HZ] [--sys-hz HZ] [--timing T1,T2,T3] [--feed-interval-ns N]\n"
+                             "                  [--no-join] [--spec sk6812|ws2812] [--pixels N] [--vcd PATH] [WORD ...]\n");
+        std::exit(2);
+    }
+
+    Options parse(int argc, char **argv)
+    {
+        Options opts;
+        for (int ii{1}; ii < argc; ++ii)
+        {
+            const std::string_view arg{argv[ii]};
+            auto &&value{[&]()
+                         {
+                             if (ii + 1 >= argc)
+                             {
+                                 usage();
+                             }
+                             return argv[++ii];
+                         }};
+            if (arg == "--rgb")
+            {
+                opts.rgbw = false;
+            }
+            else if (arg == "--freq")
+            {
+                opts.freq = std::strtod(value(), nullptr);
+            }
+            else if (arg == "--sys-hz")
+            {
+                opts.sys_hz = static_cast<uint32_t>(std::strtoul(value(), nullptr, 10));
+            }
+            else if (arg == "--timing")
+            {
+                opts.patch_timing = true;
+                if (std::sscanf(value(), "%u,%u,%u", &opts.timing[0], &opts.timing[1], &opts.timing[2]) != 3)
+                {
+                    usage();
+                }
+            }
+            else if (arg == "--feed-interval-ns")
+            {
+                opts.feed_interval_ns = std::strtoull(value(), nullptr, 10);
+            }
+            else if (arg == "--no-join")
+            {
+                opts.join = false;
+            }
+            else if (arg == "--spec")
+            {
+                const std::string_view name{value()};
+                const auto itr{std::find_if(std::begin(SPECS), std::end(SPECS), [&](const auto &spec)
+                                            { return name == spec.name; })};
+                if (itr == std::end(SPECS))
+                {
+                    usage();
+                }
+                opts.spec = &*itr;
+            }
+            else if (arg == "--pixels")
+            {
+                opts.pixels = std::strtoul(value(), nullptr, 10);
+            }
+            else if (arg == "--vcd")
+            {
+                opts.vcd_path = value();
+            }
+            else if (!arg.empty() && arg[0] != '-')
+            {
+                opts.words.push_back(static_cast<uint32_t>(std::strtoul(argv[ii], nullptr, 16)));
+            }
+            else
+            {
+                usage();
+            }
+        }
+        if (opts.words.empty())
+        {
+            // every bit position sees both values, and runs of each
+            for (size_t ii{0}; ii < opts.pixels; ++ii)
+            {
+                const uint32_t word{0xFF00A55AU ^ static_cast<uint32_t>(ii * 0x01010101U)};
+                opts.words.push_back(opts.rgbw ? word : word & 0xFFFFFF00U);
+            }
+        }
+        return opts;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const auto opts{parse(argc, argv)};
+    const auto [t1, t2, t3]{opts.timing};
+    if (t1 == 0 || t2 == 0 || t3 == 0 || t1 > 32 || t2 > 32 || t3 > 32)
+    {
+        std::fprintf(stderr, "T1, T2 and T3 must be 1..32 with one side-set bit\n");
+        return 2;
+    }
+
+    // the delay field sits under the side-set bit: 4 bits of it with .side_set 1
+    std::array<uint16_t, std::size(ws2812_program_instructions)> instructions{};
+    std::copy(std::begin(ws2812_program_instructions), std::end(ws2812_program_instructions), std::begin(instructions));
+    if (opts.patch_timing)
+    {
+        const std::array<uint32_t, 4> delays{t3 - 1, t1 - 1, t2 - 1, t2 - 1};
+        for (size_t ii{0}; ii < std::size(instructions); ++ii)
+        {
+            instructions[ii] = static_cast<uint16_t>((instructions[ii] & ~0x0F00U) | ((delays[ii] & 0xFU) << 8U));
+        }
+    }
+
+    // mirror ws2812_program_init(), float arithmetic and all
+    const uint32_t cycles_per_bit{t1 + t2 + t3};
+    const float div{static_cast<float>(opts.sys_hz) / (static_cast<float>(opts.freq) * cycles_per_bit)};
+    pio_sim::Config config{
+        .sideset_base = 0,
+        .out_shift_right = false,
+        .autopull = true,
+        .pull_threshold = opts.rgbw ? 32U : 24U,
+        .join_tx = opts.join,
+    };
+    pio_sim::Config::split_clkdiv(div, config.clkdiv_int, config.clkdiv_frac);
+    const pio_sim::Program program{
+        .instructions = instructions,
+        .wrap_target = ws2812_wrap_target,
+        .wrap = ws2812_wrap,
+        .sideset_bits = 1,
+        .sideset_optional = false,
+    };
+    pio_sim::State_Machine sm{program, config};
+
+    const double ns_per_tick{1e9 / opts.sys_hz};
+    const double divider{config.clkdiv_int + config.clkdiv_frac / 256.0};
+    const double bit_ns{cycles_per_bit * divider * ns_per_tick};
+    const auto feed_ticks{static_cast<uint64_t>(opts.feed_interval_ns / ns_per_tick)};
+
+    // run until everything is fed and shifted, then a reset period of idle low on top
+    size_t fed{0};
+    uint64_t next_feed_tick{0};
+    uint64_t starvation_events{0};
+    uint64_t starved_ticks{0};
+    bool was_starving{false};
+    uint64_t done_tick{0};
+    const auto reset_ticks{static_cast<uint64_t>(opts.spec->reset_ns / ns_per_tick)};
+    const uint64_t tick_limit{static_cast<uint64_t>((std::size(opts.words) * 32 * bit_ns + 1e6 + std::size(opts.words) * opts.feed_interval_ns) / ns_per_tick)};
+    while (sm.ticks() < tick_limit)
+    {
+        if (fed < std::size(opts.words) && !sm.tx_fifo_full() && sm.ticks() >= next_feed_tick)
+        {
+            sm.push(opts.words[fed++]);
+            next_feed_tick = sm.ticks() + feed_ticks;
+        }
+        sm.tick();
+
+        const bool starving{sm.starving()};
+        if (starving && fed < std::size(opts.words))
+        {
+            ++starved_ticks;
+            if (!was_starving)
+            {
+                ++starvation_events;
+            }
+        }
+        was_starving = starving;
+
+        if (starving && fed == std::size(opts.words) && sm.tx_fifo_level() == 0)
+        {
+            if (done_tick == 0)
+            {
+                done_tick = sm.ticks();
+            }
+            if (sm.ticks() - done_tick >= reset_ticks)
+            {
+                break;
+            }
+        }
+    }
+
+    // pulses on the data pin
+    std::vector<uint64_t> rises;
+    std::vector<uint64_t> falls;
+    uint32_t level{0};
+    for (const auto &change : sm.pin_changes())
+    {
+        const uint32_t now{change.pins & 1U};
+        if (now != level)
+        {
+            (now != 0 ? rises : falls).push_back(change.tick);
+        }
+        level = now;
+    }
+
+    const double threshold_ns{(opts.spec->t0h_ns + opts.spec->t1h_ns) / 2};
+    Range t0h, t0l, t1h, t1l;
+    std::vector<uint8_t> decoded;
+    uint64_t early_latches{0};
+    for (size_t ii{0}; ii < std::size(rises) && ii < std::size(falls); ++ii)
+    {
+        const double high{(falls[ii] - rises[ii]) * ns_per_tick};
+        const bool one{high > threshold_ns};
+        decoded.push_back(one ? 1 : 0);
+        (one ? t1h : t0h).add(high);
+        if (ii + 1 < std::size(rises))
+        {
+            const double low{(rises[ii + 1] - falls[ii]) * ns_per_tick};
+            if (low >= opts.spec->reset_ns)
+            {
+                ++early_latches;
+            }
+            (one ? t1l : t0l).add(low);
+        }
+    }
+
+    std::vector<uint8_t> expected;
+    const uint32_t bits_per_word{config.pull_threshold};
+    for (const auto word : opts.words)
+    {
+        for (uint32_t bit{0}; bit < bits_per_word; ++bit)
+        {
+            expected.push_back(static_cast<uint8_t>((word >> (31 - bit)) & 1U));
+        }
+    }
+    const auto mismatch{std::mismatch(std::begin(expected), std::end(expected), std::begin(decoded), std::end(decoded))};
+    const bool bits_match{mismatch.first == std::end(expected) && mismatch.second == std::end(decoded)};
+
+    const double frame_ns{rises.empty() ? 0.0 : (rises.back() - rises.front()) * ns_per_tick + bit_ns};
+    const double period_ns{frame_ns + opts.spec->reset_ns};
+
+    const auto &spec{*opts.spec};
+    const bool t0h_ok{t0h.within(spec.t0h_ns, spec.tolerance_ns)};
+    const bool t0l_ok{t0l.within(spec.t0l_ns, spec.tolerance_ns)};
+    const bool t1h_ok{t1h.within(spec.t1h_ns, spec.tolerance_ns)};
+    const bool t1l_ok{t1l.within(spec.t1l_ns, spec.tolerance_ns)};
+
+    std::printf("program      ws2812, T1=%u T2=%u T3=%u, %u cycles/bit%s\n", t1, t2, t3, cycles_per_bit, opts.patch_timing ? " (patched)" : "");
+    std::printf("clock        %.3f MHz / %.4f (%u + %u/256) -> state machine %.4f MHz, bit %.3f ns\n",
+                opts.sys_hz / 1e6, div, config.clkdiv_int, config.clkdiv_frac, opts.sys_hz / divider / 1e6, bit_ns);
+    std::printf("stream       %zu words x %u bits, %s feed, %u-deep FIFO\n",
+                std::size(opts.words), bits_per_word, opts.feed_interval_ns == 0 ? "DMA" : "interval", opts.join ? 8U : 4U);
+    std::printf("             min ns     max ns     %s spec\n", spec.name);
+    auto &&row{[&](const char *name, const Range &range, double nominal, bool ok)
+               {
+                   if (range.count == 0)
+                   {
+                       std::printf("%-12s -          -          %.0f +/- %.0f\n", name, nominal, spec.tolerance_ns);
+                       return;
+                   }
+                   std::printf("%-12s %-10.1f %-10.1f %.0f +/- %.0f %s\n", name, range.min, range.max, nominal, spec.tolerance_ns, ok ? "ok" : "OUT OF SPEC");
+               }};
+    row("T0H", t0h, spec.t0h_ns, t0h_ok);
+    row("T0L", t0l, spec.t0l_ns, t0l_ok);
+    row("T1H", t1h, spec.t1h_ns, t1h_ok);
+    row("T1L", t1l, spec.t1l_ns, t1l_ok);
+    std::printf("frame        %.3f us on the wire, %.3f us with reset -> %.1f frames/s max\n",
+                frame_ns / 1e3, period_ns / 1e3, period_ns > 0 ? 1e9 / period_ns : 0.0);
+    std::printf("starvation   %llu events, %.3f us stalled mid-stream, %llu early latches\n",
+                static_cast<unsigned long long>(starvation_events), starved_ticks * ns_per_tick / 1e3,
+                static_cast<unsigned long long>(early_latches));
+    std::printf("decode       %zu/%zu bits %s\n", std::size(decoded), std::size(expected), bits_match ? "match" : "DIFFER");
+
+    if (opts.vcd_path != nullptr)
+    {
+        std::FILE *vcd{std::fopen(opts.vcd_path, "w")};
+        if (vcd == nullptr)
+        {
+            std::fprintf(stderr, "unable to write %s\n", opts.vcd_path);
+            return 1;
+        }
+        pio_sim::write_vcd(vcd, sm.pin_changes(), 0, 1, static_cast<uint64_t>(1e12 / opts.sys_hz));
+        std::fclose(vcd);
+    }
+
+    const bool ok{t0h_ok && t0l_ok && t1h_ok && t1l_ok && bits_match && early_latches == 0};
+    return ok ? 0 : 1;
+}
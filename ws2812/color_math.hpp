@@ -0,0 +1,215 @@
+#if !defined(COLOR_MATH_HPP)
+#define COLOR_MATH_HPP
+
+#include <cstdint>
+
+/* Colour arithmetic on a whole packed pixel at once.
+ *
+ * Every function takes pixels as 32-bit words, one channel per byte, and treats the four bytes alike, so it works
+ * on wire words (Wire_Format<WRGB>, or RGB with an empty fourth byte) without unpacking them.  Channels are kept
+ * apart by masking: a product of a channel and a factor of at most 256 fits in 16 bits, so two channels can share
+ * one multiply.  No floating point, no branches; the M0+ has a single-cycle multiplier and no FPU.
+ *
+ * reference:: has the same operations one channel at a time; the packed versions match them bit for bit. */
+namespace pico_ws2812::color_math
+{
+    namespace detail
+    {
+        inline constexpr uint32_t LOW_LANES{0x00FF00FFU};
+        inline constexpr uint32_t LOW_BITS{0x7F7F7F7FU};
+        inline constexpr uint32_t HIGH_BITS{0x80808080U};
+
+        /* 0..255 onto 0..256, so 255 leaves a channel as it is and 0 clears it */
+        [[nodiscard]] constexpr uint32_t weight(uint8_t amount) noexcept
+        {
+            return uint32_t{amount} + (amount >> 7);
+        }
+
+        /* channels 0 and 2 of each word times its weight, the two weights summing to 256 or less */
+        [[nodiscard]] constexpr uint32_t mix_low_lanes(uint32_t a, uint32_t a_weight, uint32_t b, uint32_t b_weight) noexcept
+        {
+            return (((a & LOW_LANES) * a_weight + (b & LOW_LANES) * b_weight) >> 8) & LOW_LANES;
+        }
+        [[nodiscard]] constexpr uint32_t mix_high_lanes(uint32_t a, uint32_t a_weight, uint32_t b, uint32_t b_weight) noexcept
+        {
+            return (((a >> 8) & LOW_LANES) * a_weight + ((b >> 8) & LOW_LANES) * b_weight) & ~LOW_LANES;
+        }
+    }
+
+    /**
+     * @brief a + b in each channel, stopping at 255 rather than wrapping
+     */
+    [[nodiscard]] constexpr uint32_t add_saturating(uint32_t a, uint32_t b) noexcept
+    {
+        using namespace detail;
+        // the low seven bits of each channel, added without reaching the next channel
+        const uint32_t low{(a & LOW_BITS) + (b & LOW_BITS)};
+        const uint32_t sum{low ^ ((a ^ b) & HIGH_BITS)};
+        // a channel overflowed if both top bits were set, or one was and the carry into it cleared it
+        const uint32_t carry{((a & b) | ((a | b) & ~sum)) & HIGH_BITS};
+        return sum | ((carry >> 7) * 0xFFU);
+    }
+
+    /**
+     * @brief each channel times amount / 255, near enough (rounded down, via a factor of 0..256 so there is no
+     *  divide): 255 is the pixel unchanged and 0 clears it
+     */
+    [[nodiscard]] constexpr uint32_t scale(uint32_t pixel, uint8_t amount) noexcept
+    {
+        const uint32_t factor{detail::weight(amount)};
+        return detail::mix_low_lanes(pixel, factor, 0, 0) | detail::mix_high_lanes(pixel, factor, 0, 0);
+    }
+
+    /**
+     * @brief from `from` at 0 to `to` at 255, both ends exact; blending `to` over `from` with `amount` as its alpha
+     */
+    [[nodiscard]] constexpr uint32_t lerp(uint32_t from, uint32_t to, uint8_t amount) noexcept
+    {
+        const uint32_t to_weight{detail::weight(amount)};
+        const uint32_t from_weight{256U - to_weight};
+        return detail::mix_low_lanes(from, from_weight, to, to_weight) | detail::mix_high_lanes(from, from_weight, to, to_weight);
+    }
+
+    /**
+     * @brief darker by `amount`: 0 leaves the pixel as it is, 255 turns it off
+     */
+    [[nodiscard]] constexpr uint32_t fade_to_black(uint32_t pixel, uint8_t amount) noexcept
+    {
+        return scale(pixel, static_cast<uint8_t>(255U - amount));
+    }
+
+    /**
+     * @brief each channel of `a` times the same channel of `b` / 255, near enough, as scale(): a channel of b at
+     *  255 leaves a's as it is.  One multiply per channel: the factors differ, so no two channels can share one
+     */
+    [[nodiscard]] constexpr uint32_t multiply(uint32_t a, uint32_t b) noexcept
+    {
+        uint32_t rv{0};
+        for (unsigned shift{0}; shift < 32; shift += 8)
+        {
+            rv |= ((((a >> shift) & 0xFFU) * detail::weight(static_cast<uint8_t>(b >> shift))) >> 8) << shift;
+        }
+        return rv;
+    }
+
+    /**
+     * @brief the larger of a and b in each channel
+     */
+    [[nodiscard]] constexpr uint32_t maximum(uint32_t a, uint32_t b) noexcept
+    {
+        // two channels to a word in 16-bit lanes: 256 + a - b has bit 8 set exactly when a >= b, and never borrows
+        // from the next lane
+        constexpr uint32_t NINTH_BITS{0x01000100U};
+        const auto larger{[](uint32_t a_lanes, uint32_t b_lanes)
+                          {
+                              const uint32_t a_wins{((((a_lanes | NINTH_BITS) - b_lanes) & NINTH_BITS) >> 8) * 0xFFU};
+                              return b_lanes ^ ((a_lanes ^ b_lanes) & a_wins);
+                          }};
+        return larger(a & detail::LOW_LANES, b & detail::LOW_LANES) |
+               (larger((a >> 8) & detail::LOW_LANES, (b >> 8) & detail::LOW_LANES) << 8);
+    }
+
+    /* The same operations a channel at a time, for checking the packed ones against and for timing them by */
+    namespace reference
+    {
+        [[nodiscard]] constexpr uint8_t add_saturating(uint8_t a, uint8_t b) noexcept
+        {
+            const unsigned sum{unsigned{a} + b};
+            return static_cast<uint8_t>(sum > 255 ? 255 : sum);
+        }
+        [[nodiscard]] constexpr uint8_t scale(uint8_t channel, uint8_t amount) noexcept
+        {
+            return static_cast<uint8_t>(channel * detail::weight(amount) / 256);
+        }
+        [[nodiscard]] constexpr uint8_t lerp(uint8_t from, uint8_t to, uint8_t amount) noexcept
+        {
+            const unsigned to_weight{detail::weight(amount)};
+            return static_cast<uint8_t>((from * (256 - to_weight) + to * to_weight) / 256);
+        }
+        [[nodiscard]] constexpr uint8_t fade_to_black(uint8_t channel, uint8_t amount) noexcept
+        {
+            return scale(channel, static_cast<uint8_t>(255U - amount));
+        }
+        [[nodiscard]] constexpr uint8_t multiply(uint8_t a, uint8_t b) noexcept
+        {
+            return scale(a, b);
+        }
+        [[nodiscard]] constexpr uint8_t maximum(uint8_t a, uint8_t b) noexcept
+        {
+            return a > b ? a : b;
+        }
+
+        /* op applied to each byte of the words in turn */
+        template <class Op>
+        [[nodiscard]] constexpr uint32_t per_channel(Op &&op, uint32_t a, auto... rest) noexcept
+        {
+            uint32_t rv{0};
+            for (unsigned shift{0}; shift < 32; shift += 8)
+            {
+                const auto channel{op(static_cast<uint8_t>(a >> shift), rest...)};
+                rv |= uint32_t{channel} << shift;
+            }
+            return rv;
+        }
+        template <class Op>
+        [[nodiscard]] constexpr uint32_t per_channel_pair(Op &&op, uint32_t a, uint32_t b, auto... rest) noexcept
+        {
+            uint32_t rv{0};
+            for (unsigned shift{0}; shift < 32; shift += 8)
+            {
+                const auto channel{op(static_cast<uint8_t>(a >> shift), static_cast<uint8_t>(b >> shift), rest...)};
+                rv |= uint32_t{channel} << shift;
+            }
+            return rv;
+        }
+    }
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_color_math_tests()
+    {
+        using namespace pico_ws2812::color_math;
+        namespace ref = pico_ws2812::color_math::reference;
+        bool rv{true};
+
+        // =========================================
+        // the ends of each range
+        rv &= add_saturating(0x01FF807FU, 0x01018080U) == 0x02FFFFFFU;
+        rv &= add_saturating(0x00000000U, 0xFFFFFFFFU) == 0xFFFFFFFFU;
+        rv &= scale(0x12345678U, 255) == 0x12345678U;
+        rv &= scale(0xFFFFFFFFU, 0) == 0;
+        rv &= scale(0xFF80FF80U, 127) == 0x7E3F7E3FU;
+        rv &= lerp(0x00FF00FFU, 0xFF00FF00U, 0) == 0x00FF00FFU;
+        rv &= lerp(0x00FF00FFU, 0xFF00FF00U, 255) == 0xFF00FF00U;
+        rv &= fade_to_black(0xFFFFFFFFU, 0) == 0xFFFFFFFFU;
+        rv &= fade_to_black(0xFFFFFFFFU, 255) == 0;
+        rv &= multiply(0x12345678U, 0xFFFFFFFFU) == 0x12345678U;
+        rv &= multiply(0x12345678U, 0xFF00FF00U) == 0x12005600U;
+        rv &= maximum(0x00FF7F80U, 0xFF0080FFU) == 0xFFFF80FFU;
+        rv &= maximum(0x12345678U, 0x12345678U) == 0x12345678U;
+
+        // =========================================
+        // against the reference, four different channels per word; host/bench/color_math_bench checks every value
+        uint32_t lcg{1};
+        for (int ii{0}; ii < 64; ++ii)
+        {
+            lcg = lcg * 1664525U + 1013904223U;
+            const uint32_t a{lcg};
+            lcg = lcg * 1664525U + 1013904223U;
+            const uint32_t b{lcg};
+            const auto amount{static_cast<uint8_t>(lcg >> 13)};
+            rv &= add_saturating(a, b) == ref::per_channel_pair(ref::add_saturating, a, b);
+            rv &= scale(a, amount) == ref::per_channel(ref::scale, a, amount);
+            rv &= lerp(a, b, amount) == ref::per_channel_pair(ref::lerp, a, b, amount);
+            rv &= fade_to_black(a, amount) == ref::per_channel(ref::fade_to_black, a, amount);
+            rv &= multiply(a, b) == ref::per_channel_pair(ref::multiply, a, b);
+            rv &= maximum(a, b) == ref::per_channel_pair(ref::maximum, a, b);
+        }
+
+        return rv;
+    }
+    static_assert(run_color_math_tests());
+}
+
+#endif
@@ -0,0 +1,165 @@
+#if !defined(COLOR_SPACE_HPP)
+#define COLOR_SPACE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "color_math.hpp"
+#include "wire_frame.hpp"
+
+/* Hue based colours to pixels, in integers.
+ *
+ * HSV and HSL both come down to the same shape: within each sixth of the hue circle one channel sits at a high
+ * level, one at a low level, and one ramps between them.  Which channel does what is a table lookup on the
+ * sixth, so there is no branch per sector, and the ramp is one multiply.
+ *
+ * An RGBW strip can show the part of a colour all three of R, G and B share on its white LED instead; for HSV that
+ * part is exactly the low level, so hsv_to_wrgb() hands it to white as it goes. */
+namespace pico_ws2812
+{
+    /* hue as a whole turn in 65536ths, so a sweep is a plain add that wraps: 0 red, 21845 green, 43690 blue */
+    struct HSV
+    {
+        uint16_t hue;
+        uint8_t saturation;
+        uint8_t value;
+    };
+
+    struct HSL
+    {
+        uint16_t hue;
+        uint8_t saturation;
+        uint8_t lightness;
+    };
+
+    namespace detail
+    {
+        enum Hue_Level : uint8_t
+        {
+            HIGH,
+            LOW,
+            RISING,
+            FALLING
+        };
+        // red, green and blue in each sixth of the circle, starting at red
+        inline constexpr std::array<std::array<uint8_t, 3>, 6> SECTOR_LEVELS{{{HIGH, RISING, LOW},
+                                                                              {FALLING, HIGH, LOW},
+                                                                              {LOW, HIGH, RISING},
+                                                                              {LOW, FALLING, HIGH},
+                                                                              {RISING, LOW, HIGH},
+                                                                              {HIGH, LOW, FALLING}}};
+
+        /* a * b / 255, near enough */
+        [[nodiscard]] constexpr uint32_t mul8(uint32_t a, uint8_t b) noexcept
+        {
+            return (a * color_math::detail::weight(b) + 128) >> 8;
+        }
+
+        /* the pixel of `hue` between `low` and `high`, as red, green and blue in a wire word's bytes */
+        [[nodiscard]] constexpr uint32_t hue_ramp(uint16_t hue, uint32_t low, uint32_t high) noexcept
+        {
+            const uint32_t sixths{hue * 6U};
+            const auto &levels_of{SECTOR_LEVELS[sixths >> 16]};
+            const uint32_t ramp{mul8(high - low, static_cast<uint8_t>(sixths >> 8))};
+            const std::array<uint32_t, 4> levels{high, low, low + ramp, high - ramp};
+            return Wire_Format<WRGB>::pack(WRGB{.white{0},
+                                                .red{static_cast<uint8_t>(levels[levels_of[0]])},
+                                                .green{static_cast<uint8_t>(levels[levels_of[1]])},
+                                                .blue{static_cast<uint8_t>(levels[levels_of[2]])}});
+        }
+    }
+
+    /* as red, green and blue, with white off */
+    [[nodiscard]] constexpr WRGB hsv_to_rgb(HSV colour) noexcept
+    {
+        const uint32_t low{colour.value - detail::mul8(colour.value, colour.saturation)};
+        return Wire_Format<WRGB>::unpack(detail::hue_ramp(colour.hue, low, colour.value));
+    }
+
+    [[nodiscard]] constexpr WRGB hsl_to_rgb(HSL colour) noexcept
+    {
+        // the chroma, 1 - |2L - 1| of the way out, and the lightness halfway between the ends
+        const int from_middle{2 * colour.lightness - 255};
+        const auto chroma{detail::mul8(static_cast<uint32_t>(255 - (from_middle < 0 ? -from_middle : from_middle)), colour.saturation)};
+        const uint32_t low{colour.lightness - chroma / 2};
+        return Wire_Format<WRGB>::unpack(detail::hue_ramp(colour.hue, low, low + chroma));
+    }
+
+    /* the part red, green and blue have in common, moved onto white (added to what it had, up to 255) */
+    [[nodiscard]] constexpr WRGB extract_white(WRGB pixel) noexcept
+    {
+        const uint8_t common{std::min({pixel.red, pixel.green, pixel.blue})};
+        return WRGB{.white{color_math::reference::add_saturating(pixel.white, common)},
+                    .red{static_cast<uint8_t>(pixel.red - common)},
+                    .green{static_cast<uint8_t>(pixel.green - common)},
+                    .blue{static_cast<uint8_t>(pixel.blue - common)}};
+    }
+
+    /* extract_white(hsv_to_rgb(colour)), as a wire word, for the price of hsv_to_rgb(): the low level is white */
+    [[nodiscard]] constexpr uint32_t hsv_to_wrgb(HSV colour) noexcept
+    {
+        const uint32_t low{colour.value - detail::mul8(colour.value, colour.saturation)};
+        return detail::hue_ramp(colour.hue, 0, colour.value - low) | low;
+    }
+
+    /* a span of colours into wire words, as many as both have room for */
+    constexpr void hsv_to_wrgb(std::span<const HSV> colours, std::span<uint32_t> words) noexcept
+    {
+        const size_t count{std::min(std::size(colours), std::size(words))};
+        for (size_t ii{0}; ii < count; ++ii)
+        {
+            words[ii] = hsv_to_wrgb(colours[ii]);
+        }
+    }
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_color_space_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+        const auto same{[](WRGB a, WRGB b)
+                        { return a.white == b.white && a.red == b.red && a.green == b.green && a.blue == b.blue; }};
+
+        // =========================================
+        // the primaries and secondaries, at the start of each sixth
+        rv &= same(hsv_to_rgb(HSV{.hue = 0, .saturation = 255, .value = 255}), WRGB{.white{0}, .red{255}, .green{0}, .blue{0}});
+        rv &= same(hsv_to_rgb(HSV{.hue = 10923, .saturation = 255, .value = 255}), WRGB{.white{0}, .red{255}, .green{255}, .blue{0}});
+        rv &= same(hsv_to_rgb(HSV{.hue = 21846, .saturation = 255, .value = 255}), WRGB{.white{0}, .red{0}, .green{255}, .blue{0}});
+        rv &= same(hsv_to_rgb(HSV{.hue = 43691, .saturation = 255, .value = 200}), WRGB{.white{0}, .red{0}, .green{0}, .blue{200}});
+        // halfway from red to yellow, and no saturation at all
+        rv &= same(hsv_to_rgb(HSV{.hue = 5461, .saturation = 255, .value = 255}), WRGB{.white{0}, .red{255}, .green{127}, .blue{0}});
+        rv &= same(hsv_to_rgb(HSV{.hue = 30000, .saturation = 0, .value = 99}), WRGB{.white{0}, .red{99}, .green{99}, .blue{99}});
+        // the circle closes: just short of a whole turn is red again
+        rv &= same(hsv_to_rgb(HSV{.hue = 65535, .saturation = 255, .value = 255}), WRGB{.white{0}, .red{255}, .green{0}, .blue{0}});
+
+        // =========================================
+        // HSL: full saturation at half lightness is the hue at full (128 is a shade over half); the ends are black and white
+        rv &= same(hsl_to_rgb(HSL{.hue = 21846, .saturation = 255, .lightness = 128}), WRGB{.white{0}, .red{1}, .green{255}, .blue{1}});
+        rv &= same(hsl_to_rgb(HSL{.hue = 21846, .saturation = 255, .lightness = 0}), WRGB{.white{0}, .red{0}, .green{0}, .blue{0}});
+        rv &= same(hsl_to_rgb(HSL{.hue = 21846, .saturation = 255, .lightness = 255}), WRGB{.white{0}, .red{255}, .green{255}, .blue{255}});
+
+        // =========================================
+        // white extraction
+        rv &= same(extract_white(WRGB{.white{250}, .red{40}, .green{30}, .blue{90}}), WRGB{.white{255}, .red{10}, .green{0}, .blue{60}});
+
+        // the fused kernel is the two steps, bit for bit, around the circle
+        for (uint32_t hue{0}; hue < 65536; hue += 97)
+        {
+            for (uint32_t sv{0}; sv < 256; sv += 51)
+            {
+                const HSV colour{.hue = static_cast<uint16_t>(hue), .saturation = static_cast<uint8_t>(sv), .value = static_cast<uint8_t>(255 - sv / 2)};
+                rv &= hsv_to_wrgb(colour) == Wire_Format<WRGB>::pack(extract_white(hsv_to_rgb(colour)));
+            }
+        }
+
+        return rv;
+    }
+    static_assert(run_color_space_tests());
+}
+
+#endif
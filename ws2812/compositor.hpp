@@ -0,0 +1,372 @@
+#if !defined(COMPOSITOR_HPP)
+#define COMPOSITOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "color_math.hpp"
+
+/* Layers of wire words, stacked into one frame.
+ *
+ * Each layer is a whole strip's worth of pixels with an opacity, a blend mode, and optionally a mask giving every
+ * pixel an opacity of its own on top of the layer's.  flatten() stacks them bottom up into a frame in one pass
+ * along the strip, a block of pixels at a time: every layer is blended into the block before moving on to the
+ * next, so the frame is written once however many layers there are, and the blend mode is picked once a layer a
+ * block rather than once a pixel.
+ *
+ * Work is skipped where it can't show: a layer at opacity 0 is left out, and everything under the topmost layer
+ * that covers the strip (normal, fully opaque, no mask) is too.  The layers under the lowest one that changed are
+ * kept stacked from the last flatten(), so a still background under a moving foreground costs one read a pixel,
+ * and a flatten() with nothing changed costs nothing. */
+namespace pico_ws2812
+{
+    enum struct Blend : uint8_t
+    {
+        NORMAL,   // drawn over what's below
+        ADD,      // added to what's below, saturating
+        MULTIPLY, // what's below, darkened channel by channel
+        MAX       // the brighter of the two in each channel
+    };
+
+    /* `above` blended onto `below`, `alpha` of the way in */
+    [[nodiscard]] constexpr uint32_t blend(Blend mode, uint32_t below, uint32_t above, uint8_t alpha) noexcept
+    {
+        using namespace color_math;
+        switch (mode)
+        {
+        case Blend::ADD:
+            return add_saturating(below, scale(above, alpha));
+        case Blend::MULTIPLY:
+            return lerp(below, multiply(below, above), alpha);
+        case Blend::MAX:
+            return lerp(below, maximum(below, above), alpha);
+        case Blend::NORMAL:
+        default:
+            return lerp(below, above, alpha);
+        }
+    }
+
+    /* One layer: its pixels and how they're blended.  Everything that could change how it looks marks it changed,
+     * including taking its words() to write to. */
+    template <size_t N>
+    class Layer
+    {
+    public:
+        [[nodiscard]] constexpr std::span<uint32_t, N> words() noexcept
+        {
+            m_changed = true;
+            return m_words;
+        }
+        [[nodiscard]] constexpr std::span<const uint32_t, N> words() const noexcept
+        {
+            return m_words;
+        }
+        constexpr void set(size_t index, uint32_t word) noexcept
+        {
+            m_words[index] = word;
+            m_changed = true;
+        }
+        constexpr void fill(uint32_t word) noexcept
+        {
+            m_words.fill(word);
+            m_changed = true;
+        }
+
+        constexpr void set_opacity(uint8_t opacity) noexcept
+        {
+            m_changed |= opacity != m_opacity;
+            m_opacity = opacity;
+        }
+        [[nodiscard]] constexpr uint8_t opacity() const noexcept
+        {
+            return m_opacity;
+        }
+        constexpr void set_blend(Blend mode) noexcept
+        {
+            m_changed |= mode != m_blend;
+            m_blend = mode;
+        }
+        [[nodiscard]] constexpr Blend blend() const noexcept
+        {
+            return m_blend;
+        }
+
+        /* the mask, each pixel's opacity out of 255, to write to; taking it turns it on */
+        [[nodiscard]] constexpr std::span<uint8_t, N> mask() noexcept
+        {
+            m_masked = true;
+            m_changed = true;
+            return m_mask;
+        }
+        [[nodiscard]] constexpr std::span<const uint8_t, N> mask() const noexcept
+        {
+            return m_mask;
+        }
+        constexpr void clear_mask() noexcept
+        {
+            m_changed |= m_masked;
+            m_masked = false;
+        }
+        [[nodiscard]] constexpr bool masked() const noexcept
+        {
+            return m_masked;
+        }
+
+        /* hides everything under it */
+        [[nodiscard]] constexpr bool covers() const noexcept
+        {
+            return m_opacity == 255 && m_blend == Blend::NORMAL && !m_masked;
+        }
+        [[nodiscard]] constexpr bool changed() const noexcept
+        {
+            return m_changed;
+        }
+        constexpr void mark_unchanged() noexcept
+        {
+            m_changed = false;
+        }
+
+    private:
+        std::array<uint32_t, N> m_words{};
+        std::array<uint8_t, N> m_mask{};
+        uint8_t m_opacity{255};
+        Blend m_blend{Blend::NORMAL};
+        bool m_masked{false};
+        bool m_changed{true};
+    };
+
+    /* LAYERS layers of N pixels, layer 0 at the bottom, over black */
+    template <size_t N, size_t LAYERS>
+    class Compositor
+    {
+    public:
+        static_assert(LAYERS > 0);
+
+        [[nodiscard]] constexpr Layer<N> &layer(size_t index) noexcept
+        {
+            return m_layers[index];
+        }
+        [[nodiscard]] constexpr const Layer<N> &layer(size_t index) const noexcept
+        {
+            return m_layers[index];
+        }
+
+        /**
+         * @brief stack the layers into `out`, if any of them changed since the last time; false, leaving `out` as
+         *  it is, if none did.  So `out` should be the frame last flattened into, or a copy of it (a back buffer
+         *  kept with Back_Buffer::PRESERVE is).
+         */
+        constexpr bool flatten(std::span<uint32_t, N> out) noexcept
+        {
+            size_t lowest_changed{LAYERS};
+            size_t first{0};
+            for (size_t ii{0}; ii < LAYERS; ++ii)
+            {
+                if (m_layers[ii].changed() && lowest_changed == LAYERS)
+                {
+                    lowest_changed = ii;
+                }
+                if (m_layers[ii].covers())
+                {
+                    first = ii;
+                }
+            }
+            if (lowest_changed == LAYERS)
+            {
+                return false;
+            }
+
+            // start from black under the covering layer, or from the stack kept last time if that's higher and
+            // nothing in it has changed; keep the stack up to the lowest changed layer for next time, if that's
+            // more than was kept.  Black under the covering layer is no stack of the layers under it, so it is
+            // only kept once the covering layer is in it
+            const bool from_kept{m_kept_layers > first && m_kept_layers <= lowest_changed};
+            const size_t begin{from_kept ? m_kept_layers : first};
+            const size_t split{lowest_changed > begin ? lowest_changed : begin};
+            const bool keep{split > begin};
+
+            std::array<uint8_t, LAYERS> visible{};
+            size_t kept_count{0};
+            size_t count{0};
+            for (size_t ii{begin}; ii < LAYERS; ++ii)
+            {
+                if (m_layers[ii].opacity() != 0)
+                {
+                    visible[count++] = static_cast<uint8_t>(ii);
+                    kept_count += ii < split;
+                }
+            }
+
+            for (size_t start{0}; start < N; start += BLOCK)
+            {
+                const size_t length{N - start < BLOCK ? N - start : BLOCK};
+                const std::span<uint32_t> block{std::span{m_block}.first(length)};
+                if (from_kept)
+                {
+                    std::ranges::copy(std::span{m_kept}.subspan(start, length), block.begin());
+                }
+                else
+                {
+                    std::ranges::fill(block, 0U);
+                }
+                for (size_t ii{0}; ii < count; ++ii)
+                {
+                    if (ii == kept_count && keep)
+                    {
+                        std::ranges::copy(block, m_kept.begin() + start);
+                    }
+                    apply(m_layers[visible[ii]], start, block);
+                }
+                if (kept_count == count && keep)
+                {
+                    std::ranges::copy(block, m_kept.begin() + start);
+                }
+                std::ranges::copy(block, out.begin() + start);
+            }
+
+            m_kept_layers = keep ? split : (from_kept ? m_kept_layers : 0);
+            for (auto &layer : m_layers)
+            {
+                layer.mark_unchanged();
+            }
+            return true;
+        }
+
+    private:
+        /* `layer` from `start` on, blended onto `block`: the mode and the mask are settled once a block, leaving
+         * a loop of the packed operations */
+        static constexpr void apply(const Layer<N> &layer, size_t start, std::span<uint32_t> block) noexcept
+        {
+            switch (layer.blend())
+            {
+            case Blend::ADD:
+                return apply(layer, start, block, [](uint32_t below, uint32_t above, uint8_t alpha)
+                             { return blend(Blend::ADD, below, above, alpha); });
+            case Blend::MULTIPLY:
+                return apply(layer, start, block, [](uint32_t below, uint32_t above, uint8_t alpha)
+                             { return blend(Blend::MULTIPLY, below, above, alpha); });
+            case Blend::MAX:
+                return apply(layer, start, block, [](uint32_t below, uint32_t above, uint8_t alpha)
+                             { return blend(Blend::MAX, below, above, alpha); });
+            case Blend::NORMAL:
+            default:
+                return apply(layer, start, block, [](uint32_t below, uint32_t above, uint8_t alpha)
+                             { return blend(Blend::NORMAL, below, above, alpha); });
+            }
+        }
+        template <class Blend_Fn>
+        static constexpr void apply(const Layer<N> &layer, size_t start, std::span<uint32_t> block, Blend_Fn &&blend_fn) noexcept
+        {
+            const auto above{layer.words().subspan(start, block.size())};
+            if (!layer.masked())
+            {
+                for (size_t ii{0}; ii < block.size(); ++ii)
+                {
+                    block[ii] = blend_fn(block[ii], above[ii], layer.opacity());
+                }
+                return;
+            }
+            const auto mask{layer.mask().subspan(start, block.size())};
+            const uint32_t opacity{color_math::detail::weight(layer.opacity())};
+            for (size_t ii{0}; ii < block.size(); ++ii)
+            {
+                block[ii] = blend_fn(block[ii], above[ii], static_cast<uint8_t>(mask[ii] * opacity >> 8));
+            }
+        }
+
+        // pixels are stacked a block at a time, small enough to stay in the cache (or registers) while every layer
+        // goes over it
+        static constexpr size_t BLOCK{32};
+
+        std::array<Layer<N>, LAYERS> m_layers{};
+        // what layers [0, m_kept_layers) stack up to
+        std::array<uint32_t, N> m_kept{};
+        size_t m_kept_layers{0};
+        std::array<uint32_t, BLOCK> m_block{};
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_compositor_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        // =========================================
+        // each blend mode, fully in and halfway
+        rv &= blend(Blend::NORMAL, 0x10203040U, 0x50607080U, 255) == 0x50607080U;
+        rv &= blend(Blend::NORMAL, 0x10203040U, 0x50607080U, 0) == 0x10203040U;
+        rv &= blend(Blend::ADD, 0x10F03040U, 0x10207080U, 255) == 0x20FFA0C0U;
+        rv &= blend(Blend::ADD, 0x10203040U, 0x80808080U, 128) == 0x50607080U;
+        rv &= blend(Blend::MULTIPLY, 0x80FF4000U, 0xFF80FFFFU, 255) == 0x80804000U;
+        rv &= blend(Blend::MAX, 0x10F03040U, 0x50207080U, 255) == 0x50F07080U;
+        rv &= blend(Blend::MAX, 0x00000000U, 0xFEFEFEFEU, 128) == 0x7F7F7F7FU;
+
+        Compositor<4, 3> dut;
+        std::array<uint32_t, 4> out{};
+
+        // =========================================
+        // a background, something added over half of it, and a masked layer on top
+        dut.layer(0).fill(0x10101010U);
+        dut.layer(1).set_blend(Blend::ADD);
+        dut.layer(1).set(2, 0x01020304U);
+        dut.layer(1).set(3, 0x01020304U);
+        dut.layer(2).fill(0xFF000000U);
+        dut.layer(2).mask()[3] = 255;
+        rv &= dut.flatten(out);
+        rv &= out == std::array<uint32_t, 4>{0x10101010U, 0x10101010U, 0x11121314U, 0xFF000000U};
+
+        // nothing changed, nothing to do
+        out.fill(0);
+        rv &= !dut.flatten(out);
+        rv &= out[0] == 0;
+
+        // =========================================
+        // only the top changed: the kept stack underneath is the same as stacking again
+        dut.layer(2).mask()[0] = 255;
+        rv &= dut.flatten(out);
+        rv &= out == std::array<uint32_t, 4>{0xFF000000U, 0x10101010U, 0x11121314U, 0xFF000000U};
+        dut.layer(2).set_opacity(0);
+        rv &= dut.flatten(out);
+        rv &= out == std::array<uint32_t, 4>{0x10101010U, 0x10101010U, 0x11121314U, 0x11121314U};
+        // setting what's already there isn't a change
+        dut.layer(2).set_opacity(0);
+        rv &= !dut.flatten(out);
+
+        // =========================================
+        // a layer that covers everything hides the ones under it, however they change
+        dut.layer(1).set_blend(Blend::NORMAL);
+        dut.layer(1).fill(0x00AA00AAU);
+        rv &= dut.flatten(out);
+        rv &= out == std::array<uint32_t, 4>{0x00AA00AAU, 0x00AA00AAU, 0x00AA00AAU, 0x00AA00AAU};
+        dut.layer(0).fill(0x12345678U);
+        rv &= dut.flatten(out);
+        rv &= out[1] == 0x00AA00AAU;
+
+        // and stops hiding them when it's see-through again
+        dut.layer(1).set_opacity(0);
+        rv &= dut.flatten(out);
+        rv &= out == std::array<uint32_t, 4>{0x12345678U, 0x12345678U, 0x12345678U, 0x12345678U};
+
+        // =========================================
+        // a mask is scaled by the layer's opacity
+        dut.layer(2).clear_mask();
+        std::ranges::fill(dut.layer(2).mask(), 128);
+        dut.layer(2).fill(0);
+        dut.layer(2).set_opacity(255);
+        rv &= dut.flatten(out);
+        rv &= out[0] == color_math::lerp(0x12345678U, 0, 128);
+        dut.layer(2).set_opacity(128);
+        rv &= dut.flatten(out);
+        rv &= out[0] == color_math::lerp(0x12345678U, 0, 64);
+
+        return rv;
+    }
+    static_assert(run_compositor_tests());
+}
+
+#endif
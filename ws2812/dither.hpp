@@ -0,0 +1,202 @@
+#if !defined(DITHER_HPP)
+#define DITHER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "wire_frame.hpp"
+
+namespace pico_ws2812
+{
+    /* a WRGB pixel with 16 bits a channel: 65535 is the 8-bit 255 */
+    struct WRGB16
+    {
+        uint16_t white;
+        uint16_t red;
+        uint16_t green;
+        uint16_t blue;
+    };
+
+    /* A frame drawn at 16 bits a channel and sent at 8, with the part that doesn't fit carried to the next frame.
+     *
+     * Each channel is kept as 8.8 fixed point, 0 to 255.0, next to the fraction it still owes.  quantize() adds
+     * the two, sends the whole part and keeps the fraction, so over successive frames each LED's average is its
+     * 16-bit value, and a channel at 4.5 shows 4, 5, 4, 5, ... rather than 4.  Called at the rate the strip
+     * refreshes, the flicker is far too quick to see.
+     *
+     * A pixel is two words, each with two channels in 16-bit lanes, placed so the whole parts line up with the
+     * bytes of the wire word: one of them with bytes 1 and 3, the other, shifted down 8, with bytes 0 and 2.
+     * 255.0 plus a fraction still fits its lane, so the four channels take two adds and no carries between them. */
+    template <size_t N>
+    class Dithered_Frame
+    {
+    public:
+        using format = Wire_Format<WRGB>;
+
+        /* Each LED starts part way through its cycle, so a fade doesn't step every LED on the same frame; a seed of 0
+         * starts them all at no fraction. */
+        constexpr explicit Dithered_Frame(uint32_t seed = 0x2545F491U) noexcept
+        {
+            uint32_t lcg{seed};
+            for (auto &error : m_errors)
+            {
+                lcg = lcg * 1664525U + 1013904223U;
+                error = seed == 0 ? 0 : (lcg >> 8) & FRACTIONS;
+            }
+        }
+
+        constexpr void set(size_t index, WRGB16 pixel) noexcept
+        {
+            m_values[2 * index] = lanes_of(pixel, 1);
+            m_values[2 * index + 1] = lanes_of(pixel, 0);
+        }
+        constexpr void fill(WRGB16 pixel) noexcept
+        {
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                set(ii, pixel);
+            }
+        }
+
+        /* the next 8-bit frame, as wire words */
+        constexpr void quantize(std::span<uint32_t, N> out) noexcept
+        {
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                const uint32_t odd{m_values[2 * ii] + m_errors[2 * ii]};
+                const uint32_t even{m_values[2 * ii + 1] + m_errors[2 * ii + 1]};
+                m_errors[2 * ii] = odd & FRACTIONS;
+                m_errors[2 * ii + 1] = even & FRACTIONS;
+                out[ii] = (odd & ~FRACTIONS) | ((even >> 8) & FRACTIONS);
+            }
+        }
+
+        /* the stored channels, two words a pixel; for copying a frame across a word at a time */
+        [[nodiscard]] constexpr std::span<const uint32_t, 2 * N> values() const noexcept
+        {
+            return m_values;
+        }
+        [[nodiscard]] constexpr std::span<uint32_t, 2 * N> values() noexcept
+        {
+            return m_values;
+        }
+
+        [[nodiscard]] static constexpr size_t size() noexcept
+        {
+            return N;
+        }
+
+    private:
+        static constexpr uint32_t FRACTIONS{0x00FF00FFU};
+
+        std::array<uint32_t, 2 * N> m_values{};
+        std::array<uint32_t, 2 * N> m_errors{};
+
+        /* 0..65535 onto 0..255.0 in 8.8, near enough: x - x / 256 */
+        [[nodiscard]] static constexpr uint32_t fixed_of(uint16_t channel) noexcept
+        {
+            return channel - (channel >> 8);
+        }
+
+        /* the channels that go out in wire bytes `byte` and `byte` + 2, in the low and high lanes */
+        [[nodiscard]] static constexpr uint32_t lanes_of(WRGB16 pixel, unsigned byte) noexcept
+        {
+            const auto channel_at{[&](unsigned wire_byte) -> uint16_t
+                                  {
+                                      // where Wire_Format<WRGB> puts each channel
+                                      switch (wire_byte)
+                                      {
+                                      case 0:
+                                          return pixel.white;
+                                      case 1:
+                                          return pixel.blue;
+                                      case 2:
+                                          return pixel.red;
+                                      default:
+                                          return pixel.green;
+                                      }
+                                  }};
+            return fixed_of(channel_at(byte)) | (fixed_of(channel_at(byte + 2)) << 16);
+        }
+    };
+
+    namespace reference
+    {
+        /* one channel of Dithered_Frame: the 8-bit value to send, with `error` carried in and out */
+        [[nodiscard]] constexpr uint8_t quantize(uint16_t channel, uint8_t &error) noexcept
+        {
+            const unsigned sum{static_cast<unsigned>(channel - (channel >> 8)) + error};
+            error = static_cast<uint8_t>(sum);
+            return static_cast<uint8_t>(sum >> 8);
+        }
+    }
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_dither_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        using format = Wire_Format<WRGB>;
+        Dithered_Frame<3> dut;
+        std::array<uint32_t, 3> out{};
+
+        // =========================================
+        // the ends, and whole values, come out exactly, every frame
+        dut.set(0, WRGB16{.white{0xFFFF}, .red{0}, .green{0xFFFF}, .blue{0}});
+        dut.set(1, WRGB16{.white{0}, .red{0}, .green{0}, .blue{0}});
+        dut.set(2, WRGB16{.white{0x1010}, .red{0x2020}, .green{0x3030}, .blue{0x4040}});
+        for (int frame{0}; frame < 8; ++frame)
+        {
+            dut.quantize(out);
+            rv &= out[0] == format::pack(WRGB{.white{0xFF}, .red{0}, .green{0xFF}, .blue{0}});
+            rv &= out[1] == 0;
+            rv &= out[2] == format::pack(WRGB{.white{0x10}, .red{0x20}, .green{0x30}, .blue{0x40}});
+        }
+
+        // =========================================
+        // in between, each channel averages out to its 16-bit value over 256 frames, a different one per channel
+        // (x - x / 256 is what each is stored as: 4.5, 0.25, 128.75 and 1/256)
+        dut.set(0, WRGB16{.white{0x0484}, .red{0x0040}, .green{0x8141}, .blue{0x0001}});
+        std::array<uint32_t, 4> totals{};
+        for (int frame{0}; frame < 256; ++frame)
+        {
+            dut.quantize(out);
+            const auto pixel{format::unpack(out[0])};
+            totals[0] += pixel.white;
+            totals[1] += pixel.red;
+            totals[2] += pixel.green;
+            totals[3] += pixel.blue;
+        }
+        rv &= totals[0] == 0x0480;
+        rv &= totals[1] == 0x0040;
+        rv &= totals[2] == 0x80C0;
+        rv &= totals[3] == 0x0001;
+
+        // =========================================
+        // from no fractions, it matches the reference a channel at a time
+        Dithered_Frame<1> exact{0};
+        const WRGB16 pixel{.white{1234}, .red{60000}, .green{77}, .blue{40000}};
+        exact.set(0, pixel);
+        std::array<uint8_t, 4> errors{};
+        for (int frame{0}; frame < 300; ++frame)
+        {
+            std::array<uint32_t, 1> word{};
+            exact.quantize(word);
+            const WRGB expected{.white{reference::quantize(pixel.white, errors[0])},
+                                .red{reference::quantize(pixel.red, errors[1])},
+                                .green{reference::quantize(pixel.green, errors[2])},
+                                .blue{reference::quantize(pixel.blue, errors[3])}};
+            rv &= word[0] == format::pack(expected);
+        }
+
+        return rv;
+    }
+    static_assert(run_dither_tests());
+}
+
+#endif
@@ -0,0 +1,287 @@
+#if !defined(FRAME_SCHEDULER_HPP)
+#define FRAME_SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "output_lut.hpp"
+#include "power_limiter.hpp"
+
+namespace pico_ws2812
+{
+    struct Frame_Scheduler_Stats
+    {
+        uint32_t flushes{0};
+        uint32_t skipped_unchanged{0}; // dirty, but the back buffer matched what was already on the strip
+        uint32_t coalesced{0};         // mutations folded into a flush some earlier mutation had already asked for
+        Power_Stats power{};
+    };
+
+    /* Sits between the things that draw into a FrameBuffer and the driver that sends it.  Writers mark the frame
+     * dirty as often as they like; update(), once per superloop pass, sends at most one frame for all of it, and
+     * none at all if the pixels didn't actually change.
+     *
+     * Output (an Output_LUT, or No_Output_Transform) turns each frame into what the strip gets, and Power (a
+     * Power_Limiter, or No_Power_Limit) sees every word that changed, as the strip gets it, as the frames are
+     * compared, and decides what is actually sent. */
+    template <class Frames, class Driver, class Power = No_Power_Limit, class Output = No_Output_Transform>
+    class Frame_Scheduler
+    {
+    public:
+        constexpr Frame_Scheduler(Frames &frames, Driver &drv, uint32_t coalesce_window_us = 0) noexcept : m_frames{frames}, m_drv{drv}, m_window_us{coalesce_window_us} {}
+
+        constexpr void mark_dirty(uint32_t now_us) noexcept
+        {
+            if (m_dirty)
+            {
+                ++m_stats.coalesced;
+                return;
+            }
+            m_dirty = true;
+            m_dirty_since_us = now_us;
+        }
+
+        /* send the frame again even if it hasn't changed, e.g. when what power() makes of it has */
+        constexpr void resend(uint32_t now_us) noexcept
+        {
+            m_resend = true;
+            mark_dirty(now_us);
+        }
+
+        constexpr void update(uint32_t now_us) noexcept
+        {
+            if (!m_dirty || now_us - m_dirty_since_us < m_window_us)
+            {
+                return;
+            }
+            // the front buffer is still on the wire; keep collecting changes and try again next pass
+            if (m_drv.busy())
+            {
+                return;
+            }
+            m_dirty = false;
+            // every changed word has to be tracked, so no short cut for a resend
+            if (!track_changes() && !m_resend)
+            {
+                ++m_stats.skipped_unchanged;
+                return;
+            }
+            m_resend = false;
+            m_frames.present();
+            (void)m_drv.flush(m_power.limit(m_output.apply(m_frames.front().words())));
+            m_stats.power = m_power.stats();
+            ++m_stats.flushes;
+        }
+
+        /* how long after the first change to wait for more before flushing; 0 means the next update() */
+        constexpr void set_coalesce_window(uint32_t window_us) noexcept
+        {
+            m_window_us = window_us;
+        }
+
+        [[nodiscard]] constexpr Power &power() noexcept
+        {
+            return m_power;
+        }
+
+        /* change() the output transform, moving the power estimate of the frame already up along with it, and
+         * resend that frame through the new one */
+        template <class Change>
+        constexpr void change_output(Change &&change, uint32_t now_us) noexcept
+        {
+            const auto front{m_frames.front().words()};
+            for (const auto word : front)
+            {
+                m_power.track(m_output.word(word), 0);
+            }
+            change(m_output);
+            for (const auto word : front)
+            {
+                m_power.track(0, m_output.word(word));
+            }
+            resend(now_us);
+        }
+        [[nodiscard]] constexpr const Output &output() const noexcept
+        {
+            return m_output;
+        }
+
+        [[nodiscard]] constexpr bool dirty() const noexcept
+        {
+            return m_dirty;
+        }
+        [[nodiscard]] constexpr const Frame_Scheduler_Stats &stats() const noexcept
+        {
+            return m_stats;
+        }
+
+    private:
+        Frames &m_frames;
+        Driver &m_drv;
+        uint32_t m_window_us;
+        uint32_t m_dirty_since_us{0};
+        bool m_dirty{false};
+        bool m_resend{false};
+        Frame_Scheduler_Stats m_stats{};
+        Power m_power{};
+        Output m_output{};
+
+        /* whether the back buffer differs from the front; the power estimate moves with each word that does */
+        [[nodiscard]] constexpr bool track_changes() noexcept
+        {
+            const auto back{m_frames.back().words()};
+            const auto front{m_frames.front().words()};
+            bool changed{false};
+            for (size_t ii{0}; ii < std::size(back); ++ii)
+            {
+                if (back[ii] != front[ii])
+                {
+                    m_power.track(m_output.word(front[ii]), m_output.word(back[ii]));
+                    changed = true;
+                }
+            }
+            return changed;
+        }
+    };
+}
+
+#include "framebuffer.hpp"
+#include "wire_frame.hpp"
+
+namespace tests
+{
+    struct Fake_Flush_Driver
+    {
+        bool in_flight{false};
+        uint32_t flushes{0};
+        uint32_t last_first_word{0};
+
+        [[nodiscard]] constexpr bool busy() const noexcept { return in_flight; }
+        constexpr bool flush(std::span<const uint32_t> words) noexcept
+        {
+            ++flushes;
+            last_first_word = words[0];
+            return true;
+        }
+    };
+
+    [[nodiscard]] constexpr bool run_frame_scheduler_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        FrameBuffer<Wire_Frame<WRGB, 4>> frames;
+        Fake_Flush_Driver drv;
+        Frame_Scheduler dut{frames, drv};
+
+        // =========================================
+        // nothing written, nothing sent
+        dut.update(0);
+        rv &= drv.flushes == 0;
+
+        // many writes in one pass, one flush
+        for (uint8_t ii{0}; ii < 4; ++ii)
+        {
+            frames.back().set(ii, WRGB{.white{ii}, .red{0}, .green{0}, .blue{0}});
+            dut.mark_dirty(0);
+        }
+        frames.back().set(0, WRGB{.white{9}, .red{0}, .green{0}, .blue{0}});
+        dut.mark_dirty(0);
+        dut.update(1);
+        rv &= drv.flushes == 1;
+        rv &= drv.last_first_word == 9;
+        rv &= dut.stats().coalesced == 4;
+        rv &= !dut.dirty();
+
+        // =========================================
+        // writing what is already shown doesn't send a frame
+        frames.back().set(0, WRGB{.white{9}, .red{0}, .green{0}, .blue{0}});
+        dut.mark_dirty(2);
+        dut.update(3);
+        rv &= drv.flushes == 1;
+        rv &= dut.stats().skipped_unchanged == 1;
+
+        // =========================================
+        // a frame in flight holds the next one back, without losing it
+        drv.in_flight = true;
+        frames.back().set(3, WRGB{.white{0}, .red{1}, .green{0}, .blue{0}});
+        dut.mark_dirty(4);
+        dut.update(5);
+        rv &= drv.flushes == 1;
+        rv &= dut.dirty();
+        drv.in_flight = false;
+        dut.update(6);
+        rv &= drv.flushes == 2;
+
+        // =========================================
+        // a coalescing window holds the flush until it has passed
+        dut.set_coalesce_window(100);
+        frames.back().set(2, WRGB{.white{0}, .red{0}, .green{0}, .blue{1}});
+        dut.mark_dirty(1000);
+        dut.update(1050);
+        rv &= drv.flushes == 2;
+        frames.back().set(1, WRGB{.white{0}, .red{0}, .green{0}, .blue{1}});
+        dut.mark_dirty(1060);
+        dut.update(1100);
+        rv &= drv.flushes == 3;
+        rv &= dut.stats().flushes == 3;
+
+        // =========================================
+        // with a limiter, what goes out is within budget and the frame stays as drawn
+        FrameBuffer<Wire_Frame<WRGB, 4>> limited_frames;
+        Fake_Flush_Driver limited_drv;
+        Frame_Scheduler<decltype(limited_frames), Fake_Flush_Driver, Power_Limiter<WRGB, 4>> limited{limited_frames, limited_drv};
+        limited.power().set_budget(Power_Budget{.budget_ma = 30, .full_ma{.white{10}, .red{10}, .green{10}, .blue{10}}, .idle_ma = 0});
+        limited_frames.back().set(0, WRGB{.white{255}, .red{0}, .green{0}, .blue{0}});
+        limited.mark_dirty(0);
+        limited.update(1);
+        rv &= limited_drv.last_first_word == 0xFF;
+        rv &= limited.stats().power.requested_ma == 10;
+        limited_frames.back().fill(WRGB{.white{255}, .red{0}, .green{0}, .blue{0}});
+        limited.mark_dirty(2);
+        limited.update(3);
+        rv &= limited_drv.last_first_word < 0xFF;
+        rv &= limited.stats().power.requested_ma == 40;
+        rv &= limited.stats().power.delivered_ma <= 30;
+        rv &= limited.stats().power.limited == 1;
+        rv &= limited_frames.front().words()[0] == 0xFF;
+
+        // a new budget applies to the frame already up once it's resent
+        limited.power().set_budget(Power_Budget{.budget_ma = 0, .full_ma{.white{10}, .red{10}, .green{10}, .blue{10}}, .idle_ma = 0});
+        limited.resend(4);
+        limited.update(5);
+        rv &= limited_drv.last_first_word == 0xFF;
+        rv &= limited.stats().skipped_unchanged == 0;
+
+        // =========================================
+        // with an output table, the strip gets the frame through it, and the power estimate follows
+        FrameBuffer<Wire_Frame<WRGB, 4>> lut_frames;
+        Fake_Flush_Driver lut_drv;
+        Frame_Scheduler<decltype(lut_frames), Fake_Flush_Driver, Power_Limiter<WRGB, 4>, Output_LUT<WRGB, 4>> lut{lut_frames, lut_drv};
+        lut.power().set_budget(Power_Budget{.budget_ma = 0, .full_ma{.white{10}, .red{10}, .green{10}, .blue{10}}, .idle_ma = 0});
+        lut_frames.back().fill(WRGB{.white{255}, .red{0}, .green{0}, .blue{0}});
+        lut.mark_dirty(0);
+        lut.update(1);
+        rv &= lut_drv.last_first_word == 0xFF;
+        rv &= lut.stats().power.requested_ma == 40;
+        lut.change_output([](auto &output)
+                          { output.set(Output_Settings{.gamma_x100 = 100, .brightness = 127, .balance = DEFAULT_OUTPUT_SETTINGS.balance}); },
+                          2);
+        lut.update(3);
+        rv &= lut_drv.flushes == 2;
+        rv &= lut_drv.last_first_word == 127;
+        rv &= lut.stats().power.requested_ma == 4 * 127 * 10 / 255;
+        rv &= lut_frames.front().words()[0] == 0xFF;
+        // and changes after it are estimated as sent
+        lut_frames.back().set(0, WRGB{.white{0}, .red{0}, .green{0}, .blue{0}});
+        lut.mark_dirty(4);
+        lut.update(5);
+        rv &= lut.stats().power.requested_ma == 3 * 127 * 10 / 255;
+
+        return rv;
+    }
+    static_assert(run_frame_scheduler_tests());
+}
+
+#endif
@@ -0,0 +1,103 @@
+#if !defined(FRAMEBUFFER_HPP)
+#define FRAMEBUFFER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace pico_ws2812
+{
+    enum struct Back_Buffer
+    {
+        PRESERVE, // after present(), the back buffer starts out as a copy of what was just presented
+        DISCARD   // after present(), the back buffer holds a stale frame; for writers that redraw everything
+    };
+
+    /* A front buffer that is being (or is about to be) streamed to the strip, and a back buffer that writers
+     * render into.  The two trade places in present(). */
+    template <class Frame>
+    class FrameBuffer
+    {
+    public:
+        using frame_type = Frame;
+        using value_type = typename Frame::value_type;
+
+        [[nodiscard]] constexpr Frame &back() noexcept
+        {
+            return m_frames[m_front ^ 1U];
+        }
+        [[nodiscard]] constexpr const Frame &back() const noexcept
+        {
+            return m_frames[m_front ^ 1U];
+        }
+        [[nodiscard]] constexpr const Frame &front() const noexcept
+        {
+            return m_frames[m_front];
+        }
+
+        /**
+         * @brief make the back buffer the new front buffer. The swap is a single index store, so a reader of
+         *  front() sees either the old frame or the new one, never a mix.
+         *  PRECONDITION: nothing is still reading the old front buffer (i.e. the previous flush has completed),
+         *  since it becomes the buffer writers get next.
+         */
+        constexpr void present(Back_Buffer mode = Back_Buffer::PRESERVE) noexcept
+        {
+            m_front ^= 1U;
+            if (mode == Back_Buffer::PRESERVE)
+            {
+                back() = front();
+            }
+        }
+
+        [[nodiscard]] static constexpr size_t size() noexcept
+        {
+            return Frame{}.size();
+        }
+
+    private:
+        std::array<Frame, 2> m_frames{};
+        uint8_t m_front{0};
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_framebuffer_tests()
+    {
+        bool rv{true};
+
+        pico_ws2812::FrameBuffer<std::array<uint32_t, 4>> dut;
+        rv &= dut.size() == 4;
+
+        // =========================================
+        // writers only ever touch the back buffer
+        dut.back()[1] = 42;
+        rv &= dut.front()[1] == 0;
+        rv &= &dut.front() != &dut.back();
+
+        const auto *old_back{&dut.back()};
+        dut.present();
+        rv &= &dut.front() == old_back;
+        rv &= dut.front()[1] == 42;
+
+        // preserved back buffer carries on from what was presented
+        rv &= dut.back()[1] == 42;
+        dut.back()[2] = 7;
+        rv &= dut.front()[2] == 0;
+
+        // =========================================
+        dut.present(pico_ws2812::Back_Buffer::DISCARD);
+        rv &= dut.front()[1] == 42;
+        rv &= dut.front()[2] == 7;
+        // the back buffer is whatever was last on the front
+        rv &= dut.back()[2] == 0;
+
+        return rv;
+    }
+    static_assert(run_framebuffer_tests());
+}
+
+#endif
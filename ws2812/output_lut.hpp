@@ -0,0 +1,265 @@
+#if !defined(OUTPUT_LUT_HPP)
+#define OUTPUT_LUT_HPP
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "color_math.hpp"
+#include "wire_frame.hpp"
+
+namespace pico_ws2812
+{
+    /* What the strip does to a frame on the way out */
+    struct Output_Settings
+    {
+        uint16_t gamma_x100; // 100 leaves values alone, 220 is the usual LED curve
+        uint8_t brightness;  // 255 is full
+        WRGB balance;        // each channel's gain, 255 is full
+    };
+
+    inline constexpr Output_Settings DEFAULT_OUTPUT_SETTINGS{
+        .gamma_x100 = 100,
+        .brightness = 255,
+        .balance{.white{255}, .red{255}, .green{255}, .blue{255}},
+    };
+
+    namespace detail
+    {
+        /* log2(value) in Q16, for value >= 1, by repeated squaring of the mantissa */
+        [[nodiscard]] constexpr uint32_t log2_q16(uint32_t value) noexcept
+        {
+            const auto exponent{static_cast<uint32_t>(std::bit_width(value) - 1)};
+            // the mantissa, 1.0 to 2.0, in Q31
+            uint64_t mantissa{uint64_t{value} << (31 - exponent)};
+            uint32_t fraction{0};
+            for (uint32_t bit{1U << 15}; bit != 0; bit >>= 1)
+            {
+                mantissa = (mantissa * mantissa) >> 31;
+                if (mantissa >= (uint64_t{1} << 32))
+                {
+                    mantissa >>= 1;
+                    fraction |= bit;
+                }
+            }
+            return (exponent << 16) | fraction;
+        }
+
+        [[nodiscard]] constexpr double sqrt_newton(double value) noexcept
+        {
+            double rv{value};
+            for (int ii{0}; ii < 64; ++ii)
+            {
+                rv = 0.5 * (rv + value / rv);
+            }
+            return rv;
+        }
+
+        /* 2^-(2^-k) in Q31, for k = 1 to 16: 2^-(bits of a fraction) is a product of these */
+        inline constexpr auto NEGATIVE_ROOTS_OF_TWO{[]
+                                                    {
+                                                        std::array<uint32_t, 16> rv{};
+                                                        double root{2.0};
+                                                        for (size_t kk{0}; kk < std::size(rv); ++kk)
+                                                        {
+                                                            root = sqrt_newton(root);
+                                                            rv[kk] = static_cast<uint32_t>(2147483648.0 / root + 0.5);
+                                                        }
+                                                        return rv;
+                                                    }()};
+
+        /* 2^-value for value >= 0 in Q16, as Q16 */
+        [[nodiscard]] constexpr uint32_t exp2_negative_q16(uint32_t value) noexcept
+        {
+            const uint32_t whole{value >> 16};
+            if (whole >= 17)
+            {
+                return 0;
+            }
+            uint64_t rv{uint64_t{1} << 31};
+            for (uint32_t kk{0}; kk < 16; ++kk)
+            {
+                if ((value & (1U << (15 - kk))) != 0)
+                {
+                    rv = (rv * NEGATIVE_ROOTS_OF_TWO[kk]) >> 31;
+                }
+            }
+            return static_cast<uint32_t>(((rv >> whole) + (1U << 14)) >> 15);
+        }
+    }
+
+    /**
+     * @brief (index / 255) ^ (gamma_x100 / 100), as 0 to 65536.  Integer only: a log2 and an exp2 by shifts and
+     *  multiplies, for rebuilding tables on a core with no FPU.
+     */
+    [[nodiscard]] constexpr uint32_t gamma_q16(uint8_t index, uint16_t gamma_x100) noexcept
+    {
+        if (index == 0)
+        {
+            return gamma_x100 == 0 ? 65536 : 0;
+        }
+        // log2(index / 255) is at most 0; carry it as a magnitude
+        const uint32_t magnitude{detail::log2_q16(255) - detail::log2_q16(index)};
+        const auto scaled{static_cast<uint32_t>((uint64_t{magnitude} * gamma_x100 + 50) / 100)};
+        return detail::exp2_negative_q16(scaled);
+    }
+
+    /* One 256 entry table per channel, with gamma, brightness and white balance folded in, so the flush looks each
+     * channel up once and does nothing else.  set() rebuilds the tables; the gamma curve itself is only recomputed
+     * when gamma changes.  Settings that change nothing (the default) skip the tables altogether. */
+    template <class Pixel, size_t N>
+    class Output_LUT
+    {
+    public:
+        constexpr explicit Output_LUT(const Output_Settings &settings = DEFAULT_OUTPUT_SETTINGS) noexcept
+        {
+            set(settings);
+        }
+
+        constexpr void set(const Output_Settings &settings) noexcept
+        {
+            if (!m_curve_valid || settings.gamma_x100 != m_settings.gamma_x100)
+            {
+                for (size_t ii{0}; ii < 256; ++ii)
+                {
+                    m_curve[ii] = gamma_q16(static_cast<uint8_t>(ii), settings.gamma_x100);
+                }
+                m_curve_valid = true;
+            }
+            m_settings = settings;
+
+            const auto gains{Wire_Format<Pixel>::pack(settings.balance)};
+            const uint32_t brightness{color_math::detail::weight(settings.brightness)};
+            m_identity = true;
+            for (size_t lane{0}; lane < LANES; ++lane)
+            {
+                const uint32_t gain{color_math::detail::weight(static_cast<uint8_t>(gains >> (8 * lane)))};
+                for (size_t ii{0}; ii < 256; ++ii)
+                {
+                    const uint32_t level{(((m_curve[ii] * brightness) >> 8) * gain) >> 8};
+                    const uint32_t value{(level * 255 + (1U << 15)) >> 16};
+                    m_tables[lane][ii] = static_cast<uint8_t>(value > 255 ? 255 : value);
+                    m_identity &= m_tables[lane][ii] == ii;
+                }
+            }
+        }
+        [[nodiscard]] constexpr const Output_Settings &settings() const noexcept
+        {
+            return m_settings;
+        }
+
+        /* a wire word as the strip gets it */
+        [[nodiscard]] constexpr uint32_t word(uint32_t in) const noexcept
+        {
+            if (m_identity)
+            {
+                return in;
+            }
+            return uint32_t{m_tables[0][in & 0xFFU]} |
+                   (uint32_t{m_tables[1][(in >> 8) & 0xFFU]} << 8) |
+                   (uint32_t{m_tables[2][(in >> 16) & 0xFFU]} << 16) |
+                   (uint32_t{m_tables[3][in >> 24]} << 24);
+        }
+
+        /**
+         * @brief what to send for `frame`: `frame` itself if the tables change nothing, otherwise a looked up copy.
+         *  PRECONDITION: the last frame apply() returned is no longer being sent.
+         */
+        [[nodiscard]] constexpr std::span<const uint32_t, N> apply(std::span<const uint32_t, N> frame) noexcept
+        {
+            if (m_identity)
+            {
+                return frame;
+            }
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                m_out[ii] = word(frame[ii]);
+            }
+            return m_out;
+        }
+
+        [[nodiscard]] constexpr bool identity() const noexcept
+        {
+            return m_identity;
+        }
+
+    private:
+        static constexpr size_t LANES{4};
+
+        Output_Settings m_settings{};
+        std::array<uint32_t, 256> m_curve{};
+        bool m_curve_valid{false};
+        // indexed by the byte of the wire word
+        std::array<std::array<uint8_t, 256>, LANES> m_tables{};
+        bool m_identity{true};
+        std::array<uint32_t, N> m_out{};
+    };
+
+    /* for a scheduler that sends frames as they are */
+    struct No_Output_Transform
+    {
+        [[nodiscard]] constexpr uint32_t word(uint32_t in) const noexcept
+        {
+            return in;
+        }
+        template <class Words>
+        [[nodiscard]] constexpr Words apply(Words frame) const noexcept
+        {
+            return frame;
+        }
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_output_lut_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        // =========================================
+        // the integer curve, at its ends and against known powers
+        rv &= detail::log2_q16(1) == 0;
+        rv &= detail::log2_q16(2) == 1U << 16;
+        rv &= detail::log2_q16(256) == 8U << 16;
+        rv &= detail::exp2_negative_q16(0) == 65536;
+        rv &= detail::exp2_negative_q16(1U << 16) == 32768;
+        rv &= gamma_q16(255, 220) == 65536;
+        rv &= gamma_q16(0, 220) == 0;
+        const auto near{[](uint32_t value, uint32_t expected)
+                        { return value + 2 >= expected && value <= expected + 2; }};
+        // (128 / 255) ^ 2 and ^ 0.5
+        rv &= near(gamma_q16(128, 200), 16513);
+        rv &= near(gamma_q16(128, 50), 46432);
+        rv &= near(gamma_q16(51, 100), 13107);
+
+        // =========================================
+        // the default is no change at all
+        Output_LUT<WRGB, 2> dut;
+        rv &= dut.identity();
+        const std::array<uint32_t, 2> frame{0x12345678U, 0xFF00FF00U};
+        rv &= dut.apply(frame).data() == frame.data();
+
+        // =========================================
+        // brightness and balance, each channel its own table
+        dut.set(Output_Settings{.gamma_x100 = 100, .brightness = 127, .balance{.white{255}, .red{255}, .green{255}, .blue{0}}});
+        rv &= !dut.identity();
+        const auto out{Wire_Format<WRGB>::unpack(dut.word(Wire_Format<WRGB>::pack(WRGB{.white{254}, .red{100}, .green{255}, .blue{255}})))};
+        rv &= out.white == 126 && out.red == 50 && out.green == 127 && out.blue == 0;
+        rv &= dut.apply(frame).data() != frame.data();
+
+        // =========================================
+        // gamma bends the middle and keeps the ends
+        dut.set(Output_Settings{.gamma_x100 = 220, .brightness = 255, .balance = DEFAULT_OUTPUT_SETTINGS.balance});
+        rv &= dut.word(0xFFFFFFFFU) == 0xFFFFFFFFU;
+        rv &= dut.word(0) == 0;
+        rv &= (dut.word(0x80808080U) & 0xFFU) == 56;
+
+        return rv;
+    }
+    static_assert(run_output_lut_tests());
+}
+
+#endif
@@ -0,0 +1,235 @@
+#if !defined(PIO_BACKEND_HPP)
+#define PIO_BACKEND_HPP
+
+#include "generated/ws2812.pio.h"
+#include "generated/ws2812_parallel.pio.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "pico/time.h"
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <span>
+
+namespace pico_ws2812
+{
+    inline constexpr uint32_t WS2812_BIT_RATE_HZ{800000};
+
+    /* Told when a frame handed to a backend has been fully fed into the state machine */
+    class Dma_Completion_Sink
+    {
+    public:
+        constexpr virtual void on_dma_complete() noexcept = 0;
+
+    protected:
+        constexpr ~Dma_Completion_Sink() = default;
+    };
+
+    template <class T>
+    concept pio_backend = requires(T a, const T ca, bool rgbw, uint32_t word, std::span<const uint32_t> words, Dma_Completion_Sink &sink) {
+        a.init(rgbw);
+        a.put_blocking(word);
+        a.start_dma(words, sink);
+        { ca.busy() } -> std::convertible_to<bool>;
+    };
+
+    /* A DMA channel paced by one state machine's TX DREQ, and the bookkeeping for when the strip has latched */
+    class Pio_Dma_Feed final
+    {
+    public:
+        /**
+         * @brief claim and configure the channel the first time round; `bits_per_word` is how many bits of each
+         *  strand a FIFO word carries, which sets how long the tail of a frame takes to drain after DMA is done.
+         */
+        void init(PIO pio_index, int state_machine_index, uint32_t bits_per_word) noexcept
+        {
+            m_latch_us = latch_time_us(bits_per_word);
+            // idle from the start, rather than latching a frame that was never sent
+            m_transfer_done_us = time_us_32() - m_latch_us;
+            if (m_dma_channel < 0)
+            {
+                claim_dma_channel(pio_index, state_machine_index);
+            }
+        }
+
+        /**
+         * @brief kick off a transfer of `words` into the TX FIFO. Returns immediately.
+         *  Completion is reported to `sink` from the DMA interrupt.
+         */
+        void start(std::span<const uint32_t> words, Dma_Completion_Sink &sink) noexcept
+        {
+            m_sink = &sink;
+            m_in_flight = true;
+            dma_channel_transfer_from_buffer_now(m_dma_channel, std::data(words), std::size(words));
+        }
+
+        /**
+         * @brief true while DMA is still feeding the FIFO, or while the tail of the last frame is
+         *  still being shifted out and latched by the strip.  The channel goes idle a moment before its interrupt
+         *  stamps the time, so until the interrupt has run the transfer still counts as in flight.
+         */
+        [[nodiscard]] bool busy() const noexcept
+        {
+            if (m_in_flight || (m_dma_channel >= 0 && dma_channel_is_busy(m_dma_channel)))
+            {
+                return true;
+            }
+            return (time_us_32() - m_transfer_done_us) < m_latch_us;
+        }
+
+    private:
+        // joined TX FIFO depth, plus the word sitting in the OSR
+        static constexpr uint32_t WORDS_IN_FLIGHT_AFTER_DMA{8 + 1};
+        // SK6812 wants >80us of low to latch, ws2812 >50us
+        static constexpr uint32_t RESET_TIME_US{80};
+
+        static inline std::array<Pio_Dma_Feed *, NUM_DMA_CHANNELS> s_channel_owners{};
+
+        int m_dma_channel{-1};
+        uint32_t m_latch_us{0};
+        volatile uint32_t m_transfer_done_us{0};
+        // from start() until the interrupt has stamped m_transfer_done_us
+        volatile bool m_in_flight{false};
+        Dma_Completion_Sink *volatile m_sink{nullptr};
+
+        [[nodiscard]] static constexpr uint32_t latch_time_us(uint32_t bits_per_word) noexcept
+        {
+            const uint32_t word_time_us{(bits_per_word * 1000000 + WS2812_BIT_RATE_HZ - 1) / WS2812_BIT_RATE_HZ};
+            return WORDS_IN_FLIGHT_AFTER_DMA * word_time_us + RESET_TIME_US;
+        }
+
+        void claim_dma_channel(PIO pio_index, int state_machine_index) noexcept
+        {
+            m_dma_channel = dma_claim_unused_channel(true);
+
+            dma_channel_config cfg{dma_channel_get_default_config(m_dma_channel)};
+            channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+            channel_config_set_read_increment(&cfg, true);
+            channel_config_set_write_increment(&cfg, false);
+            channel_config_set_dreq(&cfg, pio_get_dreq(pio_index, state_machine_index, true));
+            dma_channel_configure(m_dma_channel, &cfg, &pio_index->txf[state_machine_index], nullptr, 0, false);
+
+            const bool first_owner{std::all_of(std::begin(s_channel_owners), std::end(s_channel_owners), [](auto owner)
+                                               { return owner == nullptr; })};
+            s_channel_owners[m_dma_channel] = this;
+            dma_channel_set_irq0_enabled(m_dma_channel, true);
+            if (first_owner)
+            {
+                irq_add_shared_handler(DMA_IRQ_0, dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+                irq_set_enabled(DMA_IRQ_0, true);
+            }
+        }
+
+        void on_transfer_complete() noexcept
+        {
+            m_transfer_done_us = time_us_32();
+            m_in_flight = false;
+            if (m_sink != nullptr)
+            {
+                m_sink->on_dma_complete();
+            }
+        }
+
+        static void dma_irq_handler()
+        {
+            for (uint channel{0}; channel < NUM_DMA_CHANNELS; ++channel)
+            {
+                auto *owner{s_channel_owners[channel]};
+                if (owner == nullptr || !dma_channel_get_irq0_status(channel))
+                {
+                    continue;
+                }
+                dma_channel_acknowledge_irq0(channel);
+                owner->on_transfer_complete();
+            }
+        }
+    };
+
+    /* One ws2812 state machine, plus a DMA channel paced by its TX DREQ */
+    class Pico_PIO_Backend final
+    {
+    public:
+        explicit Pico_PIO_Backend(PIO pio_index, int state_machine_index, int gpio_pin) noexcept : m_pio{pio_index}, m_state_machine{state_machine_index}, m_pin{gpio_pin}
+        {
+        }
+
+        void init(bool rgbw) noexcept
+        {
+            uint offset = pio_add_program(m_pio, &ws2812_program);
+            ws2812_program_init(m_pio, m_state_machine, offset, m_pin, WS2812_BIT_RATE_HZ, rgbw);
+            m_feed.init(m_pio, m_state_machine, rgbw ? 32 : 24);
+        }
+
+        void put_blocking(uint32_t word) noexcept
+        {
+            pio_sm_put_blocking(m_pio, m_state_machine, word);
+        }
+
+        void start_dma(std::span<const uint32_t> words, Dma_Completion_Sink &sink) noexcept
+        {
+            m_feed.start(words, sink);
+        }
+
+        [[nodiscard]] bool busy() const noexcept
+        {
+            return m_feed.busy();
+        }
+
+    private:
+        PIO m_pio;
+        int m_state_machine;
+        int m_pin;
+        Pio_Dma_Feed m_feed;
+    };
+
+    /**
+     * @brief One ws2812_parallel state machine driving up to 8 strands on consecutive pins in lockstep.
+     *  It takes bit-planes rather than pixels, see transpose.hpp; `rgbw` only changes the latch bookkeeping.
+     */
+    class Pico_PIO_Parallel_Backend final
+    {
+    public:
+        static constexpr int MAX_STRANDS{8};
+
+        explicit Pico_PIO_Parallel_Backend(PIO pio_index, int state_machine_index, int first_gpio_pin, int strand_count = MAX_STRANDS) noexcept
+            : m_pio{pio_index}, m_state_machine{state_machine_index}, m_first_pin{first_gpio_pin}, m_strand_count{std::clamp(strand_count, 1, MAX_STRANDS)}
+        {
+        }
+
+        void init(bool) noexcept
+        {
+            uint offset = pio_add_program(m_pio, &ws2812_parallel_program);
+            ws2812_parallel_program_init(m_pio, m_state_machine, offset, m_first_pin, m_strand_count, WS2812_BIT_RATE_HZ);
+            // a word is four bit-planes, i.e. four bits of every strand
+            m_feed.init(m_pio, m_state_machine, 4);
+        }
+
+        void put_blocking(uint32_t word) noexcept
+        {
+            pio_sm_put_blocking(m_pio, m_state_machine, word);
+        }
+
+        void start_dma(std::span<const uint32_t> words, Dma_Completion_Sink &sink) noexcept
+        {
+            m_feed.start(words, sink);
+        }
+
+        [[nodiscard]] bool busy() const noexcept
+        {
+            return m_feed.busy();
+        }
+
+    private:
+        PIO m_pio;
+        int m_state_machine;
+        int m_first_pin;
+        int m_strand_count;
+        Pio_Dma_Feed m_feed;
+    };
+}
+
+#endif
@@ -0,0 +1,214 @@
+#if !defined(POWER_LIMITER_HPP)
+#define POWER_LIMITER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "color_math.hpp"
+#include "wire_frame.hpp"
+
+namespace pico_ws2812
+{
+    /* What the strip may draw, and what each LED draws to get there */
+    struct Power_Budget
+    {
+        uint32_t budget_ma; // 0 is no limit
+        WRGB full_ma;       // one LED's draw for each channel at 255
+        uint8_t idle_ma;    // one LED's draw when it's dark
+    };
+
+    /* An SK6812RGBW on 5 V, from its datasheet; a budget a USB 2.0 port can supply */
+    inline constexpr Power_Budget DEFAULT_POWER_BUDGET{
+        .budget_ma = 500,
+        .full_ma{.white{20}, .red{12}, .green{12}, .blue{12}},
+        .idle_ma = 1,
+    };
+
+    struct Power_Stats
+    {
+        uint32_t requested_ma; // the frame on the strip as it was drawn
+        uint32_t delivered_ma; // the same frame as it was sent, scaled down if it was over budget
+        uint32_t limited;      // frames scaled down
+    };
+
+    /* Keeps the draw of the frame on the strip, a channel total at a time, and scales frames that would go over
+     * budget.
+     *
+     * The totals follow the frame word by word: the scheduler already compares the next frame with the last one
+     * before sending it, and hands every word that changed to track(), so a frame costs as many updates as it has
+     * changed pixels and is never summed from scratch.  Frames over budget are scaled by one factor into a copy
+     * of their own, leaving the frame the totals describe as it was drawn. */
+    template <class Pixel, size_t N>
+    class Power_Limiter
+    {
+    public:
+        constexpr explicit Power_Limiter(const Power_Budget &budget = DEFAULT_POWER_BUDGET) noexcept
+        {
+            set_budget(budget);
+        }
+
+        constexpr void set_budget(const Power_Budget &budget) noexcept
+        {
+            m_budget = budget;
+            const auto full_ma{Wire_Format<Pixel>::pack(budget.full_ma)};
+            for (size_t lane{0}; lane < LANES; ++lane)
+            {
+                m_lane_ma[lane] = static_cast<uint8_t>(full_ma >> (8 * lane));
+            }
+        }
+        [[nodiscard]] constexpr const Power_Budget &budget() const noexcept
+        {
+            return m_budget;
+        }
+
+        /* the pixel that was `before` is now `after` */
+        constexpr void track(uint32_t before, uint32_t after) noexcept
+        {
+            for (size_t lane{0}; lane < LANES; ++lane)
+            {
+                m_lane_totals[lane] += ((after >> (8 * lane)) & 0xFFU);
+                m_lane_totals[lane] -= ((before >> (8 * lane)) & 0xFFU);
+            }
+        }
+
+        /**
+         * @brief what to send for `frame`, the frame the totals describe: `frame` itself if it is within budget,
+         *  otherwise a scaled copy.
+         *  PRECONDITION: the last frame limit() returned is no longer being sent.
+         */
+        [[nodiscard]] constexpr std::span<const uint32_t> limit(std::span<const uint32_t, N> frame) noexcept
+        {
+            const auto idle_ma{static_cast<uint32_t>(m_budget.idle_ma * N)};
+            const uint32_t lit_ma{lit_draw_ma()};
+            m_stats.requested_ma = idle_ma + lit_ma;
+            m_stats.delivered_ma = m_stats.requested_ma;
+            if (m_budget.budget_ma == 0 || m_stats.requested_ma <= m_budget.budget_ma)
+            {
+                return frame;
+            }
+
+            const uint32_t allowance_ma{m_budget.budget_ma > idle_ma ? m_budget.budget_ma - idle_ma : 0};
+            const auto amount{amount_within(allowance_ma, lit_ma)};
+            for (size_t ii{0}; ii < N; ++ii)
+            {
+                m_limited[ii] = color_math::scale(frame[ii], amount);
+            }
+            ++m_stats.limited;
+            m_stats.delivered_ma = idle_ma + lit_ma * color_math::detail::weight(amount) / 256;
+            return m_limited;
+        }
+
+        [[nodiscard]] constexpr const Power_Stats &stats() const noexcept
+        {
+            return m_stats;
+        }
+
+    private:
+        static constexpr size_t LANES{4};
+
+        Power_Budget m_budget{};
+        std::array<uint8_t, LANES> m_lane_ma{};
+        // every pixel's value of each byte of the wire word, added up
+        std::array<uint32_t, LANES> m_lane_totals{};
+        std::array<uint32_t, N> m_limited{};
+        Power_Stats m_stats{};
+
+        [[nodiscard]] constexpr uint32_t lit_draw_ma() const noexcept
+        {
+            uint32_t rv{0};
+            for (size_t lane{0}; lane < LANES; ++lane)
+            {
+                rv += m_lane_totals[lane] * m_lane_ma[lane];
+            }
+            return rv / 255;
+        }
+
+        /* the largest amount for color_math::scale() whose factor keeps `lit_ma` within `allowance_ma` */
+        [[nodiscard]] static constexpr uint8_t amount_within(uint32_t allowance_ma, uint32_t lit_ma) noexcept
+        {
+            const auto factor{static_cast<uint32_t>(uint64_t{allowance_ma} * 256 / lit_ma)};
+            // scale()'s factor is amount + amount / 128: only 128 has no amount of its own
+            return static_cast<uint8_t>(factor < 128 ? factor : factor - 1);
+        }
+    };
+
+    /* for a scheduler with no limit at all */
+    struct No_Power_Limit
+    {
+        constexpr void track(uint32_t, uint32_t) noexcept {}
+        [[nodiscard]] constexpr std::span<const uint32_t> limit(std::span<const uint32_t> frame) const noexcept
+        {
+            return frame;
+        }
+        [[nodiscard]] constexpr Power_Stats stats() const noexcept
+        {
+            return {};
+        }
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_power_limiter_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        using format = Wire_Format<WRGB>;
+        const Power_Budget budget{.budget_ma = 100, .full_ma{.white{20}, .red{10}, .green{10}, .blue{10}}, .idle_ma = 1};
+        Power_Limiter<WRGB, 4> dut{budget};
+        std::array<uint32_t, 4> frame{};
+
+        // =========================================
+        // dark, only the idle draw
+        rv &= dut.limit(frame).data() == frame.data();
+        rv &= dut.stats().requested_ma == 4;
+
+        // =========================================
+        // the totals follow each change
+        const auto write{[&](size_t index, WRGB pixel)
+                         {
+                             const auto word{format::pack(pixel)};
+                             dut.track(frame[index], word);
+                             frame[index] = word;
+                         }};
+        write(0, WRGB{.white{255}, .red{0}, .green{0}, .blue{0}});
+        write(1, WRGB{.white{0}, .red{255}, .green{255}, .blue{0}});
+        rv &= dut.limit(frame).data() == frame.data();
+        rv &= dut.stats().requested_ma == 4 + 20 + 20;
+        write(1, WRGB{.white{0}, .red{0}, .green{0}, .blue{255}});
+        rv &= dut.limit(frame).data() == frame.data();
+        rv &= dut.stats().requested_ma == 4 + 20 + 10;
+        rv &= dut.stats().limited == 0;
+
+        // =========================================
+        // over budget: one factor for every pixel, and within the budget afterwards
+        for (size_t ii{0}; ii < 4; ++ii)
+        {
+            write(ii, WRGB{.white{255}, .red{255}, .green{255}, .blue{255}});
+        }
+        rv &= dut.stats().limited == 0;
+        const auto sent{dut.limit(frame)};
+        rv &= sent.data() != frame.data();
+        rv &= dut.stats().requested_ma == 4 + 4 * 50;
+        rv &= dut.stats().limited == 1;
+        rv &= dut.stats().delivered_ma <= budget.budget_ma;
+        rv &= dut.stats().delivered_ma >= budget.budget_ma - 2;
+        rv &= sent[0] == sent[3] && sent[0] < frame[0];
+        // the frame itself is as drawn
+        rv &= frame[0] == 0xFFFFFFFFU;
+
+        // =========================================
+        // no budget, no limit
+        dut.set_budget(Power_Budget{.budget_ma = 0, .full_ma = budget.full_ma, .idle_ma = 1});
+        rv &= dut.limit(frame).data() == frame.data();
+        rv &= dut.stats().limited == 1;
+
+        return rv;
+    }
+    static_assert(run_power_limiter_tests());
+}
+
+#endif
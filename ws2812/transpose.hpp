@@ -0,0 +1,215 @@
+#if !defined(TRANSPOSE_HPP)
+#define TRANSPOSE_HPP
+
+#include "wire_frame.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/* Turns 8 strands of wire words into the bit-planes ws2812_parallel.pio clocks out.
+ *
+ * Plane k of a pixel is one byte: bit s is wire bit k (MSB first) of strand s.  Planes are packed four to a word,
+ * first one in the top byte, since the state machine shifts left.  So an LED index costs 8 words for WRGB and 6
+ * for RGB, whatever the number of strands actually wired up. */
+namespace pico_ws2812
+{
+    inline constexpr size_t PARALLEL_STRANDS{8};
+
+    template <class Pixel>
+    inline constexpr size_t PLANE_WORDS_PER_PIXEL{sizeof(Pixel) * 8 / 4};
+
+    namespace detail
+    {
+        /* 8x8 bit matrix transpose, Hacker's Delight 7-3.  Rows are bytes, row 0 in the top byte of `hi`; column 0
+         * is the MSB.  On return row j holds column j. */
+        constexpr void transpose8(uint32_t &hi, uint32_t &lo) noexcept
+        {
+            uint32_t t{(hi ^ (hi >> 7)) & 0x00AA00AAU};
+            hi = hi ^ t ^ (t << 7);
+            t = (lo ^ (lo >> 7)) & 0x00AA00AAU;
+            lo = lo ^ t ^ (t << 7);
+
+            t = (hi ^ (hi >> 14)) & 0x0000CCCCU;
+            hi = hi ^ t ^ (t << 14);
+            t = (lo ^ (lo >> 14)) & 0x0000CCCCU;
+            lo = lo ^ t ^ (t << 14);
+
+            t = (hi & 0xF0F0F0F0U) | ((lo >> 4) & 0x0F0F0F0FU);
+            lo = ((hi << 4) & 0xF0F0F0F0U) | (lo & 0x0F0F0F0FU);
+            hi = t;
+        }
+
+        /* 4x4 byte transpose: on return word k holds byte k (from the top) of a, b, c, d, in that order */
+        constexpr void transpose4x4_bytes(uint32_t a, uint32_t b, uint32_t c, uint32_t d, std::array<uint32_t, 4> &out) noexcept
+        {
+            const uint32_t ab02{(a & 0xFF00FF00U) | ((b >> 8) & 0x00FF00FFU)};
+            const uint32_t ab13{((a << 8) & 0xFF00FF00U) | (b & 0x00FF00FFU)};
+            const uint32_t cd02{(c & 0xFF00FF00U) | ((d >> 8) & 0x00FF00FFU)};
+            const uint32_t cd13{((c << 8) & 0xFF00FF00U) | (d & 0x00FF00FFU)};
+            out[0] = (ab02 & 0xFFFF0000U) | (cd02 >> 16);
+            out[1] = (ab13 & 0xFFFF0000U) | (cd13 >> 16);
+            out[2] = (ab02 << 16) | (cd02 & 0x0000FFFFU);
+            out[3] = (ab13 << 16) | (cd13 & 0x0000FFFFU);
+        }
+    }
+
+    /**
+     * @brief transpose pixel `index` of every strand into its PLANE_WORDS_PER_PIXEL<Pixel> words at `planes`.
+     */
+    template <class Pixel>
+    constexpr void transpose_pixel(const std::array<const uint32_t *, PARALLEL_STRANDS> &strands, size_t index, uint32_t *planes) noexcept
+    {
+        // strand 7 goes in the top row, so that strand s lands on bit s of each plane
+        std::array<uint32_t, 4> hi{};
+        std::array<uint32_t, 4> lo{};
+        detail::transpose4x4_bytes(strands[7][index], strands[6][index], strands[5][index], strands[4][index], hi);
+        detail::transpose4x4_bytes(strands[3][index], strands[2][index], strands[1][index], strands[0][index], lo);
+        for (size_t byte{0}; byte < sizeof(Pixel); ++byte)
+        {
+            detail::transpose8(hi[byte], lo[byte]);
+            planes[2 * byte] = hi[byte];
+            planes[2 * byte + 1] = lo[byte];
+        }
+    }
+
+    /* Every pixel of 8 equally long strands.  `planes` must hold size() * PLANE_WORDS_PER_PIXEL<Pixel> words. */
+    template <class Pixel>
+    constexpr void transpose_strands(const std::array<std::span<const uint32_t>, PARALLEL_STRANDS> &strands, std::span<uint32_t> planes) noexcept
+    {
+        std::array<const uint32_t *, PARALLEL_STRANDS> rows{};
+        for (size_t ss{0}; ss < PARALLEL_STRANDS; ++ss)
+        {
+            rows[ss] = std::data(strands[ss]);
+        }
+        const size_t pixels{std::size(strands[0])};
+        for (size_t ii{0}; ii < pixels; ++ii)
+        {
+            transpose_pixel<Pixel>(rows, ii, std::data(planes) + ii * PLANE_WORDS_PER_PIXEL<Pixel>);
+        }
+    }
+
+    /* Bit at a time, the obvious way.  The yardstick for transpose_strands(). */
+    template <class Pixel>
+    constexpr void transpose_strands_reference(const std::array<std::span<const uint32_t>, PARALLEL_STRANDS> &strands, std::span<uint32_t> planes) noexcept
+    {
+        constexpr size_t WIRE_BITS{sizeof(Pixel) * 8};
+        for (size_t ii{0}; ii < std::size(strands[0]); ++ii)
+        {
+            for (size_t bit{0}; bit < WIRE_BITS; ++bit)
+            {
+                uint32_t plane{0};
+                for (size_t ss{0}; ss < PARALLEL_STRANDS; ++ss)
+                {
+                    plane |= ((strands[ss][ii] >> (31 - bit)) & 1U) << ss;
+                }
+                uint32_t &word{planes[ii * PLANE_WORDS_PER_PIXEL<Pixel> + bit / 4]};
+                const uint32_t shift{static_cast<uint32_t>(24 - 8 * (bit % 4))};
+                word = (word & ~(0xFFU << shift)) | (plane << shift);
+            }
+        }
+    }
+
+    /* Eight Wire_Frames, one per strand, and the bit-planes they transpose into for the parallel driver */
+    template <class Pixel, size_t N>
+    class Parallel_Frame
+    {
+    public:
+        using strand_type = Wire_Frame<Pixel, N>;
+
+        [[nodiscard]] constexpr strand_type &strand(size_t index) noexcept
+        {
+            return m_strands[index];
+        }
+        [[nodiscard]] constexpr const strand_type &strand(size_t index) const noexcept
+        {
+            return m_strands[index];
+        }
+
+        /* refresh planes() from the strands; call once per frame, before flushing */
+        constexpr void transpose() noexcept
+        {
+            std::array<std::span<const uint32_t>, PARALLEL_STRANDS> strands{};
+            for (size_t ss{0}; ss < PARALLEL_STRANDS; ++ss)
+            {
+                strands[ss] = m_strands[ss].words();
+            }
+            transpose_strands<Pixel>(strands, m_planes);
+        }
+
+        [[nodiscard]] constexpr std::span<const uint32_t> planes() const noexcept
+        {
+            return m_planes;
+        }
+
+        [[nodiscard]] static constexpr size_t size() noexcept
+        {
+            return N;
+        }
+
+    private:
+        std::array<strand_type, PARALLEL_STRANDS> m_strands{};
+        std::array<uint32_t, N * PLANE_WORDS_PER_PIXEL<Pixel>> m_planes{};
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_transpose_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        // =========================================
+        // one lit bit per strand: strand s sends its 1 at wire bit s, so plane s is just bit s
+        Parallel_Frame<WRGB, 1> diagonal;
+        for (size_t ss{0}; ss < PARALLEL_STRANDS; ++ss)
+        {
+            diagonal.strand(ss).words()[0] = 0x80000000U >> ss;
+        }
+        diagonal.transpose();
+        rv &= diagonal.planes()[0] == 0x01020408U;
+        rv &= diagonal.planes()[1] == 0x10204080U;
+        for (size_t ww{2}; ww < PLANE_WORDS_PER_PIXEL<WRGB>; ++ww)
+        {
+            rv &= diagonal.planes()[ww] == 0;
+        }
+
+        // =========================================
+        // the kernel agrees with the bit at a time version on something irregular, for both pixel widths
+        constexpr size_t N{3};
+        std::array<std::array<uint32_t, N>, PARALLEL_STRANDS> words{};
+        uint32_t lcg{12345};
+        for (auto &strand : words)
+        {
+            for (auto &word : strand)
+            {
+                lcg = lcg * 1664525U + 1013904223U;
+                word = lcg;
+            }
+        }
+        std::array<std::span<const uint32_t>, PARALLEL_STRANDS> strands{};
+        for (size_t ss{0}; ss < PARALLEL_STRANDS; ++ss)
+        {
+            strands[ss] = words[ss];
+        }
+
+        std::array<uint32_t, N * PLANE_WORDS_PER_PIXEL<WRGB>> fast_wrgb{};
+        std::array<uint32_t, N * PLANE_WORDS_PER_PIXEL<WRGB>> slow_wrgb{};
+        transpose_strands<WRGB>(strands, fast_wrgb);
+        transpose_strands_reference<WRGB>(strands, slow_wrgb);
+        rv &= fast_wrgb == slow_wrgb;
+
+        std::array<uint32_t, N * PLANE_WORDS_PER_PIXEL<RGB>> fast_rgb{};
+        std::array<uint32_t, N * PLANE_WORDS_PER_PIXEL<RGB>> slow_rgb{};
+        transpose_strands<RGB>(strands, fast_rgb);
+        transpose_strands_reference<RGB>(strands, slow_rgb);
+        rv &= fast_rgb == slow_rgb;
+
+        return rv;
+    }
+    static_assert(run_transpose_tests());
+}
+
+#endif
@@ -0,0 +1,145 @@
+#if !defined(WIRE_FRAME_HPP)
+#define WIRE_FRAME_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace pico_ws2812
+{
+    struct RGB
+    {
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+    };
+
+    struct WRGB
+    {
+        uint8_t white;
+        uint8_t red;
+        uint8_t green;
+        uint8_t blue;
+    };
+
+    /* How a pixel sits in the word pushed to the state machine, which shifts out MSB first */
+    template <class Pixel>
+    struct Wire_Format;
+
+    template <>
+    struct Wire_Format<RGB>
+    {
+        [[nodiscard]] static constexpr uint32_t pack(RGB pixel) noexcept
+        {
+            return (static_cast<uint32_t>(pixel.red) << 16) |
+                   (static_cast<uint32_t>(pixel.green) << 24) |
+                   (static_cast<uint32_t>(pixel.blue) << 8);
+        }
+        [[nodiscard]] static constexpr RGB unpack(uint32_t word) noexcept
+        {
+            return RGB{.red{static_cast<uint8_t>(word >> 16)},
+                       .green{static_cast<uint8_t>(word >> 24)},
+                       .blue{static_cast<uint8_t>(word >> 8)}};
+        }
+    };
+
+    template <>
+    struct Wire_Format<WRGB>
+    {
+        [[nodiscard]] static constexpr uint32_t pack(WRGB pixel) noexcept
+        {
+            return (static_cast<uint32_t>(pixel.green) << 24) |
+                   (static_cast<uint32_t>(pixel.red) << 16) |
+                   (static_cast<uint32_t>(pixel.blue) << 8) |
+                   static_cast<uint32_t>(pixel.white);
+        }
+        [[nodiscard]] static constexpr WRGB unpack(uint32_t word) noexcept
+        {
+            return WRGB{.white{static_cast<uint8_t>(word)},
+                        .red{static_cast<uint8_t>(word >> 16)},
+                        .green{static_cast<uint8_t>(word >> 24)},
+                        .blue{static_cast<uint8_t>(word >> 8)}};
+        }
+    };
+
+    /* A frame kept the way the strip wants it: one GRB(W) word per LED, contiguous.  Pixels are packed once,
+     * when they are written, so sending the frame is a straight copy (or DMA) of words(). */
+    template <class Pixel, size_t N>
+    class Wire_Frame
+    {
+    public:
+        using pixel_type = Pixel;
+        using value_type = uint32_t;
+        using format = Wire_Format<Pixel>;
+
+        constexpr void set(size_t index, Pixel pixel) noexcept
+        {
+            m_words[index] = format::pack(pixel);
+        }
+        [[nodiscard]] constexpr Pixel get(size_t index) const noexcept
+        {
+            return format::unpack(m_words[index]);
+        }
+        constexpr void fill(Pixel pixel) noexcept
+        {
+            std::fill(std::begin(m_words), std::end(m_words), format::pack(pixel));
+        }
+
+        [[nodiscard]] constexpr std::span<const uint32_t, N> words() const noexcept
+        {
+            return m_words;
+        }
+        [[nodiscard]] constexpr std::span<uint32_t, N> words() noexcept
+        {
+            return m_words;
+        }
+
+        [[nodiscard]] static constexpr size_t size() noexcept
+        {
+            return N;
+        }
+
+        [[nodiscard]] constexpr bool operator==(const Wire_Frame &) const noexcept = default;
+
+    private:
+        std::array<uint32_t, N> m_words{};
+    };
+}
+
+namespace tests
+{
+    [[nodiscard]] constexpr bool run_wire_frame_tests()
+    {
+        using namespace pico_ws2812;
+        bool rv{true};
+
+        // =========================================
+        // wire order is G, R, B, (W), most significant first
+        rv &= Wire_Format<WRGB>::pack(WRGB{.white{0x44}, .red{0x22}, .green{0x11}, .blue{0x33}}) == 0x11223344;
+        rv &= Wire_Format<RGB>::pack(RGB{.red{0x22}, .green{0x11}, .blue{0x33}}) == 0x11223300;
+
+        const auto wrgb{Wire_Format<WRGB>::unpack(0x11223344)};
+        rv &= wrgb.white == 0x44 && wrgb.red == 0x22 && wrgb.green == 0x11 && wrgb.blue == 0x33;
+        const auto rgb{Wire_Format<RGB>::unpack(0x11223300)};
+        rv &= rgb.red == 0x22 && rgb.green == 0x11 && rgb.blue == 0x33;
+
+        // =========================================
+        Wire_Frame<WRGB, 3> dut;
+        rv &= dut.size() == 3;
+        dut.fill(WRGB{.white{1}, .red{2}, .green{3}, .blue{4}});
+        rv &= std::ranges::all_of(dut.words(), [](auto word)
+                                  { return word == 0x03020401; });
+
+        dut.set(1, WRGB{.white{0xFF}, .red{0}, .green{0}, .blue{0}});
+        rv &= dut.words()[1] == 0x000000FF;
+        rv &= dut.get(1).white == 0xFF;
+        rv &= dut.get(2).blue == 4;
+
+        return rv;
+    }
+    static_assert(run_wire_frame_tests());
+}
+
+#endif
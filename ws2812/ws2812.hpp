@@ -12,7 +12,13 @@
 #include "generated/ws2812.pio.h"
 #include "hardware/clocks.h"
 #include "hardware/pio.h"
+#include "pio_backend.hpp"
+#include "wire_frame.hpp"
+#include <algorithm>
+#include <array>
+#include <concepts>
 #include <cstdint>
+#include <span>
 #include <utility>
 
 namespace pico_ws2812
@@ -24,58 +30,101 @@ namespace pico_ws2812
         a.set_wrgb_mode();
     };
 
-    struct RGB
-    {
-        uint8_t red;
-        uint8_t green;
-        uint8_t blue;
-    };
     template <class T>
     concept rgb_interface = requires(T a, RGB pixel) {
         a.put_pixel(pixel);
     };
 
-    struct WRGB
-    {
-        uint8_t white;
-        uint8_t red;
-        uint8_t green;
-        uint8_t blue;
-    };
     template <class T>
     concept wrgb_interface = requires(T a, WRGB pixel) {
         a.put_pixel(pixel);
     };
 
-    class PIO_NeoPixel_Driver final
+    template <pio_backend Backend>
+    class Basic_PIO_NeoPixel_Driver final : private Dma_Completion_Sink
     {
     public:
-        explicit PIO_NeoPixel_Driver(PIO pio_index, int state_machine_index, int gpio_pin) noexcept : m_pio{pio_index}, m_state_machine{state_machine_index}, m_pin{gpio_pin}
+        using Flush_Callback = void (*)(void *user_data);
+
+        template <class... Args>
+            requires std::constructible_from<Backend, Args...>
+        constexpr explicit Basic_PIO_NeoPixel_Driver(Args &&...backend_args) noexcept : m_backend{std::forward<Args>(backend_args)...}
+        {
+        }
+
+        constexpr void set_rgb_mode() noexcept
+        {
+            m_backend.init(false);
+        }
+        constexpr void set_wrgb_mode() noexcept
+        {
+            m_backend.init(true);
+        }
+
+        constexpr void put_pixel(uint32_t pixel_value) noexcept
         {
+            m_backend.put_blocking(pixel_value);
         }
 
-        void set_rgb_mode() noexcept
+        /**
+         * @brief hand a whole frame of packed pixel words to DMA, and return without waiting for the wire.
+         *  The words are read in place while the transfer is in flight, so the storage must outlive it.
+         * @return false, and nothing is sent, if the previous frame is still busy.
+         */
+        [[nodiscard]] constexpr bool flush(std::span<const uint32_t> frame) noexcept
         {
-            uint offset = pio_add_program(m_pio, &ws2812_program);
-            ws2812_program_init(m_pio, m_state_machine, offset, m_pin, 800000, false);
+            if (busy())
+            {
+                return false;
+            }
+            m_backend.start_dma(frame, *this);
+            return true;
         }
-        void set_wrgb_mode() noexcept
+
+        [[nodiscard]] constexpr bool busy() const noexcept
+        {
+            return m_backend.busy();
+        }
+
+        [[nodiscard]] constexpr uint32_t frames_flushed() const noexcept
+        {
+            return m_frames_flushed;
+        }
+
+        /**
+         * @brief called, from interrupt context, each time a flushed frame has been fed to the state machine
+         */
+        constexpr void set_flush_callback(Flush_Callback callback, void *user_data) noexcept
         {
-            uint offset = pio_add_program(m_pio, &ws2812_program);
-            ws2812_program_init(m_pio, m_state_machine, offset, m_pin, 800000, true);
+            m_callback = callback;
+            m_callback_data = user_data;
         }
 
-        void put_pixel(uint32_t pixel_value) noexcept
+        [[nodiscard]] constexpr Backend &backend() noexcept
         {
-            pio_sm_put_blocking(m_pio, m_state_machine, pixel_value);
+            return m_backend;
         }
 
     private:
-        PIO m_pio;
-        int m_state_machine;
-        int m_pin;
+        Backend m_backend;
+        Flush_Callback m_callback{nullptr};
+        void *m_callback_data{nullptr};
+        uint32_t m_frames_flushed{0};
+
+        constexpr void on_dma_complete() noexcept override
+        {
+            ++m_frames_flushed;
+            if (m_callback != nullptr)
+            {
+                m_callback(m_callback_data);
+            }
+        }
     };
 
+    using PIO_NeoPixel_Driver = Basic_PIO_NeoPixel_Driver<Pico_PIO_Backend>;
+    /* flush() takes Parallel_Frame::planes(), from transpose.hpp, rather than pixels */
+    using PIO_NeoPixel_Parallel_Driver = Basic_PIO_NeoPixel_Driver<Pico_PIO_Parallel_Backend>;
+
     template <string_interface Driver>
     class RGB_Driver final
     {
@@ -90,15 +139,13 @@ namespace pico_ws2812
             m_drv.put_pixel(rgb_u32(pixel));
         }
 
-    protected:
-        Driver &m_drv;
-
         [[nodiscard]] static constexpr uint32_t rgb_u32(RGB pixel) noexcept
         {
-            return (static_cast<uint32_t>(pixel.red) << 16) |
-                   (static_cast<uint32_t>(pixel.green) << 24) |
-                   (static_cast<uint32_t>(pixel.blue) << 8);
+            return Wire_Format<RGB>::pack(pixel);
         }
+
+    protected:
+        Driver &m_drv;
     };
 
     template <string_interface Driver>
@@ -119,16 +166,13 @@ namespace pico_ws2812
             m_drv.put_pixel(wrgb_u32(WRGB{.white{w}, .red{0}, .green{0}, .blue{0}}));
         }
 
-    private:
-        Driver &m_drv;
-
         [[nodiscard]] static constexpr uint32_t wrgb_u32(WRGB pixel) noexcept
         {
-            return (static_cast<uint32_t>(pixel.green) << 24) |
-                   (static_cast<uint32_t>(pixel.red) << 16) |
-                   (static_cast<uint32_t>(pixel.blue) << 8) |
-                   static_cast<uint32_t>(pixel.white);
+            return Wire_Format<WRGB>::pack(pixel);
         }
+
+    private:
+        Driver &m_drv;
     };
 
     template <rgb_interface Driver>
@@ -172,4 +216,125 @@ namespace pico_ws2812
     };
 }
 
+namespace tests
+{
+    /* Stands in for the PIO state machine and its DMA channel.  Nothing reaches `wire` until drain() plays the
+     * part of the TX DREQ, so a test can look at the driver while a frame is still in flight. */
+    template <size_t CAPACITY>
+    class Fake_PIO_Backend
+    {
+    public:
+        constexpr void init(bool rgbw) noexcept
+        {
+            m_rgbw = rgbw;
+        }
+        constexpr void put_blocking(uint32_t word) noexcept
+        {
+            push(word);
+        }
+        constexpr void start_dma(std::span<const uint32_t> words, pico_ws2812::Dma_Completion_Sink &sink) noexcept
+        {
+            m_pending = words;
+            m_sink = &sink;
+        }
+        [[nodiscard]] constexpr bool busy() const noexcept
+        {
+            return !m_pending.empty();
+        }
+
+        /* let the state machine pull up to `count` words out of the transfer in flight */
+        constexpr void drain(size_t count) noexcept
+        {
+            if (m_pending.empty())
+            {
+                return;
+            }
+            const auto moved{std::min(count, std::size(m_pending))};
+            for (const auto word : m_pending.first(moved))
+            {
+                push(word);
+            }
+            m_pending = m_pending.subspan(moved);
+            if (m_pending.empty())
+            {
+                m_sink->on_dma_complete();
+            }
+        }
+
+        [[nodiscard]] constexpr std::span<const uint32_t> wire() const noexcept
+        {
+            return std::span{m_wire}.first(m_wire_size);
+        }
+        [[nodiscard]] constexpr bool rgbw() const noexcept
+        {
+            return m_rgbw;
+        }
+
+    private:
+        std::array<uint32_t, CAPACITY> m_wire{};
+        size_t m_wire_size{0};
+        std::span<const uint32_t> m_pending{};
+        pico_ws2812::Dma_Completion_Sink *m_sink{nullptr};
+        bool m_rgbw{false};
+
+        constexpr void push(uint32_t word) noexcept
+        {
+            if (m_wire_size < CAPACITY)
+            {
+                m_wire[m_wire_size++] = word;
+            }
+        }
+    };
+
+    [[nodiscard]] constexpr bool run_dma_flush_tests()
+    {
+        bool rv{true};
+
+        pico_ws2812::Basic_PIO_NeoPixel_Driver<Fake_PIO_Backend<16>> dut;
+        dut.set_wrgb_mode();
+        rv &= dut.backend().rgbw();
+
+        const std::array<uint32_t, 4> frame{0x11223344, 0x55667788, 0x99AABBCC, 0xDDEEFF00};
+        const std::array<uint32_t, 2> second_frame{0xCAFEF00D, 0xDEADBEEF};
+
+        // =========================================
+        // flush returns before a single word has been put on the wire
+        rv &= !dut.busy();
+        rv &= dut.flush(frame);
+        rv &= dut.busy();
+        rv &= std::size(dut.backend().wire()) == 0;
+        rv &= dut.frames_flushed() == 0;
+
+        // can't start another frame while one is in flight
+        rv &= !dut.flush(second_frame);
+
+        dut.backend().drain(3);
+        rv &= dut.busy();
+        rv &= std::size(dut.backend().wire()) == 3;
+        rv &= dut.frames_flushed() == 0;
+
+        dut.backend().drain(3);
+        rv &= !dut.busy();
+        rv &= dut.frames_flushed() == 1;
+        rv &= std::ranges::equal(dut.backend().wire(), frame);
+
+        // =========================================
+        // the byte stream is exactly the frames, back to back
+        rv &= dut.flush(second_frame);
+        dut.backend().drain(std::size(second_frame));
+        rv &= !dut.busy();
+        rv &= dut.frames_flushed() == 2;
+        rv &= std::size(dut.backend().wire()) == std::size(frame) + std::size(second_frame);
+        rv &= std::ranges::equal(dut.backend().wire().last(2), second_frame);
+
+        // =========================================
+        // the blocking path still works
+        dut.put_pixel(0x01020304);
+        rv &= dut.backend().wire().back() == 0x01020304;
+
+        return rv;
+    }
+    static_assert(run_dma_flush_tests());
+}
+
 #endif
\ No newline at end of file